@@ -6,4 +6,6 @@
 #define VISMUT_VISMUT_H
 #include "types.h"
 
+#define VISMUT_VERSION "0.1.0"
+
 #endif //VISMUT_VISMUT_H
\ No newline at end of file
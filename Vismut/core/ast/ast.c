@@ -4,538 +4,328 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "../ansi_colors.h"
+#include "../errors/errors.h"
 #include "../hash/murmur3.h"
+#include "../memory/array.h"
 
-static void ASTNode_PrintNode(const ASTNode *, int, FILE *);
+#define AST_MODULE_INITIAL_PAGES 4
+#define AST_MODULE_INITIAL_LIST_ITEMS 256
 
-void ASTNode_Print(const ASTNode *node, FILE *file) {
-    ASTNode_PrintNode(node, 0, file);
-}
+FunctionSignature *FindFunctionSignature(const ASTModule *module, const uint8_t *function_name) {
+    const uint32_t function_name_hash = murmurhash3_string(function_name, MURMURHASH3_DEFAULT_STR_SEED);
 
-static void print_value(FILE *file, const VValue *value) {
-    if (!value) {
-        fprintf(file, "<NULL>");
-        return;
-    }
+    return FunctionTable_Find(module->function_table, function_name, function_name_hash);
+}
 
-    switch (value->type) {
-        case VALUE_VOID:
-            FPRINT_COLOR(file, ANSI_BRIGHT_MAGENTA_FG, "void");
-            break;
-        case VALUE_AUTO:
-            FPRINT_COLOR(file, ANSI_BRIGHT_MAGENTA_FG, "auto");
-            break;
-        case VALUE_I64:
-            FPRINTF_COLOR(file, ANSI_BRIGHT_BLUE_FG, "%lld", value->i64);
-            break;
-        case VALUE_F64:
-            FPRINTF_COLOR(file, ANSI_BRIGHT_BLUE_FG, "%f", value->f64);
-            break;
-        case VALUE_STR: {
-            SET_FILE_COLOR(file, ANSI_GREEN_FG);
-            putc('"', file);
-            const uint8_t *ptr = value->str;
-            const uint8_t *end = value->str + strlen((const char *) value->str);
-            while (ptr != end) {
-                const uint8_t c = *ptr;
-                switch (c) {
-                    case '\n':
-                        FPRINT_COLOR(file, ANSI_BLUE_FG, "\\n");
-                        SET_FILE_COLOR(file, ANSI_GREEN_FG);
-                        break;
-                    case '\r':
-                        FPRINT_COLOR(file, ANSI_BLUE_FG, "\\r");
-                        SET_FILE_COLOR(file, ANSI_GREEN_FG);
-                        break;
-                    case '\t':
-                        FPRINT_COLOR(file, ANSI_BLUE_FG, "\\t");
-                        SET_FILE_COLOR(file, ANSI_GREEN_FG);
-                        break;
-                    case '\b':
-                        FPRINT_COLOR(file, ANSI_BLUE_FG, "\\b");
-                        SET_FILE_COLOR(file, ANSI_GREEN_FG);
-                        break;
-                    case '\v':
-                        FPRINT_COLOR(file, ANSI_BLUE_FG, "\\v");
-                        SET_FILE_COLOR(file, ANSI_GREEN_FG);
-                        break;
-                    default:
-                        putc(c, file);
-                        break;
-                }
-                ++ptr;
-            }
-            putc('"', file);
-            RESET_FILE_COLOR(file);
-            break;
-        }
+bool IsNodePure(const ASTNode *node) {
+    switch (node->type) {
+        case AST_BINARY:
+            return node->binary_op.is_pure;
+        case AST_UNARY:
+            return node->unary_op.is_pure;
+        case AST_TERNARY:
+            return node->ternary_op.is_pure;
+        case AST_TYPE_CAST:
+            return node->type_cast.is_pure;
+        case AST_FUNCTION_CALL:
+            return (node->flags & AST_NODE_FLAG_PURE_CALL) != 0;
         default:
-            fprintf(file, "<unknown value type>");
+            return true;
     }
 }
 
-static void print_indent(FILE *file, const int ident) {
-    for (int i = 0; i < ident; ++i) {
-        if (i % 2 == 0) {
-            FPRINT_COLOR(file, ANSI_WHITE_FG, "|   ");
-        } else {
-            FPRINT_3COLOR(file, ANSI_WHITE_FG, ANSI_BLACK_BG, ANSI_UNDERLINE, "|");
-            FPRINT_COLOR(file, ANSI_WHITE_FG, "   ");
-        }
+static void ASTModule_AddPage(ASTModule *module) {
+    if (module->pages_count == module->pages_capacity) {
+        const uint32_t new_capacity = module->pages_capacity * 2;
+        ASTNode **node_pages = Arena_Array(module->arena, ASTNode *, new_capacity);
+        ASTNodePosition **position_pages = Arena_Array(module->arena, ASTNodePosition *, new_capacity);
+        memcpy(node_pages, module->node_pages, module->pages_count * sizeof(*node_pages));
+        memcpy(position_pages, module->position_pages, module->pages_count * sizeof(*position_pages));
+        module->node_pages = node_pages;
+        module->position_pages = position_pages;
+        module->pages_capacity = new_capacity;
     }
+
+    module->node_pages[module->pages_count] = Arena_Array(module->arena, ASTNode, AST_NODE_PAGE_SIZE);
+    module->position_pages[module->pages_count] = Arena_Array(module->arena, ASTNodePosition, AST_NODE_PAGE_SIZE);
+    ++module->pages_count;
 }
 
-#define PRINT_EXPR_TYPE(FILE, EXPR_TYPE) \
-    START_BLOCK_WRAPPER \
-        FPRINT_COLOR(FILE, ANSI_BRIGHT_BLACK_FG, " (");\
-        FPRINT_COLOR(FILE, ANSI_CYAN_FG, VValueType_String(EXPR_TYPE));\
-        FPRINT_COLOR(FILE, ANSI_BRIGHT_BLACK_FG, ")");\
-    END_BLOCK_WRAPPER
-
-#define PRINT_PURE(FILE, IS_PURE) \
-    START_BLOCK_WRAPPER \
-        if (IS_PURE) { \
-            FPRINT_COLOR(FILE, ANSI_GREEN_FG, " pure"); \
-        } else { \
-            FPRINT_COLOR(FILE, ANSI_RED_FG, " !pure"); \
-        } \
-    END_BLOCK_WRAPPER
-
-#define PRINT_NODE_POS(FILE, node_ptr) \
-    START_BLOCK_WRAPPER \
-        FPRINTF_COLOR(FILE, ANSI_BRIGHT_BLACK_FG, " [%zu-%zu]\n", (node_ptr)->pos.offset, (node_ptr)->pos.offset + (node_ptr)->pos.length); \
-    END_BLOCK_WRAPPER
-
-#define PRINT_LABEL(file, LABEL) \
-    FPRINT_COLOR(file, ANSI_YELLOW_FG, LABEL);
-
-#define PRINT_FUNCTION_PARAM(FILE, PARAMS_PTR) \
-    START_BLOCK_WRAPPER \
-        FPRINT_COLOR(FILE, ANSI_YELLOW_FG, (const char*) (PARAMS_PTR).param_names[i]); \
-        FPRINT_COLOR(FILE, ANSI_BRIGHT_BLACK_FG, ": "); \
-        FPRINT_COLOR(FILE, ANSI_BLUE_FG, VValueType_String((PARAMS_PTR).param_types[i])); \
-    END_BLOCK_WRAPPER
-
-static void ASTNode_PrintNode(const ASTNode *node, const int depth, FILE *file) {
-    if (!node) {
-        print_indent(file, depth);
-        fprintf(file, "<NULL>\n");
-        return;
+static ASTNodeId ASTModule_AllocateNode(ASTModule *module, const ASTNodeType type, const Position pos,
+                                        const VValueType expr_type) {
+    if (unlikely(module->nodes_count == module->pages_count * AST_NODE_PAGE_SIZE)) {
+        ASTModule_AddPage(module);
     }
 
-    print_indent(file, depth);
+    const ASTNodeId id = module->nodes_count++;
+    *AST_NODE(module, id) = (ASTNode){
+        .type = type,
+        .expr_type = expr_type,
+        .flags = 0,
+    };
+    ASTNode_SetPosition(module, id, pos);
+    return id;
+}
 
+ASTModule *ASTModule_Create(Arena *arena, const uint8_t *module_name, Scope *scope) {
+    ASTModule *module = Arena_Type(arena, ASTModule);
+    *module = (ASTModule){
+        .arena = arena,
+        .node_pages = Arena_Array(arena, ASTNode *, AST_MODULE_INITIAL_PAGES),
+        .position_pages = Arena_Array(arena, ASTNodePosition *, AST_MODULE_INITIAL_PAGES),
+        .pages_count = 0,
+        .pages_capacity = AST_MODULE_INITIAL_PAGES,
+        .nodes_count = 0,
+        .list_items = Arena_Array(arena, ASTNodeId, AST_MODULE_INITIAL_LIST_ITEMS),
+        .list_items_count = 0,
+        .list_items_capacity = AST_MODULE_INITIAL_LIST_ITEMS,
+        .root = AST_NODE_NONE,
+        .module_name = module_name,
+        .scope = scope,
+        .function_table = FunctionTable_Allocate(arena),
+    };
 
-    FPRINT_COLOR(file, ANSI_BRIGHT_MAGENTA_FG, ASTNodeType_String(node->type));
-    switch (node->type) {
-        case AST_LITERAL:
-            putc(' ', file);
-            print_value(file, &node->literal);
-            PRINT_EXPR_TYPE(file, node->literal.type);
-            PRINT_NODE_POS(file, node);
-            break;
-
-        case AST_VAR_REF:
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_YELLOW_FG,
-                         node->var_ref.var_name ? (const char *) node->var_ref.var_name : "<NULL>");
-            PRINT_EXPR_TYPE(file, node->var_ref.expr_type);
-            PRINT_NODE_POS(file, node);
-            break;
+    // Id 0 is reserved for AST_NODE_NONE
+    ASTModule_AllocateNode(module, AST_UNKNOWN, (Position){0}, VALUE_UNKNOWN);
 
-        case AST_BINARY:
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_GREEN_FG, ASTBinaryType_String(node->binary_op.op));
-            PRINT_EXPR_TYPE(file, node->binary_op.expr_type);
-            PRINT_PURE(file, node->binary_op.is_pure);
-            PRINT_NODE_POS(file, node);
-            print_indent(file, depth + 1);
-            PRINT_LABEL(file, "left\n");
-            ASTNode_PrintNode((const ASTNode *) node->binary_op.left, depth + 2, file);
-            print_indent(file, depth + 1);
-            PRINT_LABEL(file, "right\n");
-            ASTNode_PrintNode((const ASTNode *) node->binary_op.right, depth + 2, file);
-            break;
+    module->root = ASTModule_AllocateNode(module, AST_MODULE, (Position){0}, VALUE_VOID);
+    AST_NODE(module, module->root)->module.statements = (ASTNodeList){0};
+    AST_NODE(module, module->root)->module.functions = (ASTNodeList){0};
+    return module;
+}
 
-        case AST_UNARY:
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_GREEN_FG, ASTUnaryType_String(node->unary_op.op));
-            PRINT_EXPR_TYPE(file, node->unary_op.expr_type);
-            PRINT_PURE(file, node->unary_op.is_pure);
-            PRINT_NODE_POS(file, node);
-            ASTNode_PrintNode((const ASTNode *) node->unary_op.operand, depth + 1, file);
-            break;
+ASTNodeList ASTModule_AllocateList(ASTModule *module, const uint32_t count) {
+    if (unlikely(module->list_items_count + count > module->list_items_capacity)) {
+        uint32_t new_capacity = module->list_items_capacity * 2;
+        while (new_capacity < module->list_items_count + count) {
+            new_capacity *= 2;
+        }
+        ASTNodeId *list_items = Arena_Array(module->arena, ASTNodeId, new_capacity);
+        memcpy(list_items, module->list_items, module->list_items_count * sizeof(*list_items));
+        module->list_items = list_items;
+        module->list_items_capacity = new_capacity;
+    }
 
-        case AST_TERNARY:
-            PRINT_EXPR_TYPE(file, node->ternary_op.expr_type);
-            PRINT_PURE(file, node->ternary_op.is_pure);
-            PRINT_NODE_POS(file, node);
-            ASTNode_PrintNode((const ASTNode *) node->ternary_op.condition, depth + 1, file);
-
-            print_indent(file, depth + 1);
-            PRINT_LABEL(file, "then\n");
-            ASTNode_PrintNode((const ASTNode *) node->ternary_op.then_expression, depth + 2, file);
-
-            print_indent(file, depth + 1);
-            PRINT_LABEL(file, "else\n");
-            ASTNode_PrintNode((const ASTNode *) node->ternary_op.else_expression, depth + 2, file);
-            break;
-
-        case AST_VAR_DECL:
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_YELLOW_FG,
-                         node->var_decl.var_name ? (const char *) node->var_decl.var_name : "<NULL>");
-            PRINT_EXPR_TYPE(file, node->var_decl.var_type);
-            PRINT_NODE_POS(file, node);
-            if (node->var_decl.init_value) {
-                print_indent(file, depth + 1);
-                PRINT_LABEL(file, "init");
-                PRINT_EXPR_TYPE(file, node->var_decl.init_value_type);
-                fprintf(file, "\n");
-                ASTNode_PrintNode((const ASTNode *) node->var_decl.init_value, depth + 2, file);
-            }
-            break;
-
-        case AST_BLOCK:
-            PRINT_NODE_POS(file, node);
-            if (node->block.statements) {
-                const ASTNode *stmt = (const ASTNode *) node->module.statements;
-                while (stmt) {
-                    ASTNode_PrintNode(stmt, depth + 1, file);
-                    stmt = (const ASTNode *) stmt->next_node;
-                }
-            }
-            break;
-
-        case AST_IF_STMT:
-            PRINT_NODE_POS(file, node);
-            ASTNode_PrintNode((const ASTNode *) node->if_stmt.condition, depth + 1, file);
-            print_indent(file, depth + 1);
-            PRINT_LABEL(file, "then\n");
-            ASTNode_PrintNode((const ASTNode *) node->if_stmt.then_block, depth + 2, file);
-            if (node->if_stmt.else_block) {
-                print_indent(file, depth + 1);
-                PRINT_LABEL(file, "else\n");
-                ASTNode_PrintNode((const ASTNode *) node->if_stmt.else_block, depth + 2, file);
-            }
-            break;
-
-        case AST_WHILE_STMT:
-            PRINT_NODE_POS(file, node);
-            ASTNode_PrintNode((const ASTNode *) node->while_stmt.condition, depth + 1, file);
-            print_indent(file, depth + 1);
-            PRINT_LABEL(file, "body\n");
-            ASTNode_PrintNode((const ASTNode *) node->while_stmt.body, depth + 2, file);
-            break;
+    const ASTNodeList list = {.start = module->list_items_count, .count = count};
+    module->list_items_count += count;
+    return list;
+}
 
-        case AST_TYPE_CAST:
-            PRINT_EXPR_TYPE(file, node->type_cast.from_type);
-            FPRINT_COLOR(file, ANSI_BRIGHT_YELLOW_FG, " ->");
-            PRINT_EXPR_TYPE(file, node->type_cast.target_type);
-            PRINT_PURE(file, node->type_cast.is_pure);
-            PRINT_NODE_POS(file, node);
-            ASTNode_PrintNode((const ASTNode *) node->type_cast.expression, depth + 1, file);
-            break;
-
-        case AST_PRINT_STMT:
-            PRINT_NODE_POS(file, node);
-            for (const ASTNode *current = (ASTNode *) node->print_stmt.expressions; current != NULL;
-                 current = (ASTNode *) current->next_node) {
-                ASTNode_PrintNode(current, depth + 1, file);
-            }
-            break;
-
-        case AST_MODULE:
-            putc(' ', file);
-            FPRINT_2COLOR(file, ANSI_BLACK_FG, ANSI_WHITE_BG,
-                          node->module.module_name ? (char *) node->module.module_name : "<unnamed>");
-            PRINT_NODE_POS(file, node);
-
-            if (node->module.functions) {
-                print_indent(file, depth + 1);
-                FPRINT_3COLOR(file, ANSI_WHITE_FG, ANSI_BLACK_BG, ANSI_UNDERLINE, "functions");
-                fprintf(file, "\n");
-                for (const ASTNode *current = (ASTNode *) node->module.functions; current != NULL;
-                     current = (ASTNode *) current->next_node) {
-                    ASTNode_PrintNode(current, depth + 2, file);
-                }
-            }
-            if (node->module.statements) {
-                print_indent(file, depth + 1);
-                FPRINT_3COLOR(file, ANSI_WHITE_FG, ANSI_BLACK_BG, ANSI_UNDERLINE, "statements");
-                fprintf(file, "\n");
-                for (const ASTNode *current = (ASTNode *) node->module.statements; current != NULL;
-                     current = (ASTNode *) current->next_node) {
-                    ASTNode_PrintNode(current, depth + 2, file);
-                }
-            }
-            break;
-        case AST_UNKNOWN:
-            fprintf(file, " \n");
-            break;
-        case AST_FUNCTION_DECL:
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_YELLOW_FG, (const char*)node->function_decl.signature->function_name);
-            PRINT_EXPR_TYPE(file, node->function_decl.signature->return_type);
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_BLACK_FG, "[");
-            const size_t params_count = node->function_decl.signature->params.params_count;
-            for (size_t i = 0; i < params_count; ++i) {
-                PRINT_FUNCTION_PARAM(file, node->function_decl.signature->params);
-                if (i + 1 < params_count) {
-                    FPRINT_COLOR(file, ANSI_BRIGHT_BLACK_FG, ", ");
-                }
-            }
-            FPRINT_COLOR(file, ANSI_BRIGHT_BLACK_FG, "]");
-            putc('\n', file);
-            ASTNode_PrintNode((const ASTNode *) node->function_decl.body, depth + 1, file);
-            break;
-        case AST_FUNCTION_CALL: {
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_YELLOW_FG, (const char*)node->function_call.signature->function_name);
-            PRINT_EXPR_TYPE(file, node->function_call.expr_type);
-
-            putc(' ', file);
-            FPRINT_COLOR(file, ANSI_BRIGHT_BLACK_FG, "[");
-            const size_t arguments_count = node->function_decl.signature->params.params_count;
-            for (size_t i = 0; i < arguments_count; ++i) {
-                PRINT_FUNCTION_PARAM(file, node->function_decl.signature->params);
-                if (i + 1 < arguments_count) {
-                    FPRINT_COLOR(file, ANSI_BRIGHT_BLACK_FG, ", ");
-                }
-            }
-            FPRINT_COLOR(file, ANSI_BRIGHT_BLACK_FG, "]");
-            fputc('\n', file);
-            const ASTNode *argument = (const ASTNode *) node->function_call.arguments;
-            for (const ASTNode *current = argument; current != NULL;
-                 current = (const ASTNode *) current->next_node) {
-                ASTNode_PrintNode(current, depth + 1, file);
-            }
-        }
-        break;
-        case AST_COUNT:
-        default:
-            fprintf(file, " <unhandled node type>\n");
-            break;
+ASTNodeList ASTModule_CreateList(ASTModule *module, const ASTNodeId *items, const uint32_t count) {
+    const ASTNodeList list = ASTModule_AllocateList(module, count);
+    if (count != 0) {
+        memcpy(&AST_LIST_ITEM(module, list, 0), items, count * sizeof(*items));
     }
+    return list;
 }
 
-FunctionSignature *FindFunctionSignature(const ASTNode *module, const uint8_t *function_name) {
-    DEBUG_ASSERT(module->type == AST_MODULE);
+ASTNodeId ASTModule_AppendNode(ASTModule *module, const ASTNode *node, const Position pos) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, node->type, pos, node->expr_type);
+    *AST_NODE(module, id) = *node;
+    return id;
+}
 
-    const uint32_t function_name_hash = murmurhash3_string(function_name, MURMURHASH3_DEFAULT_STR_SEED);
+Position ASTNode_Position(const ASTModule *module, const ASTNodeId node) {
+    const ASTNodePosition pos = module->position_pages[node >> AST_NODE_PAGE_SHIFT][node & AST_NODE_PAGE_MASK];
+    return (Position){pos.offset, pos.length};
+}
 
-    const ASTNode *functions = (const ASTNode *) module->module.functions;
-    for (const ASTNode *current = functions; current != NULL; current = (const ASTNode *) current->next_node) {
-        if (current->function_decl.signature->function_name_hash == function_name_hash
-            && strcmp((const char *) current->function_decl.signature->function_name, (const char *) function_name) == 0
-        ) {
-            return current->function_decl.signature;
-        }
-    }
+void ASTNode_SetPosition(ASTModule *module, const ASTNodeId node, const Position pos) {
+    module->position_pages[node >> AST_NODE_PAGE_SHIFT][node & AST_NODE_PAGE_MASK] = (ASTNodePosition){
+        .offset = (uint32_t) pos.offset,
+        .length = (uint32_t) pos.length,
+    };
+}
 
-    return NULL;
+ASTNodeId CreateLiteralNode(ASTModule *module, const Position pos, const VValue value) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_LITERAL, pos, value.type);
+    AST_NODE(module, id)->literal = value;
+    return id;
 }
 
-ASTNode *CreateLiteralNode(Arena *arena, const Position pos, const VValue value) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_LITERAL,
-        .pos = pos,
-        .next_node = NULL,
-        .literal = value,
-    };
-    return node;
+ASTNodeId CreateVarRefNode(ASTModule *module, const Position pos, const uint8_t *var_name) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_VAR_REF, pos, VALUE_AUTO);
+    ASTNode *node = AST_NODE(module, id);
+    node->var_ref.var_name = var_name;
+    node->var_ref.symbol = NULL;
+    return id;
 }
 
-ASTNode *CreateVarRefNode(Arena *arena, const Position pos, const uint8_t *var_name) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_VAR_REF,
-        .pos = pos,
-        .next_node = NULL,
-        .var_ref = {
-            .var_name = var_name,
-            .expr_type = VALUE_AUTO,
-        },
-    };
-    return node;
+ASTNodeId CreateBinaryNode(ASTModule *module, const Position pos, const ASTNodeId left, const ASTNodeId right,
+                           const ASTBinaryType op, const bool is_pure) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_BINARY, pos, VALUE_AUTO);
+    ASTNode *node = AST_NODE(module, id);
+    node->binary_op.left = left;
+    node->binary_op.right = right;
+    node->binary_op.op = op;
+    node->binary_op.is_pure = is_pure;
+    return id;
 }
 
-ASTNode *CreateBinaryNode(Arena *arena, const Position pos, const ASTNode *left, const ASTNode *right,
-                          const ASTBinaryType op, const bool is_pure) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_BINARY,
-        .pos = pos,
-        .next_node = NULL,
-        .binary_op = {
-            .left = (struct ASTNode *) left,
-            .right = (struct ASTNode *) right,
-            .expr_type = VALUE_AUTO,
-            .op = op,
-            .is_pure = is_pure,
-        },
-    };
-    return node;
+ASTNodeId CreateUnaryNode(ASTModule *module, const Position pos, const ASTNodeId operand, const ASTUnaryType op,
+                          const bool is_pure) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_UNARY, pos, VALUE_AUTO);
+    ASTNode *node = AST_NODE(module, id);
+    node->unary_op.operand = operand;
+    node->unary_op.op = op;
+    node->unary_op.is_pure = is_pure;
+    return id;
 }
 
-ASTNode *CreateUnaryNode(Arena *arena, const Position pos, const ASTNode *operand, const ASTUnaryType op,
-                         const bool is_pure) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_UNARY,
-        .pos = pos,
-        .next_node = NULL,
-        .unary_op = {
-            .operand = (struct ASTNode *) operand,
-            .expr_type = VALUE_AUTO,
-            .op = op,
-            .is_pure = is_pure,
-        },
-    };
-    return node;
+ASTNodeId CreateIfStatementNode(ASTModule *module, const Position pos, const ASTNodeId condition,
+                                const ASTNodeId then_block, const ASTNodeId else_block) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_IF_STMT, pos, VALUE_VOID);
+    ASTNode *node = AST_NODE(module, id);
+    node->if_stmt.condition = condition;
+    node->if_stmt.then_block = then_block;
+    node->if_stmt.else_block = else_block;
+    return id;
 }
 
-ASTNode *CreateIfStatementNode(Arena *arena, const Position pos, const ASTNode *condition,
-                               const ASTNode *then_block, const ASTNode *else_block) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_IF_STMT,
-        .pos = pos,
-        .next_node = NULL,
-        .if_stmt = {
-            .condition = (struct ASTNode *) condition,
-            .then_block = (struct ASTNode *) then_block,
-            .else_block = (struct ASTNode *) else_block,
-        },
-    };
-    return node;
+ASTNodeId CreateWhileStatementNode(ASTModule *module, const Position pos, const ASTNodeId condition,
+                                   const ASTNodeId body) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_WHILE_STMT, pos, VALUE_VOID);
+    ASTNode *node = AST_NODE(module, id);
+    node->while_stmt.condition = condition;
+    node->while_stmt.body = body;
+    return id;
 }
 
-ASTNode *CreateWhileStatementNode(Arena *arena, const Position pos, const ASTNode *condition, const ASTNode *body) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_WHILE_STMT,
-        .pos = pos,
-        .next_node = NULL,
-        .while_stmt = {
-            .condition = (struct ASTNode *) condition,
-            .body = (struct ASTNode *) body,
-        },
-    };
-    return node;
+ASTNodeId CreateVarDeclarationNode(ASTModule *module, const Position pos, const uint8_t *var_name,
+                                   const VValueType var_type, const ASTNodeId init_value) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_VAR_DECL, pos, VALUE_VOID);
+    ASTNode *node = AST_NODE(module, id);
+    node->var_decl.symbol = Symbol_Create(module->arena, var_name);
+    node->var_decl.init_value = init_value;
+    node->var_decl.var_type = var_type;
+    return id;
 }
 
-ASTNode *CreateVarDeclarationNode(Arena *arena, const Position pos, const uint8_t *var_name,
-                                  const VValueType var_type, const ASTNode *init_value) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_VAR_DECL,
-        .pos = pos,
-        .next_node = NULL,
-        .var_decl = {
-            .var_name = var_name,
-            .var_type = var_type,
-            .init_value_type = VALUE_AUTO,
-            .init_value = (struct ASTNode *) init_value,
-        },
-    };
-    return node;
+ASTNodeId CreateVarReadNode(ASTModule *module, const Position pos, Symbol *symbol) {
+    const ASTNodeId id = CreateVarRefNode(module, pos, symbol->name);
+    ASTNode *node = AST_NODE(module, id);
+    node->expr_type = (uint8_t) symbol->value.type;
+    node->var_ref.symbol = symbol;
+    Symbol_AddUse(module->arena, symbol, id, true);
+    return id;
 }
 
-ASTNode *CreateTypeCastNode(Arena *arena, const Position pos, ASTNode *expression, const VValueType target_type
-                            /*, const bool is_explicit*/) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_TYPE_CAST,
-        .pos = pos,
-        .next_node = NULL,
-        .type_cast = {
-            .expression = (struct ASTNode *) expression,
-            .target_type = target_type,
-            .from_type = VALUE_AUTO,
-            .is_explicit = true,
-            .is_pure = true,
-        },
+ASTNodeId ASTTemporaries_Declare(ASTTemporaries *temporaries, ASTModule *module, const ASTNodeId block,
+                                 const uint32_t index, const ASTNodeId value) {
+    const Position pos = ASTNode_Position(module, value);
+    const VValueType type = AST_NODE(module, value)->expr_type;
+
+    uint8_t *name = Arena_Array(module->arena, uint8_t, AST_TEMPORARY_NAME_SIZE);
+    snprintf((char *) name, AST_TEMPORARY_NAME_SIZE, "%s%u", temporaries->prefix, temporaries->created++);
+
+    const ASTNodeId declaration = CreateVarDeclarationNode(module, pos, name, type, value);
+    Symbol *symbol = AST_NODE(module, declaration)->var_decl.symbol;
+    symbol->value.type = type;
+    symbol->declaration = declaration;
+    symbol->flags |= SYMBOL_FLAG_INITIALIZED;
+
+    temporaries->items = Array_Grow(temporaries->items, &temporaries->capacity, temporaries->count + 1,
+                                    sizeof(*temporaries->items));
+    temporaries->items[temporaries->count++] = (ASTTemporary){
+        .block = block,
+        .index = index,
+        .declaration = declaration,
     };
-    return node;
+    return CreateVarReadNode(module, pos, symbol);
 }
 
-ASTNode *CreateTernaryNode(Arena *arena, const Position pos, const ASTNode *condition,
-                           const ASTNode *then_expression, const ASTNode *else_expression) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_TERNARY,
-        .pos = pos,
-        .next_node = NULL,
-        .ternary_op = {
-            .condition = (struct ASTNode *) condition,
-            .then_expression = (struct ASTNode *) then_expression,
-            .else_expression = (struct ASTNode *) else_expression,
-            .expr_type = VALUE_AUTO,
-            .is_pure = true,
-        },
-    };
-    return node;
+void ASTTemporaries_Insert(ASTTemporaries *temporaries, ASTModule *module, const ASTNodeId block_id) {
+    uint32_t first = temporaries->count;
+    while (first > 0 && temporaries->items[first - 1].block == block_id) {
+        --first;
+    }
+    if (first == temporaries->count) {
+        return;
+    }
+
+    ASTNode *block = AST_NODE(module, block_id);
+    ASTNodeList *statements = block->type == AST_BLOCK ? &block->block.statements : &block->module.statements;
+    const uint32_t count = statements->count + temporaries->count - first;
+    ASTNodeId *items = malloc(sizeof(*items) * count);
+    if (items == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+
+    uint32_t items_count = 0;
+    uint32_t temporary = first;
+    for (uint32_t i = 0; i < statements->count; ++i) {
+        while (temporary < temporaries->count && temporaries->items[temporary].index == i) {
+            items[items_count++] = temporaries->items[temporary++].declaration;
+        }
+        items[items_count++] = AST_LIST_ITEM(module, *statements, i);
+    }
+    DEBUG_ASSERT(items_count == count);
+
+    *statements = ASTModule_CreateList(module, items, items_count);
+    free(items);
+    temporaries->count = first;
 }
 
-ASTNode *CreateModuleNode(Arena *arena, const uint8_t *module_name, Scope *scope) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_MODULE,
-        .pos = (Position){0},
-        .next_node = NULL,
-        .module = {
-            .statements = NULL,
-            .functions = NULL,
-            .module_name = module_name,
-            .scope = scope,
-        },
-    };
-    return node;
+void ASTTemporaries_Free(ASTTemporaries *temporaries) {
+    free(temporaries->items);
+    temporaries->items = NULL;
+    temporaries->count = 0;
+    temporaries->capacity = 0;
 }
 
-ASTNode *CreateBlockNode(Arena *arena, const Position pos, ASTNode *statements, Scope *scope) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_BLOCK,
-        .pos = pos,
-        .next_node = NULL,
-        .block = {
-            .statements = (struct ASTNode *) statements,
-            .scope = scope,
-        },
-    };
-    return node;
+ASTNodeId CreateTypeCastNode(ASTModule *module, const Position pos, const ASTNodeId expression,
+                             const VValueType target_type /*, const bool is_explicit*/) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_TYPE_CAST, pos, target_type);
+    ASTNode *node = AST_NODE(module, id);
+    node->type_cast.expression = expression;
+    node->type_cast.target_type = target_type;
+    node->type_cast.from_type = VALUE_AUTO;
+    node->type_cast.is_explicit = true;
+    node->type_cast.is_pure = true;
+    return id;
 }
 
-ASTNode *CreatePrintStatementNode(Arena *arena, const Position pos, ASTNode *expressions) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_PRINT_STMT,
-        .pos = pos,
-        .next_node = NULL,
-        .print_stmt = {
-            .expressions = (struct ASTNode *) expressions,
-        },
-    };
-    return node;
+ASTNodeId CreateTernaryNode(ASTModule *module, const Position pos, const ASTNodeId condition,
+                            const ASTNodeId then_expression, const ASTNodeId else_expression) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_TERNARY, pos, VALUE_AUTO);
+    ASTNode *node = AST_NODE(module, id);
+    node->ternary_op.condition = condition;
+    node->ternary_op.then_expression = then_expression;
+    node->ternary_op.else_expression = else_expression;
+    node->ternary_op.is_pure = true;
+    return id;
 }
 
-ASTNode *CreateFunctionDeclarationNode(Arena *arena, const Position pos, FunctionSignature *signature, ASTNode *body,
-                                       Scope *scope) {
-    ASTNode *node = Arena_Type(arena, ASTNode);
-    *node = (ASTNode){
-        .type = AST_FUNCTION_DECL,
-        .pos = pos,
-        .next_node = NULL,
-        .function_decl = {
-            .signature = signature,
-            .body = (struct ASTNode *) body,
-            .scope = scope,
-        },
-    };
-    return node;
+ASTNodeId CreateBlockNode(ASTModule *module, const Position pos, const ASTNodeList statements, Scope *scope) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_BLOCK, pos, VALUE_VOID);
+    ASTNode *node = AST_NODE(module, id);
+    node->block.statements = statements;
+    node->block.scope = scope;
+    return id;
+}
+
+ASTNodeId CreatePrintStatementNode(ASTModule *module, const Position pos, const ASTNodeList expressions) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_PRINT_STMT, pos, VALUE_VOID);
+    AST_NODE(module, id)->print_stmt.expressions = expressions;
+    return id;
+}
+
+ASTNodeId CreateFunctionDeclarationNode(ASTModule *module, const Position pos, FunctionSignature *signature,
+                                        const ASTNodeId body, Scope *scope) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_FUNCTION_DECL, pos, VALUE_VOID);
+    ASTNode *node = AST_NODE(module, id);
+    node->function_decl.signature = signature;
+    node->function_decl.body = body;
+    signature->scope = scope;
+    signature->declaration = id;
+    return id;
+}
+
+ASTNodeId CreateFunctionCallNode(ASTModule *module, const Position pos, FunctionSignature *signature,
+                                 const ASTNodeList arguments) {
+    const ASTNodeId id = ASTModule_AllocateNode(module, AST_FUNCTION_CALL, pos, VALUE_AUTO);
+    ASTNode *node = AST_NODE(module, id);
+    node->function_call.signature = signature;
+    node->function_call.arguments = arguments;
+    return id;
 }
@@ -7,8 +7,20 @@
 #include "../types.h"
 #include "value.h"
 #include "scope.h"
+#include "function_table.h"
 #include <stdbool.h>
 
+#define FUNCTION_FLAG_PREDECLARED         (1 << 0)
+#define FUNCTION_FLAG_UNCHANGED           (1 << 3) // same text as in the previous build
+#define FUNCTION_FLAG_REUSED              (1 << 4) // body copied from the previous build, analyzed and optimized
+#define FUNCTION_FLAG_PURE                (1 << 5) // no side effects, see ASTModule_InferPurity
+#define FUNCTION_FLAG_INLINED             (1 << 6) // calls inlined or evaluated into the body, which no longer names its callees
+
+// Bits of FunctionSignature.analysis. Only the worker analyzing the function writes them, callers on other
+// workers read its flags meanwhile
+#define FUNCTION_ANALYSIS_RUNNING         (1 << 0)
+#define FUNCTION_ANALYSIS_DONE            (1 << 1)
+
 typedef struct FunctionParamNode {
     struct FunctionParamNode *next;
     const uint8_t *name;
@@ -21,95 +33,108 @@ typedef struct {
     size_t params_count;
 } FunctionParams;
 
-typedef struct {
+typedef struct tag_FunctionSignature {
     FunctionParams params;
     const uint8_t *function_name;
+    Scope *scope; // holds the params, parent of the body scope
+    Position span; // source of a top-level declaration, from its '$' to the end of its body
+    uint32_t span_hash[2];
+    ASTNodeId declaration;
     uint32_t function_name_hash;
     VValueType return_type;
     int flags;
+    uint8_t analysis;
 } FunctionSignature;
 
+#define AST_NODE_NONE ((ASTNodeId) 0)
+
+#define AST_NODE_FLAG_ASSIGN_TARGET       (1 << 0)
+#define AST_NODE_FLAG_PURE_CALL           (1 << 1) // call of a pure function with pure arguments
+
+// Nodes live in fixed-size pages: ids stay dense while ASTNode pointers survive the storage growth
+#define AST_NODE_PAGE_SHIFT 10
+#define AST_NODE_PAGE_SIZE (1u << AST_NODE_PAGE_SHIFT)
+#define AST_NODE_PAGE_MASK (AST_NODE_PAGE_SIZE - 1)
+
+// A run of count node ids stored contiguously in ASTModule.list_items
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+} ASTNodeList;
+
 typedef struct {
-    ASTNodeType type;
-    Position pos;
-    struct ASTNode *next_node;
+    uint8_t type; // ASTNodeType
+    uint8_t expr_type; // VValueType of an expression node, VALUE_AUTO until analyzed
+    uint8_t flags;
 
     union {
         VValue literal;
 
         struct {
             const uint8_t *var_name;
-            VValueType expr_type;
+            Symbol *symbol;
         } var_ref;
 
         struct {
-            const uint8_t *var_name;
+            Symbol *symbol;
+            ASTNodeId init_value;
             VValueType var_type;
-            VValueType init_value_type;
-            struct ASTNode *init_value;
         } var_decl;
 
         struct {
             FunctionSignature *signature;
-            const struct ASTNode *arguments;
-            VValueType expr_type;
-            size_t arguments_count;
+            ASTNodeList arguments;
         } function_call;
 
         struct {
             FunctionSignature *signature;
-            const struct ASTNode *body;
-            Scope *scope;
+            ASTNodeId body;
+            uint32_t body_offset; // source offset of the '{' of a body left to parse on demand, 0 once parsed
         } function_decl;
 
         struct {
-            struct ASTNode *operand;
-            VValueType expr_type;
+            ASTNodeId operand;
             ASTUnaryType op;
             bool is_pure;
         } unary_op;
 
         struct {
-            struct ASTNode *left;
-            struct ASTNode *right;
-            VValueType expr_type;
+            ASTNodeId left;
+            ASTNodeId right;
             ASTBinaryType op;
             bool is_pure;
         } binary_op;
 
         struct {
-            struct ASTNode *condition;
-            struct ASTNode *then_expression;
-            struct ASTNode *else_expression;
-            VValueType expr_type;
+            ASTNodeId condition;
+            ASTNodeId then_expression;
+            ASTNodeId else_expression;
             bool is_pure;
         } ternary_op;
 
         struct {
-            struct ASTNode *condition;
-            struct ASTNode *then_block;
-            struct ASTNode *else_block;
+            ASTNodeId condition;
+            ASTNodeId then_block;
+            ASTNodeId else_block;
         } if_stmt;
 
         struct {
-            struct ASTNode *condition;
-            struct ASTNode *body;
+            ASTNodeId condition;
+            ASTNodeId body;
         } while_stmt;
 
         struct {
-            struct ASTNode *statements;
+            ASTNodeList statements;
             Scope *scope;
         } block;
 
         struct {
-            struct ASTNode *statements;
-            struct ASTNode *functions;
-            const uint8_t *module_name;
-            Scope *scope;
+            ASTNodeList statements;
+            ASTNodeList functions;
         } module;
 
         struct {
-            struct ASTNode *expression;
+            ASTNodeId expression;
             VValueType target_type;
             VValueType from_type;
             bool is_explicit;
@@ -117,51 +142,134 @@ typedef struct {
         } type_cast;
 
         struct {
-            struct ASTNode *expressions;
+            ASTNodeList expressions;
         } print_stmt;
 
         struct {
-            struct ASTNode *variable;
+            ASTNodeId variable;
         } input_stmt;
     };
 } ASTNode;
 
-void ASTNode_Print(const ASTNode *, FILE *);
+// Inclusive bounds of the values of an i64 expression, min > max when no value reaches it
+typedef struct {
+    int64_t min;
+    int64_t max;
+} ASTRange;
+
+// Source positions are only needed for diagnostics, so they are kept apart from the hot node data
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} ASTNodePosition;
+
+typedef struct tag_ASTModule {
+    Arena *arena;
+    ASTNode **node_pages;
+    ASTNodePosition **position_pages;
+    uint32_t pages_count;
+    uint32_t pages_capacity;
+    uint32_t nodes_count;
+    ASTNodeId *list_items;
+    uint32_t list_items_count;
+    uint32_t list_items_capacity;
+    ASTRange *ranges; // by node id, see ASTModule_InferRanges, NULL when not computed
+    uint32_t ranges_count;
+    ASTNodeId root;
+    const uint8_t *module_name;
+    Scope *scope;
+    FunctionTable *function_table;
+} ASTModule;
+
+#define AST_NODE(module_ptr, id) \
+    (&(module_ptr)->node_pages[(id) >> AST_NODE_PAGE_SHIFT][(id) & AST_NODE_PAGE_MASK])
+
+// list_items may move when a new list is allocated: index it through AST_LIST_ITEM, never keep the pointer
+#define AST_LIST_ITEM(module_ptr, list, index) ((module_ptr)->list_items[(list).start + (index)])
+
+ASTModule *ASTModule_Create(Arena *arena, const uint8_t *module_name, Scope *scope);
+
+ASTNodeList ASTModule_AllocateList(ASTModule *module, uint32_t count);
+
+ASTNodeList ASTModule_CreateList(ASTModule *module, const ASTNodeId *items, uint32_t count);
+
+// Appends a copy of node: child ids and lists are taken as they are, the caller remaps them
+ASTNodeId ASTModule_AppendNode(ASTModule *module, const ASTNode *node, Position pos);
+
+attribute_pure
+Position ASTNode_Position(const ASTModule *module, ASTNodeId node);
+
+void ASTNode_SetPosition(ASTModule *module, ASTNodeId node, Position pos);
 
 attribute_pure
-FunctionSignature *FindFunctionSignature(const ASTNode *module, const uint8_t *function_name);
+FunctionSignature *FindFunctionSignature(const ASTModule *module, const uint8_t *function_name);
+
+attribute_pure
+bool IsNodePure(const ASTNode *node);
+
+ASTNodeId CreateLiteralNode(ASTModule *module, Position pos, VValue value);
+
+ASTNodeId CreateVarRefNode(ASTModule *module, Position pos, const uint8_t *var_name);
 
-ASTNode *CreateLiteralNode(Arena *arena, Position pos, VValue value);
+ASTNodeId CreateBinaryNode(ASTModule *module, Position pos, ASTNodeId left, ASTNodeId right,
+                           ASTBinaryType op, bool is_pure);
 
-ASTNode *CreateVarRefNode(Arena *arena, Position pos, const uint8_t *var_name);
+ASTNodeId CreateUnaryNode(ASTModule *module, Position pos, ASTNodeId operand, ASTUnaryType op, bool is_pure);
 
-ASTNode *CreateBinaryNode(Arena *arena, Position pos, const ASTNode *left, const ASTNode *right,
-                          ASTBinaryType op, bool is_pure);
+ASTNodeId CreateIfStatementNode(ASTModule *module, Position pos, ASTNodeId condition,
+                                ASTNodeId then_block, ASTNodeId else_block);
 
-ASTNode *CreateUnaryNode(Arena *arena, Position pos, const ASTNode *operand, ASTUnaryType op,
-                         bool is_pure);
+ASTNodeId CreateWhileStatementNode(ASTModule *module, Position pos, ASTNodeId condition, ASTNodeId body);
+
+ASTNodeId CreateVarDeclarationNode(ASTModule *module, Position pos, const uint8_t *var_name,
+                                   VValueType var_type, ASTNodeId init_value);
+
+// Typed read of a variable the analysis already resolved, registered as a use of the symbol
+ASTNodeId CreateVarReadNode(ASTModule *module, Position pos, Symbol *symbol);
+
+#define AST_TEMPORARY_NAME_SIZE 32
+
+typedef struct {
+    ASTNodeId block; // AST_BLOCK or AST_MODULE receiving the declaration
+    uint32_t index; // statement of the block the declaration goes in front of
+    ASTNodeId declaration;
+} ASTTemporary;
+
+// Variables `$<prefix>N` the optimizer passes make up, with the declarations waiting for the walk to leave
+// their block. A pass fills in the prefix and zeroes the rest
+typedef struct {
+    const char *prefix;
+    ASTTemporary *items;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t created;
+} ASTTemporaries;
 
-ASTNode *CreateIfStatementNode(Arena *arena, Position pos, const ASTNode *condition,
-                               const ASTNode *then_block, const ASTNode *else_block);
+// Declares a new temporary holding value in front of statement `index` of the block, returns a read of it.
+// The declaration waits for ASTTemporaries_Insert, so that the statement list is not rebuilt while walked
+ASTNodeId ASTTemporaries_Declare(ASTTemporaries *temporaries, ASTModule *module, ASTNodeId block, uint32_t index,
+                                 ASTNodeId value);
 
-ASTNode *CreateWhileStatementNode(Arena *arena, Position pos, const ASTNode *condition, const ASTNode *body);
+// Inserts the declarations waiting for the block in front of their statements. They are the last ones made,
+// since the blocks nested in the block are left before it
+void ASTTemporaries_Insert(ASTTemporaries *temporaries, ASTModule *module, ASTNodeId block_id);
 
-ASTNode *CreateVarDeclarationNode(Arena *arena, Position pos, const uint8_t *var_name,
-                                  VValueType var_type, const ASTNode *init_value);
+void ASTTemporaries_Free(ASTTemporaries *temporaries);
 
-ASTNode *CreateTypeCastNode(Arena *arena, Position pos, ASTNode *expression,
-                            VValueType target_type/*, const bool is_explicit*/);
+ASTNodeId CreateTypeCastNode(ASTModule *module, Position pos, ASTNodeId expression,
+                             VValueType target_type/*, const bool is_explicit*/);
 
-ASTNode *CreateTernaryNode(Arena *arena, Position pos, const ASTNode *condition,
-                           const ASTNode *then_expression, const ASTNode *else_expression);
+ASTNodeId CreateTernaryNode(ASTModule *module, Position pos, ASTNodeId condition,
+                            ASTNodeId then_expression, ASTNodeId else_expression);
 
-ASTNode *CreateModuleNode(Arena *arena, const uint8_t *module_name, Scope *scope);
+ASTNodeId CreateBlockNode(ASTModule *module, Position pos, ASTNodeList statements, Scope *scope);
 
-ASTNode *CreateBlockNode(Arena *arena, Position pos, ASTNode *statements, Scope *scope);
+ASTNodeId CreatePrintStatementNode(ASTModule *module, Position pos, ASTNodeList expressions);
 
-ASTNode *CreatePrintStatementNode(Arena *arena, Position pos, ASTNode *expressions);
+ASTNodeId CreateFunctionDeclarationNode(ASTModule *module, Position pos, FunctionSignature *signature,
+                                        ASTNodeId body, Scope *scope);
 
-ASTNode *CreateFunctionDeclarationNode(Arena *arena, Position pos, FunctionSignature *signature, ASTNode *body,
-                                       Scope *scope);
+ASTNodeId CreateFunctionCallNode(ASTModule *module, Position pos, FunctionSignature *signature,
+                                 ASTNodeList arguments);
 
 #endif //VISMUT_AST_H
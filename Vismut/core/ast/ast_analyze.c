@@ -1,371 +1,771 @@
 #include "ast_analyze.h"
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "ast_typing.h"
 #include "../types.h"
 #include "../errors/errors.h"
+#include "../thread/thread.h"
 #include "ast.h"
+#include "ast_print.h"
+#include "ast_purity.h"
+#include "ast_visit.h"
+
+// Below this many functions per worker, starting threads costs more than it saves
+#define AST_ANALYZE_FUNCTIONS_PER_WORKER 16
+#define AST_ANALYZE_NO_TASK UINT32_MAX
+
+// Implicit cast a worker could not create: the node storage only grows on the calling thread
+typedef struct tag_ASTTypeAnalyzeCast {
+    struct tag_ASTTypeAnalyzeCast *next;
+    ASTNodeId *slot; // a field of a node, nodes do not move while the workers run
+    VValueType from_type;
+    VValueType target_type;
+} ASTTypeAnalyzeCast;
+
+// Analysis of one top-level function. It starts once every callee it takes an inferred return type from
+// is analyzed, those callees name it among their dependents
+typedef struct {
+    ASTNodeId declaration;
+    atomic_uint waiting; // callees with an inferred return type that are not analyzed yet
+    uint32_t dependents_start; // into ASTTypeAnalyzePool.dependents
+    uint32_t dependents_count;
+    ASTTypeAnalyzeCast *casts;
+    errno_t error;
+} ASTTypeAnalyzeTask;
 
 typedef struct {
     Scope *current_scope;
     Arena *arena;
+    ASTModule *module;
+    ASTTypeAnalyzeTask *task; // function analyzed on a worker, NULL on the calling thread
 } ASTTypeAnalyzerContext;
 
-#define SAFE_ANALYZE(node_ptr, out_type_ptr) \
-    START_BLOCK_WRAPPER \
-        if (unlikely((err = ASTTypeAnalyzeNode(context, (ASTNode *)node_ptr, out_type_ptr)) != VISMUT_ERROR_OK)) { \
-            return err;\
-        }\
-    END_BLOCK_WRAPPER
+static errno_t ASTTypeAnalyzeTree(ASTTypeAnalyzerContext *context, ASTNodeId *root);
+
+// Wraps the expression stored in `*slot` into an implicit cast and stores the cast id back.
+// Nothing reads the slot again during the analysis, so a worker only records the cast
+static void ASTTypeAnalyzeInsertCast(const ASTTypeAnalyzerContext *context, ASTNodeId *slot,
+                                     const VValueType from_type, const VValueType target_type) {
+    if (context->task != NULL) {
+        ASTTypeAnalyzeCast *cast = Arena_Type(context->arena, ASTTypeAnalyzeCast);
+        *cast = (ASTTypeAnalyzeCast){
+            .next = context->task->casts,
+            .slot = slot,
+            .from_type = from_type,
+            .target_type = target_type,
+        };
+        context->task->casts = cast;
+        return;
+    }
+
+    const ASTNodeId cast_node = CreateTypeCastNode(
+        context->module, ASTNode_Position(context->module, *slot), *slot, target_type);
+    AST_NODE(context->module, cast_node)->type_cast.from_type = from_type;
+    *slot = cast_node;
+}
 
 attribute_pure
-static bool IsNodePure(const ASTNode *node) {
-    switch (node->type) {
-        case AST_BINARY:
-            return node->binary_op.is_pure;
-        case AST_UNARY:
-            return node->unary_op.is_pure;
-        case AST_TYPE_CAST:
-            return node->type_cast.is_pure;
-        case AST_FUNCTION_CALL:
-            return false;
-        default:
-            return true;
+static VValueType ASTTypeAnalyzeTypeOf(const ASTTypeAnalyzerContext *context, const ASTNodeId node_id) {
+    return AST_NODE(context->module, node_id)->expr_type;
+}
+
+// A worker gives the scopes it enters its own arena, they get the module arena back when they are left
+static void ASTTypeAnalyzeEnterScope(ASTTypeAnalyzerContext *context, Scope *scope) {
+    if (context->task != NULL) {
+        scope->allocator = context->arena;
+    }
+    context->current_scope = scope;
+}
+
+static void ASTTypeAnalyzeLeaveScope(ASTTypeAnalyzerContext *context) {
+    Scope *scope = context->current_scope;
+    if (context->task != NULL) {
+        scope->allocator = context->module->arena;
     }
+    context->current_scope = scope->parent;
 }
 
-static errno_t ASTTypeAnalyzeNode(ASTTypeAnalyzerContext *context, ASTNode *node, VValueType *value_type) {
-    DEBUG_ASSERT(node != NULL);
+static errno_t ASTTypeAnalyzeVarRef(const ASTTypeAnalyzerContext *context, const ASTNodeId node_id) {
+    ASTNode *node = AST_NODE(context->module, node_id);
+    DEBUG_ASSERT(node->type == AST_VAR_REF);
+
+    Symbol *var_symbol = Scope_Resolve(context->current_scope, node->var_ref.var_name);
+    if (var_symbol == NULL) {
+        return VISMUT_ERROR_SYMBOL_NOT_DEFINED;
+    }
+    Symbol_AddUse(context->arena, var_symbol, node_id, !(node->flags & AST_NODE_FLAG_ASSIGN_TARGET));
+    node->var_ref.symbol = var_symbol;
+    node->expr_type = var_symbol->value.type;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeFunctionDeclarationEnter(ASTTypeAnalyzerContext *context, ASTNode *node) {
+    DEBUG_ASSERT(node->type == AST_FUNCTION_DECL);
 
     errno_t err;
-    switch (node->type) {
-        case AST_BINARY: {
-            VValueType left, right;
-            SAFE_ANALYZE(node->binary_op.left, &left);
-            SAFE_ANALYZE(node->binary_op.right, &right);
-
-            const bool operands_is_pure = IsNodePure((const ASTNode *) node->binary_op.right) &&
-                                          IsNodePure((const ASTNode *) node->binary_op.left);
-            node->binary_op.is_pure = operands_is_pure && node->binary_op.is_pure;
-
-            if (node->binary_op.op == AST_BINARY_ASSIGN) {
-                if (((const ASTNode *) node->binary_op.left)->type != AST_VAR_REF) {
-                    return VISMUT_ERROR_ASSIGN_NOT_TO_VAR;
-                }
-
-                if (left == right) {
-                    *value_type = node->binary_op.expr_type = left;
-                    return VISMUT_ERROR_OK;
-                }
-                const bool is_allowed_cast = IsCastAllowed(right, left, false);
-                if (!is_allowed_cast) {
-                    return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
-                }
-                ASTNode *right_node = (ASTNode *) node->binary_op.right;
-                ASTNode *cast_node = CreateTypeCastNode(context->arena, right_node->pos, right_node, left);
-                cast_node->type_cast.from_type = right;
-                node->binary_op.right = (struct ASTNode *) cast_node;
-                *value_type = node->binary_op.expr_type = left;
-                return VISMUT_ERROR_OK;
-            }
+    FunctionSignature *signature = node->function_decl.signature;
+    signature->analysis |= FUNCTION_ANALYSIS_RUNNING;
+
+    ASTTypeAnalyzeEnterScope(context, signature->scope);
+    for (size_t i = 0; i < signature->params.params_count; ++i) {
+        const uint8_t *param_name = signature->params.param_names[i];
+        const VValueType param_type = signature->params.param_types[i];
+        RISKY_EXPRESSION_SAFE(
+            Scope_Declare(signature->scope, param_name, param_type, 0, NULL),
+            err
+        );
+    }
 
-            const VValueType result = GetBinaryOpResultType(node->binary_op.op, left, right);
-            if (likely(result != VALUE_UNKNOWN)) {
-                *value_type = node->binary_op.expr_type = result;
-                return VISMUT_ERROR_OK;
-            }
+    if (AST_NODE(context->module, node->function_decl.body)->type != AST_BLOCK
+        && signature->return_type == VALUE_VOID) {
+        return VISMUT_ERROR_VOID_FOR_EXPRESSION_FUNCTION;
+    }
+    return VISMUT_ERROR_OK;
+}
 
-            const VValueType common_type = FindCommonType(left, right);
-            if (unlikely(common_type == VALUE_UNKNOWN)) {
-                printf("Error in node:\n");
-                ASTNode_Print(node, stdout);
-                printf("Operation: '<%s> %s <%s>' is unsupported\n", VValueType_String(left),
-                       ASTBinaryType_String(node->binary_op.op), VValueType_String(right));
-                return VISMUT_ERROR_UNSUPPORTED_OPERATION;
-            }
+static errno_t ASTTypeAnalyzeFunctionDeclarationLeave(ASTTypeAnalyzerContext *context, ASTNode *node) {
+    DEBUG_ASSERT(node->type == AST_FUNCTION_DECL);
 
-            if (common_type == left) {
-                // casting right operand
-                ASTNode *right_node = (ASTNode *) node->binary_op.right;
-                ASTNode *cast_node = CreateTypeCastNode(context->arena, right_node->pos, right_node, common_type);
-                cast_node->type_cast.from_type = right;
-                node->binary_op.right = (struct ASTNode *) cast_node;
-            } else {
-                // casting left operand
-                ASTNode *left_node = (ASTNode *) node->binary_op.left;
-                ASTNode *cast_node = CreateTypeCastNode(context->arena, left_node->pos, left_node, common_type);
-                cast_node->type_cast.from_type = left;
-                node->binary_op.left = (struct ASTNode *) cast_node;
-            }
-            const VValueType result_with_casting = GetBinaryOpResultType(node->binary_op.op, common_type, common_type);
-            if (unlikely(result_with_casting == VALUE_UNKNOWN)) {
-                printf("Error in node:\n");
-                ASTNode_Print(node, stdout);
-                printf("Operation: '<%s> %s <%s>' is unsupported\n", VValueType_String(common_type),
-                       ASTBinaryType_String(node->binary_op.op), VValueType_String(common_type));
-                return VISMUT_ERROR_UNSUPPORTED_OPERATION;
+    FunctionSignature *signature = node->function_decl.signature;
+    ASTTypeAnalyzeLeaveScope(context);
+
+    if (AST_NODE(context->module, node->function_decl.body)->type != AST_BLOCK) {
+        const VValueType return_type = ASTTypeAnalyzeTypeOf(context, node->function_decl.body);
+        if (signature->return_type == VALUE_AUTO) {
+            // Only an inferred type is written: callers on other workers read the declared ones meanwhile
+            signature->return_type = return_type;
+        } else if (signature->return_type != return_type) {
+            if (!IsCastAllowed(return_type, signature->return_type, false)) {
+                return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
             }
+            ASTTypeAnalyzeInsertCast(context, &node->function_decl.body, VALUE_AUTO, signature->return_type);
+        }
+    }
 
-            *value_type = node->binary_op.expr_type = result_with_casting;
-            return VISMUT_ERROR_OK;
+    signature->analysis = FUNCTION_ANALYSIS_DONE;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeFunctionCallEnter(ASTTypeAnalyzerContext *context, ASTNode *node) {
+    DEBUG_ASSERT(node->type == AST_FUNCTION_CALL);
+
+    errno_t err;
+    const FunctionSignature *signature = node->function_call.signature;
+    if (signature->return_type == VALUE_AUTO) {
+        // Callee may be declared after the caller, infer its return type first
+        if (signature->analysis & FUNCTION_ANALYSIS_RUNNING) {
+            return VISMUT_ERROR_CANNOT_INFER_RETURN_TYPE;
         }
-        case AST_UNARY: {
-            VValueType operand;
-            SAFE_ANALYZE(node->unary_op.operand, &operand);
-
-            const bool operand_is_pure = IsNodePure((const ASTNode *) node->unary_op.operand);
-            node->unary_op.is_pure = operand_is_pure && node->unary_op.is_pure;
-
-            const VValueType result = GetUnaryOpResultType(node->unary_op.op, operand);
-            if (result == VALUE_UNKNOWN) {
-                printf("Error in node:\n");
-                ASTNode_Print(node, stdout);
-                printf("'<%s>' for '<%s>' is unsupported\n", ASTUnaryType_String(node->unary_op.op),
-                       VValueType_String(operand));
-                return VISMUT_ERROR_UNSUPPORTED_OPERATION;
-            }
+        ASTTypeAnalyzerContext callee_context = *context;
+        ASTNodeId declaration = signature->declaration;
+        RISKY_EXPRESSION_SAFE(ASTTypeAnalyzeTree(&callee_context, &declaration), err);
+    }
+    node->expr_type = signature->return_type;
+    if (node->function_call.arguments.count != signature->params.params_count) {
+        return VISMUT_ERROR_INVALID_ARGUMENTS_COUNT;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeFunctionCallLeave(const ASTTypeAnalyzerContext *context, ASTNode *node) {
+    DEBUG_ASSERT(node->type == AST_FUNCTION_CALL);
+
+    const ASTNodeList arguments = node->function_call.arguments;
+    const VValueType *param_types = node->function_call.signature->params.param_types;
+    bool is_pure = (node->function_call.signature->flags & FUNCTION_FLAG_PURE) != 0;
+    for (uint32_t i = 0; i < arguments.count; ++i) {
+        const ASTNodeId argument = AST_LIST_ITEM(context->module, arguments, i);
+        if (param_types[i] != ASTTypeAnalyzeTypeOf(context, argument)) {
+            return VISMUT_ERROR_INVALID_ARGUMENT_TYPE;
+        }
+        is_pure = is_pure && IsNodePure(AST_NODE(context->module, argument));
+    }
+    if (is_pure) {
+        node->flags |= AST_NODE_FLAG_PURE_CALL;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeBinary(const ASTTypeAnalyzerContext *context, const ASTNodeId node_id) {
+    ASTNode *node = AST_NODE(context->module, node_id);
+    DEBUG_ASSERT(node->type == AST_BINARY);
+
+    const VValueType left = ASTTypeAnalyzeTypeOf(context, node->binary_op.left);
+    const VValueType right = ASTTypeAnalyzeTypeOf(context, node->binary_op.right);
+
+    const bool operands_is_pure = IsNodePure(AST_NODE(context->module, node->binary_op.right)) &&
+                                  IsNodePure(AST_NODE(context->module, node->binary_op.left));
+    node->binary_op.is_pure = operands_is_pure && node->binary_op.is_pure;
 
-            *value_type = node->unary_op.expr_type = result;
+    if (node->binary_op.op == AST_BINARY_ASSIGN) {
+        if (AST_NODE(context->module, node->binary_op.left)->type != AST_VAR_REF) {
+            return VISMUT_ERROR_ASSIGN_NOT_TO_VAR;
+        }
+
+        if (left == right) {
+            node->expr_type = left;
             return VISMUT_ERROR_OK;
         }
-        case AST_TERNARY: {
-            VValueType condition, then_expression, else_expression;
-            SAFE_ANALYZE(node->ternary_op.condition, &condition);
-            SAFE_ANALYZE(node->ternary_op.then_expression, &then_expression);
-            SAFE_ANALYZE(node->ternary_op.else_expression, &else_expression);
+        const bool is_allowed_cast = IsCastAllowed(right, left, false);
+        if (!is_allowed_cast) {
+            return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
+        }
+        ASTTypeAnalyzeInsertCast(context, &node->binary_op.right, right, left);
+        node->expr_type = left;
+        return VISMUT_ERROR_OK;
+    }
 
-            node->ternary_op.is_pure = IsNodePure((ASTNode *) node->ternary_op.then_expression)
-                                       && IsNodePure((ASTNode *) node->ternary_op.else_expression);
+    const VValueType result = GetBinaryOpResultType(node->binary_op.op, left, right);
+    if (likely(result != VALUE_UNKNOWN)) {
+        node->expr_type = result;
+        return VISMUT_ERROR_OK;
+    }
 
-            if (likely(then_expression == else_expression)) {
-                *value_type = node->ternary_op.expr_type = then_expression;
-                return VISMUT_ERROR_OK;
-            }
+    const VValueType common_type = FindCommonType(left, right);
+    if (unlikely(common_type == VALUE_UNKNOWN)) {
+        printf("Error in node:\n");
+        ASTNode_Print(context->module, node_id, stdout);
+        printf("Operation: '<%s> %s <%s>' is unsupported\n", VValueType_String(left),
+               ASTBinaryType_String(node->binary_op.op), VValueType_String(right));
+        return VISMUT_ERROR_UNSUPPORTED_OPERATION;
+    }
 
-            const VValueType common_type = FindCommonType(then_expression, else_expression);
-            if (unlikely(common_type == VALUE_UNKNOWN)) {
-                return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
-            }
+    if (common_type == left) {
+        // casting right operand
+        ASTTypeAnalyzeInsertCast(context, &node->binary_op.right, right, common_type);
+    } else {
+        // casting left operand
+        ASTTypeAnalyzeInsertCast(context, &node->binary_op.left, left, common_type);
+    }
+    const VValueType result_with_casting = GetBinaryOpResultType(node->binary_op.op, common_type, common_type);
+    if (unlikely(result_with_casting == VALUE_UNKNOWN)) {
+        printf("Error in node:\n");
+        ASTNode_Print(context->module, node_id, stdout);
+        printf("Operation: '<%s> %s <%s>' is unsupported\n", VValueType_String(common_type),
+               ASTBinaryType_String(node->binary_op.op), VValueType_String(common_type));
+        return VISMUT_ERROR_UNSUPPORTED_OPERATION;
+    }
+
+    node->expr_type = result_with_casting;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeUnary(const ASTTypeAnalyzerContext *context, const ASTNodeId node_id) {
+    ASTNode *node = AST_NODE(context->module, node_id);
+    DEBUG_ASSERT(node->type == AST_UNARY);
+
+    const VValueType operand = ASTTypeAnalyzeTypeOf(context, node->unary_op.operand);
+
+    const bool operand_is_pure = IsNodePure(AST_NODE(context->module, node->unary_op.operand));
+    node->unary_op.is_pure = operand_is_pure && node->unary_op.is_pure;
+
+    const VValueType result = GetUnaryOpResultType(node->unary_op.op, operand);
+    if (result == VALUE_UNKNOWN) {
+        printf("Error in node:\n");
+        ASTNode_Print(context->module, node_id, stdout);
+        printf("'<%s>' for '<%s>' is unsupported\n", ASTUnaryType_String(node->unary_op.op),
+               VValueType_String(operand));
+        return VISMUT_ERROR_UNSUPPORTED_OPERATION;
+    }
+
+    node->expr_type = result;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeTernary(const ASTTypeAnalyzerContext *context, ASTNode *node) {
+    DEBUG_ASSERT(node->type == AST_TERNARY);
+
+    const VValueType then_expression = ASTTypeAnalyzeTypeOf(context, node->ternary_op.then_expression);
+    const VValueType else_expression = ASTTypeAnalyzeTypeOf(context, node->ternary_op.else_expression);
+
+    node->ternary_op.is_pure = IsNodePure(AST_NODE(context->module, node->ternary_op.condition))
+                               && IsNodePure(AST_NODE(context->module, node->ternary_op.then_expression))
+                               && IsNodePure(AST_NODE(context->module, node->ternary_op.else_expression));
+
+    if (likely(then_expression == else_expression)) {
+        node->expr_type = then_expression;
+        return VISMUT_ERROR_OK;
+    }
 
-            if (common_type == then_expression) {
-                // casting else expression
-                ASTNode *else_expression_node = (ASTNode *) node->ternary_op.else_expression;
-                ASTNode *cast_node = CreateTypeCastNode(context->arena, else_expression_node->pos, else_expression_node,
-                                                        common_type);
-                cast_node->type_cast.from_type = else_expression;
-                node->ternary_op.else_expression = (struct ASTNode *) cast_node;
-            } else {
-                // casting then expression
-                ASTNode *then_expression_node = (ASTNode *) node->ternary_op.then_expression;
-                ASTNode *cast_node = CreateTypeCastNode(context->arena, then_expression_node->pos, then_expression_node,
-                                                        common_type);
-                cast_node->type_cast.from_type = then_expression;
-                node->ternary_op.then_expression = (struct ASTNode *) cast_node;
+    const VValueType common_type = FindCommonType(then_expression, else_expression);
+    if (unlikely(common_type == VALUE_UNKNOWN)) {
+        return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
+    }
+
+    if (common_type == then_expression) {
+        // casting else expression
+        ASTTypeAnalyzeInsertCast(context, &node->ternary_op.else_expression, else_expression, common_type);
+    } else {
+        // casting then expression
+        ASTTypeAnalyzeInsertCast(context, &node->ternary_op.then_expression, then_expression, common_type);
+    }
+    node->expr_type = common_type;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeVarDeclaration(const ASTTypeAnalyzerContext *context, const ASTNodeId node_id) {
+    ASTNode *node = AST_NODE(context->module, node_id);
+    DEBUG_ASSERT(node->type == AST_VAR_DECL);
+
+    errno_t err;
+    const VValueType init_value = node->var_decl.init_value == AST_NODE_NONE
+                                      ? node->var_decl.var_type
+                                      : ASTTypeAnalyzeTypeOf(context, node->var_decl.init_value);
+
+    if (node->var_decl.var_type == VALUE_AUTO) {
+        node->var_decl.var_type = init_value;
+    } else if (node->var_decl.var_type != init_value) {
+        printf("Error in node:");
+        ASTNode_Print(context->module, node_id, stdout);
+        printf("Type %s != %s\n", VValueType_String(node->var_decl.var_type),
+               VValueType_String(init_value));
+        return VISMUT_ERROR_TYPE_IS_INCOMPATIBLE;
+    }
+
+    if ((err = Scope_DeclareSymbol(context->current_scope, node->var_decl.symbol, init_value)) !=
+        VISMUT_ERROR_OK) {
+        return err;
+    }
+    node->var_decl.symbol->declaration = node_id;
+
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTTypeAnalyzeTypeCast(const ASTTypeAnalyzerContext *context, ASTNode *node) {
+    DEBUG_ASSERT(node->type == AST_TYPE_CAST);
+
+    const ASTNode *expression = AST_NODE(context->module, node->type_cast.expression);
+    node->type_cast.is_pure = IsNodePure(expression);
+
+    node->type_cast.from_type = expression->expr_type;
+    if (!IsCastAllowed(expression->expr_type, node->type_cast.target_type, node->type_cast.is_explicit)) {
+        return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
+    }
+
+    return VISMUT_ERROR_OK;
+}
+
+// Scopes and assignment targets are set up on the way down, before the children are analyzed
+static errno_t ASTTypeAnalyzeEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTTypeAnalyzerContext *context = visitor->context;
+    ASTNode *node = AST_NODE(context->module, *slot);
+
+    switch (node->type) {
+        case AST_BINARY: {
+            ASTNode *left = AST_NODE(context->module, node->binary_op.left);
+            if (node->binary_op.op == AST_BINARY_ASSIGN && left->type == AST_VAR_REF) {
+                left->flags |= AST_NODE_FLAG_ASSIGN_TARGET;
             }
-            *value_type = node->ternary_op.expr_type = common_type;
             return VISMUT_ERROR_OK;
         }
-        case AST_PRINT_STMT: {
-            for (const ASTNode *current = (ASTNode *) node->print_stmt.expressions; current != NULL;
-                 current = (ASTNode *) current->next_node) {
-                VValueType type;
-                SAFE_ANALYZE(current, &type);
+        case AST_BLOCK:
+            ASTTypeAnalyzeEnterScope(context, node->block.scope);
+            return VISMUT_ERROR_OK;
+        case AST_FUNCTION_DECL:
+            if (node->function_decl.signature->analysis & FUNCTION_ANALYSIS_DONE) {
+                *skip_children = true;
+                return VISMUT_ERROR_OK;
             }
+            return ASTTypeAnalyzeFunctionDeclarationEnter(context, node);
+        case AST_FUNCTION_CALL:
+            return ASTTypeAnalyzeFunctionCallEnter(context, node);
+        default:
             return VISMUT_ERROR_OK;
-        }
-        case AST_VAR_REF: {
-            const Symbol *var_symbol = Scope_Resolve(context->current_scope, node->var_ref.var_name);
-            if (var_symbol == NULL) {
-                return VISMUT_ERROR_SYMBOL_NOT_DEFINED;
+    }
+}
+
+// Types flow bottom-up: every child already carries its expr_type when its parent is left
+static errno_t ASTTypeAnalyzeLeave(ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTTypeAnalyzerContext *context = visitor->context;
+    const ASTNodeId node_id = *slot;
+    ASTNode *node = AST_NODE(context->module, node_id);
+
+    switch (node->type) {
+        case AST_BINARY:
+            return ASTTypeAnalyzeBinary(context, node_id);
+        case AST_UNARY:
+            return ASTTypeAnalyzeUnary(context, node_id);
+        case AST_TERNARY:
+            return ASTTypeAnalyzeTernary(context, node);
+        case AST_VAR_REF:
+            return ASTTypeAnalyzeVarRef(context, node_id);
+        case AST_VAR_DECL:
+            return ASTTypeAnalyzeVarDeclaration(context, node_id);
+        case AST_TYPE_CAST:
+            return ASTTypeAnalyzeTypeCast(context, node);
+        case AST_FUNCTION_CALL:
+            return ASTTypeAnalyzeFunctionCallLeave(context, node);
+        case AST_FUNCTION_DECL:
+            if (!(node->function_decl.signature->analysis & FUNCTION_ANALYSIS_RUNNING)) {
+                return VISMUT_ERROR_OK;
             }
-            Scope_MarkUsed(context->current_scope, node->var_ref.var_name);
-            *value_type = node->var_ref.expr_type = var_symbol->value.type;
+            return ASTTypeAnalyzeFunctionDeclarationLeave(context, node);
+        case AST_BLOCK:
+            ASTTypeAnalyzeLeaveScope(context);
+            return VISMUT_ERROR_OK;
+        default:
             return VISMUT_ERROR_OK;
+    }
+}
+
+static errno_t ASTTypeAnalyzeTree(ASTTypeAnalyzerContext *context, ASTNodeId *root) {
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, context->module, context);
+    visitor.arena = context->arena;
+    visitor.enter = ASTTypeAnalyzeEnter;
+    visitor.leave = ASTTypeAnalyzeLeave;
+    return ASTVisit(&visitor, root);
+}
+
+// Work-stealing deque of task indices (Chase-Lev): the owner pushes and takes at the bottom, the other
+// workers steal from the top. Every task is pushed once, so a deque as large as the task list never wraps
+typedef struct {
+    atomic_llong top;
+    atomic_llong bottom;
+    atomic_uint *items;
+    long long mask;
+} ASTTypeAnalyzeDeque;
+
+typedef struct tag_ASTTypeAnalyzePool ASTTypeAnalyzePool;
+
+typedef struct {
+    ASTTypeAnalyzePool *pool;
+    ASTTypeAnalyzeDeque deque;
+    Arena *arena;
+    uint32_t index;
+    Thread thread;
+} ASTTypeAnalyzeWorker;
+
+struct tag_ASTTypeAnalyzePool {
+    ASTModule *module;
+    ASTTypeAnalyzeTask *tasks;
+    uint32_t tasks_count;
+    uint32_t *dependents;
+    ASTTypeAnalyzeWorker *workers;
+    uint32_t workers_count;
+    atomic_uint pending; // tasks that are ready or running, no new task shows up once it drops to zero
+    atomic_bool failed;
+};
+
+// Collects the callees every task waits for
+typedef struct {
+    ASTModule *module;
+    uint32_t *task_of; // task index + 1 of every top-level declaration, by node id
+    uint32_t *seen_by; // task index + 1 of the caller an edge to the callee was last added for
+    uint32_t (*edges)[2]; // caller, callee
+    uint32_t edges_count;
+    uint32_t edges_capacity;
+    ASTNodeId root;
+    uint32_t task;
+    ASTTypeAnalyzeTask *tasks;
+    bool has_nested_functions;
+} ASTTypeAnalyzeScan;
+
+static void ASTTypeAnalyzeDeque_Init(ASTTypeAnalyzeDeque *deque, Arena *arena, const uint32_t capacity) {
+    uint32_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    deque->items = Arena_Array(arena, atomic_uint, size);
+    deque->mask = size - 1;
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+}
+
+static void ASTTypeAnalyzeDeque_Push(ASTTypeAnalyzeDeque *deque, const uint32_t task) {
+    const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    atomic_store_explicit(&deque->items[bottom & deque->mask], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+static uint32_t ASTTypeAnalyzeDeque_Take(ASTTypeAnalyzeDeque *deque) {
+    const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return AST_ANALYZE_NO_TASK;
+    }
+    uint32_t task = atomic_load_explicit(&deque->items[bottom & deque->mask], memory_order_relaxed);
+    if (top == bottom) {
+        // The last task: a thief may be taking it at the same time
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            task = AST_ANALYZE_NO_TASK;
         }
-        case AST_VAR_DECL: {
-            *value_type = VALUE_VOID;
-            VValueType init_value;
-            if (!node->var_decl.init_value) {
-                init_value = node->var_decl.var_type;
-            } else {
-                SAFE_ANALYZE(node->var_decl.init_value, &init_value);
-                node->var_decl.init_value_type = init_value;
-            }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
 
-            if (node->var_decl.var_type == VALUE_AUTO) {
-                node->var_decl.var_type = init_value;
-            } else if (node->var_decl.var_type != init_value) {
-                printf("Error in node:");
-                ASTNode_Print(node, stdout);
-                printf("Type %s != %s\n", VValueType_String(node->var_decl.var_type),
-                       VValueType_String(init_value));
-                return VISMUT_ERROR_TYPE_IS_INCOMPATIBLE;
-            }
+static uint32_t ASTTypeAnalyzeDeque_Steal(ASTTypeAnalyzeDeque *deque) {
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return AST_ANALYZE_NO_TASK;
+    }
 
-            if ((err = Scope_Declare(context->current_scope, node->var_decl.var_name, init_value, 0)) !=
-                VISMUT_ERROR_OK) {
-                return err;
+    const uint32_t task = atomic_load_explicit(&deque->items[top & deque->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return AST_ANALYZE_NO_TASK;
+    }
+    return task;
+}
+
+static void ASTTypeAnalyzeWorker_RunTask(ASTTypeAnalyzeWorker *worker, const uint32_t index) {
+    ASTTypeAnalyzePool *pool = worker->pool;
+    ASTTypeAnalyzeTask *task = &pool->tasks[index];
+
+    ASTTypeAnalyzerContext context = {
+        .current_scope = pool->module->scope,
+        .arena = worker->arena,
+        .module = pool->module,
+        .task = task,
+    };
+    ASTNodeId declaration = task->declaration;
+    task->error = ASTTypeAnalyzeTree(&context, &declaration);
+
+    if (task->error != VISMUT_ERROR_OK) {
+        atomic_store(&pool->failed, true);
+    } else {
+        for (uint32_t i = 0; i < task->dependents_count; ++i) {
+            const uint32_t dependent = pool->dependents[task->dependents_start + i];
+            if (atomic_fetch_sub(&pool->tasks[dependent].waiting, 1) == 1) {
+                atomic_fetch_add(&pool->pending, 1);
+                ASTTypeAnalyzeDeque_Push(&worker->deque, dependent);
             }
+        }
+    }
+    atomic_fetch_sub(&pool->pending, 1);
+}
 
-            return VISMUT_ERROR_OK;
+static errno_t ASTTypeAnalyzeWorker_Run(void *argument) {
+    CALLSTACK_TRACE();
+    ASTTypeAnalyzeWorker *worker = argument;
+    ASTTypeAnalyzePool *pool = worker->pool;
+
+    while (!atomic_load(&pool->failed)) {
+        uint32_t task = ASTTypeAnalyzeDeque_Take(&worker->deque);
+        for (uint32_t i = 1; task == AST_ANALYZE_NO_TASK && i < pool->workers_count; ++i) {
+            task = ASTTypeAnalyzeDeque_Steal(&pool->workers[(worker->index + i) % pool->workers_count].deque);
         }
-        case AST_FUNCTION_DECL: {
-            *value_type = VALUE_VOID;
-
-            Scope *function_scope = node->function_decl.scope;
-            for (size_t i = 0; i < node->function_decl.signature->params.params_count; ++i) {
-                const uint8_t *param_name = node->function_decl.signature->params.param_names[i];
-                const VValueType param_type = node->function_decl.signature->params.param_types[i];
-                RISKY_EXPRESSION_SAFE(
-                    Scope_Declare(function_scope, param_name, param_type, 0),
-                    err
-                );
-            }
+        if (task != AST_ANALYZE_NO_TASK) {
+            ASTTypeAnalyzeWorker_RunTask(worker, task);
+        } else if (atomic_load(&pool->pending) == 0) {
+            break;
+        } else {
+            Thread_Yield();
+        }
+    }
+    return VISMUT_ERROR_OK;
+}
 
-            if (((const ASTNode *) node->function_decl.body)->type != AST_BLOCK) {
-                VValueType declaration_type = node->function_decl.signature->return_type;
-                if (declaration_type == VALUE_VOID) {
-                    return VISMUT_ERROR_VOID_FOR_EXPRESSION_FUNCTION;
-                }
-
-                Scope *old_scope = context->current_scope;
-                context->current_scope = function_scope;
-                VValueType return_type;
-                SAFE_ANALYZE(node->function_decl.body, &return_type);
-                context->current_scope = old_scope;
-
-                declaration_type = (declaration_type == VALUE_AUTO) ? return_type : declaration_type;
-                if (declaration_type == return_type) {
-                    node->function_decl.signature->return_type = declaration_type;
-                    return VISMUT_ERROR_OK;
-                }
-                if (!IsCastAllowed(return_type, declaration_type, false)) {
-                    return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
-                }
-                ASTNode *body = (ASTNode *) node->function_decl.body;
-                node->function_decl.body = (struct ASTNode *) CreateTypeCastNode(
-                    context->arena, body->pos, body, declaration_type);
+static errno_t ASTTypeAnalyzeScanEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTTypeAnalyzeScan *scan = visitor->context;
+    const ASTNode *node = AST_NODE(scan->module, *slot);
 
-                return VISMUT_ERROR_OK;
-            }
+    if (node->type == AST_FUNCTION_DECL && *slot != scan->root) {
+        // Whoever calls a nested function first infers its return type, which only works in one thread
+        scan->has_nested_functions = true;
+        *skip_children = true;
+        return VISMUT_ERROR_OK;
+    }
+    if (node->type != AST_FUNCTION_CALL) {
+        return VISMUT_ERROR_OK;
+    }
 
-            Scope *old_scope = context->current_scope;
-            context->current_scope = function_scope;
-            VValueType body;
-            SAFE_ANALYZE(node->function_decl.body, &body);
-            context->current_scope = old_scope;
+    const FunctionSignature *signature = node->function_call.signature;
+    if (signature->return_type != VALUE_AUTO || (signature->analysis & FUNCTION_ANALYSIS_DONE)) {
+        return VISMUT_ERROR_OK;
+    }
+    const uint32_t callee = signature->declaration != AST_NODE_NONE ? scan->task_of[signature->declaration] : 0;
+    if (callee == 0) {
+        // Not a task of its own: the caller is left to the analysis of the whole module
+        atomic_fetch_add(&scan->tasks[scan->task].waiting, 1);
+        return VISMUT_ERROR_OK;
+    }
+    if (scan->seen_by[callee - 1] == scan->task + 1) {
+        return VISMUT_ERROR_OK;
+    }
+    scan->seen_by[callee - 1] = scan->task + 1;
 
-            return VISMUT_ERROR_OK;
+    if (scan->edges_count == scan->edges_capacity) {
+        scan->edges_capacity = scan->edges_capacity == 0 ? 64 : scan->edges_capacity * 2;
+        scan->edges = realloc(scan->edges, sizeof(*scan->edges) * scan->edges_capacity);
+        if (scan->edges == NULL) {
+            exit(VISMUT_ERROR_ALLOC);
         }
-        case AST_FUNCTION_CALL: {
-            *value_type = node->function_call.expr_type = node->function_call.signature->return_type;
-            if (node->function_call.arguments_count != node->function_call.signature->params.params_count) {
-                return VISMUT_ERROR_INVALID_ARGUMENTS_COUNT;
-            }
-            if (node->function_call.arguments_count == 0) {
-                return VISMUT_ERROR_OK;
-            }
+    }
+    scan->edges[scan->edges_count][0] = scan->task;
+    scan->edges[scan->edges_count][1] = callee - 1;
+    ++scan->edges_count;
+    atomic_fetch_add(&scan->tasks[scan->task].waiting, 1);
+    return VISMUT_ERROR_OK;
+}
 
-            ASTNode *arguments = (ASTNode *) node->function_call.arguments;
-            VValueType *param_type = node->function_call.signature->params.param_types;
-            for (
-                ASTNode *current = arguments; current != NULL; current = (ASTNode *) current->next_node, ++param_type
-            ) {
-                const VValueType current_param = *param_type;
-                VValueType current_type;
-                SAFE_ANALYZE(current, &current_type);
-
-                if (current_param != current_type) {
-                    return VISMUT_ERROR_FUNCTION_ALREADY_DEFINED;
-                }
-            }
+// Finds the callees every task waits for and lists the callers of every task. Returns false when the
+// module has to be analyzed in one thread
+static bool ASTTypeAnalyzePool_Schedule(ASTTypeAnalyzePool *pool, Arena *arena) {
+    ASTModule *module = pool->module;
+    ASTTypeAnalyzeScan scan = {
+        .module = module,
+        .task_of = calloc(module->nodes_count, sizeof(uint32_t)),
+        .seen_by = calloc(pool->tasks_count, sizeof(uint32_t)),
+        .tasks = pool->tasks,
+    };
+    if (scan.task_of == NULL || scan.seen_by == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    for (uint32_t i = 0; i < pool->tasks_count; ++i) {
+        scan.task_of[pool->tasks[i].declaration] = i + 1;
+    }
 
-            return VISMUT_ERROR_OK;
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &scan);
+    visitor.enter = ASTTypeAnalyzeScanEnter;
+    for (uint32_t i = 0; i < pool->tasks_count && !scan.has_nested_functions; ++i) {
+        scan.root = pool->tasks[i].declaration;
+        scan.task = i;
+        ASTVisit(&visitor, &scan.root);
+    }
+
+    if (!scan.has_nested_functions) {
+        pool->dependents = Arena_Array(arena, uint32_t, scan.edges_count);
+        for (uint32_t i = 0; i < scan.edges_count; ++i) {
+            ++pool->tasks[scan.edges[i][1]].dependents_count;
         }
-        case AST_IF_STMT: {
-            *value_type = VALUE_VOID;
-            VValueType condition, then_block, else_block;
-            SAFE_ANALYZE(node->if_stmt.condition, &condition);
-            SAFE_ANALYZE(node->if_stmt.then_block, &then_block);
-            if (node->if_stmt.else_block != NULL) {
-                SAFE_ANALYZE(node->if_stmt.else_block, &else_block);
-            }
-            return VISMUT_ERROR_OK;
+        uint32_t start = 0;
+        for (uint32_t i = 0; i < pool->tasks_count; ++i) {
+            pool->tasks[i].dependents_start = start;
+            start += pool->tasks[i].dependents_count;
+            pool->tasks[i].dependents_count = 0;
         }
-        case AST_WHILE_STMT: {
-            *value_type = VALUE_VOID;
-            VValueType condition, body;
-            SAFE_ANALYZE(node->while_stmt.condition, &condition);
-            SAFE_ANALYZE(node->while_stmt.body, &body);
-            return VISMUT_ERROR_OK;
+        for (uint32_t i = 0; i < scan.edges_count; ++i) {
+            ASTTypeAnalyzeTask *callee = &pool->tasks[scan.edges[i][1]];
+            pool->dependents[callee->dependents_start + callee->dependents_count++] = scan.edges[i][0];
         }
-        case AST_BLOCK: {
-            *value_type = VALUE_VOID;
-            context->current_scope = node->block.scope;
-
-            ASTNode *current_statement = (ASTNode *) node->block.statements;
-            while (current_statement != NULL) {
-                VValueType statement_type;
-                SAFE_ANALYZE(current_statement, &statement_type);
-                current_statement = (ASTNode *) current_statement->next_node;
-            }
+    }
 
-            Scope_RemoveUnused(context->current_scope);
+    free(scan.task_of);
+    free(scan.seen_by);
+    free(scan.edges);
+    return !scan.has_nested_functions;
+}
 
-            context->current_scope = context->current_scope->parent;
-            return VISMUT_ERROR_OK;
+// Analyzes the top-level functions on worker threads, each with its own arena. A function whose return
+// type is inferred is analyzed before its callers; functions on a cycle of inferred return types are left
+// to the analysis of the whole module, which reports them
+static errno_t ASTTypeAnalyzeFunctionsInParallel(Arena *arena, ASTModule *module) {
+    CALLSTACK_TRACE();
+    const ASTNode *root = AST_NODE(module, module->root);
+    const ASTNodeList functions = root->module.functions;
+
+    if (functions.count < AST_ANALYZE_FUNCTIONS_PER_WORKER * 2) return VISMUT_ERROR_OK;
+
+    ASTTypeAnalyzePool pool = {
+        .module = module,
+        .tasks = Arena_Array(arena, ASTTypeAnalyzeTask, functions.count),
+        .tasks_count = 0,
+    };
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        const ASTNodeId declaration = AST_LIST_ITEM(module, functions, i);
+        const ASTNode *node = AST_NODE(module, declaration);
+        if (node->type != AST_FUNCTION_DECL || (node->function_decl.signature->analysis & FUNCTION_ANALYSIS_DONE)) {
+            continue;
         }
-        case AST_MODULE: {
-            *value_type = VALUE_VOID;
-            ASTNode *function_statement = (ASTNode *) node->module.functions;
-            while (function_statement != NULL) {
-                VValueType statement_type;
-                SAFE_ANALYZE(function_statement, &statement_type);
-                function_statement = (ASTNode *) function_statement->next_node;
-            }
+        ASTTypeAnalyzeTask *task = &pool.tasks[pool.tasks_count++];
+        *task = (ASTTypeAnalyzeTask){
+            .declaration = declaration,
+            .casts = NULL,
+            .error = VISMUT_ERROR_OK,
+        };
+        atomic_init(&task->waiting, 0);
+    }
 
-            ASTNode *current_statement = (ASTNode *) node->module.statements;
-            while (current_statement != NULL) {
-                VValueType statement_type;
-                SAFE_ANALYZE(current_statement, &statement_type);
-                current_statement = (ASTNode *) current_statement->next_node;
-            }
-            return VISMUT_ERROR_OK;
+    uint32_t workers_count = Thread_HardwareConcurrency();
+    if (workers_count > pool.tasks_count / AST_ANALYZE_FUNCTIONS_PER_WORKER) {
+        workers_count = pool.tasks_count / AST_ANALYZE_FUNCTIONS_PER_WORKER;
+    }
+    if (workers_count < 2 || !ASTTypeAnalyzePool_Schedule(&pool, arena)) return VISMUT_ERROR_OK;
+    pool.workers_count = workers_count;
+
+    // The tasks nothing holds back are dealt out before the threads start
+    pool.workers = Arena_Array(arena, ASTTypeAnalyzeWorker, workers_count);
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        pool.workers[i] = (ASTTypeAnalyzeWorker){
+            .pool = &pool,
+            .arena = Arena_Create(arena->block_size),
+            .index = i,
+        };
+        ASTTypeAnalyzeDeque_Init(&pool.workers[i].deque, arena, pool.tasks_count);
+    }
+    uint32_t ready = 0;
+    for (uint32_t i = 0; i < pool.tasks_count; ++i) {
+        if (atomic_load(&pool.tasks[i].waiting) == 0) {
+            ASTTypeAnalyzeDeque_Push(&pool.workers[ready++ % workers_count].deque, i);
         }
-        case AST_LITERAL: {
-            *value_type = node->literal.type;
-            return VISMUT_ERROR_OK;
+    }
+    atomic_init(&pool.pending, ready);
+    atomic_init(&pool.failed, false);
+
+    // The tasks of a worker that did not start are stolen by the others
+    bool *started = Arena_Array(arena, bool, workers_count);
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        started[i] = Thread_Start(&pool.workers[i].thread, ASTTypeAnalyzeWorker_Run, &pool.workers[i])
+                     == VISMUT_ERROR_OK;
+    }
+    bool any_started = false;
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        if (started[i]) {
+            Thread_Join(&pool.workers[i].thread);
+            any_started = true;
         }
-        case AST_TYPE_CAST: {
-            VValueType expression;
-            SAFE_ANALYZE(node->type_cast.expression, &expression);
-
-            const bool casting_expression_is_pure = IsNodePure((const ASTNode *) node->type_cast.expression);
-            node->type_cast.is_pure = casting_expression_is_pure;
+    }
+    if (!any_started) {
+        ASTTypeAnalyzeWorker_Run(&pool.workers[0]);
+    }
 
-            node->type_cast.from_type = expression;
-            if (!IsCastAllowed(expression, node->type_cast.target_type, node->type_cast.is_explicit)) {
-                return VISMUT_ERROR_CAST_IS_NOT_ALLOWED;
-            }
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        Arena_Adopt(arena, pool.workers[i].arena);
+    }
+    // The first failed function in source order, as the analysis in one thread would have reported it
+    for (uint32_t i = 0; i < pool.tasks_count; ++i) {
+        if (pool.tasks[i].error != VISMUT_ERROR_OK) {
+            return pool.tasks[i].error;
+        }
+    }
 
-            *value_type = node->type_cast.target_type;
-            return VISMUT_ERROR_OK;
+    for (uint32_t i = 0; i < pool.tasks_count; ++i) {
+        for (const ASTTypeAnalyzeCast *cast = pool.tasks[i].casts; cast != NULL; cast = cast->next) {
+            const ASTNodeId cast_node = CreateTypeCastNode(
+                module, ASTNode_Position(module, *cast->slot), *cast->slot, cast->target_type);
+            AST_NODE(module, cast_node)->type_cast.from_type = cast->from_type;
+            *cast->slot = cast_node;
         }
-        default:
-            return VISMUT_ERROR_OK;
     }
+    return VISMUT_ERROR_OK;
 }
 
-errno_t ASTModuleTypeAnalyze(Arena *arena, ASTNode *node) {
-    DEBUG_ASSERT(node->type == AST_MODULE);
+errno_t ASTModuleTypeAnalyze(Arena *arena, ASTModule *module) {
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
 
     ASTTypeAnalyzerContext ctx = {
-        .current_scope = node->module.scope,
+        .current_scope = module->scope,
         .arena = arena,
+        .module = module,
+        .task = NULL,
     };
-    VValueType type;
 
-    return ASTTypeAnalyzeNode(&ctx, node, &type);
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTModule_InferPurity(module), err);
+    RISKY_EXPRESSION_SAFE(ASTTypeAnalyzeFunctionsInParallel(arena, module), err);
+    return ASTTypeAnalyzeTree(&ctx, &module->root);
 }
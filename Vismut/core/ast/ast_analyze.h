@@ -6,6 +6,6 @@
 #define VISMUT_AST_ANALYZE_H
 #include "ast.h"
 
-errno_t ASTModuleTypeAnalyze(Arena *, ASTNode *);
+errno_t ASTModuleTypeAnalyze(Arena *, ASTModule *);
 
 #endif //VISMUT_AST_ANALYZE_H
@@ -0,0 +1,705 @@
+#include "ast_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../Vismut.h"
+#include "../errors/errors.h"
+#include "../hash/murmur3.h"
+
+#define AST_CACHE_MAGIC 0x54534156u // "VAST"
+#define AST_CACHE_SECTION_ALIGNMENT 8
+#define AST_CACHE_SOURCE_SEED_HIGH 0x5bd1e995
+#define AST_CACHE_POINTER_MAP_INITIAL_CAPACITY 64
+
+// The module was parsed with lazy function bodies and misses the functions nothing calls
+#define AST_CACHE_FLAG_LAZY_FUNCTIONS (1u << 0)
+
+// Strings, symbols and signatures are referenced as index + 1 (0 is NULL), stored in place of the pointer fields
+#define AST_CACHE_REF_TO_POINTER(ref) ((void *) (uintptr_t) (ref))
+#define AST_CACHE_POINTER_TO_REF(pointer) ((uint32_t) (uintptr_t) (pointer))
+
+/*
+ * File layout, every section is aligned to AST_CACHE_SECTION_ALIGNMENT:
+ *   header | node pages | position pages | list items | symbols | symbol uses | signatures | params | strings
+ * Node and position pages are mapped in place, the remaining tables are small and rebuilt in the arena.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t format_version;
+    uint32_t compiler_version; // hash of VISMUT_VERSION
+    uint16_t node_size;
+    uint16_t flags; // AST_CACHE_FLAG_*
+    uint64_t source_length;
+    uint32_t source_hash[2];
+    uint32_t pages_count;
+    uint32_t nodes_count;
+    uint32_t list_items_count;
+    uint32_t symbols_count;
+    uint32_t symbol_uses_count;
+    uint32_t signatures_count;
+    uint32_t params_count;
+    uint32_t strings_size;
+    uint32_t root;
+    uint32_t module_name;
+    uint64_t nodes_offset;
+    uint64_t positions_offset;
+    uint64_t list_items_offset;
+    uint64_t symbols_offset;
+    uint64_t symbol_uses_offset;
+    uint64_t signatures_offset;
+    uint64_t params_offset;
+    uint64_t strings_offset;
+} ASTCacheHeader;
+
+typedef struct {
+    uint32_t name;
+    uint32_t hash;
+    uint32_t flags;
+    uint32_t value_type;
+    uint32_t declaration;
+    uint32_t uses_start;
+    uint32_t uses_count;
+    uint32_t reads_count;
+} ASTCacheSymbol;
+
+typedef struct {
+    uint32_t function_name;
+    uint32_t function_name_hash;
+    uint32_t return_type;
+    uint32_t flags;
+    uint32_t declaration;
+    uint32_t params_start;
+    uint32_t params_count;
+    uint32_t span_offset;
+    uint32_t span_length;
+    uint32_t span_hash[2];
+} ASTCacheSignature;
+
+typedef struct {
+    uint32_t name;
+    uint32_t type;
+} ASTCacheParam;
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} ASTCacheBuffer;
+
+typedef struct {
+    const void **keys;
+    uint32_t *refs;
+    uint32_t capacity;
+    uint32_t size;
+} ASTCachePointerMap;
+
+typedef struct {
+    ASTCachePointerMap strings;
+    ASTCachePointerMap symbols;
+    ASTCachePointerMap signatures;
+    ASTCacheBuffer string_data;
+    ASTCacheBuffer symbol_records;
+    ASTCacheBuffer symbol_uses;
+    ASTCacheBuffer signature_records;
+    ASTCacheBuffer param_records;
+} ASTCacheWriter;
+
+attribute_pure
+static uint32_t ASTCache_CompilerVersion(void) {
+    return murmurhash3_string((const uint8_t *) VISMUT_VERSION, AST_CACHE_FORMAT_VERSION);
+}
+
+static void ASTCache_HashSource(const StringView source, uint32_t hash[2]) {
+    hash[0] = murmurhash3_32(source.data, source.length, MURMURHASH3_DEFAULT_STR_SEED);
+    hash[1] = murmurhash3_32(source.data, source.length, AST_CACHE_SOURCE_SEED_HIGH);
+}
+
+static void ASTCacheBuffer_Append(ASTCacheBuffer *buffer, const void *data, const size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        size_t new_capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (new_capacity < buffer->size + size) {
+            new_capacity *= 2;
+        }
+        uint8_t *new_data = realloc(buffer->data, new_capacity);
+        if (new_data == NULL) {
+            exit(VISMUT_ERROR_ALLOC);
+        }
+        buffer->data = new_data;
+        buffer->capacity = new_capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static void ASTCachePointerMap_Init(ASTCachePointerMap *map, const uint32_t capacity) {
+    map->keys = calloc(capacity, sizeof(*map->keys));
+    map->refs = calloc(capacity, sizeof(*map->refs));
+    if (map->keys == NULL || map->refs == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    map->capacity = capacity;
+    map->size = 0;
+}
+
+static void ASTCachePointerMap_Free(const ASTCachePointerMap *map) {
+    free(map->keys);
+    free(map->refs);
+}
+
+// Returns the slot of key: either the one holding it or the empty one where it belongs
+static uint32_t ASTCachePointerMap_Slot(const ASTCachePointerMap *map, const void *key) {
+    uint32_t index = murmurhash3_int64((int64_t) (uintptr_t) key, MURMURHASH3_DEFAULT_STR_SEED) & (map->capacity - 1);
+    while (map->keys[index] != NULL && map->keys[index] != key) {
+        index = (index + 1) & (map->capacity - 1);
+    }
+    return index;
+}
+
+static void ASTCachePointerMap_Insert(ASTCachePointerMap *map, const void *key, const uint32_t ref) {
+    if ((map->size + 1) * 4 > map->capacity * 3) {
+        const ASTCachePointerMap old = *map;
+        ASTCachePointerMap_Init(map, old.capacity * 2);
+        for (uint32_t i = 0; i < old.capacity; ++i) {
+            if (old.keys[i] != NULL) {
+                ASTCachePointerMap_Insert(map, old.keys[i], old.refs[i]);
+            }
+        }
+        ASTCachePointerMap_Free(&old);
+    }
+
+    const uint32_t index = ASTCachePointerMap_Slot(map, key);
+    map->keys[index] = key;
+    map->refs[index] = ref;
+    ++map->size;
+}
+
+attribute_pure
+static uint32_t ASTCachePointerMap_Find(const ASTCachePointerMap *map, const void *key) {
+    const uint32_t index = ASTCachePointerMap_Slot(map, key);
+    return map->keys[index] == key ? map->refs[index] : 0;
+}
+
+static uint32_t ASTCacheWriter_String(ASTCacheWriter *writer, const uint8_t *str) {
+    if (str == NULL) return 0;
+
+    uint32_t ref = ASTCachePointerMap_Find(&writer->strings, str);
+    if (ref == 0) {
+        ref = (uint32_t) writer->string_data.size + 1;
+        ASTCacheBuffer_Append(&writer->string_data, str, strlen((const char *) str) + 1);
+        ASTCachePointerMap_Insert(&writer->strings, str, ref);
+    }
+    return ref;
+}
+
+static uint32_t ASTCacheWriter_Symbol(ASTCacheWriter *writer, const Symbol *symbol) {
+    if (symbol == NULL) return 0;
+
+    uint32_t ref = ASTCachePointerMap_Find(&writer->symbols, symbol);
+    if (ref == 0) {
+        const ASTCacheSymbol record = {
+            .name = ASTCacheWriter_String(writer, symbol->name),
+            .hash = symbol->hash,
+            .flags = symbol->flags,
+            .value_type = symbol->value.type,
+            .declaration = symbol->declaration,
+            .uses_start = (uint32_t) (writer->symbol_uses.size / sizeof(ASTNodeId)),
+            .uses_count = symbol->uses_count,
+            .reads_count = symbol->reads_count,
+        };
+        if (symbol->uses_count != 0) {
+            ASTCacheBuffer_Append(&writer->symbol_uses, symbol->uses, symbol->uses_count * sizeof(ASTNodeId));
+        }
+        ASTCacheBuffer_Append(&writer->symbol_records, &record, sizeof(record));
+        ref = (uint32_t) (writer->symbol_records.size / sizeof(record));
+        ASTCachePointerMap_Insert(&writer->symbols, symbol, ref);
+    }
+    return ref;
+}
+
+static void ASTCacheWriter_Signatures(ASTCacheWriter *writer, const FunctionTable *function_table) {
+    for (size_t i = 0; i < function_table->capacity; ++i) {
+        const FunctionSignature *signature = function_table->slots[i];
+        if (signature == NULL) continue;
+
+        const ASTCacheSignature record = {
+            .function_name = ASTCacheWriter_String(writer, signature->function_name),
+            .function_name_hash = signature->function_name_hash,
+            .return_type = signature->return_type,
+            .flags = (uint32_t) signature->flags,
+            .declaration = signature->declaration,
+            .params_start = (uint32_t) (writer->param_records.size / sizeof(ASTCacheParam)),
+            .params_count = (uint32_t) signature->params.params_count,
+            .span_offset = (uint32_t) signature->span.offset,
+            .span_length = (uint32_t) signature->span.length,
+            .span_hash = {signature->span_hash[0], signature->span_hash[1]},
+        };
+        for (size_t j = 0; j < signature->params.params_count; ++j) {
+            const ASTCacheParam param = {
+                .name = ASTCacheWriter_String(writer, signature->params.param_names[j]),
+                .type = signature->params.param_types[j],
+            };
+            ASTCacheBuffer_Append(&writer->param_records, &param, sizeof(param));
+        }
+        ASTCacheBuffer_Append(&writer->signature_records, &record, sizeof(record));
+        ASTCachePointerMap_Insert(&writer->signatures, signature,
+                                  (uint32_t) (writer->signature_records.size / sizeof(record)));
+    }
+}
+
+static ASTNode ASTCacheWriter_EncodeNode(ASTCacheWriter *writer, const ASTNode *node) {
+    ASTNode encoded = *node;
+    switch (node->type) {
+        case AST_LITERAL:
+            if (node->literal.type == VALUE_STR) {
+                encoded.literal.str = AST_CACHE_REF_TO_POINTER(ASTCacheWriter_String(writer, node->literal.str));
+            }
+            break;
+        case AST_VAR_REF:
+            encoded.var_ref.var_name = AST_CACHE_REF_TO_POINTER(ASTCacheWriter_String(writer, node->var_ref.var_name));
+            encoded.var_ref.symbol = AST_CACHE_REF_TO_POINTER(ASTCacheWriter_Symbol(writer, node->var_ref.symbol));
+            break;
+        case AST_VAR_DECL:
+            encoded.var_decl.symbol = AST_CACHE_REF_TO_POINTER(ASTCacheWriter_Symbol(writer, node->var_decl.symbol));
+            break;
+        case AST_FUNCTION_CALL:
+            encoded.function_call.signature = AST_CACHE_REF_TO_POINTER(
+                ASTCachePointerMap_Find(&writer->signatures, node->function_call.signature));
+            break;
+        case AST_FUNCTION_DECL:
+            encoded.function_decl.signature = AST_CACHE_REF_TO_POINTER(
+                ASTCachePointerMap_Find(&writer->signatures, node->function_decl.signature));
+            break;
+        case AST_BLOCK:
+            // Scopes are only needed by the analysis, which a cached module has already been through
+            encoded.block.scope = NULL;
+            break;
+        default:
+            break;
+    }
+    return encoded;
+}
+
+static errno_t ASTCache_WriteSection(FILE *file, const void *data, const size_t size, uint64_t *offset,
+                                     uint64_t *section_offset) {
+    static const uint8_t padding[AST_CACHE_SECTION_ALIGNMENT] = {0};
+
+    const size_t padding_size = (size_t) (-*offset & (AST_CACHE_SECTION_ALIGNMENT - 1));
+    if (padding_size != 0 && fwrite(padding, 1, padding_size, file) != padding_size) {
+        return VISMUT_ERROR_IO;
+    }
+    *offset += padding_size;
+    if (section_offset != NULL) {
+        *section_offset = *offset;
+    }
+
+    if (size != 0 && fwrite(data, 1, size, file) != size) {
+        return VISMUT_ERROR_IO;
+    }
+    *offset += size;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTCache_WriteModule(FILE *file, ASTCacheWriter *writer, const ASTModule *module,
+                                    ASTCacheHeader *header) {
+    errno_t err;
+    uint64_t offset = 0;
+
+    // Placeholder, the real header is written last so an interrupted store never looks valid
+    RISKY_EXPRESSION_SAFE(ASTCache_WriteSection(file, header, sizeof(*header), &offset, NULL), err);
+
+    ASTNode *page = calloc(AST_NODE_PAGE_SIZE, sizeof(ASTNode));
+    ASTNodePosition *positions = calloc(AST_NODE_PAGE_SIZE, sizeof(ASTNodePosition));
+    if (page == NULL || positions == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+
+    for (uint32_t i = 0; i < module->pages_count && err == VISMUT_ERROR_OK; ++i) {
+        const uint32_t first = i << AST_NODE_PAGE_SHIFT;
+        const uint32_t count = module->nodes_count - first < AST_NODE_PAGE_SIZE
+                                   ? module->nodes_count - first
+                                   : AST_NODE_PAGE_SIZE;
+        for (uint32_t j = 0; j < count; ++j) {
+            page[j] = ASTCacheWriter_EncodeNode(writer, &module->node_pages[i][j]);
+        }
+        memset(page + count, 0, (AST_NODE_PAGE_SIZE - count) * sizeof(ASTNode));
+        err = ASTCache_WriteSection(file, page, AST_NODE_PAGE_SIZE * sizeof(ASTNode), &offset,
+                                    i == 0 ? &header->nodes_offset : NULL);
+    }
+    for (uint32_t i = 0; i < module->pages_count && err == VISMUT_ERROR_OK; ++i) {
+        const uint32_t first = i << AST_NODE_PAGE_SHIFT;
+        const uint32_t count = module->nodes_count - first < AST_NODE_PAGE_SIZE
+                                   ? module->nodes_count - first
+                                   : AST_NODE_PAGE_SIZE;
+        memcpy(positions, module->position_pages[i], count * sizeof(ASTNodePosition));
+        memset(positions + count, 0, (AST_NODE_PAGE_SIZE - count) * sizeof(ASTNodePosition));
+        err = ASTCache_WriteSection(file, positions, AST_NODE_PAGE_SIZE * sizeof(ASTNodePosition), &offset,
+                                    i == 0 ? &header->positions_offset : NULL);
+    }
+    free(page);
+    free(positions);
+    if (err != VISMUT_ERROR_OK) {
+        return err;
+    }
+
+    header->module_name = ASTCacheWriter_String(writer, module->module_name);
+    header->pages_count = module->pages_count;
+    header->nodes_count = module->nodes_count;
+    header->list_items_count = module->list_items_count;
+    header->symbols_count = (uint32_t) (writer->symbol_records.size / sizeof(ASTCacheSymbol));
+    header->symbol_uses_count = (uint32_t) (writer->symbol_uses.size / sizeof(ASTNodeId));
+    header->signatures_count = (uint32_t) (writer->signature_records.size / sizeof(ASTCacheSignature));
+    header->params_count = (uint32_t) (writer->param_records.size / sizeof(ASTCacheParam));
+    header->strings_size = (uint32_t) writer->string_data.size;
+    header->root = module->root;
+
+    RISKY_EXPRESSION_SAFE(ASTCache_WriteSection(file, module->list_items,
+                              module->list_items_count * sizeof(ASTNodeId), &offset, &header->list_items_offset), err);
+    RISKY_EXPRESSION_SAFE(ASTCache_WriteSection(file, writer->symbol_records.data, writer->symbol_records.size,
+                              &offset, &header->symbols_offset), err);
+    RISKY_EXPRESSION_SAFE(ASTCache_WriteSection(file, writer->symbol_uses.data, writer->symbol_uses.size,
+                              &offset, &header->symbol_uses_offset), err);
+    RISKY_EXPRESSION_SAFE(ASTCache_WriteSection(file, writer->signature_records.data,
+                              writer->signature_records.size, &offset, &header->signatures_offset), err);
+    RISKY_EXPRESSION_SAFE(ASTCache_WriteSection(file, writer->param_records.data, writer->param_records.size,
+                              &offset, &header->params_offset), err);
+    RISKY_EXPRESSION_SAFE(ASTCache_WriteSection(file, writer->string_data.data, writer->string_data.size,
+                              &offset, &header->strings_offset), err);
+
+    header->magic = AST_CACHE_MAGIC;
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(header, sizeof(*header), 1, file) != 1) {
+        return VISMUT_ERROR_IO;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+errno_t ASTCache_Store(const ASTModule *module, const char *cache_filename, const StringView source,
+                       const bool lazy_functions) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(module != NULL);
+
+    FILE *file = fopen(cache_filename, "wb");
+    if (file == NULL) {
+        return VISMUT_ERROR_IO;
+    }
+
+    ASTCacheHeader header = {
+        .magic = 0,
+        .format_version = AST_CACHE_FORMAT_VERSION,
+        .compiler_version = ASTCache_CompilerVersion(),
+        .node_size = sizeof(ASTNode),
+        .flags = lazy_functions ? AST_CACHE_FLAG_LAZY_FUNCTIONS : 0,
+        .source_length = source.length,
+    };
+    ASTCache_HashSource(source, header.source_hash);
+
+    ASTCacheWriter writer = {0};
+    ASTCachePointerMap_Init(&writer.strings, AST_CACHE_POINTER_MAP_INITIAL_CAPACITY);
+    ASTCachePointerMap_Init(&writer.symbols, AST_CACHE_POINTER_MAP_INITIAL_CAPACITY);
+    ASTCachePointerMap_Init(&writer.signatures, AST_CACHE_POINTER_MAP_INITIAL_CAPACITY);
+    ASTCacheWriter_Signatures(&writer, module->function_table);
+
+    errno_t err = ASTCache_WriteModule(file, &writer, module, &header);
+    if (fclose(file) != 0 && err == VISMUT_ERROR_OK) {
+        err = VISMUT_ERROR_IO;
+    }
+    if (err != VISMUT_ERROR_OK) {
+        remove(cache_filename);
+    }
+
+    ASTCachePointerMap_Free(&writer.strings);
+    ASTCachePointerMap_Free(&writer.symbols);
+    ASTCachePointerMap_Free(&writer.signatures);
+    free(writer.string_data.data);
+    free(writer.symbol_records.data);
+    free(writer.symbol_uses.data);
+    free(writer.signature_records.data);
+    free(writer.param_records.data);
+    return err;
+}
+
+attribute_pure
+static bool ASTCache_SectionFits(const MappedFile *mapped_file, const uint64_t offset, const uint64_t size) {
+    return offset % AST_CACHE_SECTION_ALIGNMENT == 0 && offset <= mapped_file->size
+           && size <= mapped_file->size - offset;
+}
+
+// A NULL source accepts a cache built from any source and in any parse mode: every function it holds was parsed
+static errno_t ASTCache_Validate(const MappedFile *mapped_file, const StringView *source, const bool lazy_functions) {
+    if (mapped_file->size < sizeof(ASTCacheHeader)) {
+        return VISMUT_ERROR_CACHE_STALE;
+    }
+
+    const ASTCacheHeader *header = (const ASTCacheHeader *) mapped_file->data;
+    if (header->magic != AST_CACHE_MAGIC
+        || header->format_version != AST_CACHE_FORMAT_VERSION
+        || header->compiler_version != ASTCache_CompilerVersion()
+        || header->node_size != sizeof(ASTNode)) {
+        return VISMUT_ERROR_CACHE_STALE;
+    }
+    if (source != NULL) {
+        uint32_t source_hash[2];
+        ASTCache_HashSource(*source, source_hash);
+        if (header->source_length != source->length
+            || header->source_hash[0] != source_hash[0]
+            || header->source_hash[1] != source_hash[1]
+            || ((header->flags & AST_CACHE_FLAG_LAZY_FUNCTIONS) != 0) != lazy_functions) {
+            return VISMUT_ERROR_CACHE_STALE;
+        }
+    }
+
+    const uint64_t page_nodes = (uint64_t) header->pages_count << AST_NODE_PAGE_SHIFT;
+    if (header->pages_count == 0 || header->nodes_count > page_nodes || header->root >= header->nodes_count
+        || header->module_name > header->strings_size
+        || !ASTCache_SectionFits(mapped_file, header->nodes_offset, page_nodes * sizeof(ASTNode))
+        || !ASTCache_SectionFits(mapped_file, header->positions_offset, page_nodes * sizeof(ASTNodePosition))
+        || !ASTCache_SectionFits(mapped_file, header->list_items_offset,
+                                 (uint64_t) header->list_items_count * sizeof(ASTNodeId))
+        || !ASTCache_SectionFits(mapped_file, header->symbols_offset,
+                                 (uint64_t) header->symbols_count * sizeof(ASTCacheSymbol))
+        || !ASTCache_SectionFits(mapped_file, header->symbol_uses_offset,
+                                 (uint64_t) header->symbol_uses_count * sizeof(ASTNodeId))
+        || !ASTCache_SectionFits(mapped_file, header->signatures_offset,
+                                 (uint64_t) header->signatures_count * sizeof(ASTCacheSignature))
+        || !ASTCache_SectionFits(mapped_file, header->params_offset,
+                                 (uint64_t) header->params_count * sizeof(ASTCacheParam))
+        || !ASTCache_SectionFits(mapped_file, header->strings_offset, header->strings_size)) {
+        return VISMUT_ERROR_CACHE_STALE;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+typedef struct {
+    const ASTCacheHeader *header;
+    uint8_t *strings;
+    Symbol **symbols;
+    FunctionSignature **signatures;
+} ASTCacheReader;
+
+static uint8_t *ASTCacheReader_String(const ASTCacheReader *reader, const uint32_t ref) {
+    return ref == 0 ? NULL : reader->strings + ref - 1;
+}
+
+static Symbol *ASTCacheReader_Symbol(const ASTCacheReader *reader, const uint32_t ref) {
+    return ref == 0 ? NULL : reader->symbols[ref - 1];
+}
+
+static FunctionSignature *ASTCacheReader_Signature(const ASTCacheReader *reader, const uint32_t ref) {
+    return ref == 0 ? NULL : reader->signatures[ref - 1];
+}
+
+static errno_t ASTCacheReader_CheckRefs(const ASTCacheReader *reader, const ASTNode *node) {
+    const ASTCacheHeader *header = reader->header;
+    switch (node->type) {
+        case AST_LITERAL:
+            if (node->literal.type == VALUE_STR && AST_CACHE_POINTER_TO_REF(node->literal.str) - 1 >= header->strings_size) {
+                return VISMUT_ERROR_CACHE_STALE;
+            }
+            return VISMUT_ERROR_OK;
+        case AST_VAR_REF:
+            if (AST_CACHE_POINTER_TO_REF(node->var_ref.var_name) - 1 >= header->strings_size
+                || AST_CACHE_POINTER_TO_REF(node->var_ref.symbol) > header->symbols_count) {
+                return VISMUT_ERROR_CACHE_STALE;
+            }
+            return VISMUT_ERROR_OK;
+        case AST_VAR_DECL:
+            if (AST_CACHE_POINTER_TO_REF(node->var_decl.symbol) - 1 >= header->symbols_count) {
+                return VISMUT_ERROR_CACHE_STALE;
+            }
+            return VISMUT_ERROR_OK;
+        case AST_FUNCTION_CALL:
+            if (AST_CACHE_POINTER_TO_REF(node->function_call.signature) - 1 >= header->signatures_count) {
+                return VISMUT_ERROR_CACHE_STALE;
+            }
+            return VISMUT_ERROR_OK;
+        case AST_FUNCTION_DECL:
+            if (AST_CACHE_POINTER_TO_REF(node->function_decl.signature) - 1 >= header->signatures_count) {
+                return VISMUT_ERROR_CACHE_STALE;
+            }
+            return VISMUT_ERROR_OK;
+        default:
+            return node->type < AST_COUNT ? VISMUT_ERROR_OK : VISMUT_ERROR_CACHE_STALE;
+    }
+}
+
+static void ASTCacheReader_FixupNode(const ASTCacheReader *reader, ASTNode *node) {
+    switch (node->type) {
+        case AST_LITERAL:
+            if (node->literal.type == VALUE_STR) {
+                node->literal.str = ASTCacheReader_String(reader, AST_CACHE_POINTER_TO_REF(node->literal.str));
+            }
+            return;
+        case AST_VAR_REF:
+            node->var_ref.var_name = ASTCacheReader_String(reader, AST_CACHE_POINTER_TO_REF(node->var_ref.var_name));
+            node->var_ref.symbol = ASTCacheReader_Symbol(reader, AST_CACHE_POINTER_TO_REF(node->var_ref.symbol));
+            return;
+        case AST_VAR_DECL:
+            node->var_decl.symbol = ASTCacheReader_Symbol(reader, AST_CACHE_POINTER_TO_REF(node->var_decl.symbol));
+            return;
+        case AST_FUNCTION_CALL:
+            node->function_call.signature = ASTCacheReader_Signature(
+                reader, AST_CACHE_POINTER_TO_REF(node->function_call.signature));
+            return;
+        case AST_FUNCTION_DECL:
+            node->function_decl.signature = ASTCacheReader_Signature(
+                reader, AST_CACHE_POINTER_TO_REF(node->function_decl.signature));
+            return;
+        default:
+            return;
+    }
+}
+
+static errno_t ASTCacheReader_Tables(Arena *arena, ASTCacheReader *reader, const MappedFile *mapped_file,
+                                     FunctionTable *function_table) {
+    errno_t err;
+    const ASTCacheHeader *header = reader->header;
+    ASTNodeId *symbol_uses = (ASTNodeId *) (mapped_file->data + header->symbol_uses_offset);
+    const ASTCacheSymbol *symbol_records = (const ASTCacheSymbol *) (mapped_file->data + header->symbols_offset);
+    const ASTCacheSignature *signature_records =
+            (const ASTCacheSignature *) (mapped_file->data + header->signatures_offset);
+    const ASTCacheParam *param_records = (const ASTCacheParam *) (mapped_file->data + header->params_offset);
+
+    reader->symbols = Arena_Array(arena, Symbol *, header->symbols_count);
+    for (uint32_t i = 0; i < header->symbols_count; ++i) {
+        const ASTCacheSymbol *record = &symbol_records[i];
+        if (record->name == 0 || record->name > header->strings_size
+            || record->uses_start > header->symbol_uses_count
+            || record->uses_count > header->symbol_uses_count - record->uses_start) {
+            return VISMUT_ERROR_CACHE_STALE;
+        }
+
+        Symbol *symbol = Arena_Type(arena, Symbol);
+        *symbol = (Symbol){
+            .next = NULL,
+            .name = ASTCacheReader_String(reader, record->name),
+            .declaration = record->declaration,
+            .uses = symbol_uses + record->uses_start,
+            .value = {.type = (VValueType) record->value_type},
+            .hash = record->hash,
+            .flags = record->flags,
+            .uses_count = record->uses_count,
+            // The uses live in the mapping: growing them copies into the arena
+            .uses_capacity = record->uses_count,
+            .reads_count = record->reads_count,
+        };
+        reader->symbols[i] = symbol;
+    }
+
+    reader->signatures = Arena_Array(arena, FunctionSignature *, header->signatures_count);
+    for (uint32_t i = 0; i < header->signatures_count; ++i) {
+        const ASTCacheSignature *record = &signature_records[i];
+        if (record->function_name == 0 || record->function_name > header->strings_size
+            || record->params_start > header->params_count
+            || record->params_count > header->params_count - record->params_start) {
+            return VISMUT_ERROR_CACHE_STALE;
+        }
+
+        FunctionSignature *signature = Arena_Type(arena, FunctionSignature);
+        *signature = (FunctionSignature){
+            .params = {
+                .param_names = Arena_Array(arena, const uint8_t *, record->params_count),
+                .param_types = Arena_Array(arena, VValueType, record->params_count),
+                .params_count = record->params_count,
+            },
+            .function_name = ASTCacheReader_String(reader, record->function_name),
+            .scope = NULL,
+            .span = {.offset = record->span_offset, .length = record->span_length},
+            .span_hash = {record->span_hash[0], record->span_hash[1]},
+            .declaration = record->declaration,
+            .function_name_hash = record->function_name_hash,
+            .return_type = (VValueType) record->return_type,
+            .flags = (int) record->flags,
+        };
+        for (uint32_t j = 0; j < record->params_count; ++j) {
+            const ASTCacheParam *param = &param_records[record->params_start + j];
+            if (param->name == 0 || param->name > header->strings_size) {
+                return VISMUT_ERROR_CACHE_STALE;
+            }
+            signature->params.param_names[j] = ASTCacheReader_String(reader, param->name);
+            signature->params.param_types[j] = (VValueType) param->type;
+        }
+        RISKY_EXPRESSION_SAFE(FunctionTable_Declare(function_table, signature), err);
+        reader->signatures[i] = signature;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTCache_Map(Arena *arena, const MappedFile *mapped_file, ASTModule **out_module) {
+    errno_t err;
+    const ASTCacheHeader *header = (const ASTCacheHeader *) mapped_file->data;
+
+    ASTCacheReader reader = {
+        .header = header,
+        .strings = mapped_file->data + header->strings_offset,
+    };
+    // Every string has to end inside the table
+    if (header->strings_size != 0 && reader.strings[header->strings_size - 1] != '\0') {
+        return VISMUT_ERROR_CACHE_STALE;
+    }
+
+    ASTModule *module = Arena_Type(arena, ASTModule);
+    *module = (ASTModule){
+        .arena = arena,
+        .node_pages = Arena_Array(arena, ASTNode *, header->pages_count),
+        .position_pages = Arena_Array(arena, ASTNodePosition *, header->pages_count),
+        .pages_count = header->pages_count,
+        .pages_capacity = header->pages_count,
+        .nodes_count = header->nodes_count,
+        .list_items = (ASTNodeId *) (mapped_file->data + header->list_items_offset),
+        .list_items_count = header->list_items_count,
+        .list_items_capacity = header->list_items_count,
+        .root = header->root,
+        .module_name = ASTCacheReader_String(&reader, header->module_name),
+        .scope = Scope_Allocate(arena, NULL),
+        .function_table = FunctionTable_Allocate(arena),
+    };
+    RISKY_EXPRESSION_SAFE(ASTCacheReader_Tables(arena, &reader, mapped_file, module->function_table), err);
+
+    ASTNode *nodes = (ASTNode *) (mapped_file->data + header->nodes_offset);
+    ASTNodePosition *positions = (ASTNodePosition *) (mapped_file->data + header->positions_offset);
+    for (uint32_t i = 0; i < header->pages_count; ++i) {
+        module->node_pages[i] = nodes + ((size_t) i << AST_NODE_PAGE_SHIFT);
+        module->position_pages[i] = positions + ((size_t) i << AST_NODE_PAGE_SHIFT);
+    }
+
+    // Id 0 is the reserved AST_NODE_NONE slot
+    for (uint32_t id = 1; id < header->nodes_count; ++id) {
+        ASTNode *node = &nodes[id];
+        RISKY_EXPRESSION_SAFE(ASTCacheReader_CheckRefs(&reader, node), err);
+        ASTCacheReader_FixupNode(&reader, node);
+    }
+    if (AST_NODE(module, module->root)->type != AST_MODULE) {
+        return VISMUT_ERROR_CACHE_STALE;
+    }
+
+    *out_module = module;
+    return VISMUT_ERROR_OK;
+}
+
+errno_t ASTCache_Load(Arena *arena, const char *cache_filename, const StringView source, const bool lazy_functions,
+                      MappedFile *mapped_file, ASTModule **module) {
+    CALLSTACK_TRACE();
+    errno_t err;
+
+    RISKY_EXPRESSION_SAFE(MappedFile_Open(cache_filename, mapped_file), err);
+    if ((err = ASTCache_Validate(mapped_file, &source, lazy_functions)) != VISMUT_ERROR_OK
+        || (err = ASTCache_Map(arena, mapped_file, module)) != VISMUT_ERROR_OK) {
+        MappedFile_Close(mapped_file);
+        return err;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+errno_t ASTCache_LoadPrevious(Arena *arena, const char *cache_filename, MappedFile *mapped_file, ASTModule **module) {
+    CALLSTACK_TRACE();
+    errno_t err;
+
+    RISKY_EXPRESSION_SAFE(MappedFile_Open(cache_filename, mapped_file), err);
+    if ((err = ASTCache_Validate(mapped_file, NULL, false)) != VISMUT_ERROR_OK
+        || (err = ASTCache_Map(arena, mapped_file, module)) != VISMUT_ERROR_OK) {
+        MappedFile_Close(mapped_file);
+        return err;
+    }
+    return VISMUT_ERROR_OK;
+}
@@ -0,0 +1,27 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_CACHE_H
+#define VISMUT_AST_CACHE_H
+#include "../memory/arena.h"
+#include "../../io/mapped_file/mapped_file.h"
+#include "ast.h"
+
+// Bump whenever the node layout or the meaning of a cached field changes
+#define AST_CACHE_FORMAT_VERSION 3
+
+// lazy_functions tells the cache was built with ASTParser.lazy_function_bodies
+errno_t ASTCache_Store(const ASTModule *module, const char *cache_filename, StringView source, bool lazy_functions);
+
+// On success the node, position and list storage of the module point into mapped_file,
+// which has to stay open for as long as the module is used. A cache built in the other parse mode is stale:
+// a lazy one misses the functions nothing calls, with their syntax errors
+errno_t ASTCache_Load(Arena *arena, const char *cache_filename, StringView source, bool lazy_functions,
+                      MappedFile *mapped_file, ASTModule **module);
+
+// Same as ASTCache_Load for a cache built from another version of the source: the parser takes the functions
+// that did not change from it
+errno_t ASTCache_LoadPrevious(Arena *arena, const char *cache_filename, MappedFile *mapped_file, ASTModule **module);
+
+#endif //VISMUT_AST_CACHE_H
@@ -0,0 +1,282 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_compact.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_visit.h"
+#include "../errors/errors.h"
+
+typedef struct {
+    ASTModule *source;
+    ASTModule *module;
+    ASTNodeId *forward; // id of the copy of every source node, AST_NODE_NONE until it is reached
+    Symbol *moved_symbols; // copies chained through next until their uses are remapped
+    ASTNodeId first_copy; // copies are numbered from here on, the nodes before it are left alone
+    int64_t position_shift; // added to the source offset of every copied node
+} ASTCompactor;
+
+static uint8_t *ASTCompactor_String(const ASTCompactor *compactor, const uint8_t *str) {
+    if (str == NULL) return NULL;
+
+    const size_t size = strlen((const char *) str) + 1;
+    uint8_t *copy = Arena_Array(compactor->module->arena, uint8_t, size);
+    memcpy(copy, str, size);
+    return copy;
+}
+
+// The source symbol is left with a forwarding pointer to its copy, the way a copying collector does it
+static Symbol *ASTCompactor_Symbol(ASTCompactor *compactor, Symbol *symbol) {
+    if (symbol == NULL) return NULL;
+    if (symbol->flags & SYMBOL_FLAG_MOVED) return symbol->next;
+
+    Symbol *copy = Arena_Type(compactor->module->arena, Symbol);
+    *copy = *symbol;
+    copy->name = ASTCompactor_String(compactor, symbol->name);
+    copy->next = compactor->moved_symbols;
+    compactor->moved_symbols = copy;
+
+    symbol->flags |= SYMBOL_FLAG_MOVED;
+    symbol->next = copy;
+    return copy;
+}
+
+static FunctionSignature *ASTCompactor_Signature(const ASTCompactor *compactor,
+                                                 const FunctionSignature *signature) {
+    if (signature == NULL) return NULL;
+    return FunctionTable_Find(compactor->module->function_table, signature->function_name,
+                              signature->function_name_hash);
+}
+
+static errno_t ASTCompactor_Signatures(const ASTCompactor *compactor) {
+    errno_t err;
+    Arena *arena = compactor->module->arena;
+    const FunctionTable *function_table = compactor->source->function_table;
+
+    for (size_t i = 0; i < function_table->capacity; ++i) {
+        const FunctionSignature *signature = function_table->slots[i];
+        if (signature == NULL) continue;
+
+        const size_t params_count = signature->params.params_count;
+        FunctionSignature *copy = Arena_Type(arena, FunctionSignature);
+        *copy = (FunctionSignature){
+            .params = {
+                .param_names = Arena_Array(arena, const uint8_t *, params_count),
+                .param_types = Arena_Array(arena, VValueType, params_count),
+                .params_count = params_count,
+            },
+            .function_name = ASTCompactor_String(compactor, signature->function_name),
+            .scope = NULL,
+            .span = signature->span,
+            .span_hash = {signature->span_hash[0], signature->span_hash[1]},
+            .declaration = signature->declaration,
+            .function_name_hash = signature->function_name_hash,
+            .return_type = signature->return_type,
+            .flags = signature->flags,
+        };
+        for (size_t j = 0; j < params_count; ++j) {
+            copy->params.param_names[j] = ASTCompactor_String(compactor, signature->params.param_names[j]);
+            copy->params.param_types[j] = signature->params.param_types[j];
+        }
+        RISKY_EXPRESSION_SAFE(FunctionTable_Declare(compactor->module->function_table, copy), err);
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// List items keep the source ids, the lists of a node are laid out right where the node is entered
+static ASTNodeList ASTCompactor_List(const ASTCompactor *compactor, const ASTNodeList list) {
+    if (list.count == 0) {
+        return (ASTNodeList){0};
+    }
+    return ASTModule_CreateList(compactor->module, &AST_LIST_ITEM(compactor->source, list, 0), list.count);
+}
+
+static ASTNode ASTCompactor_CopyNode(ASTCompactor *compactor, const ASTNode *node) {
+    ASTNode copy = *node;
+    switch (node->type) {
+        case AST_LITERAL:
+            if (node->literal.type == VALUE_STR) {
+                copy.literal.str = ASTCompactor_String(compactor, node->literal.str);
+            }
+            break;
+        case AST_VAR_REF:
+            copy.var_ref.symbol = ASTCompactor_Symbol(compactor, node->var_ref.symbol);
+            // A resolved reference spells the name of its symbol
+            copy.var_ref.var_name = copy.var_ref.symbol != NULL
+                                        ? copy.var_ref.symbol->name
+                                        : ASTCompactor_String(compactor, node->var_ref.var_name);
+            break;
+        case AST_VAR_DECL:
+            copy.var_decl.symbol = ASTCompactor_Symbol(compactor, node->var_decl.symbol);
+            break;
+        case AST_FUNCTION_CALL:
+            copy.function_call.signature = ASTCompactor_Signature(compactor, node->function_call.signature);
+            copy.function_call.arguments = ASTCompactor_List(compactor, node->function_call.arguments);
+            break;
+        case AST_FUNCTION_DECL:
+            copy.function_decl.signature = ASTCompactor_Signature(compactor, node->function_decl.signature);
+            break;
+        case AST_PRINT_STMT:
+            copy.print_stmt.expressions = ASTCompactor_List(compactor, node->print_stmt.expressions);
+            break;
+        case AST_BLOCK:
+            // Scopes are only needed by the analysis, which has already run
+            copy.block.statements = ASTCompactor_List(compactor, node->block.statements);
+            copy.block.scope = NULL;
+            break;
+        case AST_MODULE:
+            copy.module.functions = ASTCompactor_List(compactor, node->module.functions);
+            copy.module.statements = ASTCompactor_List(compactor, node->module.statements);
+            break;
+        default:
+            break;
+    }
+    return copy;
+}
+
+static errno_t ASTCompactor_Enter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTCompactor *compactor = visitor->context;
+
+    // A shared node is reached once per occurrence and copied on the first one
+    if (compactor->forward[*slot] != AST_NODE_NONE) {
+        *skip_children = true;
+        return VISMUT_ERROR_OK;
+    }
+
+    const ASTNode copy = ASTCompactor_CopyNode(compactor, AST_NODE(compactor->source, *slot));
+    Position pos = ASTNode_Position(compactor->source, *slot);
+    pos.offset = (size_t) ((int64_t) pos.offset + compactor->position_shift);
+    if (*slot == compactor->source->root) {
+        ASTModule *module = compactor->module;
+        *AST_NODE(module, module->root) = copy;
+        ASTNode_SetPosition(module, module->root, pos);
+        compactor->forward[*slot] = module->root;
+    } else {
+        compactor->forward[*slot] = ASTModule_AppendNode(compactor->module, &copy, pos);
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static void ASTCompactor_RemapChildren(const ASTCompactor *compactor) {
+    ASTModule *module = compactor->module;
+    for (ASTNodeId id = compactor->first_copy; id < module->nodes_count; ++id) {
+        const uint32_t children_count = ASTNode_ChildrenCount(module, id);
+        for (uint32_t i = 0; i < children_count; ++i) {
+            ASTNodeId *slot = ASTNode_ChildSlot(module, id, i);
+            *slot = compactor->forward[*slot];
+        }
+    }
+}
+
+// Uses inside subtrees the optimizer cut off are not reachable, so they are dropped with them
+static void ASTCompactor_RemapSymbols(const ASTCompactor *compactor) {
+    ASTModule *module = compactor->module;
+    Symbol *symbol = compactor->moved_symbols;
+    while (symbol != NULL) {
+        Symbol *next = symbol->next;
+        const ASTNodeId *uses = symbol->uses;
+        const uint32_t uses_count = symbol->uses_count;
+
+        symbol->next = NULL;
+        symbol->declaration = compactor->forward[symbol->declaration];
+        symbol->uses = uses_count != 0 ? Arena_Array(module->arena, ASTNodeId, uses_count) : NULL;
+        symbol->uses_capacity = uses_count;
+        symbol->uses_count = 0;
+        symbol->reads_count = 0;
+        for (uint32_t i = 0; i < uses_count; ++i) {
+            const ASTNodeId use = compactor->forward[uses[i]];
+            if (use == AST_NODE_NONE) continue;
+
+            symbol->uses[symbol->uses_count++] = use;
+            if (!(AST_NODE(module, use)->flags & AST_NODE_FLAG_ASSIGN_TARGET)) {
+                ++symbol->reads_count;
+            }
+        }
+        symbol = next;
+    }
+}
+
+static void ASTCompactor_RemapSignatures(const ASTCompactor *compactor) {
+    const FunctionTable *function_table = compactor->module->function_table;
+    for (size_t i = 0; i < function_table->capacity; ++i) {
+        FunctionSignature *signature = function_table->slots[i];
+        if (signature != NULL) {
+            signature->declaration = compactor->forward[signature->declaration];
+        }
+    }
+}
+
+errno_t ASTModule_Compact(ASTModule *module, Arena *arena, ASTModule **out_module) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    ASTCompactor compactor = {
+        .source = module,
+        .module = ASTModule_Create(arena, NULL, Scope_Allocate(arena, NULL)),
+        .forward = calloc(module->nodes_count, sizeof(ASTNodeId)),
+        .moved_symbols = NULL,
+        .position_shift = 0,
+    };
+    if (compactor.forward == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    compactor.first_copy = compactor.module->root;
+    compactor.module->module_name = ASTCompactor_String(&compactor, module->module_name);
+
+    errno_t err = ASTCompactor_Signatures(&compactor);
+    if (err == VISMUT_ERROR_OK) {
+        ASTVisitor visitor;
+        ASTVisitor_Init(&visitor, module, &compactor);
+        visitor.enter = ASTCompactor_Enter;
+        err = ASTVisit(&visitor, &module->root);
+    }
+    if (err == VISMUT_ERROR_OK) {
+        ASTCompactor_RemapChildren(&compactor);
+        ASTCompactor_RemapSymbols(&compactor);
+        ASTCompactor_RemapSignatures(&compactor);
+        *out_module = compactor.module;
+    }
+
+    free(compactor.forward);
+    return err;
+}
+
+errno_t ASTModule_CopySubtrees(ASTModule *source, ASTModule *module, ASTCopiedSubtree *subtrees, const uint32_t count) {
+    CALLSTACK_TRACE();
+
+    ASTCompactor compactor = {
+        .source = source,
+        .module = module,
+        .forward = calloc(source->nodes_count, sizeof(ASTNodeId)),
+        .moved_symbols = NULL,
+        .first_copy = module->nodes_count,
+        .position_shift = 0,
+    };
+    if (compactor.forward == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, source, &compactor);
+    visitor.enter = ASTCompactor_Enter;
+
+    errno_t err = VISMUT_ERROR_OK;
+    for (uint32_t i = 0; i < count && err == VISMUT_ERROR_OK; ++i) {
+        ASTNodeId root = subtrees[i].source;
+        compactor.position_shift = subtrees[i].position_shift;
+        err = ASTVisit(&visitor, &root);
+    }
+    if (err == VISMUT_ERROR_OK) {
+        ASTCompactor_RemapChildren(&compactor);
+        ASTCompactor_RemapSymbols(&compactor);
+        for (uint32_t i = 0; i < count; ++i) {
+            subtrees[i].copy = compactor.forward[subtrees[i].source];
+        }
+    }
+
+    free(compactor.forward);
+    return err;
+}
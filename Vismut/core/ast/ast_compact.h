@@ -0,0 +1,26 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_COMPACT_H
+#define VISMUT_AST_COMPACT_H
+#include "../types.h"
+#include "ast.h"
+
+// Copies the nodes reachable from the root into a new module allocated in arena, numbered in DFS pre-order.
+// Symbols, signatures and strings are copied along, shared nodes stay shared. Scopes are left behind: they
+// are only needed by the analysis. The source module must not be used afterwards, so that its arena can go
+errno_t ASTModule_Compact(ASTModule *module, Arena *arena, ASTModule **out_module);
+
+typedef struct {
+    ASTNodeId source; // root in the source module
+    ASTNodeId copy; // root of the copy, set by ASTModule_CopySubtrees
+    int64_t position_shift; // moves the source offsets to where the subtree sits in the new source
+} ASTCopiedSubtree;
+
+// Appends copies of the subtrees to module, the same way ASTModule_Compact copies a whole module. Called
+// functions are looked up by name in the function table of module, so they have to be declared there first.
+// Symbols used inside the subtrees keep only those uses, the source module must not be used afterwards
+errno_t ASTModule_CopySubtrees(ASTModule *source, ASTModule *module, ASTCopiedSubtree *subtrees, uint32_t count);
+
+#endif //VISMUT_AST_COMPACT_H
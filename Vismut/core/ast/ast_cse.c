@@ -0,0 +1,563 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_cse.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_optimize.h"
+#include "ast_visit.h"
+#include "../errors/errors.h"
+#include "../memory/array.h"
+#include "../hash/murmur3.h"
+
+#define AST_CSE_SEED 0x5bd1e995
+
+// Written by a subtree that writes more than one variable, or calls a function that may write any
+static const Symbol AST_CSE_SEVERAL_VARIABLES;
+
+// Structure of an expression, with value numbers in place of its children
+typedef struct {
+    uint64_t payload; // bits of a literal, symbol of a variable read, types of a cast
+    uint32_t operands[2]; // value numbers of the children, version and epoch of a variable read
+    uint16_t op;
+    uint8_t type;
+    uint8_t expr_type;
+} ASTCSEKey;
+
+typedef struct {
+    ASTCSEKey key;
+    uint32_t hash;
+    uint32_t count; // occurrences left to share
+    uint32_t first; // occurrence index + 1, then linked through ASTCSEOccurrence.next
+    uint32_t last;
+    Symbol *temporary; // set once the first occurrence moved to its declaration
+    bool chosen;
+} ASTCSEValue;
+
+typedef struct {
+    ASTNodeId node;
+    ASTNodeId parent;
+    uint32_t index; // of the node among the children of its parent
+    uint32_t statement;
+    uint32_t number;
+    uint32_t next; // occurrence index + 1 of the same value
+    bool unconditional;
+    bool removed;
+} ASTCSEOccurrence;
+
+// Open addressing slot, a slot of an older generation is free
+typedef struct {
+    uint32_t generation;
+    uint32_t hash;
+    uint32_t number; // value number for the numbers table, version for the versions table
+    const Symbol *symbol;
+} ASTCSESlot;
+
+typedef struct {
+    ASTCSESlot *slots;
+    uint32_t capacity;
+    uint32_t count;
+} ASTCSETable;
+
+typedef struct {
+    ASTModule *module;
+    ASTVisitor forget_uses;
+    uint32_t generation; // one per block
+    uint32_t epoch; // bumped by the calls that may write any variable
+
+    ASTCSETable numbers;
+    ASTCSETable versions;
+
+    ASTCSEValue *values;
+    uint32_t values_count;
+    uint32_t values_capacity;
+
+    ASTCSEOccurrence *occurrences;
+    uint32_t occurrences_count;
+    uint32_t occurrences_capacity;
+    uint32_t *occurrence_of; // occurrence index + 1 by node id, for the nodes of the block being looked at
+    const Symbol **written; // by node id: the variable the subtree writes, NULL when none
+    uint32_t nodes_count; // numbered nodes, the temporaries and their reads come after them
+
+    bool *has_side_effects; // by statement
+    uint32_t statements_capacity;
+
+    ASTNodeId block; // AST_BLOCK or AST_MODULE being looked at
+    ASTTemporaries temporaries; // `$_vismut_cseN`, declared in front of the statement of the first occurrence
+} ASTCSE;
+
+// Only the slots of the current generation are moved over
+static void ASTCSETable_Grow(ASTCSETable *table, const uint32_t generation) {
+    ASTCSESlot *old_slots = table->slots;
+    const uint32_t old_capacity = table->capacity;
+
+    table->capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+    table->slots = calloc(table->capacity, sizeof(*table->slots));
+    if (table->slots == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+
+    const uint32_t mask = table->capacity - 1;
+    for (uint32_t i = 0; i < old_capacity; ++i) {
+        if (old_slots[i].generation != generation) continue;
+
+        uint32_t index = old_slots[i].hash & mask;
+        while (table->slots[index].generation == generation) {
+            index = (index + 1) & mask;
+        }
+        table->slots[index] = old_slots[i];
+    }
+    free(old_slots);
+}
+
+// Version of a variable: bumped by every write, so that reads across a write get different numbers
+static uint32_t *ASTCSE_Version(ASTCSE *cse, const Symbol *symbol) {
+    ASTCSETable *table = &cse->versions;
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        ASTCSETable_Grow(table, cse->generation);
+    }
+
+    const uint32_t hash = murmurhash3_int64((int64_t) (uintptr_t) symbol, AST_CSE_SEED);
+    const uint32_t mask = table->capacity - 1;
+    uint32_t index = hash & mask;
+    while (table->slots[index].generation == cse->generation) {
+        if (table->slots[index].symbol == symbol) {
+            return &table->slots[index].number;
+        }
+        index = (index + 1) & mask;
+    }
+    table->slots[index] = (ASTCSESlot){
+        .generation = cse->generation,
+        .hash = hash,
+        .number = 0,
+        .symbol = symbol,
+    };
+    ++table->count;
+    return &table->slots[index].number;
+}
+
+attribute_pure
+static uint32_t ASTCSEKey_Hash(const ASTCSEKey *key) {
+    uint32_t hash = murmurhash3_combine(AST_CSE_SEED, (uint32_t) key->type << 24 | (uint32_t) key->expr_type << 16
+                                                      | key->op);
+    hash = murmurhash3_combine(hash, murmurhash3_int64((int64_t) key->payload, AST_CSE_SEED));
+    hash = murmurhash3_combine(hash, key->operands[0]);
+    return murmurhash3_combine(hash, key->operands[1]);
+}
+
+attribute_pure
+static bool ASTCSEKey_Equals(const ASTCSEKey *a, const ASTCSEKey *b) {
+    return a->type == b->type && a->expr_type == b->expr_type && a->op == b->op && a->payload == b->payload
+           && a->operands[0] == b->operands[0] && a->operands[1] == b->operands[1];
+}
+
+// Value number of the key, a new one when no equal key was numbered in the block
+static uint32_t ASTCSE_Number(ASTCSE *cse, const ASTCSEKey *key) {
+    ASTCSETable *table = &cse->numbers;
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        ASTCSETable_Grow(table, cse->generation);
+    }
+
+    const uint32_t hash = ASTCSEKey_Hash(key);
+    const uint32_t mask = table->capacity - 1;
+    uint32_t index = hash & mask;
+    while (table->slots[index].generation == cse->generation) {
+        const ASTCSESlot slot = table->slots[index];
+        if (slot.hash == hash && ASTCSEKey_Equals(&cse->values[slot.number - 1].key, key)) {
+            return slot.number;
+        }
+        index = (index + 1) & mask;
+    }
+
+    cse->values = Array_Grow(cse->values, &cse->values_capacity, cse->values_count + 1, sizeof(*cse->values));
+    cse->values[cse->values_count++] = (ASTCSEValue){
+        .key = *key,
+        .hash = hash,
+    };
+    table->slots[index] = (ASTCSESlot){
+        .generation = cse->generation,
+        .hash = hash,
+        .number = cse->values_count,
+    };
+    ++table->count;
+    return cse->values_count;
+}
+
+static void ASTCSE_Invalidate(ASTCSE *cse, const ASTNode *written) {
+    if (written->type == AST_VAR_REF && written->var_ref.symbol != NULL) {
+        ++*ASTCSE_Version(cse, written->var_ref.symbol);
+    }
+}
+
+// Bumps the versions of what a statement the numbering does not look into may write
+static void ASTCSE_InvalidateWritten(ASTCSE *cse, const ASTNodeId node_id) {
+    const Symbol *written = cse->written[node_id];
+    if (written == &AST_CSE_SEVERAL_VARIABLES) {
+        ++cse->epoch;
+    } else if (written != NULL) {
+        ++*ASTCSE_Version(cse, written);
+    }
+}
+
+attribute_const
+static const Symbol *ASTCSE_MergeWritten(const Symbol *a, const Symbol *b) {
+    if (a == NULL || a == b) {
+        return b;
+    }
+    return b == NULL ? a : &AST_CSE_SEVERAL_VARIABLES;
+}
+
+// Sums up the variables a subtree writes, its children are summed up already
+static void ASTCSE_SumUpWritten(ASTCSE *cse, const ASTNodeId node_id) {
+    const ASTNode *node = AST_NODE(cse->module, node_id);
+    const Symbol *written = NULL;
+    switch (node->type) {
+        case AST_VAR_REF:
+            if (node->flags & AST_NODE_FLAG_ASSIGN_TARGET) {
+                written = node->var_ref.symbol;
+            }
+            break;
+        case AST_UNARY:
+            if (node->unary_op.op == AST_UNARY_INCREMENT || node->unary_op.op == AST_UNARY_DECREMENT) {
+                const ASTNode *operand = AST_NODE(cse->module, node->unary_op.operand);
+                written = operand->type == AST_VAR_REF ? operand->var_ref.symbol : NULL;
+            }
+            break;
+        case AST_FUNCTION_CALL:
+            // A nested function may write the variables of its enclosing one
+            if (!IsNodePure(node)) {
+                written = &AST_CSE_SEVERAL_VARIABLES;
+            }
+            break;
+        case AST_FUNCTION_DECL:
+            // Runs where it is called, not where it is declared
+            cse->written[node_id] = NULL;
+            return;
+        default:
+            break;
+    }
+
+    const uint32_t count = ASTNode_ChildrenCount(cse->module, node_id);
+    for (uint32_t i = 0; i < count; ++i) {
+        const ASTNodeId child = *ASTNode_ChildSlot(cse->module, node_id, i);
+        if (child != AST_NODE_NONE) {
+            written = ASTCSE_MergeWritten(written, cse->written[child]);
+        }
+    }
+    cse->written[node_id] = written;
+}
+
+attribute_pure
+static bool ASTCSE_IsShareable(const ASTNode *node) {
+    if ((node->expr_type != VALUE_I64 && node->expr_type != VALUE_F64) || !IsNodePure(node)) {
+        return false;
+    }
+    switch (node->type) {
+        case AST_UNARY:
+            return node->unary_op.op != AST_UNARY_INCREMENT && node->unary_op.op != AST_UNARY_DECREMENT;
+        case AST_BINARY:
+            return node->binary_op.op != AST_BINARY_ASSIGN;
+        case AST_TYPE_CAST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void ASTCSE_Occurrence(ASTCSE *cse, const ASTNodeId node, const ASTNodeId parent, const uint32_t index,
+                              const uint32_t statement, const uint32_t number, const bool unconditional) {
+    DEBUG_ASSERT(node < cse->nodes_count);
+    cse->occurrences = Array_Grow(cse->occurrences, &cse->occurrences_capacity, cse->occurrences_count + 1,
+                                  sizeof(*cse->occurrences));
+    cse->occurrences[cse->occurrences_count++] = (ASTCSEOccurrence){
+        .node = node,
+        .parent = parent,
+        .index = index,
+        .statement = statement,
+        .number = number,
+        .unconditional = unconditional,
+    };
+    cse->occurrence_of[node] = cse->occurrences_count;
+}
+
+// Numbers the expressions of a statement in evaluation order, the value number of the node or 0 when it has
+// none. Writes bump the versions on the way, and mark the statement unless the write is the statement itself
+static uint32_t ASTCSE_NumberExpression(ASTCSE *cse, const ASTNodeId parent, const uint32_t index,
+                                        const uint32_t statement, const bool unconditional, const bool is_root) {
+    const ASTNodeId node_id = *ASTNode_ChildSlot(cse->module, parent, index);
+    if (node_id == AST_NODE_NONE) {
+        return 0;
+    }
+    const ASTNode *node = AST_NODE(cse->module, node_id);
+
+    ASTCSEKey key = {
+        .type = node->type,
+        .expr_type = node->expr_type,
+    };
+    switch (node->type) {
+        case AST_LITERAL:
+            if (node->literal.type != VALUE_I64 && node->literal.type != VALUE_F64) {
+                return 0;
+            }
+            memcpy(&key.payload, &node->literal.i64, sizeof(key.payload));
+            return ASTCSE_Number(cse, &key);
+        case AST_VAR_REF:
+            if (node->var_ref.symbol == NULL || (node->flags & AST_NODE_FLAG_ASSIGN_TARGET)) {
+                return 0;
+            }
+            key.payload = (uint64_t) (uintptr_t) node->var_ref.symbol;
+            key.operands[0] = *ASTCSE_Version(cse, node->var_ref.symbol);
+            key.operands[1] = cse->epoch;
+            return ASTCSE_Number(cse, &key);
+        case AST_UNARY:
+            key.op = node->unary_op.op;
+            if (key.op == AST_UNARY_INCREMENT || key.op == AST_UNARY_DECREMENT) {
+                ASTCSE_Invalidate(cse, AST_NODE(cse->module, node->unary_op.operand));
+                cse->has_side_effects[statement] = true;
+                return 0;
+            }
+            key.operands[0] = ASTCSE_NumberExpression(cse, node_id, 0, statement, unconditional, false);
+            break;
+        case AST_BINARY:
+            key.op = node->binary_op.op;
+            if (key.op == AST_BINARY_ASSIGN) {
+                // The target is written once the value is computed
+                ASTCSE_NumberExpression(cse, node_id, 1, statement, unconditional, false);
+                ASTCSE_Invalidate(cse, AST_NODE(cse->module, node->binary_op.left));
+                cse->has_side_effects[statement] |= !is_root;
+                return 0;
+            }
+            key.operands[0] = ASTCSE_NumberExpression(cse, node_id, 0, statement, unconditional, false);
+            key.operands[1] = ASTCSE_NumberExpression(
+                cse, node_id, 1, statement,
+                unconditional && key.op != AST_BINARY_LOGICAL_AND && key.op != AST_BINARY_LOGICAL_OR, false);
+            break;
+        case AST_TYPE_CAST:
+            key.payload = (uint64_t) node->type_cast.from_type << 16 | (uint64_t) node->type_cast.target_type << 8
+                          | node->type_cast.is_explicit;
+            key.operands[0] = ASTCSE_NumberExpression(cse, node_id, 0, statement, unconditional, false);
+            break;
+        case AST_TERNARY:
+            ASTCSE_NumberExpression(cse, node_id, 0, statement, unconditional, false);
+            ASTCSE_NumberExpression(cse, node_id, 1, statement, false, false);
+            ASTCSE_NumberExpression(cse, node_id, 2, statement, false, false);
+            return 0;
+        case AST_FUNCTION_CALL: {
+            const uint32_t count = node->function_call.arguments.count;
+            for (uint32_t i = 0; i < count; ++i) {
+                ASTCSE_NumberExpression(cse, node_id, i, statement, unconditional, false);
+            }
+            if (!IsNodePure(node)) {
+                ++cse->epoch;
+                cse->has_side_effects[statement] = true;
+            }
+            return 0;
+        }
+        default:
+            // Anything else is not looked into, only the variables it writes count
+            ASTCSE_InvalidateWritten(cse, node_id);
+            cse->has_side_effects[statement] = true;
+            return 0;
+    }
+
+    if (key.operands[0] == 0 || (node->type == AST_BINARY && key.operands[1] == 0) || !ASTCSE_IsShareable(node)) {
+        return 0;
+    }
+    const uint32_t number = ASTCSE_Number(cse, &key);
+    ASTCSE_Occurrence(cse, node_id, parent, index, statement, number, unconditional);
+    return number;
+}
+
+static void ASTCSE_NumberStatement(ASTCSE *cse, const ASTNodeId block, const uint32_t index,
+                                   const uint32_t statement) {
+    const ASTNodeId node_id = *ASTNode_ChildSlot(cse->module, block, index);
+    const ASTNode *node = AST_NODE(cse->module, node_id);
+
+    switch (node->type) {
+        case AST_VAR_DECL:
+            ASTCSE_NumberExpression(cse, node_id, 0, statement, true, false);
+            break;
+        case AST_PRINT_STMT:
+            for (uint32_t i = 0; i < node->print_stmt.expressions.count; ++i) {
+                ASTCSE_NumberExpression(cse, node_id, i, statement, true, false);
+            }
+            break;
+        case AST_IF_STMT:
+            // The branches are blocks of their own
+            ASTCSE_NumberExpression(cse, node_id, 0, statement, true, false);
+            if (node->if_stmt.then_block != AST_NODE_NONE) {
+                ASTCSE_InvalidateWritten(cse, node->if_stmt.then_block);
+            }
+            if (node->if_stmt.else_block != AST_NODE_NONE) {
+                ASTCSE_InvalidateWritten(cse, node->if_stmt.else_block);
+            }
+            break;
+        case AST_WHILE_STMT:
+        case AST_BLOCK:
+            ASTCSE_InvalidateWritten(cse, node_id);
+            break;
+        case AST_FUNCTION_DECL:
+            break;
+        default:
+            ASTCSE_NumberExpression(cse, block, index, statement, true, true);
+            break;
+    }
+}
+
+// Drops a later occurrence and everything nested in it from the counts
+static void ASTCSE_Remove(ASTCSE *cse, const ASTNodeId node_id) {
+    const uint32_t occurrence = cse->occurrence_of[node_id];
+    if (occurrence != 0 && !cse->occurrences[occurrence - 1].removed) {
+        cse->occurrences[occurrence - 1].removed = true;
+        --cse->values[cse->occurrences[occurrence - 1].number - 1].count;
+    }
+    const ASTNode *node = AST_NODE(cse->module, node_id);
+    if (node->type != AST_UNARY && node->type != AST_BINARY && node->type != AST_TYPE_CAST) {
+        return;
+    }
+    const uint32_t count = ASTNode_ChildrenCount(cse->module, node_id);
+    for (uint32_t i = 0; i < count; ++i) {
+        ASTCSE_Remove(cse, *ASTNode_ChildSlot(cse->module, node_id, i));
+    }
+}
+
+// Largest values first: the children of a shared expression repeat as often as it, with nothing left to share
+static void ASTCSE_Choose(ASTCSE *cse) {
+    for (uint32_t i = 0; i < cse->occurrences_count; ++i) {
+        ASTCSEOccurrence *occurrence = &cse->occurrences[i];
+        if (cse->has_side_effects[occurrence->statement]) {
+            occurrence->removed = true;
+            continue;
+        }
+        ASTCSEValue *value = &cse->values[occurrence->number - 1];
+        if (value->first == 0) {
+            value->first = i + 1;
+        } else {
+            cse->occurrences[value->last - 1].next = i + 1;
+        }
+        value->last = i + 1;
+        ++value->count;
+    }
+
+    // An expression is numbered after its children
+    for (uint32_t number = cse->values_count; number > 0; --number) {
+        ASTCSEValue *value = &cse->values[number - 1];
+        uint32_t first = value->first;
+        while (first != 0 && cse->occurrences[first - 1].removed) {
+            first = cse->occurrences[first - 1].next;
+        }
+        value->first = first;
+        if (value->count < 2 || !cse->occurrences[first - 1].unconditional) {
+            continue;
+        }
+        value->chosen = true;
+        for (uint32_t later = cse->occurrences[first - 1].next; later != 0; later = cse->occurrences[later - 1].next) {
+            if (!cse->occurrences[later - 1].removed) {
+                ASTCSE_Remove(cse, cse->occurrences[later - 1].node);
+                // Out of the counts of the values nested in it, but replaced by a read itself
+                cse->occurrences[later - 1].removed = false;
+            }
+        }
+    }
+}
+
+// Moves the first occurrence of every chosen value to a temporary and replaces the later ones by its reads.
+// Occurrences are in evaluation order, so a temporary is declared after the ones its value reads
+static void ASTCSE_Rewrite(ASTCSE *cse) {
+    ASTModule *module = cse->module;
+    for (uint32_t i = 0; i < cse->occurrences_count; ++i) {
+        const ASTCSEOccurrence *occurrence = &cse->occurrences[i];
+        ASTCSEValue *value = &cse->values[occurrence->number - 1];
+        if (occurrence->removed || !value->chosen) continue;
+
+        ASTNodeId read;
+        if (value->temporary == NULL) {
+            DEBUG_ASSERT(value->first == i + 1);
+            read = ASTTemporaries_Declare(&cse->temporaries, module, cse->block, occurrence->statement,
+                                          occurrence->node);
+            value->temporary = AST_NODE(module, read)->var_ref.symbol;
+        } else {
+            ASTOptimize_ForgetUses(&cse->forget_uses, occurrence->node);
+            read = CreateVarReadNode(module, ASTNode_Position(module, occurrence->node), value->temporary);
+        }
+        *ASTNode_ChildSlot(module, occurrence->parent, occurrence->index) = read;
+    }
+}
+
+static void ASTCSE_Block(ASTCSE *cse, const ASTNodeId block_id) {
+    ASTNode *block = AST_NODE(cse->module, block_id);
+    ASTNodeList *statements = block->type == AST_BLOCK ? &block->block.statements : &block->module.statements;
+    const uint32_t offset = block->type == AST_BLOCK ? 0 : block->module.functions.count;
+    if (statements->count < 2) {
+        return;
+    }
+
+    ++cse->generation;
+    cse->numbers.count = 0;
+    cse->versions.count = 0;
+    cse->values_count = 0;
+    cse->occurrences_count = 0;
+    cse->block = block_id;
+    cse->has_side_effects = Array_Grow(cse->has_side_effects, &cse->statements_capacity, statements->count,
+                                       sizeof(*cse->has_side_effects));
+    memset(cse->has_side_effects, 0, sizeof(*cse->has_side_effects) * statements->count);
+
+    const uint32_t count = statements->count;
+    for (uint32_t i = 0; i < count; ++i) {
+        ASTCSE_NumberStatement(cse, block_id, offset + i, i);
+    }
+    ASTCSE_Choose(cse);
+    ASTCSE_Rewrite(cse);
+    ASTTemporaries_Insert(&cse->temporaries, cse->module, block_id);
+
+    for (uint32_t i = 0; i < cse->occurrences_count; ++i) {
+        cse->occurrence_of[cse->occurrences[i].node] = 0;
+    }
+}
+
+// Nested blocks are done before the blocks holding them, which only see the variables they write
+static errno_t ASTCSE_Leave(ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTCSE *cse = visitor->context;
+    const ASTNode *node = AST_NODE(visitor->module, *slot);
+    ASTCSE_SumUpWritten(cse, *slot);
+    if (node->type == AST_BLOCK || node->type == AST_MODULE) {
+        ASTCSE_Block(cse, *slot);
+    }
+    return VISMUT_ERROR_OK;
+}
+
+errno_t ASTModule_EliminateCommonSubexpressions(ASTModule *module) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    ASTCSE cse = {
+        .module = module,
+        .nodes_count = module->nodes_count,
+        .temporaries.prefix = "_vismut_cse",
+    };
+    cse.occurrence_of = calloc(module->nodes_count, sizeof(*cse.occurrence_of));
+    cse.written = calloc(module->nodes_count, sizeof(*cse.written));
+    if (cse.occurrence_of == NULL || cse.written == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    ASTOptimize_InitForgetUses(&cse.forget_uses, module);
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &cse);
+    visitor.enter = ASTOptimize_SkipReusedEnter;
+    visitor.leave = ASTCSE_Leave;
+    const errno_t err = ASTVisit(&visitor, &module->root);
+
+    free(cse.numbers.slots);
+    free(cse.versions.slots);
+    free(cse.values);
+    free(cse.occurrences);
+    free(cse.occurrence_of);
+    free(cse.written);
+    free(cse.has_side_effects);
+    ASTTemporaries_Free(&cse.temporaries);
+    return err;
+}
@@ -0,0 +1,17 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_CSE_H
+#define VISMUT_AST_CSE_H
+#include "../types.h"
+#include "ast.h"
+
+// Computes a pure unary, binary or cast expression repeated among the statements of a block only once: the
+// first occurrence moves to a temporary declared in front of its statement, the others read the temporary.
+// Occurrences are equal when their trees are and no operand variable was written in between, nested blocks
+// and loops only count for the variables they write. The first occurrence has to be evaluated unconditionally,
+// and statements with side effects inside their expressions are left as they are
+errno_t ASTModule_EliminateCommonSubexpressions(ASTModule *module);
+
+#endif //VISMUT_AST_CSE_H
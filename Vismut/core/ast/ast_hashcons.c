@@ -0,0 +1,219 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_hashcons.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_visit.h"
+#include "../errors/errors.h"
+#include "../hash/murmur3.h"
+
+#define AST_HASHCONS_SEED 0x2f6b1a53
+
+// Whether the node may be shared: it has to be pure and must not be written through
+attribute_pure
+static bool ASTHashCons_IsInternable(const ASTNode *node) {
+    switch (node->type) {
+        case AST_LITERAL:
+            return node->literal.type == VALUE_I64 || node->literal.type == VALUE_F64
+                   || node->literal.type == VALUE_STR;
+        case AST_VAR_REF:
+            return node->var_ref.symbol != NULL && !(node->flags & AST_NODE_FLAG_ASSIGN_TARGET);
+        case AST_UNARY:
+        case AST_BINARY:
+        case AST_TYPE_CAST:
+            return IsNodePure(node);
+        default:
+            return false;
+    }
+}
+
+// Children are interned before their parents, so hashing a child id stands for hashing the whole subtree
+attribute_pure
+static uint32_t ASTHashCons_Hash(const ASTNode *node) {
+    uint32_t hash = murmurhash3_combine(AST_HASHCONS_SEED, (uint32_t) node->type << 8 | node->expr_type);
+    switch (node->type) {
+        case AST_LITERAL:
+            switch (node->literal.type) {
+                case VALUE_I64:
+                    return murmurhash3_combine(hash, murmurhash3_int64(node->literal.i64, AST_HASHCONS_SEED));
+                case VALUE_F64:
+                    return murmurhash3_combine(hash, murmurhash3_double(node->literal.f64, AST_HASHCONS_SEED));
+                case VALUE_STR:
+                    return murmurhash3_combine(hash, murmurhash3_string(node->literal.str, AST_HASHCONS_SEED));
+                default:
+                    return hash;
+            }
+        case AST_VAR_REF:
+            // By identity, as compared: the name hash would put every `i` of every function in one chain
+            return murmurhash3_combine(hash, murmurhash3_int64((int64_t) (uintptr_t) node->var_ref.symbol,
+                                                               AST_HASHCONS_SEED));
+        case AST_UNARY:
+            hash = murmurhash3_combine(hash, node->unary_op.op);
+            return murmurhash3_combine(hash, node->unary_op.operand);
+        case AST_BINARY:
+            hash = murmurhash3_combine(hash, node->binary_op.op);
+            hash = murmurhash3_combine(hash, node->binary_op.left);
+            return murmurhash3_combine(hash, node->binary_op.right);
+        case AST_TYPE_CAST:
+            hash = murmurhash3_combine(hash, (uint32_t) node->type_cast.from_type << 8 | node->type_cast.target_type);
+            return murmurhash3_combine(hash, node->type_cast.expression);
+        default:
+            return hash;
+    }
+}
+
+attribute_pure
+static bool ASTHashCons_Equals(const ASTNode *a, const ASTNode *b) {
+    if (a->type != b->type || a->expr_type != b->expr_type) {
+        return false;
+    }
+    switch (a->type) {
+        case AST_LITERAL:
+            if (a->literal.type != b->literal.type) {
+                return false;
+            }
+            switch (a->literal.type) {
+                case VALUE_I64:
+                    return a->literal.i64 == b->literal.i64;
+                case VALUE_F64:
+                    // Bitwise, so that 0.0 and -0.0 stay apart and NaN matches itself
+                    return memcmp(&a->literal.f64, &b->literal.f64, sizeof(a->literal.f64)) == 0;
+                case VALUE_STR:
+                    return strcmp((const char *) a->literal.str, (const char *) b->literal.str) == 0;
+                default:
+                    return false;
+            }
+        case AST_VAR_REF:
+            return a->var_ref.symbol == b->var_ref.symbol;
+        case AST_UNARY:
+            return a->unary_op.op == b->unary_op.op && a->unary_op.operand == b->unary_op.operand;
+        case AST_BINARY:
+            return a->binary_op.op == b->binary_op.op && a->binary_op.left == b->binary_op.left
+                   && a->binary_op.right == b->binary_op.right;
+        case AST_TYPE_CAST:
+            return a->type_cast.from_type == b->type_cast.from_type
+                   && a->type_cast.target_type == b->type_cast.target_type
+                   && a->type_cast.is_explicit == b->type_cast.is_explicit
+                   && a->type_cast.expression == b->type_cast.expression;
+        default:
+            return false;
+    }
+}
+
+void ASTHashCons_Init(ASTHashCons *table, ASTModule *module) {
+    *table = (ASTHashCons){
+        .module = module,
+        .entries = Arena_Array(module->arena, ASTHashConsEntry, AST_HASHCONS_INITIAL_CAPACITY),
+        .capacity = AST_HASHCONS_INITIAL_CAPACITY,
+        .count = 0,
+    };
+    memset(table->entries, 0, sizeof(*table->entries) * table->capacity);
+}
+
+static void ASTHashCons_Grow(ASTHashCons *table) {
+    const ASTHashConsEntry *old_entries = table->entries;
+    const uint32_t old_capacity = table->capacity;
+
+    table->capacity = old_capacity * 2;
+    table->entries = Arena_Array(table->module->arena, ASTHashConsEntry, table->capacity);
+    memset(table->entries, 0, sizeof(*table->entries) * table->capacity);
+
+    const uint32_t mask = table->capacity - 1;
+    for (uint32_t i = 0; i < old_capacity; ++i) {
+        if (old_entries[i].node == AST_NODE_NONE) continue;
+
+        uint32_t index = old_entries[i].hash & mask;
+        while (table->entries[index].node != AST_NODE_NONE) {
+            index = (index + 1) & mask;
+        }
+        table->entries[index] = old_entries[i];
+    }
+}
+
+// Index of the entry holding a node equal to `node`, or of the free entry where it belongs
+static uint32_t ASTHashCons_Probe(const ASTHashCons *table, const ASTNodeId node_id, const uint32_t hash) {
+    const ASTNode *node = AST_NODE(table->module, node_id);
+    const uint32_t mask = table->capacity - 1;
+    uint32_t index = hash & mask;
+    while (table->entries[index].node != AST_NODE_NONE) {
+        const ASTHashConsEntry entry = table->entries[index];
+        if (entry.node == node_id
+            || (entry.hash == hash && ASTHashCons_Equals(AST_NODE(table->module, entry.node), node))) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+ASTNodeId ASTHashCons_Intern(ASTHashCons *table, const ASTNodeId node_id) {
+    const ASTNode *node = AST_NODE(table->module, node_id);
+    if (!ASTHashCons_IsInternable(node)) {
+        return node_id;
+    }
+
+    // Keep the load factor under 3/4
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        ASTHashCons_Grow(table);
+    }
+
+    const uint32_t hash = ASTHashCons_Hash(node);
+    ASTHashConsEntry *entry = &table->entries[ASTHashCons_Probe(table, node_id, hash)];
+    if (entry->node == AST_NODE_NONE) {
+        *entry = (ASTHashConsEntry){
+            .hash = hash,
+            .node = node_id,
+        };
+        ++table->count;
+    }
+    return entry->node;
+}
+
+static errno_t ASTModule_HashConsLeave(ASTVisitor *visitor, ASTNodeId *slot) {
+    *slot = ASTHashCons_Intern(visitor->context, *slot);
+    return VISMUT_ERROR_OK;
+}
+
+// Symbols keep one use per occurrence: rename the uses of dropped duplicates to the shared node in one sweep
+static void ASTModule_HashConsRenameUses(ASTHashCons *table) {
+    for (uint32_t i = 0; i < table->capacity; ++i) {
+        const ASTNodeId node_id = table->entries[i].node;
+        if (node_id == AST_NODE_NONE) continue;
+
+        // Every symbol has a single type, so it is interned as exactly one variable read
+        const ASTNode *node = AST_NODE(table->module, node_id);
+        if (node->type != AST_VAR_REF) continue;
+
+        Symbol *symbol = node->var_ref.symbol;
+        for (uint32_t use = 0; use < symbol->uses_count; ++use) {
+            const ASTNodeId use_id = symbol->uses[use];
+            const ASTNode *use_node = AST_NODE(table->module, use_id);
+            if (ASTHashCons_IsInternable(use_node)) {
+                const ASTHashConsEntry entry = table->entries[
+                    ASTHashCons_Probe(table, use_id, ASTHashCons_Hash(use_node))];
+                DEBUG_ASSERT(entry.node != AST_NODE_NONE);
+                symbol->uses[use] = entry.node;
+            }
+        }
+    }
+}
+
+errno_t ASTModule_HashCons(ASTModule *module) {
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    ASTHashCons table;
+    ASTHashCons_Init(&table, module);
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &table);
+    visitor.leave = ASTModule_HashConsLeave;
+
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTVisit(&visitor, &module->root), err);
+    ASTModule_HashConsRenameUses(&table);
+    return VISMUT_ERROR_OK;
+}
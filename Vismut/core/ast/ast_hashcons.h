@@ -0,0 +1,36 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_HASHCONS_H
+#define VISMUT_AST_HASHCONS_H
+#include "../types.h"
+#include "ast.h"
+
+#define AST_HASHCONS_INITIAL_CAPACITY 256
+
+typedef struct {
+    uint32_t hash;
+    ASTNodeId node;
+} ASTHashConsEntry;
+
+// Structural table of pure expressions: literals, variable reads and pure unary, binary and cast nodes.
+// Interned nodes are shared between all their occurrences, so two interned subtrees are equal exactly
+// when their ids are equal. Shared nodes must not be rewritten in place afterwards
+typedef struct {
+    ASTModule *module;
+    ASTHashConsEntry *entries; // open addressing, AST_NODE_NONE marks a free entry
+    uint32_t capacity;
+    uint32_t count;
+} ASTHashCons;
+
+void ASTHashCons_Init(ASTHashCons *table, ASTModule *module);
+
+// Returns the interned node equal to node_id, the children of node_id must already be interned.
+// Nodes that cannot be shared are returned as is
+ASTNodeId ASTHashCons_Intern(ASTHashCons *table, ASTNodeId node_id);
+
+// Interns every pure expression of the module, bottom-up
+errno_t ASTModule_HashCons(ASTModule *module);
+
+#endif //VISMUT_AST_HASHCONS_H
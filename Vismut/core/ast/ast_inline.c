@@ -0,0 +1,392 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_inline.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_optimize.h"
+#include "ast_visit.h"
+#include "../errors/errors.h"
+#include "../memory/array.h"
+
+typedef struct {
+    ASTModule *module;
+    ASTVisitor scan;
+    ASTVisitor copy;
+    ASTVisitor forget_uses;
+    FunctionSignature *caller; // top-level function being walked, NULL in the module statements
+
+    // The call being inlined
+    const FunctionSignature *callee;
+    ASTNodeId *arguments; // by parameter, what its reads become
+    uint32_t *reads; // by parameter
+    uint32_t arguments_capacity;
+    uint32_t reads_capacity;
+    uint32_t nodes_count;
+    bool inlinable;
+    bool inlined; // by the current walk
+
+    ASTNodeId *copies; // copied children waiting for their parent
+    uint32_t copies_count;
+    uint32_t copies_capacity;
+
+    ASTTemporaries temporaries; // `$_vismut_inlineN`, the arguments stored before the call
+} ASTInliner;
+
+// Index of the parameter of the callee a variable read refers to, params_count for any other variable
+attribute_pure
+static size_t ASTInliner_Param(const FunctionSignature *callee, const Symbol *symbol) {
+    // Parameters are the only symbols without a declaration
+    if (symbol != NULL && symbol->declaration == AST_NODE_NONE) {
+        for (size_t i = 0; i < callee->params.params_count; ++i) {
+            if (strcmp((const char *) callee->params.param_names[i], (const char *) symbol->name) == 0) {
+                return i;
+            }
+        }
+    }
+    return callee->params.params_count;
+}
+
+// Counts the nodes and the parameter reads of the callee body, which may read nothing but its parameters
+static errno_t ASTInliner_ScanEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTInliner *inliner = visitor->context;
+    const ASTNode *node = AST_NODE(inliner->module, *slot);
+
+    if (++inliner->nodes_count > AST_INLINE_MAX_NODES) {
+        inliner->inlinable = false;
+    }
+    switch (node->type) {
+        case AST_VAR_REF: {
+            const size_t param = ASTInliner_Param(inliner->callee, node->var_ref.symbol);
+            if (param == inliner->callee->params.params_count) {
+                inliner->inlinable = false;
+            } else {
+                ++inliner->reads[param];
+            }
+            break;
+        }
+        case AST_FUNCTION_CALL:
+            if (node->function_call.signature == inliner->callee) {
+                inliner->inlinable = false;
+            }
+            break;
+        default:
+            break;
+    }
+    if (!inliner->inlinable) {
+        *skip_children = true;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Fresh copy of a literal or of a variable read
+static ASTNodeId ASTInliner_CopyLeaf(const ASTInliner *inliner, const ASTNodeId source) {
+    ASTModule *module = inliner->module;
+    const ASTNode *node = AST_NODE(module, source);
+    const ASTNodeId copy = ASTModule_AppendNode(module, node, ASTNode_Position(module, source));
+    if (node->type == AST_VAR_REF && node->var_ref.symbol != NULL) {
+        Symbol_AddUse(module->arena, node->var_ref.symbol, copy, true);
+    }
+    return copy;
+}
+
+// Copies bottom-up: the children of a node are on top of the copies stack when it is left
+static errno_t ASTInliner_CopyLeave(ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTInliner *inliner = visitor->context;
+    ASTModule *module = inliner->module;
+    const ASTNode *node = AST_NODE(module, *slot);
+
+    ASTNodeId copy;
+    if (node->type == AST_VAR_REF) {
+        const size_t param = ASTInliner_Param(inliner->callee, node->var_ref.symbol);
+        copy = inliner->reads[param] == 1
+                   ? inliner->arguments[param]
+                   : ASTInliner_CopyLeaf(inliner, inliner->arguments[param]);
+    } else {
+        const uint32_t count = ASTNode_ChildrenCount(module, *slot);
+        DEBUG_ASSERT(inliner->copies_count >= count);
+        inliner->copies_count -= count;
+        const ASTNodeId *children = inliner->copies + inliner->copies_count;
+
+        // A substituted argument may have side effects the parameter read had not
+        bool children_pure = true;
+        for (uint32_t i = 0; i < count; ++i) {
+            children_pure = children_pure && IsNodePure(AST_NODE(module, children[i]));
+        }
+
+        copy = ASTModule_AppendNode(module, node, ASTNode_Position(module, *slot));
+        ASTNode *copied = AST_NODE(module, copy);
+        switch (copied->type) {
+            case AST_FUNCTION_CALL:
+                copied->function_call.arguments = ASTModule_CreateList(module, children, count);
+                if (!children_pure) {
+                    copied->flags &= ~AST_NODE_FLAG_PURE_CALL;
+                }
+                break;
+            case AST_UNARY:
+                copied->unary_op.is_pure = copied->unary_op.is_pure && children_pure;
+                break;
+            case AST_BINARY:
+                copied->binary_op.is_pure = copied->binary_op.is_pure && children_pure;
+                break;
+            case AST_TERNARY:
+                copied->ternary_op.is_pure = copied->ternary_op.is_pure && children_pure;
+                break;
+            case AST_TYPE_CAST:
+                copied->type_cast.is_pure = copied->type_cast.is_pure && children_pure;
+                break;
+            default:
+                break;
+        }
+        if (copied->type != AST_FUNCTION_CALL) {
+            for (uint32_t i = 0; i < count; ++i) {
+                *ASTNode_ChildSlot(module, copy, i) = children[i];
+            }
+        }
+    }
+
+    inliner->copies = Array_Grow(inliner->copies, &inliner->copies_capacity, inliner->copies_count + 1,
+                                 sizeof(*inliner->copies));
+    inliner->copies[inliner->copies_count++] = copy;
+    return VISMUT_ERROR_OK;
+}
+
+// Statement in front of which the temporaries of the call being left can be declared. Every node on the way
+// up to it evaluates the call once and unconditionally, after nothing but pure expressions, or only literals
+// when the arguments have side effects of their own
+static bool ASTInliner_FindStatement(const ASTInliner *inliner, const ASTVisitor *visitor, const bool literals_only,
+                                     ASTNodeId *block, uint32_t *index) {
+    const ASTModule *module = inliner->module;
+    for (uint32_t depth = visitor->depth; depth > 0; --depth) {
+        const ASTVisitFrame *frame = &visitor->stack[depth - 1];
+        if (frame->parent == AST_NODE_NONE) {
+            return false;
+        }
+        const ASTNode *parent = AST_NODE(module, frame->parent);
+
+        switch (parent->type) {
+            case AST_BLOCK:
+                *block = frame->parent;
+                *index = frame->index;
+                return true;
+            case AST_MODULE:
+                if (frame->index < parent->module.functions.count) {
+                    return false;
+                }
+                *block = frame->parent;
+                *index = frame->index - parent->module.functions.count;
+                return true;
+            case AST_BINARY:
+                if (parent->binary_op.op == AST_BINARY_ASSIGN) {
+                    // The target is written after the value is computed, it is not evaluated before it
+                    if (frame->index != 1) {
+                        return false;
+                    }
+                    continue;
+                }
+                if ((parent->binary_op.op == AST_BINARY_LOGICAL_AND || parent->binary_op.op == AST_BINARY_LOGICAL_OR)
+                    && frame->index != 0) {
+                    return false;
+                }
+                break;
+            case AST_TERNARY:
+            case AST_IF_STMT:
+                if (frame->index != 0) {
+                    return false;
+                }
+                break;
+            case AST_UNARY:
+            case AST_TYPE_CAST:
+            case AST_FUNCTION_CALL:
+            case AST_PRINT_STMT:
+            case AST_VAR_DECL:
+                break;
+            default:
+                return false;
+        }
+
+        for (uint32_t i = 0; i < frame->index; ++i) {
+            const ASTNodeId sibling = *ASTNode_ChildSlot(module, frame->parent, i);
+            if (sibling == AST_NODE_NONE) continue;
+
+            const ASTNode *sibling_node = AST_NODE(module, sibling);
+            if (literals_only ? sibling_node->type != AST_LITERAL : !IsNodePure(sibling_node)) {
+                return false;
+            }
+        }
+    }
+    return false;
+}
+
+static errno_t ASTInliner_Call(ASTInliner *inliner, const ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTModule *module = inliner->module;
+    const ASTNode *call = AST_NODE(module, *slot);
+    const FunctionSignature *callee = call->function_call.signature;
+    if (callee->declaration == AST_NODE_NONE) {
+        return VISMUT_ERROR_OK;
+    }
+    ASTNodeId body = AST_NODE(module, callee->declaration)->function_decl.body;
+    if (body == AST_NODE_NONE) {
+        return VISMUT_ERROR_OK;
+    }
+    const ASTNode *body_node = AST_NODE(module, body);
+    if (body_node->type == AST_BLOCK || body_node->expr_type != callee->return_type || !IsNodePure(body_node)) {
+        return VISMUT_ERROR_OK;
+    }
+
+    errno_t err;
+    const uint32_t params_count = (uint32_t) callee->params.params_count;
+    const ASTNodeList arguments = call->function_call.arguments;
+    DEBUG_ASSERT(arguments.count == params_count);
+
+    inliner->reads = Array_Grow(inliner->reads, &inliner->reads_capacity, params_count,
+                                sizeof(*inliner->reads));
+    inliner->arguments = Array_Grow(inliner->arguments, &inliner->arguments_capacity, params_count,
+                                    sizeof(*inliner->arguments));
+    memset(inliner->reads, 0, sizeof(*inliner->reads) * params_count);
+
+    inliner->callee = callee;
+    inliner->nodes_count = 0;
+    inliner->inlinable = true;
+    RISKY_EXPRESSION_SAFE(ASTVisit(&inliner->scan, &body), err);
+    if (!inliner->inlinable) {
+        return VISMUT_ERROR_OK;
+    }
+
+    // A value read twice has to be computed once, and side effects have to keep their order: any argument but a
+    // literal may read what an impure one writes
+    uint32_t impure_count = 0;
+    uint32_t non_literal_count = 0;
+    bool needs_temporaries = false;
+    for (uint32_t i = 0; i < params_count; ++i) {
+        const ASTNode *argument = AST_NODE(module, AST_LIST_ITEM(module, arguments, i));
+        if (!IsNodePure(argument)) {
+            ++impure_count;
+        }
+        if (argument->type != AST_LITERAL) {
+            ++non_literal_count;
+        }
+    }
+    for (uint32_t i = 0; i < params_count; ++i) {
+        const ASTNode *argument = AST_NODE(module, AST_LIST_ITEM(module, arguments, i));
+        if (IsNodePure(argument)) {
+            needs_temporaries |= argument->type != AST_LITERAL && argument->type != AST_VAR_REF
+                    && inliner->reads[i] > 1;
+        } else {
+            needs_temporaries |= inliner->reads[i] != 1 || non_literal_count > 1;
+        }
+    }
+
+    ASTNodeId block = AST_NODE_NONE;
+    uint32_t index = 0;
+    if (needs_temporaries && !ASTInliner_FindStatement(inliner, visitor, impure_count != 0, &block, &index)) {
+        return VISMUT_ERROR_OK;
+    }
+    for (uint32_t i = 0; i < params_count; ++i) {
+        const ASTNodeId argument = AST_LIST_ITEM(module, arguments, i);
+        const ASTNode *argument_node = AST_NODE(module, argument);
+        const bool is_leaf = argument_node->type == AST_LITERAL || argument_node->type == AST_VAR_REF;
+        // With side effects around, every argument that is not a literal is stored in order
+        const bool is_stored = needs_temporaries && argument_node->type != AST_LITERAL
+                               && (impure_count != 0 || (!is_leaf && inliner->reads[i] > 1));
+        inliner->arguments[i] = argument;
+        if (is_stored) {
+            inliner->arguments[i] = ASTTemporaries_Declare(&inliner->temporaries, module, block, index, argument);
+        }
+    }
+
+    // An argument nothing reads is dropped, the pure ones only: the others are kept in their temporaries
+    for (uint32_t i = 0; i < params_count; ++i) {
+        if (inliner->reads[i] == 0) {
+            RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&inliner->forget_uses, inliner->arguments[i]), err);
+        }
+    }
+
+    inliner->copies_count = 0;
+    RISKY_EXPRESSION_SAFE(ASTVisit(&inliner->copy, &body), err);
+    DEBUG_ASSERT(inliner->copies_count == 1);
+
+    // Arguments read more than once were copied at each read
+    for (uint32_t i = 0; i < params_count; ++i) {
+        if (inliner->reads[i] > 1) {
+            RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&inliner->forget_uses, inliner->arguments[i]), err);
+        }
+    }
+
+    ASTNode_SetPosition(module, inliner->copies[0], ASTNode_Position(module, *slot));
+    *slot = inliner->copies[0];
+    inliner->inlined = true;
+    if (inliner->caller != NULL) {
+        inliner->caller->flags |= FUNCTION_FLAG_INLINED;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTInliner_Enter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTInliner *inliner = visitor->context;
+    const ASTNode *node = AST_NODE(inliner->module, *slot);
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTOptimize_SkipReusedEnter(visitor, slot, skip_children), err);
+    if (node->type == AST_FUNCTION_DECL && !*skip_children && ASTVisitor_Parent(visitor) == inliner->module->root) {
+        inliner->caller = node->function_decl.signature;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Calls are inlined on the way up, their arguments are inlined already
+static errno_t ASTInliner_Leave(ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTInliner *inliner = visitor->context;
+    const ASTNode *node = AST_NODE(inliner->module, *slot);
+
+    switch (node->type) {
+        case AST_FUNCTION_CALL:
+            return ASTInliner_Call(inliner, visitor, slot);
+        case AST_BLOCK:
+        case AST_MODULE:
+            ASTTemporaries_Insert(&inliner->temporaries, inliner->module, *slot);
+            return VISMUT_ERROR_OK;
+        case AST_FUNCTION_DECL:
+            if (ASTVisitor_Parent(visitor) == inliner->module->root) {
+                inliner->caller = NULL;
+            }
+            return VISMUT_ERROR_OK;
+        default:
+            return VISMUT_ERROR_OK;
+    }
+}
+
+errno_t ASTModule_InlineCalls(ASTModule *module) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    ASTInliner inliner = {
+        .module = module,
+        .temporaries.prefix = "_vismut_inline",
+    };
+    ASTVisitor_Init(&inliner.scan, module, &inliner);
+    inliner.scan.enter = ASTInliner_ScanEnter;
+    ASTVisitor_Init(&inliner.copy, module, &inliner);
+    inliner.copy.leave = ASTInliner_CopyLeave;
+    ASTOptimize_InitForgetUses(&inliner.forget_uses, module);
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &inliner);
+    visitor.enter = ASTInliner_Enter;
+    visitor.leave = ASTInliner_Leave;
+    // The copies may call functions in turn: each walk inlines one more level of them
+    errno_t err = VISMUT_ERROR_OK;
+    inliner.inlined = true;
+    for (uint32_t round = 0; round < AST_INLINE_MAX_ROUNDS && inliner.inlined && !err; ++round) {
+        inliner.inlined = false;
+        err = ASTVisit(&visitor, &module->root);
+    }
+
+    free(inliner.arguments);
+    free(inliner.reads);
+    free(inliner.copies);
+    ASTTemporaries_Free(&inliner.temporaries);
+    return err;
+}
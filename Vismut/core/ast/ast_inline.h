@@ -0,0 +1,22 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_INLINE_H
+#define VISMUT_AST_INLINE_H
+#include "../types.h"
+#include "ast.h"
+
+// Callee bodies of at most this many nodes are copied into their call sites
+#define AST_INLINE_MAX_NODES 32
+// Levels of nested calls inlined, which also bounds the growth of mutually recursive functions
+#define AST_INLINE_MAX_ROUNDS 4
+
+// Replaces the calls of small, pure, non-recursive expression-bodied functions by a copy of the body with the
+// arguments in place of the parameters. Each argument is still evaluated exactly once: one read by the body
+// takes the argument itself, literals and variables are copied, anything else is first stored to a temporary
+// declared in front of the statement. Calls that would need a temporary where none can be declared are kept.
+// Callers get FUNCTION_FLAG_INLINED, see ASTParser_ReuseUnchangedFunctions
+errno_t ASTModule_InlineCalls(ASTModule *module);
+
+#endif //VISMUT_AST_INLINE_H
@@ -0,0 +1,389 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_licm.h"
+
+#include <stdlib.h>
+
+#include "ast_optimize.h"
+#include "ast_visit.h"
+#include "../errors/errors.h"
+#include "../memory/array.h"
+#include "../hash/murmur3.h"
+
+#define AST_LICM_SEED 0x2545f491
+
+// Bits of ASTLICM.functions, by declaration node id
+#define AST_LICM_TOP_LEVEL 1
+#define AST_LICM_VISITING  2 // body being looked into, a call of it is recursive
+#define AST_LICM_CHECKED   4
+#define AST_LICM_SAFE      8 // terminates without trapping whatever its arguments
+
+// Open addressing slot, a slot of an older generation is free
+typedef struct {
+    uint32_t generation;
+    const Symbol *symbol;
+} ASTLICMSlot;
+
+typedef struct {
+    ASTModule *module;
+    uint8_t *functions;
+    uint32_t nodes_count; // the temporaries and their reads come after the nodes the tables cover
+
+    // Variables the loop being looked at writes
+    ASTLICMSlot *written;
+    uint32_t written_capacity;
+    uint32_t written_count;
+    uint32_t generation; // one per loop
+    bool writes_any;
+
+    bool *invariant; // children of the nodes on the way down to the one being looked at
+    uint32_t invariant_count;
+    uint32_t invariant_capacity;
+
+    ASTNodeId block; // AST_BLOCK or AST_MODULE holding the loop
+    uint32_t index; // statement of the loop
+    ASTTemporaries temporaries; // `$_vismut_licmN`, declared in front of the loop
+} ASTLICM;
+
+// Only the slots of the current generation are moved over
+static void ASTLICM_GrowWritten(ASTLICM *licm) {
+    ASTLICMSlot *old_slots = licm->written;
+    const uint32_t old_capacity = licm->written_capacity;
+
+    licm->written_capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+    licm->written = calloc(licm->written_capacity, sizeof(*licm->written));
+    if (licm->written == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+
+    const uint32_t mask = licm->written_capacity - 1;
+    for (uint32_t i = 0; i < old_capacity; ++i) {
+        if (old_slots[i].generation != licm->generation) continue;
+
+        uint32_t index = murmurhash3_int64((int64_t) (uintptr_t) old_slots[i].symbol, AST_LICM_SEED) & mask;
+        while (licm->written[index].generation == licm->generation) {
+            index = (index + 1) & mask;
+        }
+        licm->written[index] = old_slots[i];
+    }
+    free(old_slots);
+}
+
+static void ASTLICM_Write(ASTLICM *licm, const Symbol *symbol) {
+    if (symbol == NULL) {
+        return;
+    }
+    if ((licm->written_count + 1) * 4 > licm->written_capacity * 3) {
+        ASTLICM_GrowWritten(licm);
+    }
+
+    const uint32_t mask = licm->written_capacity - 1;
+    uint32_t index = murmurhash3_int64((int64_t) (uintptr_t) symbol, AST_LICM_SEED) & mask;
+    while (licm->written[index].generation == licm->generation) {
+        if (licm->written[index].symbol == symbol) {
+            return;
+        }
+        index = (index + 1) & mask;
+    }
+    licm->written[index] = (ASTLICMSlot){
+        .generation = licm->generation,
+        .symbol = symbol,
+    };
+    ++licm->written_count;
+}
+
+attribute_pure
+static bool ASTLICM_IsWritten(const ASTLICM *licm, const Symbol *symbol) {
+    if (licm->writes_any) {
+        return true;
+    }
+    if (licm->written_count == 0) {
+        return false;
+    }
+
+    const uint32_t mask = licm->written_capacity - 1;
+    uint32_t index = murmurhash3_int64((int64_t) (uintptr_t) symbol, AST_LICM_SEED) & mask;
+    while (licm->written[index].generation == licm->generation) {
+        if (licm->written[index].symbol == symbol) {
+            return true;
+        }
+        index = (index + 1) & mask;
+    }
+    return false;
+}
+
+// Collects the variables a subtree of the loop writes, the ones it declares are new on every iteration
+static void ASTLICM_CollectWritten(ASTLICM *licm, const ASTNodeId node_id) {
+    if (node_id == AST_NODE_NONE) {
+        return;
+    }
+    const ASTNode *node = AST_NODE(licm->module, node_id);
+    switch (node->type) {
+        case AST_VAR_REF:
+            if (node->flags & AST_NODE_FLAG_ASSIGN_TARGET) {
+                ASTLICM_Write(licm, node->var_ref.symbol);
+            }
+            return;
+        case AST_VAR_DECL:
+            ASTLICM_Write(licm, node->var_decl.symbol);
+            break;
+        case AST_UNARY:
+            if (node->unary_op.op == AST_UNARY_INCREMENT || node->unary_op.op == AST_UNARY_DECREMENT) {
+                const ASTNode *operand = AST_NODE(licm->module, node->unary_op.operand);
+                if (operand->type == AST_VAR_REF) {
+                    ASTLICM_Write(licm, operand->var_ref.symbol);
+                }
+            }
+            break;
+        case AST_FUNCTION_CALL: {
+            // A nested function may write the variables of its enclosing one
+            const ASTNodeId declaration = node->function_call.signature->declaration;
+            if (!IsNodePure(node) && (declaration == AST_NODE_NONE || declaration >= licm->nodes_count
+                                      || !(licm->functions[declaration] & AST_LICM_TOP_LEVEL))) {
+                licm->writes_any = true;
+            }
+            break;
+        }
+        case AST_FUNCTION_DECL:
+            // Runs where it is called, not where it is declared
+            return;
+        default:
+            break;
+    }
+
+    const uint32_t count = ASTNode_ChildrenCount(licm->module, node_id);
+    for (uint32_t i = 0; i < count; ++i) {
+        ASTLICM_CollectWritten(licm, *ASTNode_ChildSlot(licm->module, node_id, i));
+    }
+}
+
+// Integer division traps on a zero divisor, and on -1 for the smallest dividend
+attribute_pure
+static bool ASTLICM_MayTrap(const ASTModule *module, const ASTNode *node) {
+    if (node->type != AST_BINARY || (node->binary_op.op != AST_BINARY_DIV && node->binary_op.op != AST_BINARY_INT_DIV
+                                     && node->binary_op.op != AST_BINARY_MOD)) {
+        return false;
+    }
+    const ASTNode *left = AST_NODE(module, node->binary_op.left);
+    const ASTNode *right = AST_NODE(module, node->binary_op.right);
+    if (left->expr_type == VALUE_F64 || right->expr_type == VALUE_F64) {
+        return false;
+    }
+    return right->type != AST_LITERAL || right->literal.type != VALUE_I64 || right->literal.i64 == 0
+           || right->literal.i64 == -1;
+}
+
+static bool ASTLICM_IsSafeCallee(ASTLICM *licm, const FunctionSignature *callee);
+
+// Whether a subtree of a pure body terminates without trapping
+static bool ASTLICM_IsSafe(ASTLICM *licm, const ASTNodeId node_id) {
+    if (node_id == AST_NODE_NONE) {
+        return true;
+    }
+    const ASTNode *node = AST_NODE(licm->module, node_id);
+    switch (node->type) {
+        case AST_WHILE_STMT:
+        case AST_FUNCTION_DECL:
+            return false;
+        case AST_FUNCTION_CALL:
+            if (!ASTLICM_IsSafeCallee(licm, node->function_call.signature)) {
+                return false;
+            }
+            break;
+        default:
+            if (ASTLICM_MayTrap(licm->module, node)) {
+                return false;
+            }
+            break;
+    }
+
+    const uint32_t count = ASTNode_ChildrenCount(licm->module, node_id);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!ASTLICM_IsSafe(licm, *ASTNode_ChildSlot(licm->module, node_id, i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A call of the function runs until it returns whatever its arguments. Recursive functions are not looked into
+// further: every function on the cycle sees a call of one being looked into
+static bool ASTLICM_IsSafeCallee(ASTLICM *licm, const FunctionSignature *callee) {
+    const ASTNodeId declaration = callee->declaration;
+    if (!(callee->flags & FUNCTION_FLAG_PURE) || declaration == AST_NODE_NONE || declaration >= licm->nodes_count) {
+        return false;
+    }
+    uint8_t *function = &licm->functions[declaration];
+    if (*function & AST_LICM_CHECKED) {
+        return (*function & AST_LICM_SAFE) != 0;
+    }
+    if (*function & AST_LICM_VISITING) {
+        return false;
+    }
+
+    *function |= AST_LICM_VISITING;
+    const ASTNodeId body = AST_NODE(licm->module, declaration)->function_decl.body;
+    const bool safe = body != AST_NODE_NONE && ASTLICM_IsSafe(licm, body);
+    licm->functions[declaration] = (uint8_t) ((licm->functions[declaration] & ~AST_LICM_VISITING) | AST_LICM_CHECKED
+                                              | (safe ? AST_LICM_SAFE : 0));
+    return safe;
+}
+
+// Whether the node alone may move out of the loop, when its children may
+static bool ASTLICM_IsMovable(ASTLICM *licm, const ASTNode *node) {
+    if (!IsNodePure(node)) {
+        return false;
+    }
+    switch (node->type) {
+        case AST_UNARY:
+            return node->unary_op.op != AST_UNARY_INCREMENT && node->unary_op.op != AST_UNARY_DECREMENT;
+        case AST_BINARY:
+            return node->binary_op.op != AST_BINARY_ASSIGN && !ASTLICM_MayTrap(licm->module, node);
+        case AST_TERNARY:
+        case AST_TYPE_CAST:
+            return true;
+        case AST_FUNCTION_CALL:
+            return ASTLICM_IsSafeCallee(licm, node->function_call.signature);
+        default:
+            return false;
+    }
+}
+
+// Leaves are cheaper to read again than a temporary, and statements keep the expressions computing their value
+attribute_pure
+static bool ASTLICM_IsWorthHoisting(const ASTModule *module, const ASTNodeId parent, const ASTNodeId node_id) {
+    const ASTNode *node = AST_NODE(module, node_id);
+    const uint8_t parent_type = AST_NODE(module, parent)->type;
+    return node->type != AST_LITERAL && node->type != AST_VAR_REF
+           && (node->expr_type == VALUE_I64 || node->expr_type == VALUE_F64)
+           && parent_type != AST_BLOCK && parent_type != AST_MODULE;
+}
+
+// Declares `$_vismut_licmN = expression` in front of the loop and reads it in place of the expression
+static void ASTLICM_Hoist(ASTLICM *licm, const ASTNodeId parent, const uint32_t index) {
+    ASTModule *module = licm->module;
+    const ASTNodeId expression = *ASTNode_ChildSlot(module, parent, index);
+    const ASTNodeId read = ASTTemporaries_Declare(&licm->temporaries, module, licm->block, licm->index, expression);
+    *ASTNode_ChildSlot(module, parent, index) = read;
+}
+
+// Whether the child of the parent is invariant in the loop. The largest invariant expressions that are not
+// children of invariant ones move out, in evaluation order, so that a temporary follows the ones it reads
+static bool ASTLICM_Walk(ASTLICM *licm, const ASTNodeId parent, const uint32_t index) {
+    ASTModule *module = licm->module;
+    const ASTNodeId node_id = *ASTNode_ChildSlot(module, parent, index);
+    if (node_id == AST_NODE_NONE) {
+        return false;
+    }
+    const ASTNode *node = AST_NODE(module, node_id);
+    switch (node->type) {
+        case AST_LITERAL:
+            return true;
+        case AST_VAR_REF:
+            return node->var_ref.symbol != NULL && !(node->flags & AST_NODE_FLAG_ASSIGN_TARGET)
+                   && !ASTLICM_IsWritten(licm, node->var_ref.symbol);
+        case AST_FUNCTION_DECL:
+            return false;
+        default:
+            break;
+    }
+
+    const uint32_t count = ASTNode_ChildrenCount(module, node_id);
+    const uint32_t base = licm->invariant_count;
+    licm->invariant = Array_Grow(licm->invariant, &licm->invariant_capacity, base + count,
+                                 sizeof(*licm->invariant));
+    licm->invariant_count = base + count;
+
+    bool invariant = ASTLICM_IsMovable(licm, node);
+    for (uint32_t i = 0; i < count; ++i) {
+        const bool child = ASTLICM_Walk(licm, node_id, i);
+        licm->invariant[base + i] = child;
+        invariant &= child;
+    }
+    if (!invariant) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (licm->invariant[base + i] && ASTLICM_IsWorthHoisting(module, node_id,
+                                                                      *ASTNode_ChildSlot(module, node_id, i))) {
+                ASTLICM_Hoist(licm, node_id, i);
+            }
+        }
+    }
+
+    licm->invariant_count = base;
+    return invariant;
+}
+
+static void ASTLICM_Loop(ASTLICM *licm, const ASTVisitor *visitor, const ASTNodeId loop) {
+    const ASTNodeId parent = ASTVisitor_Parent(visitor);
+    uint32_t index = ASTVisitor_Index(visitor);
+    const ASTNode *parent_node = AST_NODE(licm->module, parent);
+    if (parent_node->type == AST_MODULE) {
+        DEBUG_ASSERT(index >= parent_node->module.functions.count);
+        index -= parent_node->module.functions.count;
+    } else if (parent_node->type != AST_BLOCK) {
+        return;
+    }
+
+    ++licm->generation;
+    licm->written_count = 0;
+    licm->writes_any = false;
+    const ASTNode *node = AST_NODE(licm->module, loop);
+    ASTLICM_CollectWritten(licm, node->while_stmt.condition);
+    ASTLICM_CollectWritten(licm, node->while_stmt.body);
+
+    licm->block = parent;
+    licm->index = index;
+    ASTLICM_Walk(licm, loop, 0);
+    ASTLICM_Walk(licm, loop, 1);
+}
+
+// Loops are done on the way up, after the loops nested in them
+static errno_t ASTLICM_Leave(ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTLICM *licm = visitor->context;
+    const ASTNode *node = AST_NODE(visitor->module, *slot);
+
+    switch (node->type) {
+        case AST_WHILE_STMT:
+            ASTLICM_Loop(licm, visitor, *slot);
+            return VISMUT_ERROR_OK;
+        case AST_BLOCK:
+        case AST_MODULE:
+            ASTTemporaries_Insert(&licm->temporaries, licm->module, *slot);
+            return VISMUT_ERROR_OK;
+        default:
+            return VISMUT_ERROR_OK;
+    }
+}
+
+errno_t ASTModule_HoistLoopInvariants(ASTModule *module) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    ASTLICM licm = {
+        .module = module,
+        .nodes_count = module->nodes_count,
+        .temporaries.prefix = "_vismut_licm",
+    };
+    licm.functions = calloc(module->nodes_count, sizeof(*licm.functions));
+    if (licm.functions == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    const ASTNodeList functions = AST_NODE(module, module->root)->module.functions;
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        licm.functions[AST_LIST_ITEM(module, functions, i)] = AST_LICM_TOP_LEVEL;
+    }
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &licm);
+    visitor.enter = ASTOptimize_SkipReusedEnter;
+    visitor.leave = ASTLICM_Leave;
+    const errno_t err = ASTVisit(&visitor, &module->root);
+
+    free(licm.functions);
+    free(licm.written);
+    free(licm.invariant);
+    ASTTemporaries_Free(&licm.temporaries);
+    return err;
+}
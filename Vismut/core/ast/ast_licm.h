@@ -0,0 +1,18 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_LICM_H
+#define VISMUT_AST_LICM_H
+#include "../types.h"
+#include "ast.h"
+
+// Moves the pure expressions of a `@` loop that read no variable the loop writes to temporaries declared in
+// front of the loop. Pure calls write nothing, and impure calls of top-level functions cannot reach the
+// variables of their caller, only impure calls of nested functions make every variable count as written.
+// Hoisted expressions are evaluated even when the loop runs zero times, so those that may trap or not
+// terminate stay: integer divisions by anything but a non-zero literal other than -1, and calls of functions
+// that loop or recurse. Inner loops are done first, an outer loop may then hoist the temporaries further
+errno_t ASTModule_HoistLoopInvariants(ASTModule *module);
+
+#endif //VISMUT_AST_LICM_H
@@ -7,15 +7,72 @@
 #include <limits.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ast.h"
+#include "ast_cse.h"
+#include "ast_hashcons.h"
+#include "ast_inline.h"
+#include "ast_licm.h"
+#include "ast_range.h"
+#include "ast_visit.h"
 #include "../errors/errors.h"
 
+typedef struct {
+    VValue *values; // arguments of the calls being evaluated, the innermost call last
+    uint32_t values_count;
+    uint32_t values_capacity;
+    uint32_t steps; // left for the call being folded
+    uint32_t memory; // bytes taken by the frames of the calls being evaluated
+    uint32_t module_steps; // left for all the calls folded by a pass
+} ConstantEvaluator;
+
 typedef struct {
     Arena *arena;
+    ASTModule *module;
+    ASTVisitor forget_uses; // unregisters the variable reads of the subtrees folding drops
+    FunctionSignature *function; // top-level function being walked, NULL in the module statements
+    ConstantEvaluator evaluator;
 } SimpleOptimizationsContext;
 
-#define SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, operand_ptr) RISKY_EXPRESSION_SAFE(ASTOptimize_SimpleOptimizations(ctx, (ASTNode**) &operand_ptr), err)
+static errno_t ASTOptimize_ForgetUsesEnter(ASTVisitor *visitor, ASTNodeId *node_id, bool *skip_children) {
+    const ASTNode *node = AST_NODE(visitor->module, *node_id);
+    if (node->type == AST_VAR_REF && node->var_ref.symbol != NULL) {
+        Symbol_RemoveUse(node->var_ref.symbol, *node_id, !(node->flags & AST_NODE_FLAG_ASSIGN_TARGET));
+    }
+    return VISMUT_ERROR_OK;
+}
+
+void ASTOptimize_InitForgetUses(ASTVisitor *forget_uses, const ASTModule *module) {
+    ASTVisitor_Init(forget_uses, module, NULL);
+    forget_uses->enter = ASTOptimize_ForgetUsesEnter;
+}
+
+errno_t ASTOptimize_ForgetUses(ASTVisitor *forget_uses, const ASTNodeId node_id) {
+    ASTNodeId root = node_id;
+    return ASTVisit(forget_uses, &root);
+}
+
+errno_t ASTOptimize_SkipReusedEnter(ASTVisitor *visitor, ASTNodeId *node_id, bool *skip_children) {
+    const ASTNode *node = AST_NODE(visitor->module, *node_id);
+    // A reused body went through the optimizer in the build it comes from
+    if (node->type == AST_FUNCTION_DECL && (node->function_decl.signature->flags & FUNCTION_FLAG_REUSED)) {
+        *skip_children = true;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Dropped statements leave AST_NODE_NONE behind, the survivors are moved to the front of the list
+static void ASTOptimize_CompactStatements(const ASTModule *module, ASTNodeList *list) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < list->count; ++i) {
+        const ASTNodeId statement = AST_LIST_ITEM(module, *list, i);
+        if (statement != AST_NODE_NONE) {
+            AST_LIST_ITEM(module, *list, kept++) = statement;
+        }
+    }
+    list->count = kept;
+}
 
 attribute_pure
 static bool IsNodeLiteral(const ASTNode *node) {
@@ -52,13 +109,14 @@ int64_t fast_pow_int64(const int64_t base, const uint32_t exp) {
 
 attribute_const
 static int64_t IntBinaryEval(const int64_t left, const int64_t right, const ASTBinaryType op) {
+    // Two's complement wrapping, as the generated code computes it
     switch (op) {
         case AST_BINARY_ADD:
-            return left + right;
+            return (int64_t) ((uint64_t) left + (uint64_t) right);
         case AST_BINARY_SUB:
-            return left - right;
+            return (int64_t) ((uint64_t) left - (uint64_t) right);
         case AST_BINARY_MUL:
-            return left * right;
+            return (int64_t) ((uint64_t) left * (uint64_t) right);
         case AST_BINARY_POW:
             if (right < 0) return 0;
             return fast_pow_int64(left, (uint32_t) right);
@@ -256,90 +314,87 @@ LiteralValueType GetLiteralValueType(const ASTNode *node) {
 #define ZERO_VALUE(type_) (((type_) == VALUE_I64) ? (VValue){.type = VALUE_I64, .i64 = 0} : (VValue){.type = VALUE_F64, .f64 = 0.0f})
 #define ONE_VALUE(type_) (((type_) == VALUE_I64) ? (VValue){.type = VALUE_I64, .i64 = 1} : (VValue){.type = VALUE_F64, .f64 = 1.0f})
 
-static errno_t ASTOptimize_BinaryExpression(const SimpleOptimizationsContext *ctx, ASTNode **node) {
-    DEBUG_ASSERT((*node)->type == AST_BINARY);
+static errno_t ASTOptimize_BinaryExpression(SimpleOptimizationsContext *ctx, ASTNodeId *node_id) {
+    const ASTNode *node = AST_NODE(ctx->module, *node_id);
+    DEBUG_ASSERT(node->type == AST_BINARY);
 
-    ASTNode *left_operand = (ASTNode *) (*node)->binary_op.left;
-    const ASTNode *right_operand = (ASTNode *) (*node)->binary_op.right;
-    const ASTBinaryType op = (*node)->binary_op.op;
+    const ASTNodeId left_id = node->binary_op.left;
+    const ASTNode *left_operand = AST_NODE(ctx->module, left_id);
+    const ASTNode *right_operand = AST_NODE(ctx->module, node->binary_op.right);
+    const ASTBinaryType op = node->binary_op.op;
+    const Position pos = ASTNode_Position(ctx->module, *node_id);
     const bool is_left_literal = IsNodeLiteral(left_operand);
     const bool is_right_literal = IsNodeLiteral(right_operand);
 
     if (is_left_literal && is_right_literal) {
+        // Undefined quotients would trap the compiler itself, they are left to the generated code
+        if ((op == AST_BINARY_INT_DIV || op == AST_BINARY_MOD) && right_operand->literal.type == VALUE_I64
+            && (right_operand->literal.i64 == 0
+                || (right_operand->literal.i64 == -1 && left_operand->literal.i64 == INT64_MIN))) {
+            return VISMUT_ERROR_OK;
+        }
         VValue result;
         errno_t err;
-        if ((err = ConstantBinaryEval(left_operand->literal, right_operand->literal, (*node)->binary_op.op, &result)) !=
+        if ((err = ConstantBinaryEval(left_operand->literal, right_operand->literal, op, &result)) !=
             VISMUT_ERROR_OK) {
             return err;
         }
-        *node = CreateLiteralNode(ctx->arena, (*node)->pos, result);
+        *node_id = CreateLiteralNode(ctx->module, pos, result);
         return VISMUT_ERROR_OK;
     }
 
-    if (is_right_literal) {
-        const LiteralValueType literal_value_type = GetLiteralValueType(right_operand);
+    if (!is_left_literal && !is_right_literal) {
+        return VISMUT_ERROR_OK;
+    }
 
-        if (op == AST_BINARY_MUL) {
-            if (literal_value_type == ZERO_LITERAL) {
-                *node = CreateLiteralNode(ctx->arena, (*node)->pos, ZERO_VALUE(right_operand->literal.type));
-                return VISMUT_ERROR_OK;
-            }
-            if (literal_value_type == ONE_LITERAL) {
-                *node = left_operand;
-                return VISMUT_ERROR_OK;
-            }
-        } else if (op == AST_BINARY_ADD) {
-            if (literal_value_type == ZERO_LITERAL) {
-                *node = left_operand;
-                return VISMUT_ERROR_OK;
-            }
-        } else if (op == AST_BINARY_POW) {
-            if (literal_value_type == ZERO_LITERAL) {
-                *node = CreateLiteralNode(ctx->arena, (*node)->pos, ONE_VALUE(left_operand->literal.type));
-                return VISMUT_ERROR_OK;
-            }
-            if (literal_value_type == ONE_LITERAL) {
-                *node = left_operand;
-                return VISMUT_ERROR_OK;
-            }
-        }
-    } else if (is_left_literal) {
-        const LiteralValueType literal_value_type = GetLiteralValueType(left_operand);
+    // Identities with one literal operand. The other one is kept only when it already has the type of the
+    // expression, and dropped only when the result does not depend on it: `0 * x` of floats is NaN for an
+    // infinite x, and `0 ** x` is 1 for a zero x
+    const LiteralValueType literal_value_type = GetLiteralValueType(is_right_literal ? right_operand : left_operand);
+    const ASTNodeId other_id = is_right_literal ? left_id : node->binary_op.right;
+    const ASTNode *other = is_right_literal ? left_operand : right_operand;
+    const VValueType type = node->expr_type;
+    if (type != VALUE_I64 && type != VALUE_F64) {
+        return VISMUT_ERROR_OK;
+    }
 
-        if (op == AST_BINARY_MUL) {
-            if (literal_value_type == ZERO_LITERAL) {
-                *node = CreateLiteralNode(ctx->arena, (*node)->pos, ZERO_VALUE(right_operand->literal.type));
-                return VISMUT_ERROR_OK;
-            }
-            if (literal_value_type == ONE_LITERAL) {
-                *node = left_operand;
-                return VISMUT_ERROR_OK;
-            }
-        } else if (op == AST_BINARY_ADD) {
-            if (literal_value_type == ZERO_LITERAL) {
-                *node = left_operand;
-                return VISMUT_ERROR_OK;
-            }
-        } else if (op == AST_BINARY_POW) {
-            if (literal_value_type == ZERO_LITERAL) {
-                *node = CreateLiteralNode(ctx->arena, (*node)->pos, ZERO_VALUE(right_operand->literal.type));
-                return VISMUT_ERROR_OK;
-            }
-            if (literal_value_type == ONE_LITERAL) {
-                *node = CreateLiteralNode(ctx->arena, (*node)->pos, ONE_VALUE(right_operand->literal.type));
-                return VISMUT_ERROR_OK;
-            }
-        }
+    bool keeps_other = false;
+    bool is_constant = false;
+    VValue constant = {0};
+    switch (op) {
+        case AST_BINARY_ADD:
+            keeps_other = literal_value_type == ZERO_LITERAL;
+            break;
+        case AST_BINARY_MUL:
+            keeps_other = literal_value_type == ONE_LITERAL;
+            is_constant = literal_value_type == ZERO_LITERAL && type == VALUE_I64;
+            constant = ZERO_VALUE(type);
+            break;
+        case AST_BINARY_POW:
+            keeps_other = is_right_literal && literal_value_type == ONE_LITERAL;
+            is_constant = is_right_literal ? literal_value_type == ZERO_LITERAL : literal_value_type == ONE_LITERAL;
+            constant = ONE_VALUE(type);
+            break;
+        default:
+            break;
     }
 
+    if (keeps_other && other->expr_type == type) {
+        *node_id = other_id;
+    } else if (is_constant) {
+        errno_t err;
+        RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, other_id), err);
+        *node_id = CreateLiteralNode(ctx->module, pos, constant);
+    }
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTOptimize_UnaryExpression(const SimpleOptimizationsContext *ctx, ASTNode **node) {
-    DEBUG_ASSERT((*node)->type == AST_UNARY);
+static errno_t ASTOptimize_UnaryExpression(const SimpleOptimizationsContext *ctx, ASTNodeId *node_id) {
+    const ASTNode *node = AST_NODE(ctx->module, *node_id);
+    DEBUG_ASSERT(node->type == AST_UNARY);
 
-    const ASTNode *operand = (ASTNode *) (*node)->unary_op.operand;
-    const ASTUnaryType op = (*node)->unary_op.op;
+    const ASTNode *operand = AST_NODE(ctx->module, node->unary_op.operand);
+    const ASTUnaryType op = node->unary_op.op;
 
     if (IsNodeLiteral(operand)) {
         errno_t err;
@@ -347,7 +402,7 @@ static errno_t ASTOptimize_UnaryExpression(const SimpleOptimizationsContext *ctx
         if ((err = ConstantUnaryEval(operand->literal, op, &result)) != VISMUT_ERROR_OK) {
             return err;
         }
-        *node = CreateLiteralNode(ctx->arena, (*node)->pos, result);
+        *node_id = CreateLiteralNode(ctx->module, ASTNode_Position(ctx->module, *node_id), result);
     }
 
     return VISMUT_ERROR_OK;
@@ -376,15 +431,16 @@ VValue ConstantTypeCastEval(const VValue value, const VValueType target_type) {
     }
 }
 
-static errno_t ASTOptimize_TypeCast(const SimpleOptimizationsContext *ctx, ASTNode **node) {
-    DEBUG_ASSERT((*node)->type == AST_TYPE_CAST);
+static errno_t ASTOptimize_TypeCast(const SimpleOptimizationsContext *ctx, ASTNodeId *node_id) {
+    const ASTNode *node = AST_NODE(ctx->module, *node_id);
+    DEBUG_ASSERT(node->type == AST_TYPE_CAST);
 
-    const ASTNode *operand = (ASTNode *) (*node)->unary_op.operand;
+    const ASTNode *operand = AST_NODE(ctx->module, node->type_cast.expression);
 
     if (IsNodeLiteral(operand)) {
-        *node = CreateLiteralNode(
-            ctx->arena, (*node)->pos,
-            ConstantTypeCastEval(operand->literal, (*node)->type_cast.target_type)
+        *node_id = CreateLiteralNode(
+            ctx->module, ASTNode_Position(ctx->module, *node_id),
+            ConstantTypeCastEval(operand->literal, node->type_cast.target_type)
         );
     }
 
@@ -402,96 +458,736 @@ bool LiteralToBoolean(const VValue literal) {
     }
 }
 
-static errno_t ASTOptimize_SimpleOptimizations(SimpleOptimizationsContext *ctx, ASTNode **node) {
-    DEBUG_ASSERT(node != NULL && *node != NULL);
-    errno_t err;
+// Index of the parameter of the function a variable read refers to, params_count for any other variable
+attribute_pure
+static size_t ConstantEvaluator_Param(const FunctionSignature *function, const Symbol *symbol) {
+    // Parameters are the only symbols without a declaration
+    if (symbol != NULL && symbol->declaration == AST_NODE_NONE) {
+        for (size_t i = 0; i < function->params.params_count; ++i) {
+            if (strcmp((const char *) function->params.param_names[i], (const char *) symbol->name) == 0) {
+                return i;
+            }
+        }
+    }
+    return function->params.params_count;
+}
 
-    switch ((*node)->type) {
-        case AST_BINARY: {
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->binary_op.left);
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->binary_op.right);
-            if (!(*node)->binary_op.is_pure) {
-                return VISMUT_ERROR_OK;
+// Body of a pure expression-bodied function, AST_NODE_NONE for the functions that cannot be evaluated:
+// block bodies yield no value in the generated code
+attribute_pure
+static ASTNodeId ConstantEvaluator_Body(const ASTModule *module, const FunctionSignature *function) {
+    if (!(function->flags & FUNCTION_FLAG_PURE) || function->declaration == AST_NODE_NONE) {
+        return AST_NODE_NONE;
+    }
+    const ASTNodeId body = AST_NODE(module, function->declaration)->function_decl.body;
+    if (body == AST_NODE_NONE || AST_NODE(module, body)->type == AST_BLOCK) {
+        return AST_NODE_NONE;
+    }
+    return body;
+}
+
+attribute_pure
+static bool ConstantEvaluator_IsNumber(const VValue value) {
+    return value.type == VALUE_I64 || value.type == VALUE_F64;
+}
+
+static bool ConstantEvaluator_Eval(ConstantEvaluator *evaluator, const ASTModule *module,
+                                   const FunctionSignature *function, uint32_t frame, ASTNodeId node_id,
+                                   VValue *result);
+
+// Runs a call with the arguments on top of the values, each call taking its frame out of the memory budget
+static bool ConstantEvaluator_Call(ConstantEvaluator *evaluator, const ASTModule *module,
+                                   const FunctionSignature *function, const uint32_t frame, const ASTNode *call,
+                                   VValue *result) {
+    const FunctionSignature *callee = call->function_call.signature;
+    const ASTNodeId body = ConstantEvaluator_Body(module, callee);
+    const ASTNodeList arguments = call->function_call.arguments;
+    const uint32_t frame_size = (uint32_t) sizeof(VValue) * (arguments.count + 1);
+    if (body == AST_NODE_NONE || evaluator->memory + frame_size > AST_CTFE_MAX_MEMORY) {
+        return false;
+    }
+
+    const uint32_t callee_frame = evaluator->values_count;
+    for (uint32_t i = 0; i < arguments.count; ++i) {
+        VValue argument;
+        if (!ConstantEvaluator_Eval(evaluator, module, function, frame, AST_LIST_ITEM(module, arguments, i),
+                                    &argument)) {
+            evaluator->values_count = callee_frame;
+            return false;
+        }
+        if (evaluator->values_count == evaluator->values_capacity) {
+            evaluator->values_capacity = evaluator->values_capacity == 0 ? 64 : evaluator->values_capacity * 2;
+            evaluator->values = realloc(evaluator->values, sizeof(*evaluator->values) * evaluator->values_capacity);
+            if (evaluator->values == NULL) {
+                exit(VISMUT_ERROR_ALLOC);
+            }
+        }
+        evaluator->values[evaluator->values_count++] = argument;
+    }
+
+    evaluator->memory += frame_size;
+    const bool evaluated = ConstantEvaluator_Eval(evaluator, module, callee, callee_frame, body, result);
+    evaluator->memory -= frame_size;
+    evaluator->values_count = callee_frame;
+    return evaluated;
+}
+
+// Computes an expression of a pure function body the way the generated code would, false when it reads
+// anything but the parameters, would trap, or runs out of the budget
+static bool ConstantEvaluator_Eval(ConstantEvaluator *evaluator, const ASTModule *module,
+                                   const FunctionSignature *function, const uint32_t frame, const ASTNodeId node_id,
+                                   VValue *result) {
+    if (evaluator->steps == 0) {
+        return false;
+    }
+    --evaluator->steps;
+
+    const ASTNode *node = AST_NODE(module, node_id);
+    switch (node->type) {
+        case AST_LITERAL:
+            *result = node->literal;
+            return ConstantEvaluator_IsNumber(*result);
+        case AST_VAR_REF: {
+            if (function == NULL) {
+                return false;
+            }
+            const size_t param = ConstantEvaluator_Param(function, node->var_ref.symbol);
+            if (param == function->params.params_count) {
+                return false;
             }
-            return ASTOptimize_BinaryExpression(ctx, node);
+            *result = evaluator->values[frame + param];
+            return true;
         }
         case AST_UNARY: {
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->unary_op.operand);
-            if (!(*node)->unary_op.is_pure) {
-                return VISMUT_ERROR_OK;
+            const ASTUnaryType op = node->unary_op.op;
+            if (op == AST_UNARY_INCREMENT || op == AST_UNARY_DECREMENT) {
+                return false;
             }
-            return ASTOptimize_UnaryExpression(ctx, node);
+            VValue operand;
+            return ConstantEvaluator_Eval(evaluator, module, function, frame, node->unary_op.operand, &operand)
+                   && ConstantUnaryEval(operand, op, result) == VISMUT_ERROR_OK;
         }
-        case AST_TERNARY: {
-            const ASTNode *condition = (ASTNode *) (*node)->ternary_op.condition;
-            ASTNode *then_expression = (ASTNode *) (*node)->ternary_op.then_expression;
-            ASTNode *else_expression = (ASTNode *) (*node)->ternary_op.else_expression;
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->ternary_op.condition);
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->ternary_op.then_expression);
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->ternary_op.else_expression);
-            if (IsNodeLiteral(condition)) {
-                if (LiteralToBoolean(condition->literal)) {
-                    *node = then_expression;
-                    return VISMUT_ERROR_OK;
+        case AST_BINARY: {
+            const ASTBinaryType op = node->binary_op.op;
+            if (op == AST_BINARY_ASSIGN) {
+                return false;
+            }
+            VValue left;
+            if (!ConstantEvaluator_Eval(evaluator, module, function, frame, node->binary_op.left, &left)) {
+                return false;
+            }
+            // The right operand of a decided logical operator is never evaluated, recursion may stop there
+            if (op == AST_BINARY_LOGICAL_AND || op == AST_BINARY_LOGICAL_OR) {
+                bool value = LiteralToBoolean(left);
+                if (value == (op == AST_BINARY_LOGICAL_AND)) {
+                    VValue right;
+                    if (!ConstantEvaluator_Eval(evaluator, module, function, frame, node->binary_op.right, &right)) {
+                        return false;
+                    }
+                    value = LiteralToBoolean(right);
                 }
-                *node = else_expression;
-                return VISMUT_ERROR_OK;
+                *result = (VValue){.type = VALUE_I64, .i64 = value};
+                return true;
+            }
+
+            VValue right;
+            if (!ConstantEvaluator_Eval(evaluator, module, function, frame, node->binary_op.right, &right)
+                || left.type != right.type) {
+                return false;
             }
+            if (left.type == VALUE_I64) {
+                if ((op == AST_BINARY_INT_DIV || op == AST_BINARY_MOD)
+                    && (right.i64 == 0 || (right.i64 == -1 && left.i64 == INT64_MIN))) {
+                    return false;
+                }
+                if ((op == AST_BINARY_SHIFT_LEFT || op == AST_BINARY_SHIFT_RIGHT) && (right.i64 < 0 || right.i64 > 63)) {
+                    return false;
+                }
+            }
+            return ConstantBinaryEval(left, right, op, result) == VISMUT_ERROR_OK;
+        }
+        case AST_TERNARY: {
+            VValue condition;
+            if (!ConstantEvaluator_Eval(evaluator, module, function, frame, node->ternary_op.condition, &condition)) {
+                return false;
+            }
+            const ASTNodeId taken = LiteralToBoolean(condition)
+                                        ? node->ternary_op.then_expression
+                                        : node->ternary_op.else_expression;
+            return ConstantEvaluator_Eval(evaluator, module, function, frame, taken, result);
+        }
+        case AST_TYPE_CAST: {
+            VValue operand;
+            if (!ConstantEvaluator_Eval(evaluator, module, function, frame, node->type_cast.expression, &operand)) {
+                return false;
+            }
+            if (operand.type == node->type_cast.target_type) {
+                *result = operand;
+                return true;
+            }
+            // Out of range conversions are undefined in the generated code
+            if (operand.type == VALUE_F64 && !(operand.f64 > -0x1p63 && operand.f64 < 0x1p63)) {
+                return false;
+            }
+            *result = ConstantTypeCastEval(operand, node->type_cast.target_type);
+            return ConstantEvaluator_IsNumber(*result);
+        }
+        case AST_FUNCTION_CALL:
+            return ConstantEvaluator_Call(evaluator, module, function, frame, node, result);
+        default:
+            return false;
+    }
+}
+
+// A call of a pure expression-bodied function whose arguments are literals becomes its result, when the
+// evaluation fits in AST_CTFE_MAX_STEPS and AST_CTFE_MAX_MEMORY
+static errno_t ASTOptimize_FunctionCall(SimpleOptimizationsContext *ctx, ASTNodeId *node_id) {
+    const ASTNode *node = AST_NODE(ctx->module, *node_id);
+    DEBUG_ASSERT(node->type == AST_FUNCTION_CALL);
+
+    ConstantEvaluator *evaluator = &ctx->evaluator;
+    const ASTNodeList arguments = node->function_call.arguments;
+    if (evaluator->module_steps == 0 || ConstantEvaluator_Body(ctx->module, node->function_call.signature)
+                                        == AST_NODE_NONE) {
+        return VISMUT_ERROR_OK;
+    }
+    for (uint32_t i = 0; i < arguments.count; ++i) {
+        if (!IsNodeLiteral(AST_NODE(ctx->module, AST_LIST_ITEM(ctx->module, arguments, i)))) {
             return VISMUT_ERROR_OK;
         }
-        case AST_PRINT_STMT: {
-            ASTNode **current = (ASTNode **) &(*node)->print_stmt.expressions;
-            while (*current != NULL) {
-                ASTNode *next = (ASTNode *) (*current)->next_node;
-                RISKY_EXPRESSION_SAFE(ASTOptimize_SimpleOptimizations(ctx, current), err);
-                (*current)->next_node = (struct ASTNode *) next;
-                current = (ASTNode **) &(*current)->next_node;
+    }
+
+    evaluator->steps = evaluator->module_steps < AST_CTFE_MAX_STEPS ? evaluator->module_steps : AST_CTFE_MAX_STEPS;
+    const uint32_t steps = evaluator->steps;
+    VValue result;
+    const bool evaluated = ConstantEvaluator_Eval(evaluator, ctx->module, NULL, 0, *node_id, &result);
+    evaluator->module_steps -= steps - evaluator->steps;
+    if (!evaluated || result.type != node->expr_type) {
+        return VISMUT_ERROR_OK;
+    }
+
+    *node_id = CreateLiteralNode(ctx->module, ASTNode_Position(ctx->module, *node_id), result);
+    if (ctx->function != NULL) {
+        ctx->function->flags |= FUNCTION_FLAG_INLINED;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTOptimize_SimpleOptimizationsEnter(ASTVisitor *visitor, ASTNodeId *node_id, bool *skip_children) {
+    SimpleOptimizationsContext *ctx = visitor->context;
+    const ASTNode *node = AST_NODE(visitor->module, *node_id);
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTOptimize_SkipReusedEnter(visitor, node_id, skip_children), err);
+    if (node->type == AST_FUNCTION_DECL && !*skip_children && ASTVisitor_Parent(visitor) == visitor->module->root) {
+        ctx->function = node->function_decl.signature;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// A statement whose condition is a literal becomes the branch it takes, AST_NODE_NONE when there is none
+static errno_t ASTOptimize_ConditionalStatement(SimpleOptimizationsContext *ctx, ASTNodeId *node_id) {
+    const ASTNode *node = AST_NODE(ctx->module, *node_id);
+    const ASTNodeId condition = node->type == AST_IF_STMT ? node->if_stmt.condition : node->while_stmt.condition;
+    const ASTNode *condition_node = AST_NODE(ctx->module, condition);
+    if (!IsNodeLiteral(condition_node)) {
+        return VISMUT_ERROR_OK;
+    }
+
+    errno_t err;
+    const bool taken = LiteralToBoolean(condition_node->literal);
+    if (node->type == AST_WHILE_STMT) {
+        // `@ 1` stays: the loop is left through its body, if ever
+        if (!taken) {
+            RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, node->while_stmt.body), err);
+            *node_id = AST_NODE_NONE;
+        }
+        return VISMUT_ERROR_OK;
+    }
+
+    const ASTNodeId kept = taken ? node->if_stmt.then_block : node->if_stmt.else_block;
+    const ASTNodeId dropped = taken ? node->if_stmt.else_block : node->if_stmt.then_block;
+    if (dropped != AST_NODE_NONE) {
+        RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, dropped), err);
+    }
+    *node_id = kept;
+    return VISMUT_ERROR_OK;
+}
+
+// Folds a node whose children are already simplified
+static errno_t ASTOptimize_Fold(SimpleOptimizationsContext *ctx, ASTNodeId *node_id) {
+    ASTNode *node = AST_NODE(ctx->module, *node_id);
+
+    switch (node->type) {
+        case AST_BINARY:
+            if (!node->binary_op.is_pure) {
+                return VISMUT_ERROR_OK;
+            }
+            return ASTOptimize_BinaryExpression(ctx, node_id);
+        case AST_UNARY:
+            if (!node->unary_op.is_pure) {
+                return VISMUT_ERROR_OK;
+            }
+            return ASTOptimize_UnaryExpression(ctx, node_id);
+        case AST_TERNARY: {
+            const ASTNode *condition_node = AST_NODE(ctx->module, node->ternary_op.condition);
+            if (IsNodeLiteral(condition_node)) {
+                const bool taken = LiteralToBoolean(condition_node->literal);
+                errno_t err;
+                const ASTNodeId dropped = taken ? node->ternary_op.else_expression : node->ternary_op.then_expression;
+                RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, dropped), err);
+                *node_id = taken ? node->ternary_op.then_expression : node->ternary_op.else_expression;
+                return VISMUT_ERROR_OK;
             }
             return VISMUT_ERROR_OK;
         }
         case AST_TYPE_CAST: {
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->type_cast.expression);
-            if ((*node)->type_cast.from_type == (*node)->type_cast.target_type) {
-                ASTNode *expression = (ASTNode *) (*node)->type_cast.expression;
-                expression->pos = (*node)->pos;
-                *node = expression;
+            if (node->type_cast.from_type == node->type_cast.target_type) {
+                const ASTNodeId expression = node->type_cast.expression;
+                ASTNode_SetPosition(ctx->module, expression, ASTNode_Position(ctx->module, *node_id));
+                *node_id = expression;
+                return VISMUT_ERROR_OK;
+            }
+            if (!node->type_cast.is_pure) {
+                return VISMUT_ERROR_OK;
+            }
+            return ASTOptimize_TypeCast(ctx, node_id);
+        }
+        case AST_FUNCTION_CALL:
+            return ASTOptimize_FunctionCall(ctx, node_id);
+        case AST_IF_STMT:
+        case AST_WHILE_STMT:
+            return ASTOptimize_ConditionalStatement(ctx, node_id);
+        case AST_BLOCK:
+            ASTOptimize_CompactStatements(ctx->module, &node->block.statements);
+            return VISMUT_ERROR_OK;
+        case AST_MODULE:
+            ASTOptimize_CompactStatements(ctx->module, &node->module.statements);
+            return VISMUT_ERROR_OK;
+        default:
+            return VISMUT_ERROR_OK;
+    }
+}
+
+// Folds on the way up, so the children are already simplified when their parent is looked at
+static errno_t ASTOptimize_SimpleOptimizationsLeave(ASTVisitor *visitor, ASTNodeId *node_id) {
+    SimpleOptimizationsContext *ctx = visitor->context;
+    if (AST_NODE(visitor->module, *node_id)->type == AST_FUNCTION_DECL
+        && ASTVisitor_Parent(visitor) == visitor->module->root) {
+        ctx->function = NULL;
+    }
+    return ASTOptimize_Fold(ctx, node_id);
+}
+
+typedef struct {
+    ASTModule *module;
+    ASTVisitor forget_uses;
+    bool changed;
+} DeadVariablesContext;
+
+// Comparisons and logical operators, whose i64 result only tells true from false
+attribute_pure
+static bool IsNodeCondition(const ASTNode *node) {
+    switch (node->type) {
+        case AST_UNARY:
+            return node->unary_op.op == AST_UNARY_LOGICAL_NOT;
+        case AST_BINARY:
+            switch (node->binary_op.op) {
+                case AST_BINARY_LESS_THAN:
+                case AST_BINARY_LESS_THAN_OR_EQUALS:
+                case AST_BINARY_GREATER_THAN:
+                case AST_BINARY_GREATER_THAN_OR_EQUALS:
+                case AST_BINARY_EQUALS:
+                case AST_BINARY_NOT_EQUALS:
+                case AST_BINARY_LOGICAL_AND:
+                case AST_BINARY_LOGICAL_OR:
+                    return true;
+                default:
+                    return false;
+            }
+        default:
+            return false;
+    }
+}
+
+// A comparison the value ranges of its operands decide becomes its result, wherever it stands
+static errno_t ASTOptimize_DecidedConditionsLeave(ASTVisitor *visitor, ASTNodeId *node_id) {
+    DeadVariablesContext *ctx = visitor->context;
+    const ASTNode *node = AST_NODE(ctx->module, *node_id);
+    if (node->expr_type != VALUE_I64 || !IsNodeCondition(node) || !IsNodePure(node)) {
+        return VISMUT_ERROR_OK;
+    }
+
+    const ASTRange range = ASTNode_Range(ctx->module, *node_id);
+    if (!ASTRange_IsConstant(range)) {
+        return VISMUT_ERROR_OK;
+    }
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, *node_id), err);
+    *node_id = CreateLiteralNode(ctx->module, ASTNode_Position(ctx->module, *node_id),
+                                 (VValue){.type = VALUE_I64, .i64 = range.min});
+    return VISMUT_ERROR_OK;
+}
+
+errno_t ASTOptimize_FoldDecidedConditions(ASTModule *module) {
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTModule_InferRanges(module), err);
+
+    DeadVariablesContext ctx = {
+        .module = module,
+    };
+    ASTOptimize_InitForgetUses(&ctx.forget_uses, module);
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &ctx);
+    visitor.enter = ASTOptimize_SkipReusedEnter;
+    visitor.leave = ASTOptimize_DecidedConditionsLeave;
+    err = ASTVisit(&visitor, &module->root);
+    ASTModule_DropRanges(module);
+    return err;
+}
+
+attribute_pure
+static bool IsDeadSymbol(const ASTModule *module, const Symbol *symbol) {
+    if (symbol == NULL || symbol->declaration == AST_NODE_NONE || symbol->reads_count != 0) {
+        return false;
+    }
+    const ASTNodeId init_value = AST_NODE(module, symbol->declaration)->var_decl.init_value;
+    return init_value == AST_NODE_NONE || IsNodePure(AST_NODE(module, init_value));
+}
+
+attribute_pure
+static bool IsPureExpressionStatement(const ASTNode *node) {
+    switch (node->type) {
+        case AST_LITERAL:
+        case AST_VAR_REF:
+        case AST_UNARY:
+        case AST_BINARY:
+        case AST_TERNARY:
+        case AST_TYPE_CAST:
+        case AST_FUNCTION_CALL:
+            return IsNodePure(node);
+        default:
+            return false;
+    }
+}
+
+// Whether the node being visited is an item of a block or of the module statements
+attribute_pure
+static bool IsVisitingStatement(const ASTVisitor *visitor) {
+    const ASTNodeId parent = ASTVisitor_Parent(visitor);
+    if (parent == AST_NODE_NONE) {
+        return false;
+    }
+    const ASTNode *parent_node = AST_NODE(visitor->module, parent);
+    return parent_node->type == AST_BLOCK
+           || (parent_node->type == AST_MODULE && ASTVisitor_Index(visitor) >= parent_node->module.functions.count);
+}
+
+static errno_t ASTOptimize_DeadVariablesEnter(ASTVisitor *visitor, ASTNodeId *node_id, bool *skip_children) {
+    DeadVariablesContext *ctx = visitor->context;
+    const ASTNode *node = AST_NODE(ctx->module, *node_id);
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTOptimize_SkipReusedEnter(visitor, node_id, skip_children), err);
+    if (*skip_children) {
+        return VISMUT_ERROR_OK;
+    }
+
+    if (node->type == AST_VAR_DECL && IsVisitingStatement(visitor)
+        && IsDeadSymbol(ctx->module, node->var_decl.symbol)) {
+        RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, *node_id), err);
+        *node_id = AST_NODE_NONE;
+        ctx->changed = true;
+        return VISMUT_ERROR_OK;
+    }
+
+    if (node->type == AST_BINARY && node->binary_op.op == AST_BINARY_ASSIGN) {
+        const ASTNode *left = AST_NODE(ctx->module, node->binary_op.left);
+        if (left->type == AST_VAR_REF && IsDeadSymbol(ctx->module, left->var_ref.symbol)) {
+            // Store to a never read variable: keep only the value, `(a = x)` evaluates to `x`
+            RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, node->binary_op.left), err);
+            *node_id = node->binary_op.right;
+            ctx->changed = true;
+        }
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTOptimize_DeadVariablesLeave(ASTVisitor *visitor, ASTNodeId *node_id) {
+    DeadVariablesContext *ctx = visitor->context;
+    ASTNode *node = AST_NODE(ctx->module, *node_id);
+    errno_t err;
+
+    switch (node->type) {
+        case AST_MODULE:
+            ASTOptimize_CompactStatements(ctx->module, &node->module.statements);
+            break;
+        case AST_BLOCK:
+            ASTOptimize_CompactStatements(ctx->module, &node->block.statements);
+            break;
+        default:
+            break;
+    }
+
+    if (IsVisitingStatement(visitor) && IsPureExpressionStatement(node)) {
+        RISKY_EXPRESSION_SAFE(ASTOptimize_ForgetUses(&ctx->forget_uses, *node_id), err);
+        *node_id = AST_NODE_NONE;
+        ctx->changed = true;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+errno_t ASTOptimize_EliminateDeadVariables(ASTModule *module) {
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    DeadVariablesContext ctx = {
+        .module = module,
+    };
+    ASTOptimize_InitForgetUses(&ctx.forget_uses, module);
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &ctx);
+    visitor.enter = ASTOptimize_DeadVariablesEnter;
+    visitor.leave = ASTOptimize_DeadVariablesLeave;
+
+    // Dropping a declaration releases the reads of its initializer, which can make earlier declarations dead too
+    errno_t err;
+    do {
+        ctx.changed = false;
+        RISKY_EXPRESSION_SAFE(ASTVisit(&visitor, &module->root), err);
+    } while (ctx.changed);
+
+    return VISMUT_ERROR_OK;
+}
+
+typedef struct {
+    SimpleOptimizationsContext fold;
+    Symbol **known; // reassigned variables with SYMBOL_FLAG_CONST_EVAL set by the straight-line code walked so far
+    uint32_t known_count;
+    uint32_t known_capacity;
+} ConstantPropagationContext;
+
+static errno_t ASTOptimize_MarkReassignedEnter(ASTVisitor *visitor, ASTNodeId *node_id, bool *skip_children) {
+    const ASTNode *node = AST_NODE(visitor->module, *node_id);
+    if (node->type == AST_VAR_REF && node->var_ref.symbol != NULL && (node->flags & AST_NODE_FLAG_ASSIGN_TARGET)) {
+        node->var_ref.symbol->flags |= SYMBOL_FLAG_REASSIGNED;
+    } else if (node->type == AST_UNARY
+               && (node->unary_op.op == AST_UNARY_INCREMENT || node->unary_op.op == AST_UNARY_DECREMENT)) {
+        const ASTNode *operand = AST_NODE(visitor->module, node->unary_op.operand);
+        if (operand->type == AST_VAR_REF && operand->var_ref.symbol != NULL) {
+            operand->var_ref.symbol->flags |= SYMBOL_FLAG_REASSIGNED;
+        }
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Control flow joins paths the walk does not follow: only the variables that are never reassigned stay known
+static void ConstantPropagation_ForgetAll(ConstantPropagationContext *ctx) {
+    for (uint32_t i = 0; i < ctx->known_count; ++i) {
+        ctx->known[i]->flags &= ~SYMBOL_FLAG_CONST_EVAL;
+    }
+    ctx->known_count = 0;
+}
+
+// The variable holds the value of `value_id` from now on, known when it is a number literal
+static void ConstantPropagation_Assign(ConstantPropagationContext *ctx, Symbol *symbol, const ASTNodeId value_id) {
+    const ASTNode *value = value_id != AST_NODE_NONE ? AST_NODE(ctx->fold.module, value_id) : NULL;
+    if (value == NULL || !IsNodeLiteral(value) || value->literal.type != symbol->value.type
+        || (value->literal.type != VALUE_I64 && value->literal.type != VALUE_F64)) {
+        symbol->flags &= ~SYMBOL_FLAG_CONST_EVAL;
+        return;
+    }
+
+    symbol->value = value->literal;
+    if ((symbol->flags & (SYMBOL_FLAG_REASSIGNED | SYMBOL_FLAG_CONST_EVAL)) == SYMBOL_FLAG_REASSIGNED) {
+        if (ctx->known_count == ctx->known_capacity) {
+            ctx->known_capacity = ctx->known_capacity == 0 ? 16 : ctx->known_capacity * 2;
+            ctx->known = realloc(ctx->known, sizeof(*ctx->known) * ctx->known_capacity);
+            if (ctx->known == NULL) {
+                exit(VISMUT_ERROR_ALLOC);
+            }
+        }
+        ctx->known[ctx->known_count++] = symbol;
+    }
+    symbol->flags |= SYMBOL_FLAG_CONST_EVAL;
+}
+
+static errno_t ASTOptimize_PropagateConstantsEnter(ASTVisitor *visitor, ASTNodeId *node_id, bool *skip_children) {
+    ConstantPropagationContext *ctx = visitor->context;
+    const ASTNode *node = AST_NODE(ctx->fold.module, *node_id);
+    errno_t err;
+
+    switch (node->type) {
+        case AST_FUNCTION_DECL:
+            RISKY_EXPRESSION_SAFE(ASTOptimize_SkipReusedEnter(visitor, node_id, skip_children), err);
+            if (*skip_children) {
                 return VISMUT_ERROR_OK;
             }
-            if (!(*node)->type_cast.is_pure) {
+            if (ASTVisitor_Parent(visitor) == ctx->fold.module->root) {
+                ctx->fold.function = node->function_decl.signature;
+            }
+            ConstantPropagation_ForgetAll(ctx);
+            return VISMUT_ERROR_OK;
+        case AST_WHILE_STMT:
+            // The guard is evaluated again after every run of the body
+            ConstantPropagation_ForgetAll(ctx);
+            return VISMUT_ERROR_OK;
+        case AST_UNARY: {
+            if (node->unary_op.op != AST_UNARY_INCREMENT && node->unary_op.op != AST_UNARY_DECREMENT) {
                 return VISMUT_ERROR_OK;
             }
-            return ASTOptimize_TypeCast(ctx, node);
+            // The operand is written, not read: it must stay a variable
+            const ASTNode *operand = AST_NODE(ctx->fold.module, node->unary_op.operand);
+            if (operand->type == AST_VAR_REF && operand->var_ref.symbol != NULL) {
+                operand->var_ref.symbol->flags &= ~SYMBOL_FLAG_CONST_EVAL;
+                *skip_children = true;
+            }
+            return VISMUT_ERROR_OK;
         }
-        case AST_VAR_DECL: {
-            ASTNode *initial_value = (ASTNode *) (*node)->var_decl.init_value;
-            if (initial_value == NULL) {
+        default:
+            return VISMUT_ERROR_OK;
+    }
+}
+
+static errno_t ASTOptimize_PropagateConstantsAfterChild(ASTVisitor *visitor, const ASTNodeId node_id,
+                                                        const uint32_t index) {
+    ConstantPropagationContext *ctx = visitor->context;
+    // The else branch starts from the state before the then branch, which the walk no longer has
+    if (AST_NODE(ctx->fold.module, node_id)->type == AST_IF_STMT && index == 1) {
+        ConstantPropagation_ForgetAll(ctx);
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTOptimize_PropagateConstantsLeave(ASTVisitor *visitor, ASTNodeId *node_id) {
+    ConstantPropagationContext *ctx = visitor->context;
+    const ASTNode *node = AST_NODE(ctx->fold.module, *node_id);
+
+    switch (node->type) {
+        case AST_VAR_REF: {
+            Symbol *symbol = node->var_ref.symbol;
+            if (symbol == NULL || (node->flags & AST_NODE_FLAG_ASSIGN_TARGET)
+                || !(symbol->flags & SYMBOL_FLAG_CONST_EVAL)) {
                 return VISMUT_ERROR_OK;
             }
-            SAFE_SIMPLE_OPTIMIZATIONS(ctx, err, (*node)->var_decl.init_value);
+            Symbol_RemoveUse(symbol, *node_id, true);
+            *node_id = CreateLiteralNode(ctx->fold.module, ASTNode_Position(ctx->fold.module, *node_id),
+                                         symbol->value);
             return VISMUT_ERROR_OK;
         }
-        case AST_MODULE: {
-            ASTNode **current = (ASTNode **) &(*node)->module.statements;
-            while (*current != NULL) {
-                ASTNode *next = (ASTNode *) (*current)->next_node;
-                RISKY_EXPRESSION_SAFE(ASTOptimize_SimpleOptimizations(ctx, current), err);
-                (*current)->next_node = (struct ASTNode *) next;
-                current = (ASTNode **) &(*current)->next_node;
+        case AST_VAR_DECL:
+            if (node->var_decl.symbol != NULL) {
+                ConstantPropagation_Assign(ctx, node->var_decl.symbol, node->var_decl.init_value);
+            }
+            return VISMUT_ERROR_OK;
+        case AST_BINARY: {
+            const ASTNode *left = AST_NODE(ctx->fold.module, node->binary_op.left);
+            if (node->binary_op.op != AST_BINARY_ASSIGN || left->type != AST_VAR_REF
+                || left->var_ref.symbol == NULL) {
+                return ASTOptimize_Fold(&ctx->fold, node_id);
+            }
+            // Inside an expression the store may be skipped by a ternary or a logical operator
+            if (IsVisitingStatement(visitor)) {
+                ConstantPropagation_Assign(ctx, left->var_ref.symbol, node->binary_op.right);
+            } else {
+                left->var_ref.symbol->flags &= ~SYMBOL_FLAG_CONST_EVAL;
             }
             return VISMUT_ERROR_OK;
         }
-        default:
+        case AST_FUNCTION_CALL:
+            // A nested function may write the variables of its enclosing one
+            if (!IsNodePure(node)) {
+                ConstantPropagation_ForgetAll(ctx);
+                return VISMUT_ERROR_OK;
+            }
+            return ASTOptimize_Fold(&ctx->fold, node_id);
+        case AST_IF_STMT:
+        case AST_WHILE_STMT:
+            ConstantPropagation_ForgetAll(ctx);
+            return ASTOptimize_Fold(&ctx->fold, node_id);
+        case AST_FUNCTION_DECL:
+            if (ASTVisitor_Parent(visitor) == ctx->fold.module->root) {
+                ctx->fold.function = NULL;
+            }
+            ConstantPropagation_ForgetAll(ctx);
             return VISMUT_ERROR_OK;
+        default:
+            return ASTOptimize_Fold(&ctx->fold, node_id);
     }
 }
 
-errno_t ASTOptimize(Arena *arena, ASTNode *node) {
+errno_t ASTOptimize_PropagateConstants(ASTModule *module) {
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, NULL);
+    visitor.enter = ASTOptimize_MarkReassignedEnter;
+
+    errno_t err;
+    RISKY_EXPRESSION_SAFE(ASTVisit(&visitor, &module->root), err);
+
+    ConstantPropagationContext ctx = {
+        .fold = {
+            .arena = module->arena,
+            .module = module,
+            .evaluator.module_steps = AST_CTFE_MODULE_STEPS,
+        },
+    };
+    ASTOptimize_InitForgetUses(&ctx.fold.forget_uses, module);
+    ASTVisitor_Init(&visitor, module, &ctx);
+    visitor.enter = ASTOptimize_PropagateConstantsEnter;
+    visitor.after_child = ASTOptimize_PropagateConstantsAfterChild;
+    visitor.leave = ASTOptimize_PropagateConstantsLeave;
+    err = ASTVisit(&visitor, &module->root);
+
+    ConstantPropagation_ForgetAll(&ctx);
+    free(ctx.known);
+    free(ctx.fold.evaluator.values);
+    return err;
+}
+
+errno_t ASTOptimize(Arena *arena, ASTModule *module) {
     SimpleOptimizationsContext ctx = {
         .arena = arena,
+        .module = module,
+        .evaluator.module_steps = AST_CTFE_MODULE_STEPS,
     };
+    ASTOptimize_InitForgetUses(&ctx.forget_uses, module);
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &ctx);
+    visitor.enter = ASTOptimize_SimpleOptimizationsEnter;
+    visitor.leave = ASTOptimize_SimpleOptimizationsLeave;
 
-    errno_t err;
-    if ((err = ASTOptimize_SimpleOptimizations(&ctx, &node))) {
+    errno_t err = ASTVisit(&visitor, &module->root);
+    free(ctx.evaluator.values);
+    if (err) {
+        return err;
+    }
+    // After the bodies are folded, before the passes that fold what the copies of the bodies unlock
+    if ((err = ASTModule_InlineCalls(module))) {
+        return err;
+    }
+    if ((err = ASTOptimize_FoldDecidedConditions(module))) {
+        return err;
+    }
+    // Also drops the branches and loops whose conditions were decided above
+    if ((err = ASTOptimize_PropagateConstants(module))) {
+        return err;
+    }
+    if ((err = ASTOptimize_EliminateDeadVariables(module))) {
+        return err;
+    }
+    // Before the temporaries in front of the loops are shared with the statements around them
+    if ((err = ASTModule_HoistLoopInvariants(module))) {
+        return err;
+    }
+    // After dead code is gone, so that no temporary is left with a single read
+    if ((err = ASTModule_EliminateCommonSubexpressions(module))) {
+        return err;
+    }
+    // Last: the passes above rewrite children in place, which shared nodes no longer allow
+    if ((err = ASTModule_HashCons(module))) {
         return err;
     }
 
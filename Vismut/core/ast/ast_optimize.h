@@ -6,7 +6,33 @@
 #define VISMUT_AST_OPTIMIZE_H
 #include "../types.h"
 #include "ast.h"
+#include "ast_visit.h"
 
-errno_t ASTOptimize(Arena *arena, ASTNode *node);
+// Budgets of the compile-time evaluation of pure calls: expression nodes evaluated for one call and for all
+// the calls of a pass, and bytes of the frames of the calls it makes in turn
+#define AST_CTFE_MAX_STEPS (1u << 18)
+#define AST_CTFE_MODULE_STEPS (1u << 22)
+#define AST_CTFE_MAX_MEMORY (16u << 10)
+
+errno_t ASTOptimize(Arena *arena, ASTModule *module);
+
+// Sets up a visitor that unregisters every variable reference of the subtrees the passes drop from the tree
+void ASTOptimize_InitForgetUses(ASTVisitor *forget_uses, const ASTModule *module);
+
+errno_t ASTOptimize_ForgetUses(ASTVisitor *forget_uses, ASTNodeId node_id);
+
+// Enter callback leaving out the bodies of the functions reused from the previous build, for the passes that
+// walk the whole module
+errno_t ASTOptimize_SkipReusedEnter(ASTVisitor *visitor, ASTNodeId *node_id, bool *skip_children);
+
+errno_t ASTOptimize_EliminateDeadVariables(ASTModule *module);
+
+// Replaces the reads of variables holding a known number by that number and folds what it unlocks.
+// Variables never reassigned are known everywhere after their declaration, the others until the next
+// branch, loop or call
+errno_t ASTOptimize_PropagateConstants(ASTModule *module);
+
+// Replaces the comparisons that value ranges decide by their results, see ASTModule_InferRanges
+errno_t ASTOptimize_FoldDecidedConditions(ASTModule *module);
 
 #endif //VISMUT_AST_OPTIMIZE_H
\ No newline at end of file
@@ -1,11 +1,15 @@
 #include "ast_parse.h"
 
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "ast_compact.h"
+#include "ast_visit.h"
 #include "../errors/errors.h"
 #include "../errors/callstack.h"
+#include "../thread/thread.h"
 #include "../../utils/find_position.h"
 #include "../../utils/module_name.h"
 #include "../hash/murmur3.h"
@@ -29,6 +33,15 @@
 
 #define PARSE_EXPRESSION_OR_BLOCK_SAFE(ast_parser_ptr, err_var, node_ptr_ptr) RISKY_EXPRESSION_SAFE(ASTParser_ParseExpressionOrBlock(ast_parser_ptr, node_ptr_ptr), err_var)
 
+#define AST_PARSER_INITIAL_PENDING_ITEMS 64
+#define AST_PARSER_INITIAL_FUNCTION_SPANS 16
+// Below this many block-bodied functions per worker, starting threads costs more than it saves
+#define AST_PARSER_FUNCTIONS_PER_WORKER 16
+#define AST_PARSER_SPAN_SEED_HIGH 0x2545f491
+// The parser is recursive descent: a level takes under a kilobyte of stack in a debug build, so this stays well
+// inside the 1 MB a Windows thread gets by default
+#define AST_PARSER_MAX_NESTING_DEPTH 1024
+
 #define NEXT_TOKEN_EXCEPT(ast_parser_ptr, err_var, token_type) \
     START_BLOCK_WRAPPER \
         NEXT_TOKEN_SAFE(ast_parser_ptr, err_var); \
@@ -50,111 +63,74 @@ typedef enum {
     PRECEDENCE_PRIMARY,
 } OperatorPrecedence;
 
-static errno_t ASTParser_ParseUnaryExpression(ASTParser *, ASTNode **);
+static errno_t ASTParser_ParseUnaryExpression(ASTParser *, ASTNodeId *);
 
-static errno_t ASTParser_ParsePrimaryExpression(ASTParser *, ASTNode **);
+static errno_t ASTParser_ParsePrimaryExpression(ASTParser *, ASTNodeId *);
 
-static errno_t ASTParser_ParseExpression(ASTParser *, ASTNode **);
+static errno_t ASTParser_ParseExpression(ASTParser *, ASTNodeId *);
 
-static errno_t ASTParser_ParseExpressionWithPrecedence(ASTParser *, ASTNode **, OperatorPrecedence);
+static errno_t ASTParser_ParseExpressionWithPrecedence(ASTParser *, ASTNodeId *, OperatorPrecedence);
 
-static errno_t ASTParser_ParseStatement(ASTParser *ast_parser, ASTNode **node);
+static errno_t ASTParser_ParseStatement(ASTParser *ast_parser, ASTNodeId *node);
 
-static errno_t ASTParser_ParseExpressionOrBlock(ASTParser *ast_parser, ASTNode **node);
+static errno_t ASTParser_ParseExpressionOrBlock(ASTParser *ast_parser, ASTNodeId *node);
 
-static errno_t ASTParser_ParseBlock(ASTParser *ast_parser, ASTNode **node);
+static errno_t ASTParser_ParseBlock(ASTParser *ast_parser, ASTNodeId *node);
 
-static OperatorPrecedence GetPrecedence(const VTokenType token) {
-    CALLSTACK_TRACE();
-    switch (token) {
-        case TOKEN_ASSIGN:
-            return PRECEDENCE_ASSIGNMENT;
-        case TOKEN_QUESTION:
-            return PRECEDENCE_TERNARY;
-        case TOKEN_LOGICAL_OR:
-            return PRECEDENCE_LOGICAL_OR;
-        case TOKEN_LOGICAL_AND:
-            return PRECEDENCE_LOGICAL_AND;
-        case TOKEN_EQUALS:
-        case TOKEN_NOT_EQUALS:
-            return PRECEDENCE_EQUALITY;
-        case TOKEN_LESS_THAN:
-        case TOKEN_LESS_THAN_OR_EQUALS:
-        case TOKEN_GREATER_THAN:
-        case TOKEN_GREATER_THAN_OR_EQUALS:
-            return PRECEDENCE_RELATIONAL;
-        case TOKEN_PLUS:
-        case TOKEN_MINUS:
-            return PRECEDENCE_ADDITIVE;
-        case TOKEN_STAR:
-        case TOKEN_DIVIDE:
-        case TOKEN_INT_DIVIDE:
-            return PRECEDENCE_MULTIPLICATIVE;
-        case TOKEN_POWER:
-            return PRECEDENCE_UNARY;
-        default:
-            return PRECEDENCE_NONE;
-    }
-}
-
-attribute_const
-static ASTBinaryType GetBinaryType(const VTokenType token) {
-    switch (token) {
-        case TOKEN_PLUS:
-            return AST_BINARY_ADD;
-        case TOKEN_MINUS:
-            return AST_BINARY_SUB;
-        case TOKEN_STAR:
-            return AST_BINARY_MUL;
-        case TOKEN_DIVIDE:
-            return AST_BINARY_DIV;
-        case TOKEN_INT_DIVIDE:
-            return AST_BINARY_INT_DIV;
-        case TOKEN_MODULE_DIV:
-            return AST_BINARY_MOD;
-        case TOKEN_ASSIGN:
-            return AST_BINARY_ASSIGN;
-        case TOKEN_POWER:
-            return AST_BINARY_POW;
-        case TOKEN_EQUALS:
-            return AST_BINARY_EQUALS;
-        case TOKEN_NOT_EQUALS:
-            return AST_BINARY_NOT_EQUALS;
-        case TOKEN_GREATER_THAN:
-            return AST_BINARY_GREATER_THAN;
-        case TOKEN_GREATER_THAN_OR_EQUALS:
-            return AST_BINARY_GREATER_THAN_OR_EQUALS;
-        case TOKEN_LESS_THAN:
-            return AST_BINARY_LESS_THAN;
-        case TOKEN_LESS_THAN_OR_EQUALS:
-            return AST_BINARY_LESS_THAN_OR_EQUALS;
-        default:
-            return AST_BINARY_UNKNOWN;
-    }
-}
-
-attribute_const
-static ASTUnaryType GetUnaryType(const VTokenType token) {
-    switch (token) {
-        case TOKEN_PLUS:
-            return AST_UNARY_PLUS;
-        case TOKEN_MINUS:
-            return AST_UNARY_MINUS;
-        case TOKEN_TILDA:
-            return AST_UNARY_BITWISE_NOT;
-        case TOKEN_EXCLAMATION_MARK:
-            return AST_UNARY_LOGICAL_NOT;
-        case TOKEN_INCREMENT:
-            return AST_UNARY_INCREMENT;
-        case TOKEN_DECREMENT:
-            return AST_UNARY_DECREMENT;
-        default:
-            return AST_UNARY_UNKNOWN;
-    }
-}
+// Source range of a top-level function with a block body, from its `$` to the closing brace
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    FunctionSignature *signature;
+    ASTNodeId node; // declaration parsed ahead by a worker, AST_NODE_NONE to parse it in place
+    uint32_t worker;
+} ASTParserFunctionSpan;
+
+typedef struct {
+    ASTParserFunctionSpan *items;
+    uint32_t count;
+    uint32_t capacity;
+    // Nested functions are declared while the enclosing body is parsed, which only works in source order
+    bool has_nested_functions;
+} ASTParserFunctionSpans;
 
-static int IsRightAssocOperator(const ASTBinaryType token) {
-    return token == AST_BINARY_POW || token == AST_BINARY_ASSIGN;
+typedef struct {
+    const ASTParser *parser; // read only while the workers run
+    ASTParserFunctionSpans *spans;
+    atomic_uint *next_span;
+    Arena *arena;
+    ASTModule *module; // shares the scope and the function table of the parsed module
+    uint32_t index;
+    Thread thread;
+} ASTParserWorker;
+
+typedef enum {
+    OPERATOR_ASSOC_LEFT,
+    OPERATOR_ASSOC_RIGHT,
+} OperatorAssociativity;
+
+typedef struct {
+    uint8_t precedence; // OperatorPrecedence
+    uint8_t binary_op; // ASTBinaryType
+    uint8_t unary_op; // ASTUnaryType
+    uint8_t associativity; // OperatorAssociativity
+} OperatorInfo;
+
+#define OPERATOR_INFO_INIT(name, text, precedence, binary_op, unary_op, associativity) \
+    [name] = {PRECEDENCE_##precedence, AST_BINARY_##binary_op, AST_UNARY_##unary_op, OPERATOR_ASSOC_##associativity},
+
+// One entry per token, so the expression loop does a single load per operator
+static const OperatorInfo OPERATORS[TOKEN_COUNT] = {
+    TOKENS_MAP(OPERATOR_INFO_INIT)
+};
+
+#undef OPERATOR_INFO_INIT
+
+static void ASTParser_SetFunctionSpan(const ASTParser *ast_parser, FunctionSignature *signature, const size_t start,
+                                      const size_t end) {
+    signature->span = (Position){.offset = start, .length = end - start};
+    signature->span_hash[0] = murmurhash3_32(ast_parser->source + start, end - start, MURMURHASH3_DEFAULT_STR_SEED);
+    signature->span_hash[1] = murmurhash3_32(ast_parser->source + start, end - start, AST_PARSER_SPAN_SEED_HIGH);
 }
 
 static void ASTParser_SetError(const ASTParser *ast_parser, const VismutError err_code, const Position position,
@@ -165,7 +141,7 @@ static void ASTParser_SetError(const ASTParser *ast_parser, const VismutError er
     ast_parser->error_info->error = err_code;
     ast_parser->error_info->source = ast_parser->source;
     ast_parser->error_info->source_length = ast_parser->source_length;
-    ast_parser->error_info->module = ast_parser->module_node->module.module_name;
+    ast_parser->error_info->module = ast_parser->module->module_name;
     ast_parser->error_info->column = (int) error_position.column;
     ast_parser->error_info->line = (int) error_position.line;
     ast_parser->error_info->location = ast_parser->source + position.offset;
@@ -173,6 +149,39 @@ static void ASTParser_SetError(const ASTParser *ast_parser, const VismutError er
     ast_parser->error_info->details = details;
 }
 
+static errno_t ASTParser_EnterNesting(ASTParser *ast_parser) {
+    if (unlikely(++ast_parser->nesting_depth > AST_PARSER_MAX_NESTING_DEPTH)) {
+        ASTParser_SetError(ast_parser, VISMUT_ERROR_NESTING_TOO_DEEP, CURRENT_TOKEN_POS(ast_parser),
+                           (VismutErrorDetails){0});
+        return VISMUT_ERROR_NESTING_TOO_DEEP;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static void ASTParser_LeaveNesting(ASTParser *ast_parser) {
+    --ast_parser->nesting_depth;
+}
+
+static void ASTParser_PushPendingItem(ASTParser *ast_parser, const ASTNodeId item) {
+    if (unlikely(ast_parser->pending_items_count == ast_parser->pending_items_capacity)) {
+        const uint32_t new_capacity = ast_parser->pending_items_capacity * 2;
+        ASTNodeId *pending_items = Arena_Array(ast_parser->arena, ASTNodeId, new_capacity);
+        memcpy(pending_items, ast_parser->pending_items, ast_parser->pending_items_count * sizeof(*pending_items));
+        ast_parser->pending_items = pending_items;
+        ast_parser->pending_items_capacity = new_capacity;
+    }
+    ast_parser->pending_items[ast_parser->pending_items_count++] = item;
+}
+
+// Moves the items pushed since list_base into a module list of the exact length
+static ASTNodeList ASTParser_FlushPendingItems(ASTParser *ast_parser, const uint32_t list_base) {
+    DEBUG_ASSERT(list_base <= ast_parser->pending_items_count);
+    const ASTNodeList list = ASTModule_CreateList(ast_parser->module, &ast_parser->pending_items[list_base],
+                                                  ast_parser->pending_items_count - list_base);
+    ast_parser->pending_items_count = list_base;
+    return list;
+}
+
 static errno_t ASTParser_ParseType(const ASTParser *ast_parser, const VToken token, VValueType *out_value) {
     CALLSTACK_TRACE();
 
@@ -219,7 +228,7 @@ static VValue GetVValueFromLiteralToken(const VToken token) {
     }
 }
 
-static errno_t ASTParser_ParseLiteral(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseLiteral(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(
         ast_parser->current_token.type == TOKEN_INT_LITERAL || ast_parser->current_token.type == TOKEN_FLOAT_LITERAL ||
@@ -233,26 +242,13 @@ static errno_t ASTParser_ParseLiteral(ASTParser *ast_parser, ASTNode **node) {
         return VISMUT_ERROR_UNEXPECTED_TOKEN;
     }
 
-    *node = CreateLiteralNode(ast_parser->arena, ast_parser->current_token.position, value);
-
-    NEXT_TOKEN_SAFE(ast_parser, err);
-    return VISMUT_ERROR_OK;
-}
-
-static errno_t ASTParser_ParseVarRef(ASTParser *ast_parser, ASTNode **node) {
-    CALLSTACK_TRACE();
-    DEBUG_ASSERT(ast_parser->current_token.type == TOKEN_IDENTIFIER);
-    errno_t err;
-
-    *node = CreateVarRefNode(
-        ast_parser->arena, ast_parser->current_token.position, ast_parser->current_token.data.chars
-    );
+    *node = CreateLiteralNode(ast_parser->module, ast_parser->current_token.position, value);
 
     NEXT_TOKEN_SAFE(ast_parser, err);
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseParenthesizedExpression(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseParenthesizedExpression(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     errno_t err;
 
@@ -266,7 +262,7 @@ static errno_t ASTParser_ParseParenthesizedExpression(ASTParser *ast_parser, AST
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseUnaryExpression(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseUnaryExpression(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     errno_t err;
 
@@ -278,21 +274,23 @@ static errno_t ASTParser_ParseUnaryExpression(ASTParser *ast_parser, ASTNode **n
     }
 
     const Position op_pos = ast_parser->current_token.position;
+    RISKY_EXPRESSION_SAFE(ASTParser_EnterNesting(ast_parser), err);
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    ASTNode *operand = NULL;
+    ASTNodeId operand = AST_NODE_NONE;
     RISKY_EXPRESSION_SAFE(ASTParser_ParseUnaryExpression(ast_parser, &operand), err);
+    ASTParser_LeaveNesting(ast_parser);
 
-    const ASTUnaryType unary_op = GetUnaryType(op);
+    const ASTUnaryType unary_op = OPERATORS[op].unary_op;
 
     *node = CreateUnaryNode(
-        ast_parser->arena, op_pos, operand, unary_op,
+        ast_parser->module, op_pos, operand, unary_op,
         unary_op != AST_UNARY_INCREMENT && unary_op != AST_UNARY_DECREMENT
     );
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseTypeCast(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseTypeCast(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(
         CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_I64_TYPE || CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_FLOAT_TYPE
@@ -306,21 +304,21 @@ static errno_t ASTParser_ParseTypeCast(ASTParser *ast_parser, ASTNode **node) {
     NEXT_TOKEN_EXCEPT(ast_parser, err, TOKEN_LPAREN);
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    ASTNode *expression;
+    ASTNodeId expression;
     PARSE_EXPRESSION_SAFE(ast_parser, err, &expression);
 
     CURRENT_TOKEN_TYPE_ASSERT(ast_parser, TOKEN_RPAREN);
     NEXT_TOKEN_SAFE(ast_parser, err);
 
     *node = CreateTypeCastNode(
-        ast_parser->arena, pos, expression, target_type /*, true*/
+        ast_parser->module, pos, expression, target_type /*, true*/
     );
 
     return VISMUT_ERROR_OK;
 }
 
 static errno_t
-ASTParser_ParseFunctionCallArguments(ASTParser *ast_parser, ASTNode **arguments, size_t *arguments_count) {
+ASTParser_ParseFunctionCallArguments(ASTParser *ast_parser, ASTNodeList *arguments) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LPAREN);
     errno_t err;
@@ -328,27 +326,17 @@ ASTParser_ParseFunctionCallArguments(ASTParser *ast_parser, ASTNode **arguments,
     // Skip TOKEN_LPAREN
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    ASTNode *first_argument = NULL;
-    ASTNode *last_argument = NULL;
-    size_t count = 0;
+    const uint32_t list_base = ast_parser->pending_items_count;
 
     while (true) {
         if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_RPAREN) {
             NEXT_TOKEN_SAFE(ast_parser, err);
             break;
         }
-        ASTNode *argument;
+        ASTNodeId argument;
         PARSE_EXPRESSION_SAFE(ast_parser, err, &argument);
 
-        if (first_argument == NULL) {
-            first_argument = argument;
-            last_argument = argument;
-        } else {
-            DEBUG_ASSERT(last_argument != NULL);
-            last_argument->next_node = (struct ASTNode *) argument;
-            last_argument = argument;
-        }
-        ++count;
+        ASTParser_PushPendingItem(ast_parser, argument);
 
         if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_COMMA) {
             NEXT_TOKEN_SAFE(ast_parser, err);
@@ -360,36 +348,31 @@ ASTParser_ParseFunctionCallArguments(ASTParser *ast_parser, ASTNode **arguments,
         break;
     }
 
-    *arguments = first_argument;
-    *arguments_count = count;
+    *arguments = ASTParser_FlushPendingItems(ast_parser, list_base);
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseFunctionCall(ASTParser *ast_parser, ASTNode *var_ref_node) {
+static errno_t ASTParser_ParseFunctionCall(ASTParser *ast_parser, const VToken identifier, ASTNodeId *node) {
     CALLSTACK_TRACE();
-    DEBUG_ASSERT(var_ref_node->type == AST_VAR_REF);
+    DEBUG_ASSERT(CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LPAREN);
     errno_t err;
 
-    FunctionSignature *signature = FindFunctionSignature(ast_parser->module_node, var_ref_node->var_ref.var_name);
+    FunctionSignature *signature = FindFunctionSignature(ast_parser->module, identifier.data.chars);
     if (signature == NULL) {
-        ASTParser_SetError(ast_parser, VISMUT_ERROR_FUNCTION_NOT_DEFINED, var_ref_node->pos, (VismutErrorDetails){0});
+        ASTParser_SetError(ast_parser, VISMUT_ERROR_FUNCTION_NOT_DEFINED, identifier.position,
+                           (VismutErrorDetails){0});
         return VISMUT_ERROR_FUNCTION_NOT_DEFINED;
     }
 
-    var_ref_node->type = AST_FUNCTION_CALL;
-    var_ref_node->function_call.signature = signature;
-
-    RISKY_EXPRESSION_SAFE(
-        ASTParser_ParseFunctionCallArguments(ast_parser,
-            (ASTNode**)&var_ref_node->function_call.arguments,
-            &var_ref_node->function_call.arguments_count),
-        err);
+    ASTNodeList arguments;
+    RISKY_EXPRESSION_SAFE(ASTParser_ParseFunctionCallArguments(ast_parser, &arguments), err);
 
+    *node = CreateFunctionCallNode(ast_parser->module, identifier.position, signature, arguments);
     return VISMUT_ERROR_OK;
 }
 
 static errno_t ASTParser_ParsePrimaryExpression(
-    ASTParser *ast_parser, ASTNode **node) {
+    ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
 
     switch (CURRENT_TOKEN_TYPE(ast_parser)) {
@@ -402,12 +385,13 @@ static errno_t ASTParser_ParsePrimaryExpression(
             return ASTParser_ParseLiteral(ast_parser, node);
         case TOKEN_IDENTIFIER: {
             errno_t err;
-            ASTNode *var_ref_node;
-            RISKY_EXPRESSION_SAFE(ASTParser_ParseVarRef(ast_parser, &var_ref_node), err);
-            if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LPAREN)
-                RISKY_EXPRESSION_SAFE(ASTParser_ParseFunctionCall(ast_parser, var_ref_node), err);
+            const VToken identifier = CURRENT_TOKEN(ast_parser);
+            NEXT_TOKEN_SAFE(ast_parser, err);
+            if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LPAREN) {
+                return ASTParser_ParseFunctionCall(ast_parser, identifier, node);
+            }
 
-            *node = var_ref_node;
+            *node = CreateVarRefNode(ast_parser->module, identifier.position, identifier.data.chars);
             return VISMUT_ERROR_OK;
         }
         case TOKEN_LPAREN:
@@ -421,16 +405,18 @@ static errno_t ASTParser_ParsePrimaryExpression(
 }
 
 static errno_t ASTParser_ParseExpressionWithPrecedence
-(ASTParser *ast_parser, ASTNode **node, const OperatorPrecedence min_precedence) {
+(ASTParser *ast_parser, ASTNodeId *node, const OperatorPrecedence min_precedence) {
     CALLSTACK_TRACE();
     errno_t err;
 
-    ASTNode *left = NULL;
+    RISKY_EXPRESSION_SAFE(ASTParser_EnterNesting(ast_parser), err);
+    ASTNodeId left = AST_NODE_NONE;
     RISKY_EXPRESSION_SAFE(ASTParser_ParseUnaryExpression(ast_parser, &left), err);
 
     while (1) {
         const VTokenType op = CURRENT_TOKEN_TYPE(ast_parser);
-        const OperatorPrecedence precedence = GetPrecedence(op);
+        const OperatorInfo op_info = OPERATORS[op];
+        const OperatorPrecedence precedence = op_info.precedence;
 
         if (precedence < min_precedence) {
             break;
@@ -440,19 +426,19 @@ static errno_t ASTParser_ParseExpressionWithPrecedence
         if (op == TOKEN_QUESTION) {
             NEXT_TOKEN_SAFE(ast_parser, err);
 
-            ASTNode *then_expr = NULL;
+            ASTNodeId then_expr = AST_NODE_NONE;
             PARSE_EXPRESSION_SAFE(ast_parser, err, &then_expr);
 
             CURRENT_TOKEN_TYPE_ASSERT(ast_parser, TOKEN_COLON);
             NEXT_TOKEN_SAFE(ast_parser, err);
 
-            ASTNode *else_expr = NULL;
+            ASTNodeId else_expr = AST_NODE_NONE;
             PARSE_EXPRESSION_WITH_PRECEDENCE_SAFE(
                 ast_parser, err, &else_expr,
                 PRECEDENCE_TERNARY - 1);
 
             left = CreateTernaryNode(
-                ast_parser->arena, op_pos,
+                ast_parser->module, op_pos,
                 left, then_expr, else_expr
             );
             continue;
@@ -460,33 +446,34 @@ static errno_t ASTParser_ParseExpressionWithPrecedence
 
         NEXT_TOKEN_SAFE(ast_parser, err);
 
-        const ASTBinaryType binary_op = GetBinaryType(op);
-        const int is_right_assoc = IsRightAssocOperator(binary_op);
+        const ASTBinaryType binary_op = op_info.binary_op;
+        const int is_right_assoc = op_info.associativity == OPERATOR_ASSOC_RIGHT;
 
-        ASTNode *right = NULL;
+        ASTNodeId right = AST_NODE_NONE;
         PARSE_EXPRESSION_WITH_PRECEDENCE_SAFE(
             ast_parser, err, &right,
             precedence + (1 - is_right_assoc));
 
         left = CreateBinaryNode(
-            ast_parser->arena, op_pos, left,
+            ast_parser->module, op_pos, left,
             right, binary_op,
             binary_op != AST_BINARY_ASSIGN
         );
     }
 
+    ASTParser_LeaveNesting(ast_parser);
     *node = left;
     return VISMUT_ERROR_OK;
 }
 
 static errno_t ASTParser_ParseExpression(
-    ASTParser *ast_parser, ASTNode **node) {
+    ASTParser *ast_parser, ASTNodeId *node) {
     return ASTParser_ParseExpressionWithPrecedence(ast_parser, node, PRECEDENCE_MINIMAL);
 }
 
 ASTParser ASTParser_Create(Tokenizer *tokenizer) {
     Scope *module_scope = Scope_Allocate(tokenizer->arena, NULL);
-    ASTNode *module = CreateModuleNode(
+    ASTModule *module = ASTModule_Create(
         tokenizer->arena,
         CreateModuleName(tokenizer->arena, tokenizer->source_filename,
                          (int) strlen((const char *) tokenizer->source_filename)), module_scope
@@ -506,9 +493,15 @@ ASTParser ASTParser_Create(Tokenizer *tokenizer) {
         .arena = tokenizer->arena,
         .tokenizer = tokenizer,
         .current_token = (VToken){0},
-        .module_node = module,
+        .module = module,
         .current_scope = module_scope,
+        .pending_items = Arena_Array(tokenizer->arena, ASTNodeId, AST_PARSER_INITIAL_PENDING_ITEMS),
+        .pending_items_count = 0,
+        .pending_items_capacity = AST_PARSER_INITIAL_PENDING_ITEMS,
+        .nesting_depth = 0,
         .error_info = tokenizer->error_info,
+        .lazy_function_bodies = false,
+        .previous_module = NULL,
     };
 }
 
@@ -577,8 +570,8 @@ static errno_t ASTParser_ParseFunctionParams(ASTParser *ast_parser, FunctionPara
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseFunctionDeclaration(ASTParser *ast_parser, ASTNode **node, const uint8_t *function_name,
-                                                  const Position pos) {
+static errno_t ASTParser_ParseFunctionSignature(ASTParser *ast_parser, const uint8_t *function_name,
+                                                FunctionSignature **out_signature) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LPAREN);
     errno_t err;
@@ -586,15 +579,12 @@ static errno_t ASTParser_ParseFunctionDeclaration(ASTParser *ast_parser, ASTNode
     // skip LPAREN
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    if (FindFunctionSignature(ast_parser->module_node, function_name) != NULL) {
-        ASTParser_SetError(ast_parser, VISMUT_ERROR_FUNCTION_ALREADY_DEFINED, pos, (VismutErrorDetails){0});
-        return VISMUT_ERROR_FUNCTION_ALREADY_DEFINED;
-    }
-
     FunctionSignature *signature = Arena_Type(ast_parser->arena, *signature);
     *signature = (FunctionSignature){
         .params = {0},
         .function_name = function_name,
+        .scope = NULL,
+        .declaration = AST_NODE_NONE,
         .function_name_hash = murmurhash3_string(function_name, MURMURHASH3_DEFAULT_STR_SEED),
         .return_type = VALUE_UNKNOWN,
         .flags = 0,
@@ -611,39 +601,96 @@ static errno_t ASTParser_ParseFunctionDeclaration(ASTParser *ast_parser, ASTNode
         NEXT_TOKEN_SAFE(ast_parser, err);
     }
 
-    Scope *function_scope = Scope_Allocate(ast_parser->arena, ast_parser->current_scope);
-
     switch (CURRENT_TOKEN_TYPE(ast_parser)) {
-        case TOKEN_ASSIGN: {
-            return_type = return_type == VALUE_VOID ? VALUE_AUTO : return_type;
-            signature->return_type = return_type;
-            NEXT_TOKEN_SAFE(ast_parser, err);
-            ASTNode *function_body;
-            PARSE_EXPRESSION_SAFE(ast_parser, err, &function_body);
-            *node = CreateFunctionDeclarationNode(
-                ast_parser->arena, pos, signature, function_body, function_scope
-            );
-            return VISMUT_ERROR_OK;
-        }
-        case TOKEN_LBRACE: {
+        case TOKEN_ASSIGN:
+            signature->return_type = return_type == VALUE_VOID ? VALUE_AUTO : return_type;
+            break;
+        case TOKEN_LBRACE:
             signature->return_type = return_type;
-            ast_parser->current_scope = function_scope;
-            ASTNode *function_body;
-            RISKY_EXPRESSION_SAFE(ASTParser_ParseBlock(ast_parser, &function_body), err);
-            ast_parser->current_scope = ast_parser->current_scope->parent;
-            *node = CreateFunctionDeclarationNode(
-                ast_parser->arena, pos, signature, function_body, function_scope
-            );
-            return VISMUT_ERROR_OK;
-        }
+            break;
         default:
             ASTParser_SetError(ast_parser, VISMUT_ERROR_UNEXPECTED_TOKEN, CURRENT_TOKEN_POS(ast_parser),
                                (VismutErrorDetails){.unexpected_token.caught = CURRENT_TOKEN(ast_parser)});
             return VISMUT_ERROR_UNEXPECTED_TOKEN;
     }
+
+    *out_signature = signature;
+    return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseNameDeclaration(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseFunctionDeclaration(ASTParser *ast_parser, ASTNodeId *node, const uint8_t *function_name,
+                                                  const Position pos) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LPAREN);
+    errno_t err;
+
+    FunctionSignature *signature = FindFunctionSignature(ast_parser->module, function_name);
+    if (ast_parser->current_scope == ast_parser->module->scope) {
+        // Top-level signatures are already parsed and declared by ASTParser_DeclareModuleFunctions
+        DEBUG_ASSERT(signature != NULL && (signature->flags & FUNCTION_FLAG_PREDECLARED));
+        while (CURRENT_TOKEN_TYPE(ast_parser) != TOKEN_ASSIGN && CURRENT_TOKEN_TYPE(ast_parser) != TOKEN_LBRACE) {
+            NEXT_TOKEN_SAFE(ast_parser, err);
+        }
+    } else {
+        if (signature != NULL) {
+            ASTParser_SetError(ast_parser, VISMUT_ERROR_FUNCTION_ALREADY_DEFINED, pos, (VismutErrorDetails){0});
+            return VISMUT_ERROR_FUNCTION_ALREADY_DEFINED;
+        }
+        RISKY_EXPRESSION_SAFE(ASTParser_ParseFunctionSignature(ast_parser, function_name, &signature), err);
+        RISKY_EXPRESSION_SAFE(FunctionTable_Declare(ast_parser->module->function_table, signature), err);
+    }
+
+    Scope *function_scope = Scope_Allocate(ast_parser->arena, ast_parser->current_scope);
+
+    if ((ast_parser->lazy_function_bodies || (signature->flags & FUNCTION_FLAG_UNCHANGED))
+        && function_scope->parent == ast_parser->module->scope && CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LBRACE) {
+        // Only the span is kept: the body is skipped by brace depth, then copied from the previous build
+        // or parsed by ASTParser_ParseCalledBodies
+        const uint32_t body_offset = (uint32_t) CURRENT_TOKEN_POS(ast_parser).offset;
+        if (signature->span.length != 0) {
+            // The pre-scan has already found the closing brace
+            ast_parser->tokenizer->cursor = ast_parser->source + signature->span.offset + signature->span.length;
+        } else {
+            size_t depth = 0;
+            while (CURRENT_TOKEN_TYPE(ast_parser) != TOKEN_RBRACE || --depth != 0) {
+                if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LBRACE) {
+                    ++depth;
+                } else if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_EOF) {
+                    ASTParser_SetError(ast_parser, VISMUT_ERROR_UNEXPECTED_TOKEN, CURRENT_TOKEN_POS(ast_parser),
+                                       (VismutErrorDetails){.unexpected_token.caught = CURRENT_TOKEN(ast_parser)});
+                    return VISMUT_ERROR_UNEXPECTED_TOKEN;
+                }
+                NEXT_TOKEN_SAFE(ast_parser, err);
+            }
+        }
+        NEXT_TOKEN_SAFE(ast_parser, err);
+
+        *node = CreateFunctionDeclarationNode(ast_parser->module, pos, signature, AST_NODE_NONE, function_scope);
+        AST_NODE(ast_parser->module, *node)->function_decl.body_offset = body_offset;
+        return VISMUT_ERROR_OK;
+    }
+
+    ASTNodeId function_body;
+    if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_ASSIGN) {
+        NEXT_TOKEN_SAFE(ast_parser, err);
+        PARSE_EXPRESSION_SAFE(ast_parser, err, &function_body);
+        if (function_scope->parent == ast_parser->module->scope) {
+            // The pre-scan only finds where block bodies end, an expression ends before the next token
+            ASTParser_SetFunctionSpan(ast_parser, signature, pos.offset, CURRENT_TOKEN_POS(ast_parser).offset);
+        }
+    } else {
+        ast_parser->current_scope = function_scope;
+        RISKY_EXPRESSION_SAFE(ASTParser_ParseBlock(ast_parser, &function_body), err);
+        ast_parser->current_scope = ast_parser->current_scope->parent;
+    }
+
+    *node = CreateFunctionDeclarationNode(
+        ast_parser->module, pos, signature, function_body, function_scope
+    );
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTParser_ParseNameDeclaration(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(ast_parser->current_token.type == TOKEN_NAME_DECLARATION);
     errno_t err;
@@ -662,10 +709,10 @@ static errno_t ASTParser_ParseNameDeclaration(ASTParser *ast_parser, ASTNode **n
         case TOKEN_ASSIGN: {
             // Skip TOKEN_ASSIGN and set type to auto
             NEXT_TOKEN_SAFE(ast_parser, err);
-            ASTNode *init_value;
+            ASTNodeId init_value;
             PARSE_EXPRESSION_SAFE(ast_parser, err, &init_value);
             *node = CreateVarDeclarationNode(
-                ast_parser->arena,
+                ast_parser->module,
                 pos,
                 var_name,
                 VALUE_AUTO,
@@ -680,19 +727,19 @@ static errno_t ASTParser_ParseNameDeclaration(ASTParser *ast_parser, ASTNode **n
             NEXT_TOKEN_SAFE(ast_parser, err);
             if (ast_parser->current_token.type != TOKEN_ASSIGN) {
                 *node = CreateVarDeclarationNode(
-                    ast_parser->arena,
+                    ast_parser->module,
                     pos,
                     var_name,
                     variable_type,
-                    NULL
+                    AST_NODE_NONE
                 );
                 return VISMUT_ERROR_OK;
             }
             NEXT_TOKEN_SAFE(ast_parser, err);
-            ASTNode *init_value;
+            ASTNodeId init_value;
             PARSE_EXPRESSION_SAFE(ast_parser, err, &init_value);
             *node = CreateVarDeclarationNode(
-                ast_parser->arena,
+                ast_parser->module,
                 pos,
                 var_name,
                 variable_type,
@@ -707,7 +754,7 @@ static errno_t ASTParser_ParseNameDeclaration(ASTParser *ast_parser, ASTNode **n
     }
 }
 
-static errno_t ASTParser_ParseIfStatement(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseIfStatement(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(ast_parser->current_token.type == TOKEN_CONDITION_STATEMENT);
     errno_t err;
@@ -715,13 +762,13 @@ static errno_t ASTParser_ParseIfStatement(ASTParser *ast_parser, ASTNode **node)
     const Position pos = ast_parser->current_token.position;
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    ASTNode *condition;
+    ASTNodeId condition;
     PARSE_EXPRESSION_SAFE(ast_parser, err, &condition);
 
-    ASTNode *then_block;
+    ASTNodeId then_block;
     PARSE_EXPRESSION_OR_BLOCK_SAFE(ast_parser, err, &then_block);
 
-    ASTNode *else_block = NULL;
+    ASTNodeId else_block = AST_NODE_NONE;
     if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_EXCLAMATION_MARK) {
         NEXT_TOKEN_SAFE(ast_parser, err);
         PARSE_EXPRESSION_OR_BLOCK_SAFE(ast_parser, err, &else_block);
@@ -732,7 +779,7 @@ static errno_t ASTParser_ParseIfStatement(ASTParser *ast_parser, ASTNode **node)
     }
 
     *node = CreateIfStatementNode(
-        ast_parser->arena,
+        ast_parser->module,
         pos,
         condition,
         then_block,
@@ -742,50 +789,45 @@ static errno_t ASTParser_ParseIfStatement(ASTParser *ast_parser, ASTNode **node)
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseBlock(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseBlock(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(ast_parser->current_token.type == TOKEN_LBRACE);
     errno_t err;
 
     const Position lbrace_pos = ast_parser->current_token.position;
+    RISKY_EXPRESSION_SAFE(ASTParser_EnterNesting(ast_parser), err);
     NEXT_TOKEN_SAFE(ast_parser, err);
 
     Scope *block_scope = Scope_Allocate(ast_parser->arena, ast_parser->current_scope);
     ast_parser->current_scope = block_scope;
 
-    ASTNode *first_statement = NULL;
-    ASTNode *last_statement = NULL;
+    const uint32_t list_base = ast_parser->pending_items_count;
 
     while (CURRENT_TOKEN_TYPE(ast_parser) != TOKEN_RBRACE) {
-        ASTNode *statement = NULL;
+        ASTNodeId statement = AST_NODE_NONE;
         RISKY_EXPRESSION_SAFE(ASTParser_ParseStatement(ast_parser, &statement), err);
-        if (statement == NULL) {
+        if (statement == AST_NODE_NONE) {
             printf("Statement is NULL. %s %d\n", __FILE__, __LINE__);
             exit(1);
         }
 
-        if (first_statement == NULL) {
-            first_statement = statement;
-            last_statement = statement;
-        } else {
-            DEBUG_ASSERT(last_statement != NULL);
-            last_statement->next_node = (struct ASTNode *) statement;
-            last_statement = statement;
-        }
+        ASTParser_PushPendingItem(ast_parser, statement);
     }
 
     const Position rbrace_pos = ast_parser->current_token.position;
     NEXT_TOKEN_SAFE(ast_parser, err);
     ast_parser->current_scope = ast_parser->current_scope->parent;
+    ASTParser_LeaveNesting(ast_parser);
 
     *node = CreateBlockNode(
-        ast_parser->arena, Position_Join(lbrace_pos, rbrace_pos), first_statement, block_scope
+        ast_parser->module, Position_Join(lbrace_pos, rbrace_pos),
+        ASTParser_FlushPendingItems(ast_parser, list_base), block_scope
     );
 
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseExpressionOrBlock(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseExpressionOrBlock(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
 
     if (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LBRACE) {
@@ -795,7 +837,7 @@ static errno_t ASTParser_ParseExpressionOrBlock(ASTParser *ast_parser, ASTNode *
     return ASTParser_ParseExpression(ast_parser, node);
 }
 
-static errno_t ASTParser_ParsePrintStatement(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParsePrintStatement(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_PRINT_STATEMENT);
     errno_t err;
@@ -803,33 +845,25 @@ static errno_t ASTParser_ParsePrintStatement(ASTParser *ast_parser, ASTNode **no
     const Position pos = CURRENT_TOKEN_POS(ast_parser);
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    ASTNode *first_expression = NULL;
-    ASTNode *current_expression = NULL;
+    const uint32_t list_base = ast_parser->pending_items_count;
 
     while (CURRENT_TOKEN_TYPE(ast_parser) != TOKEN_EOF) {
-        ASTNode *statement;
+        ASTNodeId statement;
         RISKY_EXPRESSION_SAFE(ASTParser_ParseExpression(ast_parser, &statement), err);
 
-        if (first_expression == NULL) {
-            first_expression = statement;
-            current_expression = statement;
-        } else {
-            DEBUG_ASSERT(current_expression != NULL);
-            current_expression->next_node = (struct ASTNode *) statement;
-            current_expression = statement;
-        }
+        ASTParser_PushPendingItem(ast_parser, statement);
         if (CURRENT_TOKEN_TYPE(ast_parser) != TOKEN_COMMA) {
             break;
         }
         NEXT_TOKEN_SAFE(ast_parser, err);
     }
 
-    *node = CreatePrintStatementNode(ast_parser->arena, pos, first_expression);
+    *node = CreatePrintStatementNode(ast_parser->module, pos, ASTParser_FlushPendingItems(ast_parser, list_base));
 
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseWhileStatement(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseWhileStatement(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     DEBUG_ASSERT(CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_WHILE_STATEMENT);
     errno_t err;
@@ -837,18 +871,18 @@ static errno_t ASTParser_ParseWhileStatement(ASTParser *ast_parser, ASTNode **no
     const Position pos = CURRENT_TOKEN_POS(ast_parser);
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    ASTNode *condition;
+    ASTNodeId condition;
     PARSE_EXPRESSION_SAFE(ast_parser, err, &condition);
 
-    ASTNode *body;
+    ASTNodeId body;
     PARSE_EXPRESSION_OR_BLOCK_SAFE(ast_parser, err, &body);
 
-    *node = CreateWhileStatementNode(ast_parser->arena, pos, condition, body);
+    *node = CreateWhileStatementNode(ast_parser->module, pos, condition, body);
 
     return VISMUT_ERROR_OK;
 }
 
-static errno_t ASTParser_ParseStatement(ASTParser *ast_parser, ASTNode **node) {
+static errno_t ASTParser_ParseStatement(ASTParser *ast_parser, ASTNodeId *node) {
     CALLSTACK_TRACE();
     errno_t err;
 
@@ -880,44 +914,582 @@ clear_semicolon:
     return err;
 }
 
+static void ASTParser_PushFunctionSpan(const ASTParser *ast_parser, ASTParserFunctionSpans *spans,
+                                      const uint32_t start, FunctionSignature *signature) {
+    if (spans->count == spans->capacity) {
+        const uint32_t new_capacity = spans->capacity ? spans->capacity * 2 : AST_PARSER_INITIAL_FUNCTION_SPANS;
+        ASTParserFunctionSpan *items = Arena_Array(ast_parser->arena, ASTParserFunctionSpan, new_capacity);
+        if (spans->count != 0) {
+            memcpy(items, spans->items, spans->count * sizeof(*items));
+        }
+        spans->items = items;
+        spans->capacity = new_capacity;
+    }
+    spans->items[spans->count++] = (ASTParserFunctionSpan){
+        .start = start,
+        .end = start,
+        .signature = signature,
+        .node = AST_NODE_NONE,
+        .worker = 0,
+    };
+}
+
+static errno_t ASTParser_DeclareModuleFunctions(ASTParser *ast_parser, ASTParserFunctionSpans *spans) {
+    CALLSTACK_TRACE();
+    errno_t err;
+
+    // Scan a copy of the token stream: only top-level signatures are parsed, bodies are skipped by brace depth
+    Tokenizer tokenizer = *ast_parser->tokenizer;
+    ASTParser scanner = *ast_parser;
+    scanner.tokenizer = &tokenizer;
+
+    size_t depth = 0;
+    bool span_open = false;
+    NEXT_TOKEN_SAFE(&scanner, err);
+    while (CURRENT_TOKEN_TYPE(&scanner) != TOKEN_EOF) {
+        switch (CURRENT_TOKEN_TYPE(&scanner)) {
+            case TOKEN_LBRACE:
+                ++depth;
+                break;
+            case TOKEN_RBRACE:
+                if (depth > 0) --depth;
+                if (depth == 0 && span_open) {
+                    const Position pos = CURRENT_TOKEN_POS(&scanner);
+                    spans->items[spans->count - 1].end = (uint32_t) (pos.offset + pos.length);
+                    span_open = false;
+                }
+                break;
+            case TOKEN_NAME_DECLARATION: {
+                const Position pos = CURRENT_TOKEN_POS(&scanner);
+                NEXT_TOKEN_SAFE(&scanner, err);
+                if (CURRENT_TOKEN_TYPE(&scanner) != TOKEN_IDENTIFIER) continue;
+                const uint8_t *function_name = scanner.current_token.data.chars;
+                NEXT_TOKEN_SAFE(&scanner, err);
+                if (CURRENT_TOKEN_TYPE(&scanner) != TOKEN_LPAREN) continue;
+                if (depth != 0) {
+                    spans->has_nested_functions = true;
+                    continue;
+                }
+
+                FunctionSignature *signature;
+                RISKY_EXPRESSION_SAFE(ASTParser_ParseFunctionSignature(&scanner, function_name, &signature), err);
+                signature->flags |= FUNCTION_FLAG_PREDECLARED;
+                if ((err = FunctionTable_Declare(ast_parser->module->function_table, signature)) !=
+                    VISMUT_ERROR_OK) {
+                    ASTParser_SetError(ast_parser, err, pos, (VismutErrorDetails){0});
+                    return err;
+                }
+                if (CURRENT_TOKEN_TYPE(&scanner) == TOKEN_LBRACE) {
+                    ASTParser_PushFunctionSpan(ast_parser, spans, (uint32_t) pos.offset, signature);
+                    span_open = true;
+                }
+                continue;
+            }
+            default:
+                break;
+        }
+        NEXT_TOKEN_SAFE(&scanner, err);
+    }
+    // An unclosed body is left to the main parser, which reports it
+    if (span_open) {
+        --spans->count;
+    }
+    for (uint32_t i = 0; i < spans->count; ++i) {
+        ASTParser_SetFunctionSpan(ast_parser, spans->items[i].signature, spans->items[i].start, spans->items[i].end);
+    }
+
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTParserWorker_Run(void *argument) {
+    CALLSTACK_TRACE();
+    ASTParserWorker *worker = argument;
+    const ASTParser *parser = worker->parser;
+    ASTParserFunctionSpans *spans = worker->spans;
+
+    // Errors are not reported from here: a span that fails is parsed again in place, in source order
+    Tokenizer tokenizer = Tokenizer_Create(parser->source, parser->source_length,
+                                           parser->tokenizer->source_filename, worker->arena, NULL);
+    ASTParser ast_parser = {
+        .source = parser->source,
+        .source_length = parser->source_length,
+        .arena = worker->arena,
+        .tokenizer = &tokenizer,
+        .current_token = (VToken){0},
+        .module = worker->module,
+        .current_scope = worker->module->scope,
+        .pending_items = Arena_Array(worker->arena, ASTNodeId, AST_PARSER_INITIAL_PENDING_ITEMS),
+        .pending_items_count = 0,
+        .pending_items_capacity = AST_PARSER_INITIAL_PENDING_ITEMS,
+        .nesting_depth = 0,
+        .error_info = NULL,
+    };
+
+    uint32_t index;
+    while ((index = atomic_fetch_add(worker->next_span, 1)) < spans->count) {
+        ASTParserFunctionSpan *span = &spans->items[index];
+        if (span->signature->flags & FUNCTION_FLAG_UNCHANGED) continue;
+        tokenizer.cursor = tokenizer.start + span->start;
+        ast_parser.pending_items_count = 0;
+        ast_parser.nesting_depth = 0;
+
+        ASTNodeId node = AST_NODE_NONE;
+        if (Tokenizer_Next(&tokenizer, &ast_parser.current_token) == VISMUT_ERROR_OK
+            && ASTParser_ParseNameDeclaration(&ast_parser, &node) == VISMUT_ERROR_OK) {
+            span->node = node;
+            span->worker = worker->index;
+        }
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Appends the nodes of a worker module after the nodes of the module: every id moves by the same shift
+static ASTNodeId ASTParser_MergeWorkerModule(const ASTParser *ast_parser, const ASTModule *worker_module) {
+    ASTModule *module = ast_parser->module;
+
+    // Ids 0 and 1 of the worker module are AST_NODE_NONE and its unused root
+    const ASTNodeId first = module->nodes_count;
+    const ASTNodeId shift = first - 2;
+    const uint32_t list_shift = module->list_items_count;
+
+    const ASTNodeList list_items = ASTModule_CreateList(module, worker_module->list_items,
+                                                        worker_module->list_items_count);
+    DEBUG_ASSERT(list_items.start == list_shift);
+    (void) list_items;
+
+    for (ASTNodeId id = 2; id < worker_module->nodes_count; ++id) {
+        ASTNode node = *AST_NODE(worker_module, id);
+        switch (node.type) {
+            case AST_FUNCTION_CALL:
+                node.function_call.arguments.start += list_shift;
+                break;
+            case AST_PRINT_STMT:
+                node.print_stmt.expressions.start += list_shift;
+                break;
+            case AST_BLOCK:
+                node.block.statements.start += list_shift;
+                break;
+            default:
+                break;
+        }
+        ASTModule_AppendNode(module, &node, ASTNode_Position(worker_module, id));
+    }
+
+    for (ASTNodeId id = first; id < module->nodes_count; ++id) {
+        const uint32_t children_count = ASTNode_ChildrenCount(module, id);
+        for (uint32_t i = 0; i < children_count; ++i) {
+            ASTNodeId *slot = ASTNode_ChildSlot(module, id, i);
+            if (*slot != AST_NODE_NONE) {
+                *slot += shift;
+            }
+        }
+
+        // The scopes outlive the worker arena and keep allocating symbols during the analysis
+        ASTNode *node = AST_NODE(module, id);
+        if (node->type == AST_BLOCK) {
+            node->block.scope->allocator = module->arena;
+        } else if (node->type == AST_FUNCTION_DECL) {
+            node->function_decl.signature->declaration = id;
+            node->function_decl.signature->scope->allocator = module->arena;
+        }
+    }
+    return shift;
+}
+
+// Parses the bodies of the top-level functions on worker threads, each with its own arena and module.
+// The declarations are merged back into the module, the main parser then takes them in source order
+static void ASTParser_ParseFunctionsInParallel(ASTParser *ast_parser, ASTParserFunctionSpans *spans) {
+    CALLSTACK_TRACE();
+    if (spans->has_nested_functions) return;
+
+    uint32_t workers_count = Thread_HardwareConcurrency();
+    if (workers_count > spans->count / AST_PARSER_FUNCTIONS_PER_WORKER) {
+        workers_count = spans->count / AST_PARSER_FUNCTIONS_PER_WORKER;
+    }
+    if (workers_count < 2) return;
+
+    atomic_uint next_span = 0;
+    ASTParserWorker *workers = Arena_Array(ast_parser->arena, ASTParserWorker, workers_count);
+    bool *started = Arena_Array(ast_parser->arena, bool, workers_count);
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        Arena *arena = Arena_Create(ast_parser->arena->block_size);
+        workers[i] = (ASTParserWorker){
+            .parser = ast_parser,
+            .spans = spans,
+            .next_span = &next_span,
+            .arena = arena,
+            .module = ASTModule_Create(arena, ast_parser->module->module_name, ast_parser->module->scope),
+            .index = i,
+        };
+        workers[i].module->function_table = ast_parser->module->function_table;
+    }
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        started[i] = Thread_Start(&workers[i].thread, ASTParserWorker_Run, &workers[i]) == VISMUT_ERROR_OK;
+    }
+    // The spans of a worker that did not start are taken by the others, or by the main parser at the end
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        if (started[i]) {
+            Thread_Join(&workers[i].thread);
+        }
+    }
+
+    ASTNodeId *shifts = Arena_Array(ast_parser->arena, ASTNodeId, workers_count);
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        shifts[i] = ASTParser_MergeWorkerModule(ast_parser, workers[i].module);
+        Arena_Adopt(ast_parser->arena, workers[i].arena);
+    }
+    for (uint32_t i = 0; i < spans->count; ++i) {
+        ASTParserFunctionSpan *span = &spans->items[i];
+        if (span->node != AST_NODE_NONE) {
+            span->node += shifts[span->worker];
+        }
+    }
+}
+
+static errno_t ASTParser_ParseFunctionBody(ASTParser *ast_parser, const ASTNodeId declaration) {
+    CALLSTACK_TRACE();
+    errno_t err;
+
+    ASTNode *node = AST_NODE(ast_parser->module, declaration);
+    ast_parser->tokenizer->cursor = ast_parser->source + node->function_decl.body_offset;
+    NEXT_TOKEN_SAFE(ast_parser, err);
+    DEBUG_ASSERT(CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_LBRACE);
+
+    ASTNodeId body;
+    ast_parser->current_scope = node->function_decl.signature->scope;
+    RISKY_EXPRESSION_SAFE(ASTParser_ParseBlock(ast_parser, &body), err);
+    ast_parser->current_scope = ast_parser->module->scope;
+
+    node->function_decl.body = body;
+    node->function_decl.body_offset = 0;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTParser_ParseCalledBodiesEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTParser *ast_parser = visitor->context;
+    const ASTNode *node = AST_NODE(ast_parser->module, *slot);
+
+    // Every body is walked from the work stack, on its own
+    if (node->type == AST_FUNCTION_DECL) {
+        *skip_children = true;
+        return VISMUT_ERROR_OK;
+    }
+    if (node->type != AST_FUNCTION_CALL) {
+        return VISMUT_ERROR_OK;
+    }
+
+    errno_t err;
+    const ASTNodeId declaration = node->function_call.signature->declaration;
+    if (declaration != AST_NODE_NONE && AST_NODE(ast_parser->module, declaration)->function_decl.body_offset != 0) {
+        RISKY_EXPRESSION_SAFE(ASTParser_ParseFunctionBody(ast_parser, declaration), err);
+        ASTParser_PushPendingItem(ast_parser, declaration);
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Parses the bodies reachable through calls from the top-level statements and the eagerly parsed functions,
+// then drops the declarations whose body is still unparsed. The work stack lives on top of pending_items:
+// parsing a body pushes and flushes its own lists above it
+static errno_t ASTParser_ParseCalledBodies(ASTParser *ast_parser) {
+    CALLSTACK_TRACE();
+    errno_t err;
+    ASTModule *module = ast_parser->module;
+    const ASTNodeList functions = AST_NODE(module, module->root)->module.functions;
+
+    const uint32_t stack_base = ast_parser->pending_items_count;
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        const ASTNodeId declaration = AST_LIST_ITEM(module, functions, i);
+        if (AST_NODE(module, declaration)->function_decl.body_offset == 0) {
+            ASTParser_PushPendingItem(ast_parser, declaration);
+        }
+    }
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, ast_parser);
+    visitor.enter = ASTParser_ParseCalledBodiesEnter;
+    RISKY_EXPRESSION_SAFE(ASTVisit(&visitor, &module->root), err);
+    while (ast_parser->pending_items_count != stack_base) {
+        const ASTNodeId declaration = ast_parser->pending_items[--ast_parser->pending_items_count];
+        RISKY_EXPRESSION_SAFE(ASTVisit(&visitor, &AST_NODE(module, declaration)->function_decl.body), err);
+    }
+
+    uint32_t live_count = 0;
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        const ASTNodeId declaration = AST_LIST_ITEM(module, functions, i);
+        if (AST_NODE(module, declaration)->function_decl.body_offset == 0) {
+            AST_LIST_ITEM(module, functions, live_count++) = declaration;
+        }
+    }
+    AST_NODE(module, module->root)->module.functions.count = live_count;
+    return VISMUT_ERROR_OK;
+}
+
+// The previous build of a top-level function, if its text did not change and its body was kept
+attribute_pure
+static const FunctionSignature *ASTParser_PreviousSignature(const ASTParser *ast_parser,
+                                                            const FunctionSignature *signature) {
+    const FunctionSignature *previous = FunctionTable_Find(ast_parser->previous_module->function_table,
+                                                           signature->function_name, signature->function_name_hash);
+    if (previous == NULL || previous->declaration == AST_NODE_NONE
+        || previous->span.length != signature->span.length
+        || previous->span_hash[0] != signature->span_hash[0]
+        || previous->span_hash[1] != signature->span_hash[1]) {
+        return NULL;
+    }
+    return previous;
+}
+
+// A top-level function with the same text as in the previous build
+typedef struct {
+    FunctionSignature *signature;
+    const FunctionSignature *previous;
+    uint32_t callees_start;
+    uint32_t callees_count;
+} ASTParserUnchangedFunction;
+
+typedef struct {
+    const ASTParser *parser;
+    const FunctionSignature *previous; // function whose previous body is walked
+    FunctionSignature **callees;
+    uint32_t callees_count;
+    uint32_t callees_capacity;
+    bool self_contained;
+} ASTParserReuseCheck;
+
+// Params are declared by the analysis and have no declaration node, locals are declared inside the span
+attribute_pure
+static bool ASTParser_IsLocalSymbol(const ASTParserReuseCheck *check, const Symbol *symbol) {
+    if (symbol == NULL) {
+        return false;
+    }
+    const FunctionSignature *previous = check->previous;
+    if (symbol->declaration == AST_NODE_NONE) {
+        for (size_t i = 0; i < previous->params.params_count; ++i) {
+            if (strcmp((const char *) previous->params.param_names[i], (const char *) symbol->name) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    const size_t offset = ASTNode_Position(check->parser->previous_module, symbol->declaration).offset;
+    return offset >= previous->span.offset && offset - previous->span.offset < previous->span.length;
+}
+
+static errno_t ASTParser_ReuseCheckEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTParserReuseCheck *check = visitor->context;
+    const ASTNode *node = AST_NODE(visitor->module, *slot);
+
+    switch (node->type) {
+        case AST_VAR_REF:
+            if (!ASTParser_IsLocalSymbol(check, node->var_ref.symbol)) {
+                check->self_contained = false;
+            }
+            return VISMUT_ERROR_OK;
+        case AST_FUNCTION_CALL: {
+            FunctionSignature *callee = FindFunctionSignature(check->parser->module,
+                                                              node->function_call.signature->function_name);
+            if (callee == NULL) {
+                check->self_contained = false;
+                return VISMUT_ERROR_OK;
+            }
+            if (check->callees_count == check->callees_capacity) {
+                const uint32_t new_capacity = check->callees_capacity ? check->callees_capacity * 2 : 64;
+                FunctionSignature **callees = Arena_Array(check->parser->arena, FunctionSignature *, new_capacity);
+                if (check->callees_count != 0) {
+                    memcpy(callees, check->callees, check->callees_count * sizeof(*callees));
+                }
+                check->callees = callees;
+                check->callees_capacity = new_capacity;
+            }
+            check->callees[check->callees_count++] = callee;
+            return VISMUT_ERROR_OK;
+        }
+        default:
+            return VISMUT_ERROR_OK;
+    }
+}
+
+// A previous body is valid in the new module only if it reads no variable declared outside of it and every
+// function it calls is reused as well: their analyzed signatures are baked into it
+static errno_t ASTParser_ReuseUnchangedFunctions(ASTParser *ast_parser) {
+    CALLSTACK_TRACE();
+    errno_t err;
+    ASTModule *module = ast_parser->module;
+    ASTModule *previous_module = ast_parser->previous_module;
+    const ASTNodeList functions = AST_NODE(module, module->root)->module.functions;
+
+    ASTParserReuseCheck check = {
+        .parser = ast_parser,
+    };
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, previous_module, &check);
+    visitor.enter = ASTParser_ReuseCheckEnter;
+
+    ASTParserUnchangedFunction *unchanged = Arena_Array(ast_parser->arena, ASTParserUnchangedFunction,
+                                                        functions.count);
+    uint32_t unchanged_count = 0;
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        FunctionSignature *signature = AST_NODE(module, AST_LIST_ITEM(module, functions, i))->function_decl.signature;
+        signature->flags &= ~FUNCTION_FLAG_UNCHANGED;
+
+        const FunctionSignature *previous = ASTParser_PreviousSignature(ast_parser, signature);
+        // Inlined calls left no trace of the callees the previous body depends on
+        if (previous == NULL || (previous->flags & FUNCTION_FLAG_INLINED)) continue;
+
+        const uint32_t callees_start = check.callees_count;
+        check.previous = previous;
+        check.self_contained = true;
+        ASTNodeId body = AST_NODE(previous_module, previous->declaration)->function_decl.body;
+        RISKY_EXPRESSION_SAFE(ASTVisit(&visitor, &body), err);
+        if (!check.self_contained) {
+            check.callees_count = callees_start;
+            continue;
+        }
+
+        signature->flags |= FUNCTION_FLAG_UNCHANGED;
+        unchanged[unchanged_count++] = (ASTParserUnchangedFunction){
+            .signature = signature,
+            .previous = previous,
+            .callees_start = callees_start,
+            .callees_count = check.callees_count - callees_start,
+        };
+    }
+
+    // Dropping a function drops its callers with it, until nothing changes
+    bool changed;
+    do {
+        changed = false;
+        for (uint32_t i = 0; i < unchanged_count; ++i) {
+            FunctionSignature *signature = unchanged[i].signature;
+            if (!(signature->flags & FUNCTION_FLAG_UNCHANGED)) continue;
+
+            for (uint32_t j = 0; j < unchanged[i].callees_count; ++j) {
+                if (!(check.callees[unchanged[i].callees_start + j]->flags & FUNCTION_FLAG_UNCHANGED)) {
+                    signature->flags &= ~FUNCTION_FLAG_UNCHANGED;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    } while (changed);
+
+    ASTCopiedSubtree *bodies = Arena_Array(ast_parser->arena, ASTCopiedSubtree, unchanged_count);
+    uint32_t bodies_count = 0;
+    for (uint32_t i = 0; i < unchanged_count; ++i) {
+        if (!(unchanged[i].signature->flags & FUNCTION_FLAG_UNCHANGED)) continue;
+
+        const FunctionSignature *previous = unchanged[i].previous;
+        bodies[bodies_count++] = (ASTCopiedSubtree){
+            .source = AST_NODE(previous_module, previous->declaration)->function_decl.body,
+            .copy = AST_NODE_NONE,
+            .position_shift = (int64_t) unchanged[i].signature->span.offset - (int64_t) previous->span.offset,
+        };
+        unchanged[bodies_count - 1] = unchanged[i];
+    }
+    RISKY_EXPRESSION_SAFE(ASTModule_CopySubtrees(previous_module, module, bodies, bodies_count), err);
+
+    for (uint32_t i = 0; i < bodies_count; ++i) {
+        FunctionSignature *signature = unchanged[i].signature;
+        ASTNode *declaration = AST_NODE(module, signature->declaration);
+        declaration->function_decl.body = bodies[i].copy;
+        declaration->function_decl.body_offset = 0;
+        signature->return_type = unchanged[i].previous->return_type;
+        signature->flags |= FUNCTION_FLAG_REUSED;
+        signature->analysis = FUNCTION_ANALYSIS_DONE;
+    }
+
+    // Bodies skipped as unchanged that turned out not to be reusable are parsed now, or on demand
+    if (!ast_parser->lazy_function_bodies) {
+        for (uint32_t i = 0; i < functions.count; ++i) {
+            const ASTNodeId declaration = AST_LIST_ITEM(module, functions, i);
+            if (AST_NODE(module, declaration)->function_decl.body_offset != 0) {
+                RISKY_EXPRESSION_SAFE(ASTParser_ParseFunctionBody(ast_parser, declaration), err);
+            }
+        }
+    }
+    return VISMUT_ERROR_OK;
+}
+
 static errno_t ASTParser_ParseModule(ASTParser *ast_parser) {
     CALLSTACK_TRACE();
     errno_t err;
 
+    ASTParserFunctionSpans spans = {0};
+    RISKY_EXPRESSION_SAFE(ASTParser_DeclareModuleFunctions(ast_parser, &spans), err);
+    if (spans.has_nested_functions) {
+        // A nested function is declared when the body around it is parsed, later code may already call it
+        ast_parser->lazy_function_bodies = false;
+        ast_parser->previous_module = NULL;
+    }
+    if (ast_parser->previous_module != NULL) {
+        // Bodies of unchanged functions are skipped for now, ASTParser_ReuseUnchangedFunctions decides on them
+        for (uint32_t i = 0; i < spans.count; ++i) {
+            FunctionSignature *signature = spans.items[i].signature;
+            if (ASTParser_PreviousSignature(ast_parser, signature) != NULL) {
+                signature->flags |= FUNCTION_FLAG_UNCHANGED;
+            }
+        }
+    }
+    if (!ast_parser->lazy_function_bodies) {
+        ASTParser_ParseFunctionsInParallel(ast_parser, &spans);
+    }
     NEXT_TOKEN_SAFE(ast_parser, err);
 
-    ASTNode *first_statement = NULL;
-    ASTNode *last_statement = NULL;
-    ASTNode *first_function = NULL;
-    ASTNode *last_function = NULL;
+    const uint32_t list_base = ast_parser->pending_items_count;
+    uint32_t functions_count = 0;
+    uint32_t span_index = 0;
 
     while (ast_parser->current_token.type != TOKEN_EOF) {
-        ASTNode *statement = NULL;
-        RISKY_EXPRESSION_SAFE(ASTParser_ParseStatement(ast_parser, &statement), err);
-        if (statement->type == AST_FUNCTION_DECL) {
-            if (first_function == NULL) {
-                first_function = statement;
-                last_function = statement;
-                ast_parser->module_node->module.functions = (struct ASTNode *) first_function;
-            } else {
-                DEBUG_ASSERT(last_function != NULL);
-                last_function->next_node = (struct ASTNode *) statement;
-                last_function = statement;
+        ASTNodeId statement = AST_NODE_NONE;
+
+        // A function parsed ahead is skipped over, as the statement parser would leave it: trailing ';' included
+        const size_t offset = CURRENT_TOKEN_POS(ast_parser).offset;
+        while (span_index < spans.count && spans.items[span_index].start < offset) {
+            ++span_index;
+        }
+        if (span_index < spans.count && spans.items[span_index].start == offset
+            && spans.items[span_index].node != AST_NODE_NONE) {
+            statement = spans.items[span_index].node;
+            ast_parser->tokenizer->cursor = ast_parser->source + spans.items[span_index].end;
+            NEXT_TOKEN_SAFE(ast_parser, err);
+            while (CURRENT_TOKEN_TYPE(ast_parser) == TOKEN_SEMICOLON) {
+                NEXT_TOKEN_SAFE(ast_parser, err);
             }
-            continue;
+        } else {
+            RISKY_EXPRESSION_SAFE(ASTParser_ParseStatement(ast_parser, &statement), err);
         }
+        if (AST_NODE(ast_parser->module, statement)->type == AST_FUNCTION_DECL) {
+            ++functions_count;
+        }
+        ASTParser_PushPendingItem(ast_parser, statement);
+    }
 
-        if (first_statement == NULL) {
-            first_statement = statement;
-            last_statement = statement;
-            ast_parser->module_node->module.statements = (struct ASTNode *) first_statement;
+    // Split the top-level items into the function and statement lists, keeping the source order in each
+    const uint32_t items_count = ast_parser->pending_items_count - list_base;
+    const ASTNodeList functions = ASTModule_AllocateList(ast_parser->module, functions_count);
+    const ASTNodeList statements = ASTModule_AllocateList(ast_parser->module, items_count - functions_count);
+    uint32_t function_index = 0;
+    uint32_t statement_index = 0;
+    for (uint32_t i = list_base; i < ast_parser->pending_items_count; ++i) {
+        const ASTNodeId item = ast_parser->pending_items[i];
+        if (AST_NODE(ast_parser->module, item)->type == AST_FUNCTION_DECL) {
+            AST_LIST_ITEM(ast_parser->module, functions, function_index++) = item;
         } else {
-            DEBUG_ASSERT(last_statement != NULL);
-            last_statement->next_node = (struct ASTNode *) statement;
-            last_statement = statement;
+            AST_LIST_ITEM(ast_parser->module, statements, statement_index++) = item;
         }
     }
+    ast_parser->pending_items_count = list_base;
 
+    ASTNode *module_node = AST_NODE(ast_parser->module, ast_parser->module->root);
+    module_node->module.functions = functions;
+    module_node->module.statements = statements;
+
+    if (ast_parser->previous_module != NULL) {
+        RISKY_EXPRESSION_SAFE(ASTParser_ReuseUnchangedFunctions(ast_parser), err);
+    }
+    if (ast_parser->lazy_function_bodies) {
+        RISKY_EXPRESSION_SAFE(ASTParser_ParseCalledBodies(ast_parser), err);
+    }
     return VISMUT_ERROR_OK;
 }
 
@@ -14,9 +14,20 @@ typedef struct {
     Arena *arena;
     Tokenizer *tokenizer;
     VToken current_token;
-    ASTNode *module_node;
+    ASTModule *module;
     Scope *current_scope;
+    // Items of the lists being parsed; nested lists push above their parent and are flushed to the module when closed
+    ASTNodeId *pending_items;
+    uint32_t pending_items_count;
+    uint32_t pending_items_capacity;
+    // Expressions, unary operators and blocks being parsed, each of them is a level of recursion
+    uint32_t nesting_depth;
     VismutErrorInfo *error_info;
+    // Block bodies of top-level functions are only parsed once a call reaches them from the top-level
+    // statements, functions nothing calls are left out of the module
+    bool lazy_function_bodies;
+    // Module of the previous build: functions whose text did not change are copied from it instead of parsed
+    ASTModule *previous_module;
 } ASTParser;
 
 ASTParser ASTParser_Create(Tokenizer *tokenizer);
@@ -0,0 +1,548 @@
+#include "ast_print.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "ast_visit.h"
+#include "../ansi_colors.h"
+#include "../errors/errors.h"
+
+#define AST_PRINTER_BUFFER_SIZE (16 * 1024)
+
+// Collects the output in a fixed buffer and hands it to stdio in large chunks
+typedef struct {
+    FILE *file;
+    const ASTModule *module;
+    bool colors;
+    int depth; // indentation of the node being printed in the tree format
+    size_t used;
+    char buffer[AST_PRINTER_BUFFER_SIZE];
+} ASTPrinter;
+
+static void ASTPrinter_Flush(ASTPrinter *printer) {
+    if (printer->used != 0) {
+        fwrite(printer->buffer, 1, printer->used, printer->file);
+        printer->used = 0;
+    }
+}
+
+static void ASTPrinter_Write(ASTPrinter *printer, const char *data, const size_t length) {
+    if (length > AST_PRINTER_BUFFER_SIZE - printer->used) {
+        ASTPrinter_Flush(printer);
+        if (length > AST_PRINTER_BUFFER_SIZE) {
+            fwrite(data, 1, length, printer->file);
+            return;
+        }
+    }
+    memcpy(printer->buffer + printer->used, data, length);
+    printer->used += length;
+}
+
+static void ASTPrinter_Puts(ASTPrinter *printer, const char *str) {
+    ASTPrinter_Write(printer, str, strlen(str));
+}
+
+static void ASTPrinter_Putc(ASTPrinter *printer, const char c) {
+    if (printer->used == AST_PRINTER_BUFFER_SIZE) {
+        ASTPrinter_Flush(printer);
+    }
+    printer->buffer[printer->used++] = c;
+}
+
+static void ASTPrinter_VFormat(ASTPrinter *printer, const char *format, va_list args) {
+    va_list retry_args;
+    va_copy(retry_args, args);
+
+    const size_t available = AST_PRINTER_BUFFER_SIZE - printer->used;
+    const int length = vsnprintf(printer->buffer + printer->used, available, format, args);
+    if (length >= 0 && (size_t) length < available) {
+        printer->used += (size_t) length;
+    } else if (length >= 0) {
+        ASTPrinter_Flush(printer);
+        if ((size_t) length < AST_PRINTER_BUFFER_SIZE) {
+            printer->used = (size_t) vsnprintf(printer->buffer, AST_PRINTER_BUFFER_SIZE, format, retry_args);
+        } else {
+            vfprintf(printer->file, format, retry_args);
+        }
+    }
+    va_end(retry_args);
+}
+
+static void ASTPrinter_Format(ASTPrinter *printer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    ASTPrinter_VFormat(printer, format, args);
+    va_end(args);
+}
+
+static void ASTPrinter_SetColor(ASTPrinter *printer, const char *color) {
+    if (printer->colors) {
+        ASTPrinter_Puts(printer, color);
+    }
+}
+
+static void ASTPrinter_ResetColor(ASTPrinter *printer) {
+    if (printer->colors) {
+        ASTPrinter_Puts(printer, ANSI_RESET);
+    }
+}
+
+static void ASTPrinter_Color(ASTPrinter *printer, const char *color, const char *text) {
+    ASTPrinter_SetColor(printer, color);
+    ASTPrinter_Puts(printer, text);
+    ASTPrinter_ResetColor(printer);
+}
+
+static void ASTPrinter_FormatColor(ASTPrinter *printer, const char *color, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    ASTPrinter_SetColor(printer, color);
+    ASTPrinter_VFormat(printer, format, args);
+    ASTPrinter_ResetColor(printer);
+    va_end(args);
+}
+
+static void print_value(ASTPrinter *printer, const VValue *value) {
+    if (!value) {
+        ASTPrinter_Puts(printer, "<NULL>");
+        return;
+    }
+
+    switch (value->type) {
+        case VALUE_VOID:
+            ASTPrinter_Color(printer, ANSI_BRIGHT_MAGENTA_FG, "void");
+            break;
+        case VALUE_AUTO:
+            ASTPrinter_Color(printer, ANSI_BRIGHT_MAGENTA_FG, "auto");
+            break;
+        case VALUE_I64:
+            ASTPrinter_FormatColor(printer, ANSI_BRIGHT_BLUE_FG, "%lld", value->i64);
+            break;
+        case VALUE_F64:
+            ASTPrinter_FormatColor(printer, ANSI_BRIGHT_BLUE_FG, "%f", value->f64);
+            break;
+        case VALUE_STR: {
+            ASTPrinter_SetColor(printer, ANSI_GREEN_FG);
+            ASTPrinter_Putc(printer, '"');
+            for (const uint8_t *ptr = value->str; *ptr != '\0'; ++ptr) {
+                const char *escape;
+                switch (*ptr) {
+                    case '\n': escape = "\\n";
+                        break;
+                    case '\r': escape = "\\r";
+                        break;
+                    case '\t': escape = "\\t";
+                        break;
+                    case '\b': escape = "\\b";
+                        break;
+                    case '\v': escape = "\\v";
+                        break;
+                    default:
+                        ASTPrinter_Putc(printer, (char) *ptr);
+                        continue;
+                }
+                ASTPrinter_Color(printer, ANSI_BLUE_FG, escape);
+                ASTPrinter_SetColor(printer, ANSI_GREEN_FG);
+            }
+            ASTPrinter_Putc(printer, '"');
+            ASTPrinter_ResetColor(printer);
+            break;
+        }
+        default:
+            ASTPrinter_Puts(printer, "<unknown value type>");
+    }
+}
+
+static void print_indent(ASTPrinter *printer, const int ident) {
+    for (int i = 0; i < ident; ++i) {
+        if (i % 2 == 0) {
+            ASTPrinter_Color(printer, ANSI_WHITE_FG, "|   ");
+        } else {
+            ASTPrinter_Color(printer, ANSI_WHITE_FG ANSI_BLACK_BG ANSI_UNDERLINE, "|");
+            ASTPrinter_Color(printer, ANSI_WHITE_FG, "   ");
+        }
+    }
+}
+
+static void print_expr_type(ASTPrinter *printer, const VValueType expr_type) {
+    ASTPrinter_Color(printer, ANSI_BRIGHT_BLACK_FG, " (");
+    ASTPrinter_Color(printer, ANSI_CYAN_FG, VValueType_String(expr_type));
+    ASTPrinter_Color(printer, ANSI_BRIGHT_BLACK_FG, ")");
+}
+
+static void print_pure(ASTPrinter *printer, const bool is_pure) {
+    if (is_pure) {
+        ASTPrinter_Color(printer, ANSI_GREEN_FG, " pure");
+    } else {
+        ASTPrinter_Color(printer, ANSI_RED_FG, " !pure");
+    }
+}
+
+static void print_node_pos(ASTPrinter *printer, const ASTNodeId node_id) {
+    const Position node_pos = ASTNode_Position(printer->module, node_id);
+    ASTPrinter_FormatColor(printer, ANSI_BRIGHT_BLACK_FG, " [%zu-%zu]\n", node_pos.offset,
+                           node_pos.offset + node_pos.length);
+}
+
+static void print_label(ASTPrinter *printer, const char *label) {
+    ASTPrinter_Color(printer, ANSI_YELLOW_FG, label);
+}
+
+static void print_function_params(ASTPrinter *printer, const FunctionParams *params) {
+    ASTPrinter_Color(printer, ANSI_BRIGHT_BLACK_FG, "[");
+    for (size_t i = 0; i < params->params_count; ++i) {
+        ASTPrinter_Color(printer, ANSI_YELLOW_FG, (const char *) params->param_names[i]);
+        ASTPrinter_Color(printer, ANSI_BRIGHT_BLACK_FG, ": ");
+        ASTPrinter_Color(printer, ANSI_BLUE_FG, VValueType_String(params->param_types[i]));
+        if (i + 1 < params->params_count) {
+            ASTPrinter_Color(printer, ANSI_BRIGHT_BLACK_FG, ", ");
+        }
+    }
+    ASTPrinter_Color(printer, ANSI_BRIGHT_BLACK_FG, "]");
+}
+
+// Prints the line of the node itself, the children follow through the visitor
+static errno_t ASTNode_PrintTreeEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTPrinter *printer = visitor->context;
+    const ASTModule *module = printer->module;
+    const ASTNodeId node_id = *slot;
+    const ASTNode *node = AST_NODE(module, node_id);
+
+    print_indent(printer, printer->depth);
+    ASTPrinter_Color(printer, ANSI_BRIGHT_MAGENTA_FG, ASTNodeType_String(node->type));
+    switch (node->type) {
+        case AST_LITERAL:
+            ASTPrinter_Putc(printer, ' ');
+            print_value(printer, &node->literal);
+            print_expr_type(printer, node->literal.type);
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_VAR_REF:
+            ASTPrinter_Putc(printer, ' ');
+            ASTPrinter_Color(printer, ANSI_BRIGHT_YELLOW_FG,
+                             node->var_ref.var_name ? (const char *) node->var_ref.var_name : "<NULL>");
+            print_expr_type(printer, node->expr_type);
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_BINARY:
+            ASTPrinter_Putc(printer, ' ');
+            ASTPrinter_Color(printer, ANSI_BRIGHT_GREEN_FG, ASTBinaryType_String(node->binary_op.op));
+            print_expr_type(printer, node->expr_type);
+            print_pure(printer, node->binary_op.is_pure);
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_UNARY:
+            ASTPrinter_Putc(printer, ' ');
+            ASTPrinter_Color(printer, ANSI_BRIGHT_GREEN_FG, ASTUnaryType_String(node->unary_op.op));
+            print_expr_type(printer, node->expr_type);
+            print_pure(printer, node->unary_op.is_pure);
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_TERNARY:
+            print_expr_type(printer, node->expr_type);
+            print_pure(printer, node->ternary_op.is_pure);
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_VAR_DECL:
+            ASTPrinter_Putc(printer, ' ');
+            ASTPrinter_Color(printer, ANSI_BRIGHT_YELLOW_FG, (const char *) node->var_decl.symbol->name);
+            print_expr_type(printer, node->var_decl.var_type);
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_BLOCK:
+        case AST_IF_STMT:
+        case AST_WHILE_STMT:
+        case AST_PRINT_STMT:
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_TYPE_CAST:
+            print_expr_type(printer, node->type_cast.from_type);
+            ASTPrinter_Color(printer, ANSI_BRIGHT_YELLOW_FG, " ->");
+            print_expr_type(printer, node->type_cast.target_type);
+            print_pure(printer, node->type_cast.is_pure);
+            print_node_pos(printer, node_id);
+            break;
+
+        case AST_MODULE:
+            ASTPrinter_Putc(printer, ' ');
+            ASTPrinter_Color(printer, ANSI_BLACK_FG ANSI_WHITE_BG,
+                             module->module_name ? (const char *) module->module_name : "<unnamed>");
+            print_node_pos(printer, node_id);
+            break;
+        case AST_UNKNOWN:
+            ASTPrinter_Puts(printer, " \n");
+            break;
+        case AST_FUNCTION_DECL:
+            ASTPrinter_Putc(printer, ' ');
+            ASTPrinter_Color(printer, ANSI_BRIGHT_YELLOW_FG,
+                             (const char *) node->function_decl.signature->function_name);
+            print_expr_type(printer, node->function_decl.signature->return_type);
+            ASTPrinter_Putc(printer, ' ');
+            print_function_params(printer, &node->function_decl.signature->params);
+            ASTPrinter_Putc(printer, '\n');
+            break;
+        case AST_FUNCTION_CALL:
+            ASTPrinter_Putc(printer, ' ');
+            ASTPrinter_Color(printer, ANSI_BRIGHT_YELLOW_FG,
+                             (const char *) node->function_call.signature->function_name);
+            print_expr_type(printer, node->expr_type);
+            ASTPrinter_Putc(printer, ' ');
+            print_function_params(printer, &node->function_call.signature->params);
+            ASTPrinter_Putc(printer, '\n');
+            break;
+        case AST_COUNT:
+        default:
+            ASTPrinter_Puts(printer, " <unhandled node type>\n");
+            *skip_children = true;
+            break;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Label printed above a child, labelled children are indented one extra level
+attribute_pure
+static const char *tree_child_label(const ASTNode *node, const uint32_t index) {
+    switch (node->type) {
+        case AST_BINARY:
+            return index == 0 ? "left\n" : "right\n";
+        case AST_TERNARY:
+        case AST_IF_STMT:
+            return index == 0 ? NULL : index == 1 ? "then\n" : "else\n";
+        case AST_WHILE_STMT:
+            return index == 0 ? NULL : "body\n";
+        case AST_VAR_DECL:
+            return "init";
+        case AST_MODULE:
+            return "";
+        default:
+            return NULL;
+    }
+}
+
+static errno_t ASTNode_PrintTreeBeforeChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    ASTPrinter *printer = visitor->context;
+    const ASTNode *node = AST_NODE(printer->module, node_id);
+    const char *label = tree_child_label(node, index);
+
+    if (node->type == AST_MODULE) {
+        const uint32_t functions_count = node->module.functions.count;
+        if (index == 0 && functions_count != 0) {
+            print_indent(printer, printer->depth + 1);
+            ASTPrinter_Color(printer, ANSI_WHITE_FG ANSI_BLACK_BG ANSI_UNDERLINE, "functions");
+            ASTPrinter_Putc(printer, '\n');
+        } else if (index == functions_count) {
+            print_indent(printer, printer->depth + 1);
+            ASTPrinter_Color(printer, ANSI_WHITE_FG ANSI_BLACK_BG ANSI_UNDERLINE, "statements");
+            ASTPrinter_Putc(printer, '\n');
+        }
+    } else if (node->type == AST_VAR_DECL) {
+        print_indent(printer, printer->depth + 1);
+        print_label(printer, label);
+        print_expr_type(printer, AST_NODE(printer->module, node->var_decl.init_value)->expr_type);
+        ASTPrinter_Putc(printer, '\n');
+    } else if (label != NULL) {
+        print_indent(printer, printer->depth + 1);
+        print_label(printer, label);
+    }
+
+    printer->depth += label != NULL ? 2 : 1;
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTNode_PrintTreeAfterChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    ASTPrinter *printer = visitor->context;
+    printer->depth -= tree_child_label(AST_NODE(printer->module, node_id), index) != NULL ? 2 : 1;
+    return VISMUT_ERROR_OK;
+}
+
+static void print_sexpr_string(ASTPrinter *printer, const uint8_t *str) {
+    ASTPrinter_Putc(printer, '"');
+    for (const uint8_t *ptr = str; *ptr != '\0'; ++ptr) {
+        switch (*ptr) {
+            case '"': ASTPrinter_Puts(printer, "\\\"");
+                break;
+            case '\\': ASTPrinter_Puts(printer, "\\\\");
+                break;
+            case '\n': ASTPrinter_Puts(printer, "\\n");
+                break;
+            case '\r': ASTPrinter_Puts(printer, "\\r");
+                break;
+            case '\t': ASTPrinter_Puts(printer, "\\t");
+                break;
+            default:
+                if (*ptr < 0x20) {
+                    ASTPrinter_Format(printer, "\\x%02x", *ptr);
+                } else {
+                    ASTPrinter_Putc(printer, (char) *ptr);
+                }
+                break;
+        }
+    }
+    ASTPrinter_Putc(printer, '"');
+}
+
+/*
+ * (literal <type> <value>)         (var <type> <name>)             (let <type> <name> [init])
+ * (binary <type> <op> <l> <r>)     (unary <type> <op> <x>)         (ternary <type> <c> <t> <e>)
+ * (cast <from> <to> <x>)           (call <type> <name> <args>...)  (print <args>...)
+ * (block <statements>...)          (if <c> <then> [else])          (while <c> <body>)
+ * (function <name> <type> ((<param> <type>)...) <body>)
+ */
+static errno_t ASTNode_PrintSExprEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTPrinter *printer = visitor->context;
+    const ASTNode *node = AST_NODE(printer->module, *slot);
+
+    switch (node->type) {
+        case AST_LITERAL:
+            ASTPrinter_Format(printer, "(literal %s ", VValueType_String(node->literal.type));
+            switch (node->literal.type) {
+                case VALUE_I64:
+                    ASTPrinter_Format(printer, "%lld", node->literal.i64);
+                    break;
+                case VALUE_F64:
+                    ASTPrinter_Format(printer, "%.17g", node->literal.f64);
+                    break;
+                case VALUE_STR:
+                    print_sexpr_string(printer, node->literal.str);
+                    break;
+                default:
+                    ASTPrinter_Puts(printer, "()");
+                    break;
+            }
+            break;
+        case AST_VAR_REF:
+            ASTPrinter_Format(printer, "(var %s %s", VValueType_String(node->expr_type),
+                              (const char *) node->var_ref.var_name);
+            break;
+        case AST_VAR_DECL:
+            ASTPrinter_Format(printer, "(let %s %s", VValueType_String(node->var_decl.var_type),
+                              (const char *) node->var_decl.symbol->name);
+            break;
+        case AST_BINARY:
+            ASTPrinter_Format(printer, "(binary %s %s", VValueType_String(node->expr_type),
+                              ASTBinaryType_String(node->binary_op.op));
+            break;
+        case AST_UNARY:
+            ASTPrinter_Format(printer, "(unary %s %s", VValueType_String(node->expr_type),
+                              ASTUnaryType_String(node->unary_op.op));
+            break;
+        case AST_TERNARY:
+            ASTPrinter_Format(printer, "(ternary %s", VValueType_String(node->expr_type));
+            break;
+        case AST_TYPE_CAST:
+            ASTPrinter_Format(printer, "(cast %s %s", VValueType_String(node->type_cast.from_type),
+                              VValueType_String(node->type_cast.target_type));
+            break;
+        case AST_FUNCTION_CALL:
+            ASTPrinter_Format(printer, "(call %s %s", VValueType_String(node->expr_type),
+                              (const char *) node->function_call.signature->function_name);
+            break;
+        case AST_PRINT_STMT:
+            ASTPrinter_Puts(printer, "(print");
+            break;
+        case AST_BLOCK:
+            ASTPrinter_Puts(printer, "(block");
+            break;
+        case AST_IF_STMT:
+            ASTPrinter_Puts(printer, "(if");
+            break;
+        case AST_WHILE_STMT:
+            ASTPrinter_Puts(printer, "(while");
+            break;
+        case AST_FUNCTION_DECL: {
+            const FunctionSignature *signature = node->function_decl.signature;
+            ASTPrinter_Format(printer, "(function %s %s (", (const char *) signature->function_name,
+                              VValueType_String(signature->return_type));
+            for (size_t i = 0; i < signature->params.params_count; ++i) {
+                ASTPrinter_Format(printer, i == 0 ? "(%s %s)" : " (%s %s)",
+                                  (const char *) signature->params.param_names[i],
+                                  VValueType_String(signature->params.param_types[i]));
+            }
+            ASTPrinter_Putc(printer, ')');
+            break;
+        }
+        case AST_MODULE:
+            // Streamed as one line per item so that huge modules never build a single giant expression
+            ASTPrinter_Puts(printer, "(module ");
+            print_sexpr_string(printer, printer->module->module_name
+                                            ? printer->module->module_name
+                                            : (const uint8_t *) "<unnamed>");
+            ASTPrinter_Puts(printer, ")\n");
+            break;
+        case AST_UNKNOWN:
+        case AST_COUNT:
+        default:
+            ASTPrinter_Puts(printer, "(unknown");
+            *skip_children = true;
+            break;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTNode_PrintSExprBeforeChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    ASTPrinter *printer = visitor->context;
+    if (AST_NODE(printer->module, node_id)->type != AST_MODULE) {
+        ASTPrinter_Putc(printer, ' ');
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTNode_PrintSExprAfterChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    ASTPrinter *printer = visitor->context;
+    if (AST_NODE(printer->module, node_id)->type == AST_MODULE) {
+        ASTPrinter_Putc(printer, '\n');
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTNode_PrintSExprLeave(ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTPrinter *printer = visitor->context;
+    if (AST_NODE(printer->module, *slot)->type != AST_MODULE) {
+        ASTPrinter_Putc(printer, ')');
+    }
+    return VISMUT_ERROR_OK;
+}
+
+void ASTNode_PrintFormat(const ASTModule *module, const ASTNodeId node, const ASTPrintFormat format, FILE *file) {
+    ASTPrinter printer;
+    printer.file = file;
+    printer.module = module;
+    printer.colors = format == AST_PRINT_TREE && ansi_supports_color(file);
+    printer.depth = 0;
+    printer.used = 0;
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &printer);
+    ASTNodeId root = node;
+    switch (format) {
+        case AST_PRINT_SEXPR:
+            visitor.enter = ASTNode_PrintSExprEnter;
+            visitor.before_child = ASTNode_PrintSExprBeforeChild;
+            visitor.after_child = ASTNode_PrintSExprAfterChild;
+            visitor.leave = ASTNode_PrintSExprLeave;
+            ASTVisit(&visitor, &root);
+            if (AST_NODE(module, node)->type != AST_MODULE) {
+                ASTPrinter_Putc(&printer, '\n');
+            }
+            break;
+        case AST_PRINT_TREE:
+        default:
+            visitor.enter = ASTNode_PrintTreeEnter;
+            visitor.before_child = ASTNode_PrintTreeBeforeChild;
+            visitor.after_child = ASTNode_PrintTreeAfterChild;
+            ASTVisit(&visitor, &root);
+            break;
+    }
+    ASTPrinter_Flush(&printer);
+}
+
+void ASTNode_Print(const ASTModule *module, const ASTNodeId node, FILE *file) {
+    ASTNode_PrintFormat(module, node, AST_PRINT_TREE, file);
+}
@@ -0,0 +1,19 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_PRINT_H
+#define VISMUT_AST_PRINT_H
+#include <stdio.h>
+#include "ast.h"
+
+typedef enum {
+    AST_PRINT_TREE, // indented tree for humans, colored when the output supports it
+    AST_PRINT_SEXPR, // one S-expression per top-level item, for tools and diffs
+} ASTPrintFormat;
+
+void ASTNode_Print(const ASTModule *module, ASTNodeId node, FILE *);
+
+void ASTNode_PrintFormat(const ASTModule *module, ASTNodeId node, ASTPrintFormat format, FILE *);
+
+#endif //VISMUT_AST_PRINT_H
@@ -0,0 +1,153 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_purity.h"
+
+#include <stdlib.h>
+
+#include "ast_visit.h"
+#include "../errors/errors.h"
+
+typedef struct {
+    ASTModule *module;
+    uint32_t *function_of; // function index + 1 of every top-level declaration, by node id
+    bool *impure;
+    uint32_t (*calls)[2]; // caller, callee
+    uint32_t calls_count;
+    uint32_t calls_capacity;
+    ASTNodeId root;
+    uint32_t function;
+} ASTPurityScan;
+
+static errno_t ASTPurityScanEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    ASTPurityScan *scan = visitor->context;
+    const ASTNode *node = AST_NODE(scan->module, *slot);
+
+    switch (node->type) {
+        case AST_PRINT_STMT:
+            scan->impure[scan->function] = true;
+            return VISMUT_ERROR_OK;
+        case AST_FUNCTION_DECL:
+            // Nested functions may write the variables of the enclosing one, they are not looked into
+            if (*slot != scan->root) {
+                scan->impure[scan->function] = true;
+                *skip_children = true;
+            }
+            return VISMUT_ERROR_OK;
+        case AST_FUNCTION_CALL: {
+            const ASTNodeId declaration = node->function_call.signature->declaration;
+            const uint32_t callee = declaration != AST_NODE_NONE ? scan->function_of[declaration] : 0;
+            if (callee == 0) {
+                scan->impure[scan->function] = true;
+                return VISMUT_ERROR_OK;
+            }
+            if (scan->calls_count == scan->calls_capacity) {
+                scan->calls_capacity = scan->calls_capacity == 0 ? 64 : scan->calls_capacity * 2;
+                scan->calls = realloc(scan->calls, sizeof(*scan->calls) * scan->calls_capacity);
+                if (scan->calls == NULL) {
+                    exit(VISMUT_ERROR_ALLOC);
+                }
+            }
+            scan->calls[scan->calls_count][0] = scan->function;
+            scan->calls[scan->calls_count][1] = callee - 1;
+            ++scan->calls_count;
+            return VISMUT_ERROR_OK;
+        }
+        default:
+            return VISMUT_ERROR_OK;
+    }
+}
+
+// Impurity flows from callees to their callers, whatever is not reached from an impure function is pure.
+// Recursive functions are pure together unless one of them does something. Termination is assumed,
+// the way C compilers treat their `pure` functions
+errno_t ASTModule_InferPurity(ASTModule *module) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    const ASTNodeList functions = AST_NODE(module, module->root)->module.functions;
+    if (functions.count == 0) {
+        return VISMUT_ERROR_OK;
+    }
+
+    ASTPurityScan scan = {
+        .module = module,
+        .function_of = calloc(module->nodes_count, sizeof(uint32_t)),
+        .impure = calloc(functions.count, sizeof(bool)),
+    };
+    uint32_t *callers_start = calloc(functions.count + 1, sizeof(uint32_t));
+    uint32_t *worklist = malloc(functions.count * sizeof(uint32_t));
+    if (scan.function_of == NULL || scan.impure == NULL || callers_start == NULL || worklist == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        scan.function_of[AST_LIST_ITEM(module, functions, i)] = i + 1;
+    }
+
+    errno_t err = VISMUT_ERROR_OK;
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &scan);
+    visitor.enter = ASTPurityScanEnter;
+    for (uint32_t i = 0; i < functions.count && err == VISMUT_ERROR_OK; ++i) {
+        scan.root = AST_LIST_ITEM(module, functions, i);
+        scan.function = i;
+        err = ASTVisit(&visitor, &scan.root);
+    }
+
+    if (err == VISMUT_ERROR_OK) {
+        // Callers grouped by callee
+        uint32_t *callers = malloc((scan.calls_count + 1) * sizeof(uint32_t));
+        if (callers == NULL) {
+            exit(VISMUT_ERROR_ALLOC);
+        }
+        for (uint32_t i = 0; i < scan.calls_count; ++i) {
+            ++callers_start[scan.calls[i][1] + 1];
+        }
+        for (uint32_t i = 0; i < functions.count; ++i) {
+            callers_start[i + 1] += callers_start[i];
+        }
+        for (uint32_t i = 0; i < scan.calls_count; ++i) {
+            callers[callers_start[scan.calls[i][1]]++] = scan.calls[i][0];
+        }
+        // Filling moved every start to the end of its group, which is the start of the next one
+        for (uint32_t i = functions.count; i > 0; --i) {
+            callers_start[i] = callers_start[i - 1];
+        }
+        callers_start[0] = 0;
+
+        uint32_t worklist_count = 0;
+        for (uint32_t i = 0; i < functions.count; ++i) {
+            if (scan.impure[i]) {
+                worklist[worklist_count++] = i;
+            }
+        }
+        while (worklist_count != 0) {
+            const uint32_t callee = worklist[--worklist_count];
+            for (uint32_t i = callers_start[callee]; i < callers_start[callee + 1]; ++i) {
+                if (!scan.impure[callers[i]]) {
+                    scan.impure[callers[i]] = true;
+                    worklist[worklist_count++] = callers[i];
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < functions.count; ++i) {
+            FunctionSignature *signature = AST_NODE(module, AST_LIST_ITEM(module, functions, i))
+                    ->function_decl.signature;
+            if (scan.impure[i]) {
+                signature->flags &= ~FUNCTION_FLAG_PURE;
+            } else {
+                signature->flags |= FUNCTION_FLAG_PURE;
+            }
+        }
+        free(callers);
+    }
+
+    free(scan.function_of);
+    free(scan.impure);
+    free(scan.calls);
+    free(callers_start);
+    free(worklist);
+    return err;
+}
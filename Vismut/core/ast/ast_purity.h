@@ -0,0 +1,15 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_PURITY_H
+#define VISMUT_AST_PURITY_H
+#include "../types.h"
+#include "ast.h"
+
+// Sets FUNCTION_FLAG_PURE on the top-level functions without side effects: no output, no nested
+// declarations and calls of pure functions only. Runs before the analysis, which then counts calls of
+// pure functions with pure arguments as pure expressions
+errno_t ASTModule_InferPurity(ASTModule *module);
+
+#endif //VISMUT_AST_PURITY_H
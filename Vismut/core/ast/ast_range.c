@@ -0,0 +1,851 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_range.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_visit.h"
+#include "../errors/errors.h"
+#include "../memory/array.h"
+
+#define AST_RANGE_WIDEN_AFTER 2 // loop iterations joined exactly before the growing bounds are given up
+#define AST_RANGE_PRECISE_LOOPS 3 // deeper loops widen right away, every outer iteration walks them again
+#define AST_RANGE_REFINE_DEPTH 16 // conditions nested deeper than this refine nothing
+
+#define AST_RANGE_BOOL ((ASTRange){.min = 0, .max = 1})
+
+// Variables of the walked root as they were at some point, env[base, count) stored at saved[offset]
+typedef struct {
+    uint32_t offset;
+    uint32_t count;
+} ASTRangeSnapshot;
+
+typedef struct {
+    ASTNodeId node;
+    uint32_t head; // snapshot joined over the iterations
+    uint32_t iteration;
+} ASTRangeLoop;
+
+typedef struct {
+    ASTModule *module;
+    ASTRange *values; // range of the latest visit of every node, read by the refinement right after it
+    ASTRange *operands; // ranges of the visited children of the nodes being walked
+    uint32_t operands_count;
+    uint32_t operands_capacity;
+    uint32_t *variable_of; // variable index + 1 of every i64 declaration, by node id
+    bool *is_function; // top-level declarations, by node id
+    ASTRange *env; // current range of every variable
+    uint32_t env_capacity;
+    uint32_t variables_count;
+    uint32_t base; // first variable of the walked root, the ones before belong to other functions
+    ASTRange *saved;
+    uint32_t saved_count;
+    uint32_t saved_capacity;
+    ASTRangeSnapshot *snapshots;
+    uint32_t snapshots_count;
+    uint32_t snapshots_capacity;
+    ASTRangeLoop *loops;
+    uint32_t loops_count;
+    uint32_t loops_capacity;
+    ASTNodeId root;
+} ASTRangeAnalysis;
+
+bool ASTRange_IsEmpty(const ASTRange range) {
+    return range.min > range.max;
+}
+
+bool ASTRange_IsFull(const ASTRange range) {
+    return range.min == INT64_MIN && range.max == INT64_MAX;
+}
+
+bool ASTRange_IsConstant(const ASTRange range) {
+    return range.min == range.max;
+}
+
+bool ASTRange_ContainsZero(const ASTRange range) {
+    return range.min <= 0 && range.max >= 0;
+}
+
+attribute_const
+static bool ASTRange_IsTrue(const ASTRange range) {
+    return !ASTRange_IsEmpty(range) && !ASTRange_ContainsZero(range);
+}
+
+attribute_const
+static bool ASTRange_IsFalse(const ASTRange range) {
+    return range.min == 0 && range.max == 0;
+}
+
+attribute_const
+static ASTRange ASTRange_Constant(const int64_t value) {
+    return (ASTRange){.min = value, .max = value};
+}
+
+attribute_const
+static ASTRange ASTRange_Hull(const ASTRange a, const ASTRange b) {
+    if (ASTRange_IsEmpty(a)) return b;
+    if (ASTRange_IsEmpty(b)) return a;
+    return (ASTRange){
+        .min = a.min < b.min ? a.min : b.min,
+        .max = a.max > b.max ? a.max : b.max,
+    };
+}
+
+attribute_const
+static ASTRange ASTRange_Meet(const ASTRange a, const ASTRange b) {
+    return (ASTRange){
+        .min = a.min > b.min ? a.min : b.min,
+        .max = a.max < b.max ? a.max : b.max,
+    };
+}
+
+attribute_const
+static ASTRange ASTRange_Bool(const bool is_true, const bool is_false) {
+    if (is_true) return ASTRange_Constant(1);
+    if (is_false) return ASTRange_Constant(0);
+    return AST_RANGE_BOOL;
+}
+
+// Generated code wraps around on overflow, so a bound that overflows gives the whole range up
+attribute_const
+static ASTRange ASTRange_Add(const ASTRange a, const ASTRange b) {
+    ASTRange result;
+    if (__builtin_add_overflow(a.min, b.min, &result.min) || __builtin_add_overflow(a.max, b.max, &result.max)) {
+        return AST_RANGE_FULL;
+    }
+    return result;
+}
+
+attribute_const
+static ASTRange ASTRange_Sub(const ASTRange a, const ASTRange b) {
+    ASTRange result;
+    if (__builtin_sub_overflow(a.min, b.max, &result.min) || __builtin_sub_overflow(a.max, b.min, &result.max)) {
+        return AST_RANGE_FULL;
+    }
+    return result;
+}
+
+// Products and quotients of intervals reach their extremes at the corners
+attribute_const
+static ASTRange ASTRange_Corners(const int64_t corners[4]) {
+    ASTRange result = ASTRange_Constant(corners[0]);
+    for (int i = 1; i < 4; ++i) {
+        result = ASTRange_Hull(result, ASTRange_Constant(corners[i]));
+    }
+    return result;
+}
+
+attribute_const
+static ASTRange ASTRange_Mul(const ASTRange a, const ASTRange b) {
+    int64_t corners[4];
+    if (__builtin_mul_overflow(a.min, b.min, &corners[0]) || __builtin_mul_overflow(a.min, b.max, &corners[1])
+        || __builtin_mul_overflow(a.max, b.min, &corners[2]) || __builtin_mul_overflow(a.max, b.max, &corners[3])) {
+        return AST_RANGE_FULL;
+    }
+    return ASTRange_Corners(corners);
+}
+
+// Truncating, as `//` of integers is. A divisor that can be zero leaves nothing to prove
+attribute_const
+static ASTRange ASTRange_Div(const ASTRange a, const ASTRange b) {
+    if (ASTRange_ContainsZero(b) || (a.min == INT64_MIN && b.min <= -1 && b.max >= -1)) {
+        return AST_RANGE_FULL;
+    }
+    const int64_t corners[4] = {a.min / b.min, a.min / b.max, a.max / b.min, a.max / b.max};
+    return ASTRange_Corners(corners);
+}
+
+// The remainder is smaller than the divisor and takes the sign of the dividend
+attribute_const
+static ASTRange ASTRange_Mod(const ASTRange a, const ASTRange b) {
+    if (ASTRange_ContainsZero(b)) {
+        return AST_RANGE_FULL;
+    }
+    const int64_t low = b.min == INT64_MIN ? INT64_MAX : b.min < 0 ? -b.min : b.min;
+    const int64_t high = b.max == INT64_MIN ? INT64_MAX : b.max < 0 ? -b.max : b.max;
+    const int64_t bound = (low > high ? low : high) - 1;
+    if (a.min >= 0) {
+        return (ASTRange){.min = 0, .max = a.max < bound ? a.max : bound};
+    }
+    if (a.max <= 0) {
+        return (ASTRange){.min = a.min > -bound ? a.min : -bound, .max = 0};
+    }
+    return (ASTRange){.min = -bound, .max = bound};
+}
+
+attribute_const
+static int64_t ASTRange_FillBits(int64_t value) {
+    for (int shift = 1; shift < 64; shift *= 2) {
+        value |= value >> shift;
+    }
+    return value;
+}
+
+attribute_const
+static ASTRange ASTRange_BitwiseAnd(const ASTRange a, const ASTRange b) {
+    if (a.min >= 0 && b.min >= 0) return (ASTRange){.min = 0, .max = a.max < b.max ? a.max : b.max};
+    if (a.min >= 0) return (ASTRange){.min = 0, .max = a.max};
+    if (b.min >= 0) return (ASTRange){.min = 0, .max = b.max};
+    return AST_RANGE_FULL;
+}
+
+attribute_const
+static ASTRange ASTRange_BitwiseOr(const ASTRange a, const ASTRange b) {
+    if (a.min < 0 || b.min < 0) {
+        return AST_RANGE_FULL;
+    }
+    return (ASTRange){
+        .min = a.min > b.min ? a.min : b.min,
+        .max = ASTRange_FillBits(a.max > b.max ? a.max : b.max),
+    };
+}
+
+attribute_const
+static ASTRange ASTRange_ShiftRight(const ASTRange a, const ASTRange b) {
+    if (a.min < 0 || b.min < 0 || b.max > 63) {
+        return AST_RANGE_FULL;
+    }
+    return (ASTRange){.min = a.min >> b.max, .max = a.max >> b.min};
+}
+
+attribute_const
+static ASTRange ASTRange_Compare(const ASTBinaryType op, const ASTRange a, const ASTRange b) {
+    switch (op) {
+        case AST_BINARY_LESS_THAN:
+            return ASTRange_Bool(a.max < b.min, a.min >= b.max);
+        case AST_BINARY_LESS_THAN_OR_EQUALS:
+            return ASTRange_Bool(a.max <= b.min, a.min > b.max);
+        case AST_BINARY_GREATER_THAN:
+            return ASTRange_Bool(a.min > b.max, a.max <= b.min);
+        case AST_BINARY_GREATER_THAN_OR_EQUALS:
+            return ASTRange_Bool(a.min >= b.max, a.max < b.min);
+        case AST_BINARY_EQUALS:
+            return ASTRange_Bool(ASTRange_IsConstant(a) && ASTRange_IsConstant(b) && a.min == b.min,
+                                 a.max < b.min || b.max < a.min);
+        case AST_BINARY_NOT_EQUALS:
+            return ASTRange_Bool(a.max < b.min || b.max < a.min,
+                                 ASTRange_IsConstant(a) && ASTRange_IsConstant(b) && a.min == b.min);
+        default:
+            return AST_RANGE_BOOL;
+    }
+}
+
+attribute_const
+static ASTRange ASTRange_Binary(const ASTBinaryType op, const ASTRange a, const ASTRange b) {
+    if (ASTRange_IsEmpty(a) || ASTRange_IsEmpty(b)) {
+        return AST_RANGE_EMPTY;
+    }
+    switch (op) {
+        case AST_BINARY_ADD:
+            return ASTRange_Add(a, b);
+        case AST_BINARY_SUB:
+            return ASTRange_Sub(a, b);
+        case AST_BINARY_MUL:
+            return ASTRange_Mul(a, b);
+        case AST_BINARY_INT_DIV:
+            return ASTRange_Div(a, b);
+        case AST_BINARY_MOD:
+            return ASTRange_Mod(a, b);
+        case AST_BINARY_BITWISE_AND:
+            return ASTRange_BitwiseAnd(a, b);
+        case AST_BINARY_BITWISE_OR:
+            return ASTRange_BitwiseOr(a, b);
+        case AST_BINARY_SHIFT_RIGHT:
+            return ASTRange_ShiftRight(a, b);
+        case AST_BINARY_LESS_THAN:
+        case AST_BINARY_LESS_THAN_OR_EQUALS:
+        case AST_BINARY_GREATER_THAN:
+        case AST_BINARY_GREATER_THAN_OR_EQUALS:
+        case AST_BINARY_EQUALS:
+        case AST_BINARY_NOT_EQUALS:
+            return ASTRange_Compare(op, a, b);
+        // The right operand is only evaluated when the left one does not decide
+        case AST_BINARY_LOGICAL_AND:
+            return ASTRange_Bool(ASTRange_IsTrue(a) && ASTRange_IsTrue(b), ASTRange_IsFalse(a) || ASTRange_IsFalse(b));
+        case AST_BINARY_LOGICAL_OR:
+            return ASTRange_Bool(ASTRange_IsTrue(a) || ASTRange_IsTrue(b), ASTRange_IsFalse(a) && ASTRange_IsFalse(b));
+        default:
+            return AST_RANGE_FULL;
+    }
+}
+
+attribute_const
+static ASTRange ASTRange_Unary(const ASTUnaryType op, const ASTRange a) {
+    if (ASTRange_IsEmpty(a)) {
+        return AST_RANGE_EMPTY;
+    }
+    switch (op) {
+        case AST_UNARY_PLUS:
+            return a;
+        case AST_UNARY_MINUS:
+            return ASTRange_Sub(ASTRange_Constant(0), a);
+        case AST_UNARY_BITWISE_NOT:
+            return (ASTRange){.min = ~a.max, .max = ~a.min};
+        case AST_UNARY_LOGICAL_NOT:
+            return ASTRange_Bool(ASTRange_IsFalse(a), ASTRange_IsTrue(a));
+        case AST_UNARY_INCREMENT:
+            return ASTRange_Add(a, ASTRange_Constant(1));
+        case AST_UNARY_DECREMENT:
+            return ASTRange_Sub(a, ASTRange_Constant(1));
+        default:
+            return AST_RANGE_FULL;
+    }
+}
+
+attribute_const
+static bool ASTRange_IsComparison(const ASTBinaryType op) {
+    switch (op) {
+        case AST_BINARY_LESS_THAN:
+        case AST_BINARY_LESS_THAN_OR_EQUALS:
+        case AST_BINARY_GREATER_THAN:
+        case AST_BINARY_GREATER_THAN_OR_EQUALS:
+        case AST_BINARY_EQUALS:
+        case AST_BINARY_NOT_EQUALS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// `a <op> b` as `!(a <negated> b)`
+attribute_const
+static ASTBinaryType ASTRange_NegateComparison(const ASTBinaryType op) {
+    switch (op) {
+        case AST_BINARY_LESS_THAN:
+            return AST_BINARY_GREATER_THAN_OR_EQUALS;
+        case AST_BINARY_LESS_THAN_OR_EQUALS:
+            return AST_BINARY_GREATER_THAN;
+        case AST_BINARY_GREATER_THAN:
+            return AST_BINARY_LESS_THAN_OR_EQUALS;
+        case AST_BINARY_GREATER_THAN_OR_EQUALS:
+            return AST_BINARY_LESS_THAN;
+        case AST_BINARY_EQUALS:
+            return AST_BINARY_NOT_EQUALS;
+        default:
+            return AST_BINARY_EQUALS;
+    }
+}
+
+// `a <op> b` as `b <swapped> a`
+attribute_const
+static ASTBinaryType ASTRange_SwapComparison(const ASTBinaryType op) {
+    switch (op) {
+        case AST_BINARY_LESS_THAN:
+            return AST_BINARY_GREATER_THAN;
+        case AST_BINARY_LESS_THAN_OR_EQUALS:
+            return AST_BINARY_GREATER_THAN_OR_EQUALS;
+        case AST_BINARY_GREATER_THAN:
+            return AST_BINARY_LESS_THAN;
+        case AST_BINARY_GREATER_THAN_OR_EQUALS:
+            return AST_BINARY_LESS_THAN_OR_EQUALS;
+        default:
+            return op;
+    }
+}
+
+// What is left of `range` once `x <op> other` is known to hold for x in it
+attribute_const
+static ASTRange ASTRange_Restrict(const ASTRange range, const ASTBinaryType op, const ASTRange other) {
+    if (ASTRange_IsEmpty(other)) {
+        return AST_RANGE_EMPTY;
+    }
+    switch (op) {
+        case AST_BINARY_LESS_THAN:
+            if (other.max == INT64_MIN) return AST_RANGE_EMPTY;
+            return ASTRange_Meet(range, (ASTRange){.min = INT64_MIN, .max = other.max - 1});
+        case AST_BINARY_LESS_THAN_OR_EQUALS:
+            return ASTRange_Meet(range, (ASTRange){.min = INT64_MIN, .max = other.max});
+        case AST_BINARY_GREATER_THAN:
+            if (other.min == INT64_MAX) return AST_RANGE_EMPTY;
+            return ASTRange_Meet(range, (ASTRange){.min = other.min + 1, .max = INT64_MAX});
+        case AST_BINARY_GREATER_THAN_OR_EQUALS:
+            return ASTRange_Meet(range, (ASTRange){.min = other.min, .max = INT64_MAX});
+        case AST_BINARY_EQUALS:
+            return ASTRange_Meet(range, other);
+        case AST_BINARY_NOT_EQUALS:
+            // Only a value at an end of the interval can be cut off
+            if (ASTRange_IsConstant(other) && !ASTRange_IsEmpty(range)) {
+                if (range.min == other.min) return (ASTRange){.min = range.min + 1, .max = range.max};
+                if (range.max == other.min) return (ASTRange){.min = range.min, .max = range.max - 1};
+            }
+            return range;
+        default:
+            return range;
+    }
+}
+
+ASTNodeId ASTNode_GuardVariable(const ASTModule *module, const ASTNodeId condition) {
+    const ASTNode *node = AST_NODE(module, condition);
+    if (node->type != AST_BINARY || !ASTRange_IsComparison(node->binary_op.op)) {
+        return AST_NODE_NONE;
+    }
+    if (AST_NODE(module, node->binary_op.left)->type == AST_VAR_REF) {
+        return node->binary_op.left;
+    }
+    if (AST_NODE(module, node->binary_op.right)->type == AST_VAR_REF) {
+        return node->binary_op.right;
+    }
+    return AST_NODE_NONE;
+}
+
+ASTRange ASTNode_Range(const ASTModule *module, const ASTNodeId node_id) {
+    const ASTNode *node = AST_NODE(module, node_id);
+    if (node->type == AST_LITERAL && node->literal.type == VALUE_I64) {
+        return ASTRange_Constant(node->literal.i64);
+    }
+    // Nodes created after the analysis are not in the table
+    if (node_id < module->ranges_count && !ASTRange_IsEmpty(module->ranges[node_id])) {
+        return module->ranges[node_id];
+    }
+    return AST_RANGE_FULL;
+}
+
+void ASTModule_DropRanges(ASTModule *module) {
+    module->ranges = NULL;
+    module->ranges_count = 0;
+}
+
+// Index + 1 of the variable a reference reads or writes, 0 when its range is not followed
+attribute_pure
+static uint32_t ASTRangeAnalysis_Variable(const ASTRangeAnalysis *analysis, const ASTNode *node) {
+    DEBUG_ASSERT(node->type == AST_VAR_REF);
+    const Symbol *symbol = node->var_ref.symbol;
+    // Parameters have no declaration, they keep the full range
+    if (symbol == NULL || symbol->declaration == AST_NODE_NONE) {
+        return 0;
+    }
+    return analysis->variable_of[symbol->declaration];
+}
+
+static uint32_t ASTRangeAnalysis_Save(ASTRangeAnalysis *analysis) {
+    const uint32_t count = analysis->variables_count - analysis->base;
+    analysis->saved = Array_Grow(analysis->saved, &analysis->saved_capacity,
+                                 analysis->saved_count + count, sizeof(*analysis->saved));
+    analysis->snapshots = Array_Grow(analysis->snapshots, &analysis->snapshots_capacity,
+                                     analysis->snapshots_count + 1, sizeof(*analysis->snapshots));
+    memcpy(analysis->saved + analysis->saved_count, analysis->env + analysis->base, sizeof(*analysis->saved) * count);
+    analysis->snapshots[analysis->snapshots_count] = (ASTRangeSnapshot){
+        .offset = analysis->saved_count,
+        .count = analysis->variables_count,
+    };
+    analysis->saved_count += count;
+    return analysis->snapshots_count++;
+}
+
+// Variables declared after the snapshot keep their ranges: they are out of scope until declared again
+static void ASTRangeAnalysis_Restore(const ASTRangeAnalysis *analysis, const uint32_t index) {
+    const ASTRangeSnapshot snapshot = analysis->snapshots[index];
+    memcpy(analysis->env + analysis->base, analysis->saved + snapshot.offset,
+           sizeof(*analysis->env) * (snapshot.count - analysis->base));
+}
+
+static void ASTRangeAnalysis_Join(const ASTRangeAnalysis *analysis, const uint32_t index) {
+    const ASTRangeSnapshot snapshot = analysis->snapshots[index];
+    const ASTRange *saved = analysis->saved + snapshot.offset - analysis->base;
+    for (uint32_t i = analysis->base; i < snapshot.count; ++i) {
+        analysis->env[i] = ASTRange_Hull(analysis->env[i], saved[i]);
+    }
+}
+
+// Drops the snapshot and every one taken after it
+static void ASTRangeAnalysis_Drop(ASTRangeAnalysis *analysis, const uint32_t index) {
+    analysis->saved_count = analysis->snapshots[index].offset;
+    analysis->snapshots_count = index;
+}
+
+// Joins the state saved last into the current one and drops the last `count` snapshots
+static void ASTRangeAnalysis_Merge(ASTRangeAnalysis *analysis, const uint32_t count) {
+    ASTRangeAnalysis_Join(analysis, analysis->snapshots_count - 1);
+    ASTRangeAnalysis_Drop(analysis, analysis->snapshots_count - count);
+}
+
+static void ASTRangeAnalysis_Refine(const ASTRangeAnalysis *analysis, const ASTNodeId condition, const bool holds,
+                                    const uint32_t depth) {
+    const ASTNode *node = AST_NODE(analysis->module, condition);
+    // A condition that writes could have changed the variables after comparing them
+    if (depth > AST_RANGE_REFINE_DEPTH || !IsNodePure(node)) {
+        return;
+    }
+
+    switch (node->type) {
+        case AST_VAR_REF: {
+            const uint32_t variable = ASTRangeAnalysis_Variable(analysis, node);
+            if (variable != 0) {
+                ASTRange *range = &analysis->env[variable - 1];
+                *range = ASTRange_Restrict(*range, holds ? AST_BINARY_NOT_EQUALS : AST_BINARY_EQUALS,
+                                           ASTRange_Constant(0));
+            }
+            return;
+        }
+        case AST_UNARY:
+            if (node->unary_op.op == AST_UNARY_LOGICAL_NOT) {
+                ASTRangeAnalysis_Refine(analysis, node->unary_op.operand, !holds, depth + 1);
+            }
+            return;
+        case AST_BINARY:
+            break;
+        default:
+            return;
+    }
+
+    const ASTBinaryType op = node->binary_op.op;
+    if ((op == AST_BINARY_LOGICAL_AND && holds) || (op == AST_BINARY_LOGICAL_OR && !holds)) {
+        ASTRangeAnalysis_Refine(analysis, node->binary_op.left, holds, depth + 1);
+        ASTRangeAnalysis_Refine(analysis, node->binary_op.right, holds, depth + 1);
+        return;
+    }
+    if (!ASTRange_IsComparison(op)) {
+        return;
+    }
+
+    const ASTBinaryType compared = holds ? op : ASTRange_NegateComparison(op);
+    const ASTNode *left = AST_NODE(analysis->module, node->binary_op.left);
+    const ASTNode *right = AST_NODE(analysis->module, node->binary_op.right);
+    const ASTRange left_value = analysis->values[node->binary_op.left];
+    const ASTRange right_value = analysis->values[node->binary_op.right];
+    if (left->type == AST_VAR_REF) {
+        const uint32_t variable = ASTRangeAnalysis_Variable(analysis, left);
+        if (variable != 0) {
+            analysis->env[variable - 1] = ASTRange_Restrict(analysis->env[variable - 1], compared, right_value);
+        }
+    }
+    if (right->type == AST_VAR_REF) {
+        const uint32_t variable = ASTRangeAnalysis_Variable(analysis, right);
+        if (variable != 0) {
+            analysis->env[variable - 1] = ASTRange_Restrict(analysis->env[variable - 1],
+                                                            ASTRange_SwapComparison(compared), left_value);
+        }
+    }
+}
+
+// A nested function may write the variables of the one declaring it
+static void ASTRangeAnalysis_Forget(const ASTRangeAnalysis *analysis) {
+    for (uint32_t i = analysis->base; i < analysis->variables_count; ++i) {
+        analysis->env[i] = AST_RANGE_FULL;
+    }
+}
+
+static void ASTRangeAnalysis_Declare(ASTRangeAnalysis *analysis, const ASTNodeId declaration, const ASTRange value) {
+    if (analysis->variable_of[declaration] == 0) {
+        analysis->env = Array_Grow(analysis->env, &analysis->env_capacity, analysis->variables_count + 1,
+                                   sizeof(*analysis->env));
+        analysis->variable_of[declaration] = ++analysis->variables_count;
+    }
+    analysis->env[analysis->variable_of[declaration] - 1] = value;
+}
+
+// Range of an expression from the ranges of its children in evaluation order, variables are read and written
+// on the way. A shared node is visited once per occurrence, so the values of its children are taken from the
+// visit, never from the per-node table
+static ASTRange ASTRangeAnalysis_Value(ASTRangeAnalysis *analysis, const ASTNode *node, const ASTRange *operands) {
+
+    switch (node->type) {
+        case AST_LITERAL:
+            return node->literal.type == VALUE_I64 ? ASTRange_Constant(node->literal.i64) : AST_RANGE_FULL;
+        case AST_VAR_REF: {
+            const uint32_t variable = ASTRangeAnalysis_Variable(analysis, node);
+            if (variable == 0 || (node->flags & AST_NODE_FLAG_ASSIGN_TARGET)) {
+                return AST_RANGE_FULL;
+            }
+            return analysis->env[variable - 1];
+        }
+        case AST_UNARY: {
+            const ASTUnaryType op = node->unary_op.op;
+            if (op != AST_UNARY_INCREMENT && op != AST_UNARY_DECREMENT) {
+                return ASTRange_Unary(op, operands[0]);
+            }
+            const ASTNode *operand = AST_NODE(analysis->module, node->unary_op.operand);
+            const uint32_t variable = operand->type == AST_VAR_REF ? ASTRangeAnalysis_Variable(analysis, operand) : 0;
+            if (variable == 0) {
+                return AST_RANGE_FULL;
+            }
+            analysis->env[variable - 1] = ASTRange_Unary(op, analysis->env[variable - 1]);
+            return analysis->env[variable - 1];
+        }
+        case AST_BINARY: {
+            const ASTRange right = operands[1];
+            if (node->binary_op.op != AST_BINARY_ASSIGN) {
+                return ASTRange_Binary(node->binary_op.op, operands[0], right);
+            }
+            const ASTNode *target = AST_NODE(analysis->module, node->binary_op.left);
+            const uint32_t variable = target->type == AST_VAR_REF ? ASTRangeAnalysis_Variable(analysis, target) : 0;
+            if (variable != 0) {
+                analysis->env[variable - 1] = right;
+            }
+            return right;
+        }
+        case AST_TERNARY: {
+            if (ASTRange_IsTrue(operands[0])) return operands[1];
+            if (ASTRange_IsFalse(operands[0])) return operands[2];
+            return ASTRange_Hull(operands[1], operands[2]);
+        }
+        case AST_TYPE_CAST:
+            if (node->type_cast.from_type == VALUE_I64 && node->type_cast.target_type == VALUE_I64) {
+                return operands[0];
+            }
+            return AST_RANGE_FULL;
+        case AST_FUNCTION_CALL: {
+            const ASTNodeId declaration = node->function_call.signature->declaration;
+            if (declaration == AST_NODE_NONE || !analysis->is_function[declaration]) {
+                ASTRangeAnalysis_Forget(analysis);
+            }
+            return AST_RANGE_FULL;
+        }
+        default:
+            return AST_RANGE_FULL;
+    }
+}
+
+static errno_t ASTRangeAnalysis_Enter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    const ASTRangeAnalysis *analysis = visitor->context;
+    if (AST_NODE(analysis->module, *slot)->type == AST_FUNCTION_DECL && *slot != analysis->root) {
+        *skip_children = true;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t ASTRangeAnalysis_BeforeChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    ASTRangeAnalysis *analysis = visitor->context;
+    const ASTNode *node = AST_NODE(analysis->module, node_id);
+
+    switch (node->type) {
+        case AST_WHILE_STMT:
+            // Repeated iterations start over from the guard, the loop is already on the stack
+            if (index == 0 && (analysis->loops_count == 0
+                               || analysis->loops[analysis->loops_count - 1].node != node_id)) {
+                analysis->loops = Array_Grow(analysis->loops, &analysis->loops_capacity,
+                                             analysis->loops_count + 1, sizeof(*analysis->loops));
+                analysis->loops[analysis->loops_count++] = (ASTRangeLoop){
+                    .node = node_id,
+                    .head = ASTRangeAnalysis_Save(analysis),
+                    .iteration = 0,
+                };
+            }
+            break;
+        case AST_BINARY:
+            if (index == 1 && (node->binary_op.op == AST_BINARY_LOGICAL_AND
+                               || node->binary_op.op == AST_BINARY_LOGICAL_OR)) {
+                ASTRangeAnalysis_Save(analysis);
+                ASTRangeAnalysis_Refine(analysis, node->binary_op.left, node->binary_op.op == AST_BINARY_LOGICAL_AND, 0);
+            }
+            break;
+        default:
+            break;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Joins the end of the loop body into the loop head, true while the head still grows
+static bool ASTRangeAnalysis_BackEdge(ASTRangeAnalysis *analysis, ASTRangeLoop *loop) {
+    const uint32_t widen_after = analysis->loops_count > AST_RANGE_PRECISE_LOOPS ? 0 : AST_RANGE_WIDEN_AFTER;
+    const bool widen = loop->iteration >= widen_after;
+    const ASTRangeSnapshot head = analysis->snapshots[loop->head];
+    ASTRange *saved = analysis->saved + head.offset - analysis->base;
+
+    bool changed = false;
+    for (uint32_t i = analysis->base; i < head.count; ++i) {
+        const ASTRange old = saved[i];
+        ASTRange joined = ASTRange_Hull(old, analysis->env[i]);
+        if (widen && !ASTRange_IsEmpty(old)) {
+            if (joined.min < old.min) joined.min = INT64_MIN;
+            if (joined.max > old.max) joined.max = INT64_MAX;
+        }
+        if (joined.min != old.min || joined.max != old.max) {
+            saved[i] = joined;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Splits the state at a condition that has just been evaluated: the variables as it holds stay current, the
+// ones as it fails are saved and their snapshot returned. Both are refined now, while the values of the
+// condition are those of this evaluation
+static uint32_t ASTRangeAnalysis_Branch(ASTRangeAnalysis *analysis, const ASTNodeId condition) {
+    const uint32_t before = ASTRangeAnalysis_Save(analysis);
+    ASTRangeAnalysis_Refine(analysis, condition, false, 0);
+    const uint32_t fails = ASTRangeAnalysis_Save(analysis);
+    ASTRangeAnalysis_Restore(analysis, before);
+    ASTRangeAnalysis_Refine(analysis, condition, true, 0);
+    return fails;
+}
+
+static errno_t ASTRangeAnalysis_AfterChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    ASTRangeAnalysis *analysis = visitor->context;
+    const ASTNode *node = AST_NODE(analysis->module, node_id);
+
+    analysis->operands = Array_Grow(analysis->operands, &analysis->operands_capacity,
+                                    analysis->operands_count + 1, sizeof(*analysis->operands));
+    analysis->operands[analysis->operands_count++] = analysis->values[*ASTNode_ChildSlot(analysis->module, node_id,
+                                                                                         index)];
+
+    switch (node->type) {
+        case AST_IF_STMT:
+        case AST_TERNARY: {
+            const ASTNodeId condition = node->type == AST_IF_STMT ? node->if_stmt.condition : node->ternary_op.condition;
+            if (index == 0) {
+                ASTRangeAnalysis_Branch(analysis, condition);
+            } else if (index == 1) {
+                // The end of the then branch is kept for the join, the else branch starts where the condition fails
+                const uint32_t then_state = ASTRangeAnalysis_Save(analysis);
+                ASTRangeAnalysis_Restore(analysis, then_state - 1);
+            }
+            break;
+        }
+        case AST_WHILE_STMT:
+            if (index == 0) {
+                // The loop exits right after a failed guard
+                ASTRangeAnalysis_Branch(analysis, node->while_stmt.condition);
+
+                const ASTNodeId guard = ASTNode_GuardVariable(analysis->module, node->while_stmt.condition);
+                const uint32_t variable = guard != AST_NODE_NONE
+                                              ? ASTRangeAnalysis_Variable(analysis, AST_NODE(analysis->module, guard))
+                                              : 0;
+                if (variable != 0) {
+                    analysis->module->ranges[node_id] = ASTRange_Hull(analysis->module->ranges[node_id],
+                                                                      analysis->env[variable - 1]);
+                }
+            } else {
+                ASTRangeLoop *loop = &analysis->loops[analysis->loops_count - 1];
+                if (ASTRangeAnalysis_BackEdge(analysis, loop)) {
+                    ASTRangeAnalysis_Drop(analysis, loop->head + 1);
+                    ASTRangeAnalysis_Restore(analysis, loop->head);
+                    analysis->operands_count -= 2;
+                    ++loop->iteration;
+                    ASTVisitor_RepeatChildren(visitor);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+// Children reported to after_child: the ones present, none of a nested function left out
+attribute_pure
+static uint32_t ASTRangeAnalysis_VisitedChildren(const ASTRangeAnalysis *analysis, const ASTNodeId node_id) {
+    const ASTNode *node = AST_NODE(analysis->module, node_id);
+    if (node->type == AST_FUNCTION_DECL && node_id != analysis->root) {
+        return 0;
+    }
+    const uint32_t children_count = ASTNode_ChildrenCount(analysis->module, node_id);
+    uint32_t visited = 0;
+    for (uint32_t i = 0; i < children_count; ++i) {
+        if (*ASTNode_ChildSlot(analysis->module, node_id, i) != AST_NODE_NONE) {
+            ++visited;
+        }
+    }
+    return visited;
+}
+
+static errno_t ASTRangeAnalysis_Leave(ASTVisitor *visitor, ASTNodeId *slot) {
+    ASTRangeAnalysis *analysis = visitor->context;
+    const ASTNode *node = AST_NODE(analysis->module, *slot);
+    const uint32_t visited = ASTRangeAnalysis_VisitedChildren(analysis, *slot);
+    const ASTRange *operands = analysis->operands + analysis->operands_count - visited;
+
+    // Statements have no value, the ones of their children are only dropped
+    ASTRange value = AST_RANGE_FULL;
+    switch (node->type) {
+        case AST_IF_STMT:
+            ASTRangeAnalysis_Merge(analysis, 3);
+            break;
+        case AST_WHILE_STMT: {
+            const ASTRangeLoop loop = analysis->loops[--analysis->loops_count];
+            ASTRangeAnalysis_Restore(analysis, loop.head + 2);
+            ASTRangeAnalysis_Drop(analysis, loop.head);
+            break;
+        }
+        case AST_VAR_DECL:
+            if (node->var_decl.var_type == VALUE_I64) {
+                ASTRangeAnalysis_Declare(analysis, *slot, visited != 0 ? operands[0] : AST_RANGE_FULL);
+            }
+            break;
+        case AST_MODULE:
+        case AST_BLOCK:
+        case AST_PRINT_STMT:
+        case AST_FUNCTION_DECL:
+            break;
+        default:
+            if (node->type == AST_TERNARY) {
+                ASTRangeAnalysis_Merge(analysis, 3);
+            } else if (node->type == AST_BINARY && (node->binary_op.op == AST_BINARY_LOGICAL_AND
+                                                    || node->binary_op.op == AST_BINARY_LOGICAL_OR)) {
+                // The right operand may have been skipped
+                ASTRangeAnalysis_Merge(analysis, 1);
+            }
+            value = ASTRangeAnalysis_Value(analysis, node, operands);
+            if (node->expr_type == VALUE_I64 && !(node->flags & AST_NODE_FLAG_ASSIGN_TARGET)) {
+                analysis->module->ranges[*slot] = ASTRange_Hull(analysis->module->ranges[*slot], value);
+            }
+            break;
+    }
+
+    analysis->operands_count -= visited;
+    analysis->values[*slot] = value;
+    return VISMUT_ERROR_OK;
+}
+
+// Every top-level function is walked on its own and the statements of the module in order, the ranges
+// of parameters and of calls are not followed
+errno_t ASTModule_InferRanges(ASTModule *module) {
+    CALLSTACK_TRACE();
+    DEBUG_ASSERT(AST_NODE(module, module->root)->type == AST_MODULE);
+
+    module->ranges = Arena_Array(module->arena, ASTRange, module->nodes_count);
+    module->ranges_count = module->nodes_count;
+    for (uint32_t i = 0; i < module->nodes_count; ++i) {
+        module->ranges[i] = AST_RANGE_EMPTY;
+    }
+
+    ASTRangeAnalysis analysis = {
+        .module = module,
+        .values = calloc(module->nodes_count, sizeof(ASTRange)),
+        .variable_of = calloc(module->nodes_count, sizeof(uint32_t)),
+        .is_function = calloc(module->nodes_count, sizeof(bool)),
+    };
+    if (analysis.values == NULL || analysis.variable_of == NULL || analysis.is_function == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    analysis.env = Array_Grow(analysis.env, &analysis.env_capacity, 0, sizeof(*analysis.env));
+
+    const ASTNode *module_node = AST_NODE(module, module->root);
+    const ASTNodeList functions = module_node->module.functions;
+    const ASTNodeList statements = module_node->module.statements;
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        analysis.is_function[AST_LIST_ITEM(module, functions, i)] = true;
+    }
+
+    ASTVisitor visitor;
+    ASTVisitor_Init(&visitor, module, &analysis);
+    visitor.enter = ASTRangeAnalysis_Enter;
+    visitor.before_child = ASTRangeAnalysis_BeforeChild;
+    visitor.after_child = ASTRangeAnalysis_AfterChild;
+    visitor.leave = ASTRangeAnalysis_Leave;
+
+    errno_t err = VISMUT_ERROR_OK;
+    for (uint32_t i = 0; i < functions.count && err == VISMUT_ERROR_OK; ++i) {
+        analysis.root = AST_LIST_ITEM(module, functions, i);
+        analysis.base = analysis.variables_count;
+        err = ASTVisit(&visitor, &analysis.root);
+    }
+    analysis.base = analysis.variables_count;
+    for (uint32_t i = 0; i < statements.count && err == VISMUT_ERROR_OK; ++i) {
+        analysis.root = AST_LIST_ITEM(module, statements, i);
+        err = ASTVisit(&visitor, &analysis.root);
+    }
+
+    free(analysis.values);
+    free(analysis.operands);
+    free(analysis.variable_of);
+    free(analysis.is_function);
+    free(analysis.env);
+    free(analysis.saved);
+    free(analysis.snapshots);
+    free(analysis.loops);
+    return err;
+}
@@ -0,0 +1,42 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_RANGE_H
+#define VISMUT_AST_RANGE_H
+#include "../types.h"
+#include "ast.h"
+
+#define AST_RANGE_FULL ((ASTRange){.min = INT64_MIN, .max = INT64_MAX})
+#define AST_RANGE_EMPTY ((ASTRange){.min = 1, .max = 0})
+
+// Fills module->ranges with the values every i64 expression can take, joined over all the paths reaching it.
+// Literals, arithmetic, assignments and the comparisons of `#` conditions and `@` guards are followed,
+// loops are iterated to a fixpoint with widening. A while statement holds the range of its guard variable
+// (see ASTNode_GuardVariable) at the top of its body. Rewrites that merge nodes make the table stale:
+// drop it with ASTModule_DropRanges before hash-consing
+errno_t ASTModule_InferRanges(ASTModule *module);
+
+void ASTModule_DropRanges(ASTModule *module);
+
+// Range recorded for the node, AST_RANGE_FULL when nothing is known about it
+attribute_pure
+ASTRange ASTNode_Range(const ASTModule *module, ASTNodeId node);
+
+// Variable compared by a loop guard of the form `v <op> e` or `e <op> v`, AST_NODE_NONE for any other guard
+attribute_pure
+ASTNodeId ASTNode_GuardVariable(const ASTModule *module, ASTNodeId condition);
+
+attribute_const
+bool ASTRange_IsEmpty(ASTRange range);
+
+attribute_const
+bool ASTRange_IsFull(ASTRange range);
+
+attribute_const
+bool ASTRange_IsConstant(ASTRange range);
+
+attribute_const
+bool ASTRange_ContainsZero(ASTRange range);
+
+#endif //VISMUT_AST_RANGE_H
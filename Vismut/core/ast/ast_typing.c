@@ -1,45 +1,28 @@
 #include "ast_typing.h"
 
 #include <stdbool.h>
-#include <stdlib.h>
-
-typedef struct {
-    VValueType left_type;
-    VValueType right_type;
-    VValueType result_type;
-} ASTBinaryOpRule;
-
-typedef struct {
-    ASTBinaryType op;
-    const ASTBinaryOpRule *rules;
-    int rules_count;
-} ASTBinaryOpRules;
 
+// Zero is the default of every pair the rules leave out
 typedef enum {
+    CAST_ALLOW_NEVER,
     CAST_ALLOW_ALWAYS,
     CAST_ALLOW_EXPLICIT,
-    CAST_ALLOW_NEVER,
 } CastPermission;
 
-typedef struct {
-    VValueType from_type;
-    VValueType to_type;
-    CastPermission permission;
-} CastRule;
-
-#define BEGIN_BINARY_RULES(var_name) static const ASTBinaryOpRules var_name[] = {
+// The rules expand into dense tables indexed by the operator and the operand types, so typing a node is
+// a single load however many value types there are. Pairs without a rule stay VALUE_UNKNOWN
+#define BEGIN_BINARY_RULES(var_name) \
+    static const VValueType var_name[AST_BINARY_COUNT][VALUE_TYPES_COUNT][VALUE_TYPES_COUNT] = {
 #define END_RULES };
-#define BINARY_OP(op_name, ...) \
-    { \
-        .op = AST_BINARY_##op_name, \
-        .rules = (ASTBinaryOpRule[]){ __VA_ARGS__ }, \
-        .rules_count = sizeof((ASTBinaryOpRule[]){ __VA_ARGS__ }) / sizeof(ASTBinaryOpRule) \
-    },
+#define BINARY_OP(op_name, ...) [AST_BINARY_##op_name] = { __VA_ARGS__ },
 
-#define BEGIN_CAST_RULES(var_name) static const CastRule var_name[] = {
-#define CAST_RULE(from, to, perm) { from, to, perm },
+#define BEGIN_CAST_RULES(var_name) \
+    static const CastPermission var_name[VALUE_TYPES_COUNT][VALUE_TYPES_COUNT] = { \
+        VALUE_TYPE_MAP(CAST_IDENTITY)
+#define CAST_IDENTITY(name, _) [name][name] = CAST_ALLOW_ALWAYS,
+#define CAST_RULE(from, to, perm) [from][to] = perm,
 
-#define RULE(r, l, res) { r, l, res }
+#define RULE(l, r, res) [l][r] = res
 
 #define INT VALUE_I64
 #define FLOAT VALUE_F64
@@ -105,19 +88,7 @@ BEGIN_CAST_RULES(cast_rules)
 END_RULES
 
 VValueType GetBinaryOpResultType(const ASTBinaryType op, const VValueType left, const VValueType right) {
-    for (int i = 0; i < (int) _countof(binary_op_rules); ++i) {
-        const ASTBinaryOpRules rules = binary_op_rules[i];
-        if (rules.op == op) {
-            for (int rule_id = 0; rule_id < rules.rules_count; ++rule_id) {
-                const ASTBinaryOpRule rule = rules.rules[rule_id];
-                if (rule.left_type == left && rule.right_type == right) {
-                    return rule.result_type;
-                }
-            }
-            return VALUE_UNKNOWN;
-        }
-    }
-    return VALUE_UNKNOWN;
+    return binary_op_rules[op][left][right];
 }
 
 VValueType GetUnaryOpResultType(const ASTUnaryType op, const VValueType operand) {
@@ -138,18 +109,7 @@ VValueType GetUnaryOpResultType(const ASTUnaryType op, const VValueType operand)
 }
 
 static CastPermission GetCastPermission(const VValueType from_type, const VValueType to_type) {
-    if (from_type == to_type) {
-        return CAST_ALLOW_ALWAYS;
-    }
-
-    for (int i = 0; i < (int) _countof(cast_rules); ++i) {
-        const CastRule rule = cast_rules[i];
-        if (rule.from_type == from_type && rule.to_type == to_type) {
-            return rule.permission;
-        }
-    }
-
-    return CAST_ALLOW_NEVER;
+    return cast_rules[from_type][to_type];
 }
 
 bool IsCastAllowed(const VValueType from_type, const VValueType to_type, const bool is_explicit) {
@@ -0,0 +1,197 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include "ast_visit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../errors/errors.h"
+
+uint32_t ASTNode_ChildrenCount(const ASTModule *module, const ASTNodeId node_id) {
+    const ASTNode *node = AST_NODE(module, node_id);
+    switch (node->type) {
+        case AST_UNARY:
+        case AST_TYPE_CAST:
+        case AST_VAR_DECL:
+        case AST_FUNCTION_DECL:
+            return 1;
+        case AST_BINARY:
+        case AST_WHILE_STMT:
+            return 2;
+        case AST_TERNARY:
+        case AST_IF_STMT:
+            return 3;
+        case AST_FUNCTION_CALL:
+            return node->function_call.arguments.count;
+        case AST_PRINT_STMT:
+            return node->print_stmt.expressions.count;
+        case AST_BLOCK:
+            return node->block.statements.count;
+        case AST_MODULE:
+            return node->module.functions.count + node->module.statements.count;
+        default:
+            return 0;
+    }
+}
+
+ASTNodeId *ASTNode_ChildSlot(const ASTModule *module, const ASTNodeId node_id, const uint32_t index) {
+    ASTNode *node = AST_NODE(module, node_id);
+    DEBUG_ASSERT(index < ASTNode_ChildrenCount(module, node_id));
+
+    switch (node->type) {
+        case AST_UNARY:
+            return &node->unary_op.operand;
+        case AST_TYPE_CAST:
+            return &node->type_cast.expression;
+        case AST_VAR_DECL:
+            return &node->var_decl.init_value;
+        case AST_FUNCTION_DECL:
+            return &node->function_decl.body;
+        case AST_BINARY:
+            return index == 0 ? &node->binary_op.left : &node->binary_op.right;
+        case AST_WHILE_STMT:
+            return index == 0 ? &node->while_stmt.condition : &node->while_stmt.body;
+        case AST_TERNARY:
+            return index == 0
+                       ? &node->ternary_op.condition
+                       : index == 1
+                             ? &node->ternary_op.then_expression
+                             : &node->ternary_op.else_expression;
+        case AST_IF_STMT:
+            return index == 0
+                       ? &node->if_stmt.condition
+                       : index == 1
+                             ? &node->if_stmt.then_block
+                             : &node->if_stmt.else_block;
+        case AST_FUNCTION_CALL:
+            return &AST_LIST_ITEM(module, node->function_call.arguments, index);
+        case AST_PRINT_STMT:
+            return &AST_LIST_ITEM(module, node->print_stmt.expressions, index);
+        case AST_BLOCK:
+            return &AST_LIST_ITEM(module, node->block.statements, index);
+        case AST_MODULE:
+            if (index < node->module.functions.count) {
+                return &AST_LIST_ITEM(module, node->module.functions, index);
+            }
+            return &AST_LIST_ITEM(module, node->module.statements, index - node->module.functions.count);
+        default:
+            return NULL;
+    }
+}
+
+void ASTVisitor_Init(ASTVisitor *visitor, const ASTModule *module, void *context) {
+    *visitor = (ASTVisitor){
+        .module = module,
+        .context = context,
+        .arena = module->arena,
+    };
+}
+
+ASTNodeId ASTVisitor_Parent(const ASTVisitor *visitor) {
+    DEBUG_ASSERT(visitor->depth != 0);
+    return visitor->stack[visitor->depth - 1].parent;
+}
+
+uint32_t ASTVisitor_Index(const ASTVisitor *visitor) {
+    DEBUG_ASSERT(visitor->depth != 0);
+    return visitor->stack[visitor->depth - 1].index;
+}
+
+void ASTVisitor_RepeatChildren(ASTVisitor *visitor) {
+    DEBUG_ASSERT(visitor->depth != 0);
+    visitor->stack[visitor->depth - 1].next_child = 0;
+}
+
+static void ASTVisitor_Push(ASTVisitor *visitor, const ASTNodeId parent, const uint32_t index) {
+    if (visitor->depth == visitor->stack_capacity) {
+        const uint32_t new_capacity = visitor->stack_capacity == 0
+                                          ? AST_VISIT_INITIAL_STACK
+                                          : visitor->stack_capacity * 2;
+        ASTVisitFrame *stack = Arena_Array(visitor->arena, ASTVisitFrame, new_capacity);
+        if (visitor->depth != 0) {
+            memcpy(stack, visitor->stack, sizeof(*stack) * visitor->depth);
+        }
+        visitor->stack = stack;
+        visitor->stack_capacity = new_capacity;
+    }
+    visitor->stack[visitor->depth++] = (ASTVisitFrame){
+        .parent = parent,
+        .index = index,
+    };
+}
+
+// Slots are resolved again on every use: list items may move while a callback creates new lists
+static ASTNodeId *ASTVisitor_FrameSlot(const ASTVisitor *visitor, const ASTVisitFrame *frame) {
+    if (frame == visitor->stack) {
+        return visitor->root;
+    }
+    return ASTNode_ChildSlot(visitor->module, frame->parent, frame->index);
+}
+
+errno_t ASTVisit(ASTVisitor *visitor, ASTNodeId *root) {
+    DEBUG_ASSERT(visitor != NULL && root != NULL);
+    if (*root == AST_NODE_NONE) {
+        return VISMUT_ERROR_OK;
+    }
+
+    errno_t err;
+    visitor->root = root;
+    visitor->depth = 0;
+    ASTVisitor_Push(visitor, AST_NODE_NONE, 0);
+
+    while (visitor->depth != 0) {
+        ASTVisitFrame *frame = &visitor->stack[visitor->depth - 1];
+
+        if (frame->node == AST_NODE_NONE) {
+            ASTNodeId *slot = ASTVisitor_FrameSlot(visitor, frame);
+            bool skip_children = false;
+            if (visitor->enter != NULL) {
+                ASTNodeId entered;
+                do {
+                    entered = *slot;
+                    RISKY_EXPRESSION_SAFE(visitor->enter(visitor, slot, &skip_children), err);
+                    slot = ASTVisitor_FrameSlot(visitor, frame);
+                } while (*slot != entered && *slot != AST_NODE_NONE && !skip_children);
+            }
+            if (*slot == AST_NODE_NONE) {
+                const ASTNodeId parent = frame->parent;
+                const uint32_t index = frame->index;
+                --visitor->depth;
+                if (visitor->depth != 0 && visitor->after_child != NULL) {
+                    RISKY_EXPRESSION_SAFE(visitor->after_child(visitor, parent, index), err);
+                }
+                continue;
+            }
+            frame->node = *slot;
+            frame->next_child = 0;
+            frame->children_count = skip_children ? 0 : ASTNode_ChildrenCount(visitor->module, frame->node);
+        }
+
+        if (frame->next_child < frame->children_count) {
+            const uint32_t index = frame->next_child++;
+            if (*ASTNode_ChildSlot(visitor->module, frame->node, index) == AST_NODE_NONE) {
+                continue;
+            }
+            if (visitor->before_child != NULL) {
+                RISKY_EXPRESSION_SAFE(visitor->before_child(visitor, frame->node, index), err);
+            }
+            // Pushing may move the stack, the frame pointer is taken again on the next iteration
+            ASTVisitor_Push(visitor, frame->node, index);
+            continue;
+        }
+
+        if (visitor->leave != NULL) {
+            RISKY_EXPRESSION_SAFE(visitor->leave(visitor, ASTVisitor_FrameSlot(visitor, frame)), err);
+        }
+        const ASTNodeId parent = frame->parent;
+        const uint32_t index = frame->index;
+        --visitor->depth;
+        if (visitor->depth != 0 && visitor->after_child != NULL) {
+            RISKY_EXPRESSION_SAFE(visitor->after_child(visitor, parent, index), err);
+        }
+    }
+
+    return VISMUT_ERROR_OK;
+}
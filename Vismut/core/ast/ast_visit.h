@@ -0,0 +1,70 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_AST_VISIT_H
+#define VISMUT_AST_VISIT_H
+#include "../types.h"
+#include "ast.h"
+
+#define AST_VISIT_INITIAL_STACK 64
+
+typedef struct tag_ASTVisitor ASTVisitor;
+
+// Called when a node is reached, before its children. A replacement stored to *slot is entered in turn,
+// AST_NODE_NONE drops the node from the walk. Setting *skip_children leaves the subtree out
+typedef errno_t (*ASTVisitEnter)(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children);
+
+// Called around the walk of child `index` of `node`, children equal to AST_NODE_NONE are not reported
+typedef errno_t (*ASTVisitChild)(ASTVisitor *visitor, ASTNodeId node, uint32_t index);
+
+// Called after the children of the node, may replace *slot
+typedef errno_t (*ASTVisitLeave)(ASTVisitor *visitor, ASTNodeId *slot);
+
+typedef struct {
+    ASTNodeId parent; // AST_NODE_NONE for the root of the walk
+    uint32_t index; // child index of the node inside the parent
+    ASTNodeId node; // AST_NODE_NONE until the node is entered
+    uint32_t next_child;
+    uint32_t children_count;
+} ASTVisitFrame;
+
+// The walk keeps its own stack, so deep trees never grow the C stack. The stack is reused between walks
+// of the same visitor: a callback that needs a nested walk must use a separate visitor
+struct tag_ASTVisitor {
+    const ASTModule *module;
+    void *context;
+    ASTVisitEnter enter;
+    ASTVisitChild before_child;
+    ASTVisitChild after_child;
+    ASTVisitLeave leave;
+    ASTNodeId *root;
+    Arena *arena; // holds the stack, the module arena unless set after ASTVisitor_Init
+    ASTVisitFrame *stack;
+    uint32_t stack_capacity;
+    uint32_t depth; // frames in use, the current node is stack[depth - 1]
+};
+
+void ASTVisitor_Init(ASTVisitor *visitor, const ASTModule *module, void *context);
+
+errno_t ASTVisit(ASTVisitor *visitor, ASTNodeId *root);
+
+// Parent of the node being entered or left, AST_NODE_NONE for the root of the walk
+attribute_pure
+ASTNodeId ASTVisitor_Parent(const ASTVisitor *visitor);
+
+// Child index of the node being entered or left inside its parent
+attribute_pure
+uint32_t ASTVisitor_Index(const ASTVisitor *visitor);
+
+// Called from after_child: the children of the node are walked once more from the first one, which is how
+// a dataflow pass iterates a loop to its fixpoint
+void ASTVisitor_RepeatChildren(ASTVisitor *visitor);
+
+// Children are numbered in evaluation order; optional children may hold AST_NODE_NONE
+attribute_pure
+uint32_t ASTNode_ChildrenCount(const ASTModule *module, ASTNodeId node);
+
+ASTNodeId *ASTNode_ChildSlot(const ASTModule *module, ASTNodeId node, uint32_t index);
+
+#endif //VISMUT_AST_VISIT_H
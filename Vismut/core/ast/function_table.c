@@ -0,0 +1,90 @@
+#include "function_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "../errors/errors.h"
+
+// Capacity is always a power of two, so the slot index is a mask of the hash
+#define FUNCTION_TABLE_INITIAL_CAPACITY 16
+
+static FunctionSignature **allocate_slots(Arena *allocator, const size_t capacity) {
+    FunctionSignature **slots = Arena_Array(allocator, FunctionSignature *, capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i] = NULL;
+    }
+    return slots;
+}
+
+FunctionTable *FunctionTable_Allocate(Arena *allocator) {
+    FunctionTable *table = Arena_Type(allocator, FunctionTable);
+    table->allocator = allocator;
+    table->capacity = FUNCTION_TABLE_INITIAL_CAPACITY;
+    table->slots = allocate_slots(allocator, table->capacity);
+    table->size = 0;
+    return table;
+}
+
+attribute_pure
+static size_t probe_start(const FunctionTable *table, const uint32_t hash) {
+    return hash & (table->capacity - 1);
+}
+
+static void rehash(FunctionTable *table, const size_t new_capacity) {
+    FunctionSignature **old_slots = table->slots;
+    const size_t old_capacity = table->capacity;
+
+    table->slots = allocate_slots(table->allocator, new_capacity);
+    table->capacity = new_capacity;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        FunctionSignature *signature = old_slots[i];
+        if (signature == NULL) continue;
+
+        size_t index = probe_start(table, signature->function_name_hash);
+        while (table->slots[index] != NULL) {
+            index = (index + 1) & (table->capacity - 1);
+        }
+        table->slots[index] = signature;
+    }
+}
+
+errno_t FunctionTable_Declare(FunctionTable *table, FunctionSignature *signature) {
+    DEBUG_ASSERT(table != NULL);
+    DEBUG_ASSERT(signature != NULL);
+
+    if (FunctionTable_Find(table, signature->function_name, signature->function_name_hash) != NULL) {
+        return VISMUT_ERROR_FUNCTION_ALREADY_DEFINED;
+    }
+
+    if (table->size + 1 > table->capacity * 3 / 4) {
+        rehash(table, table->capacity * 2);
+    }
+
+    size_t index = probe_start(table, signature->function_name_hash);
+    while (table->slots[index] != NULL) {
+        index = (index + 1) & (table->capacity - 1);
+    }
+    table->slots[index] = signature;
+    ++table->size;
+
+    return VISMUT_ERROR_OK;
+}
+
+FunctionSignature *FunctionTable_Find(const FunctionTable *table, const uint8_t *name, const uint32_t hash) {
+    DEBUG_ASSERT(table != NULL);
+    DEBUG_ASSERT(name != NULL);
+
+    size_t index = probe_start(table, hash);
+    FunctionSignature *signature;
+    while ((signature = table->slots[index]) != NULL) {
+        if (signature->function_name_hash == hash
+            && strcmp((const char *) signature->function_name, (const char *) name) == 0) {
+            return signature;
+        }
+        index = (index + 1) & (table->capacity - 1);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,26 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_FUNCTION_TABLE_H
+#define VISMUT_FUNCTION_TABLE_H
+#include "../types.h"
+#include "../memory/arena.h"
+
+struct tag_FunctionSignature;
+
+typedef struct {
+    struct tag_FunctionSignature **slots;
+    Arena *allocator;
+    size_t capacity;
+    size_t size;
+} FunctionTable;
+
+FunctionTable *FunctionTable_Allocate(Arena *allocator);
+
+errno_t FunctionTable_Declare(FunctionTable *table, struct tag_FunctionSignature *signature);
+
+attribute_pure
+struct tag_FunctionSignature *FunctionTable_Find(const FunctionTable *table, const uint8_t *name, uint32_t hash);
+
+#endif //VISMUT_FUNCTION_TABLE_H
@@ -9,6 +9,7 @@
 #include "../hash/murmur3.h"
 
 #define SCOPE_INITIAL_CAPACITY 4
+#define SYMBOL_USES_INITIAL_CAPACITY 4
 
 static void symbol_set_flag(Symbol *sym, const uint32_t flag) {
     DEBUG_ASSERT(sym != NULL);
@@ -20,10 +21,10 @@ static void symbol_set_flag(Symbol *sym, const uint32_t flag) {
 //     sym->flags &= ~flag;
 // }
 
-static bool symbol_has_flag(const Symbol *sym, const uint32_t flag) {
-    DEBUG_ASSERT(sym != NULL);
-    return sym->flags & flag;
-}
+// static bool symbol_has_flag(const Symbol *sym, const uint32_t flag) {
+//     DEBUG_ASSERT(sym != NULL);
+//     return sym->flags & flag;
+// }
 
 // static Scope *Scope_GetParent(const Scope *scope) { return scope->parent; }
 // static bool Scope_IsGlobal(const Scope *scope) { return scope->parent == NULL; }
@@ -56,7 +57,7 @@ static void rehash(Scope *scope, const size_t new_capacity) {
     const size_t old_capacity = scope->capacity;
 
     scope->slots = Arena_Array(scope->allocator, Slot, new_capacity);
-    for (size_t i = 0; i < scope->capacity; ++i) {
+    for (size_t i = 0; i < new_capacity; ++i) {
         scope->slots[i].head = NULL;
     }
     scope->capacity = new_capacity;
@@ -90,64 +91,69 @@ static Symbol *create_symbol(
     *sym = (Symbol){
         .next = NULL,
         .name = name,
+        .declaration = 0,
+        .uses = NULL,
         .value = {
             .type = type,
         },
         .hash = hash,
         .flags = flags,
+        .uses_count = 0,
+        .uses_capacity = 0,
+        .reads_count = 0,
     };
     return sym;
 }
 
+Symbol *Symbol_Create(Arena *allocator, const uint8_t *name) {
+    DEBUG_ASSERT(name);
 
-errno_t Scope_Declare(Scope *scope, const uint8_t *name,
-                      const VValueType type, const uint32_t flags) {
+    return create_symbol(allocator, name, VALUE_AUTO, 0,
+                         murmurhash3_string(name, MURMURHASH3_DEFAULT_STR_SEED));
+}
+
+
+errno_t Scope_DeclareSymbol(Scope *scope, Symbol *symbol, const VValueType type) {
     DEBUG_ASSERT(scope);
-    DEBUG_ASSERT(name);
+    DEBUG_ASSERT(symbol);
 
-    const uint32_t hash = murmurhash3_string(name, MURMURHASH3_DEFAULT_STR_SEED);
-    size_t index = slot_index(scope, hash);
+    size_t index = slot_index(scope, symbol->hash);
 
     for (const Symbol *sym = scope->slots[index].head; sym; sym = sym->next) {
-        if (sym->hash == hash && __builtin_strcmp((const char *) sym->name, (const char *) name) == 0) {
+        if (sym->hash == symbol->hash
+            && __builtin_strcmp((const char *) sym->name, (const char *) symbol->name) == 0) {
             return VISMUT_ERROR_SYMBOL_ALREADY_DEFINED;
         }
     }
 
     if (scope->size >= scope->capacity * 3 / 4) {
         rehash(scope, scope->capacity * 2);
-        index = slot_index(scope, hash);
+        index = slot_index(scope, symbol->hash);
     }
 
-    Symbol *sym = create_symbol(scope->allocator, name, type, flags, hash);
-
-    sym->next = scope->slots[index].head;
-    scope->slots[index].head = sym;
+    symbol->value.type = type;
+    symbol->next = scope->slots[index].head;
+    scope->slots[index].head = symbol;
 
     ++scope->size;
     return VISMUT_ERROR_OK;
 }
 
-
-errno_t Scope_RemoveUnused(Scope *scope) {
+errno_t Scope_Declare(Scope *scope, const uint8_t *name,
+                      const VValueType type, const uint32_t flags, Symbol **out_symbol) {
     DEBUG_ASSERT(scope);
+    DEBUG_ASSERT(name);
 
-    for (size_t i = 0; i < scope->capacity; ++i) {
-        Symbol **pp = &scope->slots[i].head;
-
-        while (*pp) {
-            Symbol *sym = *pp;
-
-            if (!symbol_has_flag(sym, SYMBOL_FLAG_USED)) {
-                *pp = sym->next;
-                sym->next = NULL;
-                --scope->size;
-            } else {
-                pp = &sym->next;
-            }
-        }
+    errno_t err;
+    Symbol *sym = create_symbol(scope->allocator, name, type, flags,
+                                murmurhash3_string(name, MURMURHASH3_DEFAULT_STR_SEED));
+    if ((err = Scope_DeclareSymbol(scope, sym, type)) != VISMUT_ERROR_OK) {
+        return err;
     }
 
+    if (out_symbol != NULL) {
+        *out_symbol = sym;
+    }
     return VISMUT_ERROR_OK;
 }
 
@@ -188,7 +194,7 @@ errno_t Scope_AssignConstantEvaluated(const Scope *scope, const uint8_t *name, c
     sym->value = value;
     symbol_set_flag(sym, SYMBOL_FLAG_INITIALIZED | SYMBOL_FLAG_CONST_EVAL);
 
-    return true;
+    return VISMUT_ERROR_OK;
 }
 
 void Scope_MarkInitialized(const Scope *scope, const uint8_t *name) {
@@ -201,16 +207,38 @@ void Scope_MarkInitialized(const Scope *scope, const uint8_t *name) {
     }
 }
 
-void Scope_MarkUsed(const Scope *scope, const uint8_t *name) {
-    DEBUG_ASSERT(scope != NULL);
-    DEBUG_ASSERT(name != NULL);
+void Symbol_AddUse(Arena *allocator, Symbol *symbol, const ASTNodeId use, const bool is_read) {
+    DEBUG_ASSERT(symbol != NULL);
+    DEBUG_ASSERT(use != 0);
 
-    Symbol *sym = Scope_Resolve(scope, name);
-    if (sym != NULL) {
-        if (!symbol_has_flag(sym, SYMBOL_FLAG_USED)) {
-            symbol_set_flag(sym, SYMBOL_FLAG_USED);
-        } else if (!symbol_has_flag(sym, SYMBOL_FLAG_USED_MORE_ONCE)) {
-            symbol_set_flag(sym, SYMBOL_FLAG_USED_MORE_ONCE);
+    if (symbol->uses_count == symbol->uses_capacity) {
+        const uint32_t new_capacity = symbol->uses_capacity ? symbol->uses_capacity * 2 : SYMBOL_USES_INITIAL_CAPACITY;
+        ASTNodeId *uses = Arena_Array(allocator, ASTNodeId, new_capacity);
+        if (symbol->uses_count != 0) {
+            memcpy(uses, symbol->uses, symbol->uses_count * sizeof(*uses));
+        }
+        symbol->uses = uses;
+        symbol->uses_capacity = new_capacity;
+    }
+
+    symbol->uses[symbol->uses_count++] = use;
+    if (is_read) {
+        ++symbol->reads_count;
+    }
+}
+
+void Symbol_RemoveUse(Symbol *symbol, const ASTNodeId use, const bool is_read) {
+    DEBUG_ASSERT(symbol != NULL);
+    DEBUG_ASSERT(use != 0);
+
+    for (uint32_t i = 0; i < symbol->uses_count; ++i) {
+        if (symbol->uses[i] != use) continue;
+
+        memmove(&symbol->uses[i], &symbol->uses[i + 1], (symbol->uses_count - i - 1) * sizeof(*symbol->uses));
+        --symbol->uses_count;
+        if (is_read) {
+            --symbol->reads_count;
         }
+        return;
     }
 }
@@ -4,22 +4,28 @@
 
 #ifndef VISMUT_SCOPE_H
 #define VISMUT_SCOPE_H
+#include <stdbool.h>
 #include "../types.h"
 #include "value.h"
 #include "../memory/arena.h"
 
 #define SYMBOL_FLAG_INITIALIZED           (1 << 0)
 #define SYMBOL_FLAG_CONST                 (1 << 1)
-#define SYMBOL_FLAG_CONST_EVAL            (1 << 2)
-#define SYMBOL_FLAG_USED                  (1 << 3)
-#define SYMBOL_FLAG_USED_MORE_ONCE        (1 << 4)
+#define SYMBOL_FLAG_CONST_EVAL            (1 << 2) // value holds the number the variable has at this point
+#define SYMBOL_FLAG_MOVED                 (1 << 3) // copied out by ASTModule_Compact, next is the copy
+#define SYMBOL_FLAG_REASSIGNED            (1 << 4) // written after its declaration, see ASTOptimize_PropagateConstants
 
 typedef struct tag_Symbol {
     struct tag_Symbol *next;
     const uint8_t *name;
+    ASTNodeId declaration; // AST_VAR_DECL, AST_NODE_NONE for function params
+    ASTNodeId *uses; // AST_VAR_REF nodes referring to this symbol, in analysis order
     VValue value;
     uint32_t hash;
     uint32_t flags;
+    uint32_t uses_count;
+    uint32_t uses_capacity;
+    uint32_t reads_count; // uses_count minus assignment targets
 } Symbol;
 
 typedef struct {
@@ -37,9 +43,11 @@ typedef struct tag_Scope {
 
 Scope *Scope_Allocate(Arena *allocator, Scope *parent);
 
-errno_t Scope_Declare(Scope *scope, const uint8_t *name, VValueType type, uint32_t flags);
+Symbol *Symbol_Create(Arena *allocator, const uint8_t *name);
 
-errno_t Scope_RemoveUnused(Scope *scope);
+errno_t Scope_Declare(Scope *scope, const uint8_t *name, VValueType type, uint32_t flags, Symbol **out_symbol);
+
+errno_t Scope_DeclareSymbol(Scope *scope, Symbol *symbol, VValueType type);
 
 Symbol *Scope_Resolve(const Scope *scope, const uint8_t *name);
 
@@ -47,6 +55,8 @@ errno_t Scope_AssignConstantEvaluated(const Scope *scope, const uint8_t *name, V
 
 void Scope_MarkInitialized(const Scope *scope, const uint8_t *name);
 
-void Scope_MarkUsed(const Scope *scope, const uint8_t *name);
+void Symbol_AddUse(Arena *allocator, Symbol *symbol, ASTNodeId use, bool is_read);
+
+void Symbol_RemoveUse(Symbol *symbol, ASTNodeId use, bool is_read);
 
 #endif //VISMUT_SCOPE_H
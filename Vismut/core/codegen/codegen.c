@@ -4,16 +4,18 @@
 #include <stdlib.h>
 #include <string.h>
 
-CodeGenContext CodeGen_CreateContext(FILE *output, const uint8_t* module_name) {
+#include "../ast/ast_range.h"
+#include "../errors/errors.h"
+
+CodeGenContext CodeGen_CreateContext(FILE *output, const ASTModule *module) {
     return (CodeGenContext){
         .output = output,
-        .module_name = module_name,
+        .module = module,
+        .module_name = module->module_name,
     };
 }
 
-static void CodeGen_GenerateExpression(CodeGenContext ctx, const ASTNode *node);
-
-static void CodeGen_GenerateStatement(CodeGenContext ctx, const ASTNode *node, int indent_level);
+static void CodeGen_GenerateStatement(CodeGenContext ctx, ASTNodeId node_id, int indent_level);
 
 static void CodeGen_EmitIndent(const CodeGenContext ctx, const int indent_level) {
     for (int i = 0; i < indent_level; i++) {
@@ -50,7 +52,12 @@ static void CodeGen_GenerateLiteral(const CodeGenContext ctx, const ASTNode *nod
 
     switch (node->literal.type) {
         case VALUE_I64:
-            CodeGen_EmitFormat(ctx, "%lldL", node->literal.i64);
+            // -9223372036854775808L is the negation of a constant that does not fit in long long
+            if (node->literal.i64 == INT64_MIN) {
+                CodeGen_Emit(ctx, "(-9223372036854775807L - 1)");
+            } else {
+                CodeGen_EmitFormat(ctx, "%lldL", node->literal.i64);
+            }
             break;
         case VALUE_F64:
             if (node->literal.f64 != node->literal.f64) {
@@ -60,7 +67,14 @@ static void CodeGen_GenerateLiteral(const CodeGenContext ctx, const ASTNode *nod
             } else if (node->literal.f64 == -1.0 / 0.0) {
                 CodeGen_Emit(ctx, "-INFINITY");
             } else {
-                CodeGen_EmitFormat(ctx, "%.17g", node->literal.f64);
+                // "%.17g" keeps every bit of the value but prints whole numbers without a point, which C would
+                // read as an integer
+                char text[32];
+                snprintf(text, sizeof(text), "%.17g", node->literal.f64);
+                CodeGen_Emit(ctx, text);
+                if (strpbrk(text, ".e") == NULL) {
+                    CodeGen_Emit(ctx, ".0");
+                }
             }
             break;
         case VALUE_STR:
@@ -105,122 +119,66 @@ static bool need_to_wrap_node(const ASTNode *node) {
     }
 }
 
-static void CodeGen_GenerateWrappedExpression(const CodeGenContext ctx, const ASTNode *node) {
-    const bool is_need_to_wrap = need_to_wrap_node(node);
-    if (is_need_to_wrap) CodeGen_Emit(ctx, "(");
-    CodeGen_GenerateExpression(ctx, node);
-    if (is_need_to_wrap) CodeGen_Emit(ctx, ")");
-}
-
-static void CodeGen_GenerateBinaryOp(const CodeGenContext ctx, const ASTNode *node) {
-    DEBUG_ASSERT(node->type == AST_BINARY);
-
-    const char *op_str = NULL;
-    switch (node->binary_op.op) {
+// C spelling of an infix operator, NULL for pow and for the operators C has no counterpart for
+attribute_const
+static const char *CodeGen_BinaryOperator(const ASTBinaryType op) {
+    switch (op) {
         case AST_BINARY_ADD:
-            op_str = "+";
-            break;
+            return "+";
         case AST_BINARY_SUB:
-            op_str = "-";
-            break;
+            return "-";
         case AST_BINARY_MUL:
-            op_str = "*";
-            break;
+            return "*";
         case AST_BINARY_DIV:
-            op_str = "/";
-            break;
+        case AST_BINARY_INT_DIV:
+            return "/";
         case AST_BINARY_ASSIGN:
-            op_str = "=";
-            break;
+            return "=";
         case AST_BINARY_MOD:
-            op_str = "%";
-            break;
-        case AST_BINARY_POW:
-            CodeGen_Emit(ctx, "pow(");
-            CodeGen_GenerateExpression(ctx, (const ASTNode *) node->binary_op.left);
-            CodeGen_Emit(ctx, ", ");
-            CodeGen_GenerateExpression(ctx, (const ASTNode *) node->binary_op.right);
-            CodeGen_Emit(ctx, ")");
-            return;
+            return "%";
         case AST_BINARY_EQUALS:
-            op_str = "==";
-            break;
+            return "==";
         case AST_BINARY_NOT_EQUALS:
-            op_str = "!=";
-            break;
+            return "!=";
         case AST_BINARY_LESS_THAN:
-            op_str = "<";
-            break;
+            return "<";
         case AST_BINARY_LESS_THAN_OR_EQUALS:
-            op_str = "<=";
-            break;
+            return "<=";
         case AST_BINARY_GREATER_THAN:
-            op_str = ">";
-            break;
+            return ">";
         case AST_BINARY_GREATER_THAN_OR_EQUALS:
-            op_str = ">=";
-            break;
+            return ">=";
         case AST_BINARY_LOGICAL_AND:
-            op_str = "&&";
-            break;
+            return "&&";
         case AST_BINARY_BITWISE_AND:
-            op_str = "&";
-            break;
+            return "&";
         case AST_BINARY_LOGICAL_OR:
-            op_str = "||";
-            break;
+            return "||";
         case AST_BINARY_BITWISE_OR:
-            op_str = "|";
-            break;
+            return "|";
         default:
-            CodeGen_EmitFormat(ctx, "/* unknown binary op '%s' */", ASTBinaryType_String(node->binary_op.op));
-            return;
+            return NULL;
     }
-
-    const ASTNode *left = (const ASTNode *) node->binary_op.left;
-    const ASTNode *right = (const ASTNode *) node->binary_op.right;
-
-    CodeGen_Emit(ctx, "(");
-    CodeGen_GenerateWrappedExpression(ctx, left);
-    CodeGen_EmitFormat(ctx, " %s ", op_str);
-    CodeGen_GenerateWrappedExpression(ctx, right);
-    CodeGen_Emit(ctx, ")");
 }
 
-static void CodeGen_GenerateUnaryOp(const CodeGenContext ctx, const ASTNode *node) {
-    DEBUG_ASSERT(node->type == AST_UNARY);
-
-    const char *op_str = NULL;
-    switch (node->unary_op.op) {
+attribute_const
+static const char *CodeGen_UnaryOperator(const ASTUnaryType op) {
+    switch (op) {
         case AST_UNARY_PLUS:
-            op_str = "+";
-            break;
+            return "+";
         case AST_UNARY_MINUS:
-            op_str = "-";
-            break;
+            return "-";
         case AST_UNARY_LOGICAL_NOT:
-            op_str = "!";
-            break;
+            return "!";
         case AST_UNARY_BITWISE_NOT:
-            op_str = "~";
-            break;
+            return "~";
         case AST_UNARY_INCREMENT:
-            op_str = "++";
-            break;
+            return "++";
         case AST_UNARY_DECREMENT:
-            op_str = "--";
-            break;
+            return "--";
         default:
-            CodeGen_EmitFormat(ctx, "/* unknown unary op '%s' */", ASTUnaryType_String(node->unary_op.op));
-            return;
+            return NULL;
     }
-
-    //  (<op>(<expr>))
-    const bool is_need_to_wrap = need_to_wrap_node(node);
-    if (is_need_to_wrap) CodeGen_Emit(ctx, "(");
-    CodeGen_Emit(ctx, op_str);
-    CodeGen_GenerateWrappedExpression(ctx, (const ASTNode *) node->unary_op.operand);
-    if (is_need_to_wrap) CodeGen_Emit(ctx, ")");
 }
 
 static const char *CodeGen_CTypeString(const VValueType type) {
@@ -238,42 +196,24 @@ static const char *CodeGen_CTypeString(const VValueType type) {
     }
 }
 
-static void CodeGen_GenerateTypeCast(const CodeGenContext ctx, const ASTNode *node) {
-    DEBUG_ASSERT(node->type == AST_TYPE_CAST);
-
-    //  ((<target>)(<expr>))
-    CodeGen_EmitFormat(ctx, "((%s)(", CodeGen_CTypeString(node->type_cast.target_type));
-    CodeGen_GenerateExpression(ctx, (ASTNode *) node->type_cast.expression);
-    CodeGen_Emit(ctx, "))");
+// `//` of floats rounds down and yields an integer, of integers it is the C division
+static bool CodeGen_IsFloorDivision(const CodeGenContext ctx, const ASTNode *node) {
+    return node->type == AST_BINARY && node->binary_op.op == AST_BINARY_INT_DIV
+           && AST_NODE(ctx.module, node->binary_op.left)->expr_type == VALUE_F64;
 }
 
-static void CodeGen_GenerateTernary(const CodeGenContext ctx, const ASTNode *node) {
-    DEBUG_ASSERT(node->type == AST_TERNARY);
+/*
+ * Expressions are emitted by the visitor, every node writes its opening part on enter, its separators
+ * between the children and its closing part on leave:
+ *   binary   (<l> <op> <r>), pow(<l>, <r>)       unary    (<op><x>)
+ *   ternary  ((<c>) ? (<t>) : (<e>))              cast     ((<target>)(<x>))
+ *   call     <name>(<args>, ...)                 floor division ((long long) floor((<l> / <r>)))
+ * Operands of binary and unary operators are additionally wrapped when need_to_wrap_node asks for it
+ */
+static errno_t CodeGen_ExpressionEnter(ASTVisitor *visitor, ASTNodeId *slot, bool *skip_children) {
+    const CodeGenContext ctx = *(const CodeGenContext *) visitor->context;
+    const ASTNode *node = AST_NODE(ctx.module, *slot);
 
-    // ((<condition>) ? (<then>) : (<else>))
-    CodeGen_Emit(ctx, "((");
-    CodeGen_GenerateExpression(ctx, (const ASTNode *) node->ternary_op.condition);
-    CodeGen_Emit(ctx, ") ? (");
-    CodeGen_GenerateExpression(ctx, (const ASTNode *) node->ternary_op.then_expression);
-    CodeGen_Emit(ctx, ") : (");
-    CodeGen_GenerateExpression(ctx, (const ASTNode *) node->ternary_op.else_expression);
-    CodeGen_Emit(ctx, "))");
-}
-
-static void CodeGen_GenerateFunctionCall(const CodeGenContext ctx, const ASTNode *node) {
-    CodeGen_EmitGlobalName(ctx, node->function_call.signature->function_name);
-    CodeGen_EmitSymbol(ctx, '(');
-    const ASTNode *argument = (const ASTNode *) node->function_call.arguments;
-    for (const ASTNode *current = argument; current != NULL; current = (const ASTNode *) current->next_node) {
-        CodeGen_GenerateExpression(ctx, current);
-        if (current->next_node != NULL) {
-            CodeGen_Emit(ctx, ", ");
-        }
-    }
-    CodeGen_EmitSymbol(ctx, ')');
-}
-
-static void CodeGen_GenerateExpression(const CodeGenContext ctx, const ASTNode *node) {
     switch (node->type) {
         case AST_LITERAL:
             CodeGen_GenerateLiteral(ctx, node);
@@ -282,73 +222,179 @@ static void CodeGen_GenerateExpression(const CodeGenContext ctx, const ASTNode *
             CodeGen_EmitFormat(ctx, "%s", node->var_ref.var_name);
             break;
         case AST_TYPE_CAST:
-            CodeGen_GenerateTypeCast(ctx, node);
-            break;
-        case AST_UNARY:
-            CodeGen_GenerateUnaryOp(ctx, node);
+            CodeGen_EmitFormat(ctx, "((%s)(", CodeGen_CTypeString(node->type_cast.target_type));
+            break;
+        case AST_UNARY: {
+            const char *op_str = CodeGen_UnaryOperator(node->unary_op.op);
+            if (op_str == NULL) {
+                CodeGen_EmitFormat(ctx, "/* unknown unary op '%s' */", ASTUnaryType_String(node->unary_op.op));
+                *skip_children = true;
+                break;
+            }
+            if (need_to_wrap_node(node)) CodeGen_Emit(ctx, "(");
+            CodeGen_Emit(ctx, op_str);
             break;
+        }
         case AST_BINARY:
-            CodeGen_GenerateBinaryOp(ctx, node);
+            if (node->binary_op.op == AST_BINARY_POW) {
+                CodeGen_Emit(ctx, "pow(");
+            } else if (CodeGen_IsFloorDivision(ctx, node)) {
+                CodeGen_Emit(ctx, "((long long) floor((");
+            } else if (CodeGen_BinaryOperator(node->binary_op.op) != NULL) {
+                CodeGen_Emit(ctx, "(");
+            } else {
+                CodeGen_EmitFormat(ctx, "/* unknown binary op '%s' */", ASTBinaryType_String(node->binary_op.op));
+                *skip_children = true;
+            }
             break;
         case AST_TERNARY:
-            CodeGen_GenerateTernary(ctx, node);
+            CodeGen_Emit(ctx, "((");
             break;
         case AST_FUNCTION_CALL:
-            CodeGen_GenerateFunctionCall(ctx, node);
+            CodeGen_EmitGlobalName(ctx, node->function_call.signature->function_name);
+            CodeGen_EmitSymbol(ctx, '(');
             break;
         default:
             CodeGen_EmitFormat(ctx, "/* unknown expression, typeof = '%s' */", ASTNodeType_String(node->type));
+            *skip_children = true;
             break;
     }
+    return VISMUT_ERROR_OK;
+}
+
+// Whether the child is an operand that needs its own parentheses
+static bool CodeGen_IsWrappedOperand(const CodeGenContext ctx, const ASTNode *node, const ASTNodeId child) {
+    if (node->type == AST_UNARY || (node->type == AST_BINARY && node->binary_op.op != AST_BINARY_POW)) {
+        return need_to_wrap_node(AST_NODE(ctx.module, child));
+    }
+    return false;
+}
+
+static errno_t CodeGen_ExpressionBeforeChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    const CodeGenContext ctx = *(const CodeGenContext *) visitor->context;
+    const ASTNode *node = AST_NODE(ctx.module, node_id);
+
+    switch (node->type) {
+        case AST_BINARY:
+            if (index == 1) {
+                if (node->binary_op.op == AST_BINARY_POW) {
+                    CodeGen_Emit(ctx, ", ");
+                } else {
+                    CodeGen_EmitFormat(ctx, " %s ", CodeGen_BinaryOperator(node->binary_op.op));
+                }
+            }
+            break;
+        case AST_TERNARY:
+            if (index == 1) {
+                CodeGen_Emit(ctx, ") ? (");
+            } else if (index == 2) {
+                CodeGen_Emit(ctx, ") : (");
+            }
+            break;
+        case AST_FUNCTION_CALL:
+            if (index != 0) {
+                CodeGen_Emit(ctx, ", ");
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (CodeGen_IsWrappedOperand(ctx, node, *ASTNode_ChildSlot(ctx.module, node_id, index))) {
+        CodeGen_Emit(ctx, "(");
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t CodeGen_ExpressionAfterChild(ASTVisitor *visitor, const ASTNodeId node_id, const uint32_t index) {
+    const CodeGenContext ctx = *(const CodeGenContext *) visitor->context;
+    const ASTNode *node = AST_NODE(ctx.module, node_id);
+
+    if (CodeGen_IsWrappedOperand(ctx, node, *ASTNode_ChildSlot(ctx.module, node_id, index))) {
+        CodeGen_Emit(ctx, ")");
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static errno_t CodeGen_ExpressionLeave(ASTVisitor *visitor, ASTNodeId *slot) {
+    const CodeGenContext ctx = *(const CodeGenContext *) visitor->context;
+    const ASTNode *node = AST_NODE(ctx.module, *slot);
+
+    switch (node->type) {
+        case AST_TYPE_CAST:
+        case AST_TERNARY:
+            CodeGen_Emit(ctx, "))");
+            break;
+        case AST_UNARY:
+            if (CodeGen_UnaryOperator(node->unary_op.op) != NULL && need_to_wrap_node(node)) {
+                CodeGen_Emit(ctx, ")");
+            }
+            break;
+        case AST_BINARY:
+            if (CodeGen_IsFloorDivision(ctx, node)) {
+                CodeGen_Emit(ctx, ")))");
+            } else if (node->binary_op.op == AST_BINARY_POW || CodeGen_BinaryOperator(node->binary_op.op) != NULL) {
+                CodeGen_Emit(ctx, ")");
+            }
+            break;
+        case AST_FUNCTION_CALL:
+            CodeGen_EmitSymbol(ctx, ')');
+            break;
+        default:
+            break;
+    }
+    return VISMUT_ERROR_OK;
+}
+
+static void CodeGen_GenerateExpression(const CodeGenContext ctx, const ASTNodeId node_id) {
+    ASTNodeId root = node_id;
+    ASTVisit(ctx.expressions, &root);
 }
 
 static void CodeGen_GenerateVarDeclaration(const CodeGenContext ctx, const ASTNode *node, const int indent_level) {
     DEBUG_ASSERT(node->type == AST_VAR_DECL);
 
     const char *c_var_type = CodeGen_CTypeString(node->var_decl.var_type);
-    const uint8_t *var_name = node->var_decl.var_name;
-    const ASTNode *init_expr = (const ASTNode *) node->var_decl.init_value;
+    const uint8_t *var_name = node->var_decl.symbol->name;
 
     CodeGen_EmitIndent(ctx, indent_level);
-    if (init_expr == NULL) {
+    if (node->var_decl.init_value == AST_NODE_NONE) {
         // <ctype> <var_name>;
         CodeGen_EmitFormat(ctx, "%s %s;\n", c_var_type, var_name);
         return;
     }
 
     CodeGen_EmitFormat(ctx, "%s %s = ", c_var_type, var_name);
-    CodeGen_GenerateExpression(ctx, init_expr);
+    CodeGen_GenerateExpression(ctx, node->var_decl.init_value);
     CodeGen_Emit(ctx, ";\n");
 }
 
 static void CodeGen_GenerateIfStatement(const CodeGenContext ctx, const ASTNode *node, const int indent_level) {
     DEBUG_ASSERT(node->type == AST_IF_STMT);
 
-    const ASTNode *condition = (const ASTNode *) node->if_stmt.condition;
-    const ASTNode *then_block = (const ASTNode *) node->if_stmt.then_block;
-    const ASTNode *else_block = (const ASTNode *) node->if_stmt.else_block;
+    const ASTNode *then_block = AST_NODE(ctx.module, node->if_stmt.then_block);
 
     // if (<condition>)
     CodeGen_EmitIndent(ctx, indent_level);
     CodeGen_Emit(ctx, "if (");
-    CodeGen_GenerateExpression(ctx, condition);
+    CodeGen_GenerateExpression(ctx, node->if_stmt.condition);
     CodeGen_Emit(ctx, ")\n");
     // then block
-    CodeGen_GenerateStatement(ctx, then_block, then_block->type != AST_BLOCK ? indent_level + 1 : indent_level);
+    CodeGen_GenerateStatement(ctx, node->if_stmt.then_block, then_block->type != AST_BLOCK ? indent_level + 1 : indent_level);
     // else block
-    if (else_block == NULL) return;
+    if (node->if_stmt.else_block == AST_NODE_NONE) return;
+    const ASTNode *else_block = AST_NODE(ctx.module, node->if_stmt.else_block);
     CodeGen_EmitLine(ctx, indent_level, "else");
-    CodeGen_GenerateStatement(ctx, else_block, else_block->type != AST_BLOCK ? indent_level + 1 : indent_level);
+    CodeGen_GenerateStatement(ctx, node->if_stmt.else_block, else_block->type != AST_BLOCK ? indent_level + 1 : indent_level);
 }
 
 static void CodeGen_GenerateBlock(const CodeGenContext ctx, const ASTNode *node, const int indent_level) {
     DEBUG_ASSERT(node->type == AST_BLOCK);
 
-    const ASTNode *statement = (const ASTNode *) node->block.statements;
-
     CodeGen_EmitLine(ctx, indent_level, "{");
-    for (const ASTNode *current = statement; current != NULL; current = (const ASTNode *) current->next_node) {
-        CodeGen_GenerateStatement(ctx, current, indent_level + 1);
+    const ASTNodeList statements = node->block.statements;
+    for (uint32_t i = 0; i < statements.count; ++i) {
+        CodeGen_GenerateStatement(ctx, AST_LIST_ITEM(ctx.module, statements, i), indent_level + 1);
     }
     CodeGen_EmitLine(ctx, indent_level, "}");
 }
@@ -356,17 +402,12 @@ static void CodeGen_GenerateBlock(const CodeGenContext ctx, const ASTNode *node,
 static VValueType GetNodeExpressionType(const ASTNode *node) {
     switch (node->type) {
         case AST_LITERAL:
-            return node->literal.type;
         case AST_VAR_REF:
-            return node->var_ref.expr_type;
         case AST_UNARY:
-            return node->unary_op.expr_type;
         case AST_BINARY:
-            return node->binary_op.expr_type;
         case AST_TERNARY:
-            return node->ternary_op.expr_type;
         case AST_FUNCTION_CALL:
-            return node->function_call.expr_type;
+            return node->expr_type;
         default:
             return VALUE_UNKNOWN;
     }
@@ -392,9 +433,6 @@ static void CodeGen_GenerateLiteralForPrintf(const CodeGenContext ctx, const AST
         case VALUE_I64:
             fprintf(ctx.output, "%lld", node->literal.i64);
             break;
-        case VALUE_F64:
-            fprintf(ctx.output, "%.17g", node->literal.f64);
-            break;
         case VALUE_STR: {
             const uint8_t *ptr = node->literal.str;
             const uint8_t *end_ptr = ptr + strlen((const char *) ptr);
@@ -436,16 +474,23 @@ static void CodeGen_GenerateLiteralForPrintf(const CodeGenContext ctx, const AST
     }
 }
 
+// f64 literals are passed to printf as arguments rather than written into the format: "%f" rounds them to six
+// digits the same way as computed values, while the argument keeps the full precision of the literal
+static bool CodeGen_IsInlinedInPrintf(const ASTNode *node) {
+    return node->type == AST_LITERAL && node->literal.type != VALUE_F64;
+}
+
 static void CodeGen_GeneratePrintStatement(const CodeGenContext ctx, const ASTNode *node, const int indent_level) {
     DEBUG_ASSERT(node->type == AST_PRINT_STMT);
 
     CodeGen_EmitIndent(ctx, indent_level);
-    const ASTNode *expressions = (const ASTNode *) node->print_stmt.expressions;
+    const ASTNodeList expressions = node->print_stmt.expressions;
 
     CodeGen_Emit(ctx, "printf(\"");
 
-    for (const ASTNode *current = expressions; current != NULL; current = (const ASTNode *) current->next_node) {
-        if (current->type == AST_LITERAL) {
+    for (uint32_t i = 0; i < expressions.count; ++i) {
+        const ASTNode *current = AST_NODE(ctx.module, AST_LIST_ITEM(ctx.module, expressions, i));
+        if (CodeGen_IsInlinedInPrintf(current)) {
             CodeGen_GenerateLiteralForPrintf(ctx, current);
         } else {
             CodeGen_Emit(ctx, GetNodePrintfFormat(current));
@@ -453,8 +498,9 @@ static void CodeGen_GeneratePrintStatement(const CodeGenContext ctx, const ASTNo
     }
     CodeGen_EmitSymbol(ctx, '\"');
 
-    for (const ASTNode *current = expressions; current != NULL; current = (const ASTNode *) current->next_node) {
-        if (current->type != AST_LITERAL) {
+    for (uint32_t i = 0; i < expressions.count; ++i) {
+        const ASTNodeId current = AST_LIST_ITEM(ctx.module, expressions, i);
+        if (!CodeGen_IsInlinedInPrintf(AST_NODE(ctx.module, current))) {
             CodeGen_Emit(ctx, ", ");
             CodeGen_GenerateExpression(ctx, current);
         }
@@ -463,19 +509,49 @@ static void CodeGen_GeneratePrintStatement(const CodeGenContext ctx, const ASTNo
     CodeGen_Emit(ctx, ");\n");
 }
 
-static void CodeGen_GenerateWhileStatement(const CodeGenContext ctx, const ASTNode *node, const int indent_level) {
+// Tells the C compiler the range of the guard variable inside the loop body, which lets it drop overflow and
+// sign checks when it vectorizes the loop. Nothing is written when the range is unknown
+static bool CodeGen_GenerateLoopAssumption(const CodeGenContext ctx, const ASTNodeId node_id, const ASTNode *node,
+                                           const int indent_level) {
+    const ASTNodeId guard = ASTNode_GuardVariable(ctx.module, node->while_stmt.condition);
+    const ASTRange range = ASTNode_Range(ctx.module, node_id);
+    if (guard == AST_NODE_NONE || ASTRange_IsFull(range) || ASTRange_IsEmpty(range)) {
+        return false;
+    }
+
+    const uint8_t *name = AST_NODE(ctx.module, guard)->var_ref.var_name;
+    CodeGen_EmitLine(ctx, indent_level, "{");
+    CodeGen_EmitIndent(ctx, indent_level + 1);
+    CodeGen_Emit(ctx, "_VISMUT_ASSUME(");
+    if (range.min != INT64_MIN) {
+        CodeGen_EmitFormat(ctx, "%s >= %lldL", name, range.min);
+    }
+    if (range.max != INT64_MAX) {
+        CodeGen_EmitFormat(ctx, "%s%s <= %lldL", range.min != INT64_MIN ? " && " : "", name, range.max);
+    }
+    CodeGen_Emit(ctx, ");\n");
+    return true;
+}
+
+static void CodeGen_GenerateWhileStatement(const CodeGenContext ctx, const ASTNodeId node_id, const ASTNode *node,
+                                           const int indent_level) {
     DEBUG_ASSERT(node->type == AST_WHILE_STMT);
 
-    const ASTNode *condition = (const ASTNode *) node->while_stmt.condition;
-    const ASTNode *body = (const ASTNode *) node->while_stmt.body;
+    const ASTNode *body = AST_NODE(ctx.module, node->while_stmt.body);
     CodeGen_EmitIndent(ctx, indent_level);
     CodeGen_Emit(ctx, "while (");
-    CodeGen_GenerateExpression(ctx, condition);
+    CodeGen_GenerateExpression(ctx, node->while_stmt.condition);
     CodeGen_Emit(ctx, ")\n");
-    CodeGen_GenerateStatement(ctx, body, body->type != AST_BLOCK ? indent_level + 1 : indent_level);
+    if (CodeGen_GenerateLoopAssumption(ctx, node_id, node, indent_level)) {
+        CodeGen_GenerateStatement(ctx, node->while_stmt.body, indent_level + 1);
+        CodeGen_EmitLine(ctx, indent_level, "}");
+        return;
+    }
+    CodeGen_GenerateStatement(ctx, node->while_stmt.body, body->type != AST_BLOCK ? indent_level + 1 : indent_level);
 }
 
-static void CodeGen_GenerateStatement(const CodeGenContext ctx, const ASTNode *node, const int indent_level) {
+static void CodeGen_GenerateStatement(const CodeGenContext ctx, const ASTNodeId node_id, const int indent_level) {
+    const ASTNode *node = AST_NODE(ctx.module, node_id);
     switch (node->type) {
         case AST_VAR_DECL:
             CodeGen_GenerateVarDeclaration(ctx, node, indent_level);
@@ -484,7 +560,7 @@ static void CodeGen_GenerateStatement(const CodeGenContext ctx, const ASTNode *n
             CodeGen_GenerateIfStatement(ctx, node, indent_level);
             break;
         case AST_WHILE_STMT:
-            CodeGen_GenerateWhileStatement(ctx, node, indent_level);
+            CodeGen_GenerateWhileStatement(ctx, node_id, node, indent_level);
             break;
         case AST_BLOCK:
             CodeGen_GenerateBlock(ctx, node, indent_level);
@@ -494,7 +570,7 @@ static void CodeGen_GenerateStatement(const CodeGenContext ctx, const ASTNode *n
             break;
         default:
             CodeGen_EmitIndent(ctx, indent_level);
-            CodeGen_GenerateExpression(ctx, node);
+            CodeGen_GenerateExpression(ctx, node_id);
             CodeGen_Emit(ctx, ";\n");
             break;
     }
@@ -508,6 +584,13 @@ static void CodeGen_GeneratePrelude(const CodeGenContext ctx) {
     CodeGen_EmitLine(ctx, 1, "#include <Windows.h>");
     CodeGen_EmitLine(ctx, 1, "#define _VISMUT_ENABLE_UTF_WIN32");
     CodeGen_EmitLine(ctx, 0, "#endif");
+    CodeGen_EmitLine(ctx, 0, "#if defined(__GNUC__) || defined(__clang__)");
+    CodeGen_EmitLine(ctx, 1, "#define _VISMUT_ASSUME(condition) do { if (!(condition)) __builtin_unreachable(); } while (0)");
+    CodeGen_EmitLine(ctx, 0, "#elif defined(_MSC_VER)");
+    CodeGen_EmitLine(ctx, 1, "#define _VISMUT_ASSUME(condition) __assume(condition)");
+    CodeGen_EmitLine(ctx, 0, "#else");
+    CodeGen_EmitLine(ctx, 1, "#define _VISMUT_ASSUME(condition) ((void) 0)");
+    CodeGen_EmitLine(ctx, 0, "#endif");
     CodeGen_Emit(ctx, "\n");
 }
 
@@ -529,35 +612,36 @@ static void CodeGen_GenerateSignature(const CodeGenContext ctx, const FunctionSi
     CodeGen_Emit(ctx, ")");
 }
 
-static void CodeGen_GenerateModuleFunctionsSignatures(const CodeGenContext ctx, const ASTNode *functions) {
-    for (const ASTNode *current = functions; current != NULL; current = (const ASTNode *) current->next_node) {
-        CodeGen_GenerateSignature(ctx, current->function_decl.signature);
+static void CodeGen_GenerateModuleFunctionsSignatures(const CodeGenContext ctx, const ASTNodeList functions) {
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        CodeGen_GenerateSignature(ctx, AST_NODE(ctx.module, AST_LIST_ITEM(ctx.module, functions, i))->function_decl.signature);
         CodeGen_Emit(ctx, ";\n\n");
     }
 
     CodeGen_Emit(ctx, "\n");
 }
 
-static void CodeGen_GenerateModuleFunctionsDeclarations(const CodeGenContext ctx, const ASTNode *functions) {
-    for (const ASTNode *current = functions; current != NULL; current = (const ASTNode *) current->next_node) {
+static void CodeGen_GenerateModuleFunctionsDeclarations(const CodeGenContext ctx, const ASTNodeList functions) {
+    for (uint32_t i = 0; i < functions.count; ++i) {
+        const ASTNode *current = AST_NODE(ctx.module, AST_LIST_ITEM(ctx.module, functions, i));
         CodeGen_GenerateSignature(ctx, current->function_decl.signature);
-        if (((const ASTNode *) current->function_decl.body)->type != AST_BLOCK) {
+        if (AST_NODE(ctx.module, current->function_decl.body)->type != AST_BLOCK) {
             CodeGen_Emit(ctx, " {\n");
             CodeGen_EmitIndent(ctx, 1);
             CodeGen_Emit(ctx, "return ");
-            CodeGen_GenerateExpression(ctx, (const ASTNode *) current->function_decl.body);
+            CodeGen_GenerateExpression(ctx, current->function_decl.body);
             CodeGen_Emit(ctx, ";\n}\n\n");
             continue;
         }
         CodeGen_EmitSymbol(ctx, '\n');
-        CodeGen_GenerateBlock(ctx, (const ASTNode *) current->function_decl.body, 0);
+        CodeGen_GenerateBlock(ctx, AST_NODE(ctx.module, current->function_decl.body), 0);
         CodeGen_EmitSymbol(ctx, '\n');
     }
 
     CodeGen_Emit(ctx, "\n");
 }
 
-static void CodeGen_GenerateMain(const CodeGenContext ctx, const ASTNode *statement) {
+static void CodeGen_GenerateMain(const CodeGenContext ctx, const ASTNodeList statements) {
     CodeGen_EmitLine(ctx, 0, "int main(int argc, const char **argv) {");
     CodeGen_EmitLine(ctx, 0, "#ifdef _VISMUT_ENABLE_UTF_WIN32");
     CodeGen_EmitLine(ctx, 1, "SetConsoleOutputCP(CP_UTF8);");
@@ -565,8 +649,8 @@ static void CodeGen_GenerateMain(const CodeGenContext ctx, const ASTNode *statem
     CodeGen_EmitLine(ctx, 0, "#endif");
     CodeGen_EmitLine(ctx, 1, "");
 
-    for (const ASTNode *current = statement; current != NULL; current = (const ASTNode *) current->next_node) {
-        CodeGen_GenerateStatement(ctx, current, 1);
+    for (uint32_t i = 0; i < statements.count; ++i) {
+        CodeGen_GenerateStatement(ctx, AST_LIST_ITEM(ctx.module, statements, i), 1);
     }
 
     CodeGen_EmitLine(ctx, 1, "");
@@ -574,11 +658,20 @@ static void CodeGen_GenerateMain(const CodeGenContext ctx, const ASTNode *statem
     CodeGen_EmitLine(ctx, 0, "}\n");
 }
 
-void CodeGen_GenerateFromAST(const CodeGenContext ctx, const ASTNode *module) {
+void CodeGen_GenerateFromAST(CodeGenContext ctx) {
+    const ASTNode *module = AST_NODE(ctx.module, ctx.module->root);
     DEBUG_ASSERT(module->type == AST_MODULE);
 
+    ASTVisitor expressions;
+    ASTVisitor_Init(&expressions, ctx.module, &ctx);
+    expressions.enter = CodeGen_ExpressionEnter;
+    expressions.before_child = CodeGen_ExpressionBeforeChild;
+    expressions.after_child = CodeGen_ExpressionAfterChild;
+    expressions.leave = CodeGen_ExpressionLeave;
+    ctx.expressions = &expressions;
+
     CodeGen_GeneratePrelude(ctx);
-    CodeGen_GenerateModuleFunctionsSignatures(ctx, (const ASTNode *) module->module.functions);
-    CodeGen_GenerateMain(ctx, (const ASTNode *) module->module.statements);
-    CodeGen_GenerateModuleFunctionsDeclarations(ctx, (const ASTNode *) module->module.functions);
+    CodeGen_GenerateModuleFunctionsSignatures(ctx, module->module.functions);
+    CodeGen_GenerateMain(ctx, module->module.statements);
+    CodeGen_GenerateModuleFunctionsDeclarations(ctx, module->module.functions);
 }
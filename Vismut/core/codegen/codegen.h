@@ -7,15 +7,18 @@
 #include <stdio.h>
 #include "../memory/arena.h"
 #include "../ast/ast.h"
+#include "../ast/ast_visit.h"
 
 typedef struct {
     FILE *output;
+    const ASTModule *module;
     const uint8_t *module_name;
+    ASTVisitor *expressions; // emits expressions without recursion, set up by CodeGen_GenerateFromAST
 } CodeGenContext;
 
 attribute_pure
-CodeGenContext CodeGen_CreateContext(FILE *output, const uint8_t *module_name);
+CodeGenContext CodeGen_CreateContext(FILE *output, const ASTModule *module);
 
-void CodeGen_GenerateFromAST(CodeGenContext ctx, const ASTNode *module);
+void CodeGen_GenerateFromAST(CodeGenContext ctx);
 
 #endif //VISMUT_CODEGEN_H
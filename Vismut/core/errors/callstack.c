@@ -4,10 +4,11 @@
 #include <string.h>
 
 
-#if DEBUG
-static CallStackEntry callstack[CALLSTACK_MAX_DEPTH];
-static int callstack_depth = 0;
-static int callstack_initialized = 0;
+#if CALLSTACK_ENABLED
+// Every thread traces its own calls
+static _Thread_local CallStackEntry callstack[CALLSTACK_MAX_DEPTH];
+static _Thread_local int callstack_depth = 0;
+static _Thread_local int callstack_initialized = 0;
 
 void CallStack_Init(void) {
     if (callstack_initialized) return;
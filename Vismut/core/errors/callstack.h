@@ -7,7 +7,12 @@
 #include "../debug.h"
 #include <stdint.h>
 
-#if DEBUG
+// Calls are traced in debug builds, a target may still turn tracing off with -DCALLSTACK_ENABLED=0
+#ifndef CALLSTACK_ENABLED
+#define CALLSTACK_ENABLED DEBUG
+#endif
+
+#if CALLSTACK_ENABLED
 #define CALLSTACK_MAX_DEPTH 1024
 
 typedef struct {
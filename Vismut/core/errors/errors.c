@@ -56,6 +56,14 @@ const char *GetVismutErrorString(const VismutError err) {
             return "Invalid arguments count passed to function call";
         case VISMUT_ERROR_INVALID_ARGUMENT_TYPE:
             return "VISMUT_ERROR_INVALID_ARGUMENT_TYPE";
+        case VISMUT_ERROR_CANNOT_INFER_RETURN_TYPE:
+            return "Cannot infer return type of recursive function, try add return type annotation.";
+        case VISMUT_ERROR_CACHE_STALE:
+            return "AST cache is damaged or does not match the source and compiler version";
+        case VISMUT_ERROR_THREAD:
+            return "Cannot start a thread";
+        case VISMUT_ERROR_NESTING_TOO_DEEP:
+            return "Code is nested too deeply";
         case VISMUT_ERROR_COUNT:
         default:
             return "Unknown error";
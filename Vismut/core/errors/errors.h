@@ -33,6 +33,10 @@ typedef enum {
     VISMUT_ERROR_INVALID_ARGUMENTS_COUNT,
     VISMUT_ERROR_INVALID_ARGUMENT_TYPE,
     VISMUT_ERROR_UNKNOWN_TYPE,
+    VISMUT_ERROR_CANNOT_INFER_RETURN_TYPE,
+    VISMUT_ERROR_CACHE_STALE,
+    VISMUT_ERROR_THREAD,
+    VISMUT_ERROR_NESTING_TOO_DEEP,
     VISMUT_ERROR_COUNT
 } VismutError;
 
@@ -90,9 +90,14 @@ void *Arena_AllocateAligned(Arena *arena, const size_t size, const size_t align)
     size_t offset = ALIGN_FORWARD(block->used, align);
 
     if (offset + size > block->size) {
-        ArenaBlock *new_block = ArenaBlock_Create(arena->block_size);
-        new_block->next = block;
+        // Oversized requests (node pages, big arrays) get a dedicated block
+        const size_t block_size = size > arena->block_size
+                                      ? ALIGN_FORWARD(size, (size_t) ARENA_ALIGNMENT)
+                                      : arena->block_size;
+        ArenaBlock *new_block = ArenaBlock_Create(block_size);
+        block->next = new_block;
         arena->current = new_block;
+        block = new_block;
         offset = 0;
     }
 
@@ -101,3 +106,22 @@ void *Arena_AllocateAligned(Arena *arena, const size_t size, const size_t align)
 
     return ptr;
 }
+
+void Arena_Adopt(Arena *arena, Arena *other) {
+    DEBUG_ASSERT(arena != NULL && other != NULL && arena != other);
+
+    // The current block is always the last one, allocation goes on in the last adopted block
+    arena->current->next = other->first;
+    arena->current = other->current;
+    free(other);
+}
+
+size_t Arena_BytesUsed(const Arena *arena) {
+    DEBUG_ASSERT(arena != NULL);
+
+    size_t used = 0;
+    for (const ArenaBlock *block = arena->first; block != NULL; block = block->next) {
+        used += block->used;
+    }
+    return used;
+}
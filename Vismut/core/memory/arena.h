@@ -31,6 +31,12 @@ void Arena_Destroy(Arena *);
 
 void *Arena_AllocateAligned(Arena *arena, size_t size, size_t align);
 
+// Moves the blocks of other into arena and frees other: its allocations stay valid until arena is destroyed
+void Arena_Adopt(Arena *arena, Arena *other);
+
+// Bytes handed out by the arena so far, alignment padding included
+size_t Arena_BytesUsed(const Arena *arena);
+
 #define Arena_Type(arena, type) Arena_AllocateAligned(arena, sizeof(type), __alignof(type))
 #define Arena_Array(arena, type, count) Arena_AllocateAligned(arena, sizeof(type) * (count), __alignof(type))
 
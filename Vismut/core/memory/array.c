@@ -0,0 +1,23 @@
+#include "array.h"
+
+#include <stdlib.h>
+
+#include "../errors/errors.h"
+
+#define ARRAY_INITIAL_CAPACITY 16
+
+void *Array_Grow(void *items, uint32_t *capacity, const uint32_t needed, const size_t item_size) {
+    if (needed <= *capacity && items != NULL) {
+        return items;
+    }
+    uint32_t new_capacity = *capacity == 0 ? ARRAY_INITIAL_CAPACITY : *capacity * 2;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    items = realloc(items, item_size * new_capacity);
+    if (items == NULL) {
+        exit(VISMUT_ERROR_ALLOC);
+    }
+    *capacity = new_capacity;
+    return items;
+}
@@ -0,0 +1,14 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_ARRAY_H
+#define VISMUT_ARRAY_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Makes room for `needed` items in a heap array, doubling its capacity, and returns the array. It is allocated
+// even when nothing is needed yet, so that empty arrays never go through NULL. Exits when memory runs out
+void *Array_Grow(void *items, uint32_t *capacity, uint32_t needed, size_t item_size);
+
+#endif //VISMUT_ARRAY_H
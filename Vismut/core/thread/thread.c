@@ -0,0 +1,74 @@
+#include "thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "../errors/errors.h"
+
+#ifdef _WIN32
+
+static DWORD WINAPI Thread_Main(LPVOID parameter) {
+    Thread *thread = parameter;
+    thread->result = thread->start(thread->argument);
+    return 0;
+}
+
+errno_t Thread_Start(Thread *thread, const ThreadStart start, void *argument) {
+    thread->start = start;
+    thread->argument = argument;
+    thread->result = VISMUT_ERROR_OK;
+    thread->handle = CreateThread(NULL, 0, Thread_Main, thread, 0, NULL);
+    return thread->handle != NULL ? VISMUT_ERROR_OK : VISMUT_ERROR_THREAD;
+}
+
+errno_t Thread_Join(Thread *thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = NULL;
+    return thread->result;
+}
+
+void Thread_Yield(void) {
+    SwitchToThread();
+}
+
+uint32_t Thread_HardwareConcurrency(void) {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return system_info.dwNumberOfProcessors != 0 ? (uint32_t) system_info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+static void *Thread_Main(void *parameter) {
+    Thread *thread = parameter;
+    thread->result = thread->start(thread->argument);
+    return NULL;
+}
+
+errno_t Thread_Start(Thread *thread, const ThreadStart start, void *argument) {
+    thread->start = start;
+    thread->argument = argument;
+    thread->result = VISMUT_ERROR_OK;
+    return pthread_create(&thread->handle, NULL, Thread_Main, thread) == 0 ? VISMUT_ERROR_OK : VISMUT_ERROR_THREAD;
+}
+
+errno_t Thread_Join(Thread *thread) {
+    pthread_join(thread->handle, NULL);
+    return thread->result;
+}
+
+void Thread_Yield(void) {
+    sched_yield();
+}
+
+uint32_t Thread_HardwareConcurrency(void) {
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t) count : 1;
+}
+
+#endif
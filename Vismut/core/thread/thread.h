@@ -0,0 +1,38 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_THREAD_H
+#define VISMUT_THREAD_H
+#include "../types.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+typedef errno_t (*ThreadStart)(void *argument);
+
+// The running thread refers to this struct, it must stay in place until Thread_Join
+typedef struct {
+#ifdef _WIN32
+    void *handle;
+#else
+    pthread_t handle;
+#endif
+    ThreadStart start;
+    void *argument;
+    errno_t result;
+} Thread;
+
+errno_t Thread_Start(Thread *thread, ThreadStart start, void *argument);
+
+// Waits for the thread and returns what its start function returned
+errno_t Thread_Join(Thread *thread);
+
+// Gives the rest of the time slice to another thread
+void Thread_Yield(void);
+
+// Number of hardware threads, at least 1
+uint32_t Thread_HardwareConcurrency(void);
+
+#endif //VISMUT_THREAD_H
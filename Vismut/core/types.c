@@ -1,5 +1,5 @@
 #include "types.h"
-#define ELEMENT_VALUE_FOR_MAP_ARRAY_INIT(name, text) [name] = (text),
+#define ELEMENT_VALUE_FOR_MAP_ARRAY_INIT(name, text, ...) [name] = (text),
 
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
@@ -65,7 +65,7 @@
 #endif
 
 typedef enum {
-#define X(name, _) name,
+#define X(name, ...) name,
     TOKENS_MAP(X)
 #undef X
     TOKEN_COUNT
@@ -122,6 +122,9 @@ typedef struct {
     size_t length;
 } Position;
 
+// Index of a node in the node storage of its module, 0 is reserved for "no node"
+typedef uint32_t ASTNodeId;
+
 #define Position_Join(from, to) (Position){(from).offset, (to).offset + (to).length - (from).offset}
 
 #define RISKY_EXPRESSION_SAFE(expression, err_var) \
@@ -5,62 +5,64 @@
 #ifndef VISMUT_TYPES_MAPS_H
 #define VISMUT_TYPES_MAPS_H
 
-#define TOKENS_MAP(X)   \
-    X(TOKEN_EOF, "<eof>") \
-    X(TOKEN_I64_TYPE, "i64") \
-    X(TOKEN_FLOAT_TYPE, "f64") \
-    X(TOKEN_STRING_TYPE, "string") \
-    X(TOKEN_IDENTIFIER, "<identifier>") \
-    X(TOKEN_NAME_DECLARATION, "$") \
-    X(TOKEN_CONDITION_STATEMENT, "#") \
-    X(TOKEN_CONDITION_ELSE_IF, "!#") \
-    X(TOKEN_EXCLAMATION_MARK, "!") \
-    X(TOKEN_QUESTION, "?") \
-    X(TOKEN_WHILE_STATEMENT, "@") \
-    X(TOKEN_MODULE_DIV, "%") \
-    X(TOKEN_FOR_STATEMENT, "%%") \
-    X(TOKEN_NAMESPACE_DECLARATION, "<>") \
-    X(TOKEN_STRUCTURE_DECLARATION, "$>") \
-    X(TOKEN_RETURN_STATEMENT, "'") \
-    X(TOKEN_PRINT_STATEMENT, "::") \
-    X(TOKEN_INPUT_STATEMENT, ":>") \
-    X(TOKEN_PLUS, "+") \
-    X(TOKEN_INCREMENT, "++") \
-    X(TOKEN_MINUS, "-") \
-    X(TOKEN_DECREMENT, "--") \
-    X(TOKEN_STAR, "*") \
-    X(TOKEN_POWER, "**") \
-    X(TOKEN_DIVIDE, "/") \
-    X(TOKEN_INT_DIVIDE, "//") \
-    X(TOKEN_ARROW,"->") \
-    X(TOKEN_THEN, "=>") \
-    X(TOKEN_DOT, ".") \
-    X(TOKEN_COMMA, ",") \
-    X(TOKEN_SEMICOLON, ";") \
-    X(TOKEN_COLON, ":") \
-    X(TOKEN_LBRACE,"{") \
-    X(TOKEN_RBRACE, "}") \
-    X(TOKEN_LBRACKET, "[") \
-    X(TOKEN_RBRACKET, "]") \
-    X(TOKEN_LPAREN, "(") \
-    X(TOKEN_RPAREN, ")") \
-    X(TOKEN_LESS_THAN, "<") \
-    X(TOKEN_LESS_THAN_OR_EQUALS, "<=") \
-    X(TOKEN_GREATER_THAN, ">") \
-    X(TOKEN_GREATER_THAN_OR_EQUALS, ">=") \
-    X(TOKEN_ASSIGN, "=") \
-    X(TOKEN_EQUALS, "==") \
-    X(TOKEN_BITWISE_OR, "|") \
-    X(TOKEN_LOGICAL_OR, "||") \
-    X(TOKEN_BITWISE_AND, "&") \
-    X(TOKEN_LOGICAL_AND, "&&") \
-    X(TOKEN_XOR, "^") \
-    X(TOKEN_TILDA, "~") \
-    X(TOKEN_NOT_EQUALS, "!=") \
-    X(TOKEN_INT_LITERAL, "<i64 literal>") \
-    X(TOKEN_FLOAT_LITERAL, "<f64 literal>") \
-    X(TOKEN_CHARS_LITERAL, "<const char*>") \
-    X(TOKEN_UNKNOWN, "<unknown>")
+// Token, its text and the operator columns the parser reads: precedence, binary op, unary op and associativity,
+// given as suffixes of PRECEDENCE_*, AST_BINARY_*, AST_UNARY_* and OPERATOR_ASSOC_*
+#define TOKENS_MAP(X)                                                                                            \
+    X(TOKEN_EOF,                    "<eof>",         NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_I64_TYPE,               "i64",           NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_FLOAT_TYPE,             "f64",           NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_STRING_TYPE,            "string",        NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_IDENTIFIER,             "<identifier>",  NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_NAME_DECLARATION,       "$",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_CONDITION_STATEMENT,    "#",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_CONDITION_ELSE_IF,      "!#",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_EXCLAMATION_MARK,       "!",             NONE,           UNKNOWN,                LOGICAL_NOT, LEFT)  \
+    X(TOKEN_QUESTION,               "?",             TERNARY,        UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_WHILE_STATEMENT,        "@",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_MODULE_DIV,             "%",             NONE,           MOD,                    UNKNOWN,     LEFT)  \
+    X(TOKEN_FOR_STATEMENT,          "%%",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_NAMESPACE_DECLARATION,  "<>",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_STRUCTURE_DECLARATION,  "$>",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_RETURN_STATEMENT,       "'",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_PRINT_STATEMENT,        "::",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_INPUT_STATEMENT,        ":>",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_PLUS,                   "+",             ADDITIVE,       ADD,                    PLUS,        LEFT)  \
+    X(TOKEN_INCREMENT,              "++",            NONE,           UNKNOWN,                INCREMENT,   LEFT)  \
+    X(TOKEN_MINUS,                  "-",             ADDITIVE,       SUB,                    MINUS,       LEFT)  \
+    X(TOKEN_DECREMENT,              "--",            NONE,           UNKNOWN,                DECREMENT,   LEFT)  \
+    X(TOKEN_STAR,                   "*",             MULTIPLICATIVE, MUL,                    UNKNOWN,     LEFT)  \
+    X(TOKEN_POWER,                  "**",            UNARY,          POW,                    UNKNOWN,     RIGHT) \
+    X(TOKEN_DIVIDE,                 "/",             MULTIPLICATIVE, DIV,                    UNKNOWN,     LEFT)  \
+    X(TOKEN_INT_DIVIDE,             "//",            MULTIPLICATIVE, INT_DIV,                UNKNOWN,     LEFT)  \
+    X(TOKEN_ARROW,                  "->",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_THEN,                   "=>",            NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_DOT,                    ".",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_COMMA,                  ",",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_SEMICOLON,              ";",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_COLON,                  ":",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_LBRACE,                 "{",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_RBRACE,                 "}",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_LBRACKET,               "[",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_RBRACKET,               "]",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_LPAREN,                 "(",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_RPAREN,                 ")",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_LESS_THAN,              "<",             RELATIONAL,     LESS_THAN,              UNKNOWN,     LEFT)  \
+    X(TOKEN_LESS_THAN_OR_EQUALS,    "<=",            RELATIONAL,     LESS_THAN_OR_EQUALS,    UNKNOWN,     LEFT)  \
+    X(TOKEN_GREATER_THAN,           ">",             RELATIONAL,     GREATER_THAN,           UNKNOWN,     LEFT)  \
+    X(TOKEN_GREATER_THAN_OR_EQUALS, ">=",            RELATIONAL,     GREATER_THAN_OR_EQUALS, UNKNOWN,     LEFT)  \
+    X(TOKEN_ASSIGN,                 "=",             ASSIGNMENT,     ASSIGN,                 UNKNOWN,     RIGHT) \
+    X(TOKEN_EQUALS,                 "==",            EQUALITY,       EQUALS,                 UNKNOWN,     LEFT)  \
+    X(TOKEN_BITWISE_OR,             "|",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_LOGICAL_OR,             "||",            LOGICAL_OR,     UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_BITWISE_AND,            "&",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_LOGICAL_AND,            "&&",            LOGICAL_AND,    UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_XOR,                    "^",             NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_TILDA,                  "~",             NONE,           UNKNOWN,                BITWISE_NOT, LEFT)  \
+    X(TOKEN_NOT_EQUALS,             "!=",            EQUALITY,       NOT_EQUALS,             UNKNOWN,     LEFT)  \
+    X(TOKEN_INT_LITERAL,            "<i64 literal>", NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_FLOAT_LITERAL,          "<f64 literal>", NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_CHARS_LITERAL,          "<const char*>", NONE,           UNKNOWN,                UNKNOWN,     LEFT)  \
+    X(TOKEN_UNKNOWN,                "<unknown>",     NONE,           UNKNOWN,                UNKNOWN,     LEFT)
 
 #define AST_NODES_MAP(X) \
     X(AST_UNKNOWN, "<unknown>") \
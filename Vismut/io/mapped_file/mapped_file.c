@@ -0,0 +1,97 @@
+#include "mapped_file.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../../core/errors/errors.h"
+
+#ifdef _WIN32
+
+errno_t MappedFile_Open(const char *filename, MappedFile *mapped_file) {
+    *mapped_file = (MappedFile){0};
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return VISMUT_ERROR_IO;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return VISMUT_ERROR_IO;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return VISMUT_ERROR_IO;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return VISMUT_ERROR_IO;
+    }
+
+    mapped_file->data = view;
+    mapped_file->size = (size_t) file_size.QuadPart;
+    mapped_file->file_handle = file;
+    mapped_file->mapping_handle = mapping;
+    return VISMUT_ERROR_OK;
+}
+
+void MappedFile_Close(MappedFile *mapped_file) {
+    if (mapped_file->data != NULL) {
+        UnmapViewOfFile(mapped_file->data);
+        CloseHandle(mapped_file->mapping_handle);
+        CloseHandle(mapped_file->file_handle);
+    }
+    *mapped_file = (MappedFile){0};
+}
+
+#else
+
+errno_t MappedFile_Open(const char *filename, MappedFile *mapped_file) {
+    *mapped_file = (MappedFile){0};
+
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return VISMUT_ERROR_IO;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        return VISMUT_ERROR_IO;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void *view = mmap(NULL, (size_t) file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        return VISMUT_ERROR_IO;
+    }
+
+    mapped_file->data = view;
+    mapped_file->size = (size_t) file_stat.st_size;
+    return VISMUT_ERROR_OK;
+}
+
+void MappedFile_Close(MappedFile *mapped_file) {
+    if (mapped_file->data != NULL) {
+        munmap(mapped_file->data, mapped_file->size);
+    }
+    *mapped_file = (MappedFile){0};
+}
+
+#endif
@@ -0,0 +1,23 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#ifndef VISMUT_MAPPED_FILE_H
+#define VISMUT_MAPPED_FILE_H
+#include "../../core/Vismut.h"
+
+// Private copy-on-write view of a whole file: writes through data never reach the disk
+typedef struct {
+    uint8_t *data;
+    size_t size;
+#ifdef _WIN32
+    void *file_handle;
+    void *mapping_handle;
+#endif
+} MappedFile;
+
+errno_t MappedFile_Open(const char *filename, MappedFile *mapped_file);
+
+void MappedFile_Close(MappedFile *mapped_file);
+
+#endif //VISMUT_MAPPED_FILE_H
@@ -0,0 +1,304 @@
+//
+// Created by kir on 18.10.2026.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "../Vismut/core/Vismut.h"
+#include "../Vismut/core/ast/ast_analyze.h"
+#include "../Vismut/core/ast/ast_optimize.h"
+#include "../Vismut/core/ast/ast_parse.h"
+#include "../Vismut/core/errors/errors.h"
+#include "../Vismut/core/memory/arena.h"
+#include "../Vismut/core/tokenizer/tokenizer.h"
+
+// Front end benchmark: generates programs of one shape each, times parse, type analysis and optimization
+// separately and writes the results to stdout as JSON. Sizes grow linearly with --scale, so comparing two
+// scales shows which phase stopped being linear
+
+// Deepest nesting of the generated code, below the nesting limit of the parser. Deeper shapes repeat the nested
+// part instead, so they stay linear in --scale
+#define BENCH_DEEP_NESTING 256
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} BenchSource;
+
+typedef void (*BenchGenerate)(BenchSource *source, uint32_t size);
+
+typedef struct {
+    const char *name;
+    BenchGenerate generate;
+    uint32_t base_size; // size at --scale 1
+} BenchShape;
+
+typedef struct {
+    uint64_t parse_ns;
+    uint64_t analyze_ns;
+    uint64_t optimize_ns;
+    size_t parse_bytes;
+    size_t analyze_bytes;
+    size_t optimize_bytes;
+    uint32_t nodes_count;
+} BenchResult;
+
+#ifdef _WIN32
+
+static uint64_t Bench_Nanoseconds(void) {
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) ((double) counter.QuadPart * 1e9 / (double) frequency.QuadPart);
+}
+
+#else
+
+static uint64_t Bench_Nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+#endif
+
+static void BenchSource_Append(BenchSource *source, const char *format, ...) {
+    va_list args;
+    for (;;) {
+        const size_t available = source->capacity - source->length;
+        va_start(args, format);
+        const int written = vsnprintf(source->data + source->length, available, format, args);
+        va_end(args);
+        if (written < 0) {
+            exit(VISMUT_ERROR_ALLOC);
+        }
+        if ((size_t) written < available) {
+            source->length += (size_t) written;
+            return;
+        }
+
+        source->capacity = source->capacity * 2 + (size_t) written;
+        source->data = realloc(source->data, source->capacity);
+        if (source->data == NULL) {
+            exit(VISMUT_ERROR_ALLOC);
+        }
+    }
+}
+
+// `size` parentheses in expressions nested BENCH_DEEP_NESTING deep, next to a flat chain of the same length
+static void Bench_DeepExpression(BenchSource *source, const uint32_t size) {
+    static const char *ops[] = {"+", "-", "*"};
+
+    BenchSource_Append(source, "$x = 3\n$deep = 0");
+    for (uint32_t done = 0; done < size; done += BENCH_DEEP_NESTING) {
+        const uint32_t nesting = size - done < BENCH_DEEP_NESTING ? size - done : BENCH_DEEP_NESTING;
+        BenchSource_Append(source, "\ndeep = deep + ");
+        for (uint32_t i = 0; i < nesting; ++i) {
+            BenchSource_Append(source, "(");
+        }
+        BenchSource_Append(source, "x");
+        for (uint32_t i = 0; i < nesting; ++i) {
+            // Every other operand is the variable, so the optimizer cannot fold the whole tree away
+            if (i % 2 == 0) {
+                BenchSource_Append(source, " %s %u)", ops[i % 3], i % 3 == 2 ? 1u : i);
+            } else {
+                BenchSource_Append(source, " %s x)", ops[i % 3]);
+            }
+        }
+    }
+    BenchSource_Append(source, "\n$flat = x");
+    for (uint32_t i = 0; i < size; ++i) {
+        BenchSource_Append(source, " + %u * x", i);
+    }
+    BenchSource_Append(source, "\n:: deep, \" \", flat, \"\\n\"\n");
+}
+
+// A single block with `size` statements, each reading the variable declared before it
+static void Bench_WideBlock(BenchSource *source, const uint32_t size) {
+    BenchSource_Append(source, "$wide(n: i64) {\n    $v0 = n\n");
+    for (uint32_t i = 1; i < size; ++i) {
+        BenchSource_Append(source, "    $v%u = v%u + %u\n", i, i - 1, i);
+    }
+    BenchSource_Append(source, "    :: v%u, \"\\n\"\n}\nwide(1)\n", size - 1);
+}
+
+// `size` small functions, a quarter of them with a block body, all called from the top level
+static void Bench_ManyFunctions(BenchSource *source, const uint32_t size) {
+    for (uint32_t i = 0; i < size; ++i) {
+        if (i % 4 == 3) {
+            BenchSource_Append(source, "$fn%u(n: i64) {\n    $s = n\n    @ s < %u {\n        s = s + 1\n    }\n"
+                               "    :: s, \"\\n\"\n}\n", i, i);
+        } else {
+            BenchSource_Append(source, "$fn%u(a: i64, b: i64) = a * %u + b\n", i, i);
+        }
+    }
+    BenchSource_Append(source, "$total = 0\n");
+    for (uint32_t i = 0; i < size; ++i) {
+        if (i % 4 == 3) {
+            BenchSource_Append(source, "fn%u(%u)\n", i, i);
+        } else {
+            BenchSource_Append(source, "total = total + fn%u(%u, 1)\n", i, i);
+        }
+    }
+    BenchSource_Append(source, ":: total, \"\\n\"\n");
+}
+
+// Each function calls the next one, the return types are inferred all the way down the chain
+static void Bench_CallChain(BenchSource *source, const uint32_t size) {
+    for (uint32_t i = 0; i + 1 < size; ++i) {
+        BenchSource_Append(source, "$chain%u(x: i64) = chain%u(x + 1) + %u\n", i, i + 1, i);
+    }
+    BenchSource_Append(source, "$chain%u(x: i64) = x\n:: chain0(0), \"\\n\"\n", size - 1);
+}
+
+// `size` conditional blocks, each declaring a variable of its own scope, nested BENCH_DEEP_NESTING deep per
+// function
+static void Bench_NestedScopes(BenchSource *source, const uint32_t size) {
+    for (uint32_t done = 0; done < size; done += BENCH_DEEP_NESTING) {
+        const uint32_t nesting = size - done < BENCH_DEEP_NESTING ? size - done : BENCH_DEEP_NESTING;
+        BenchSource_Append(source, "$nest%u(n: i64) {\n$s0 = n\n", done);
+        for (uint32_t i = 1; i < nesting; ++i) {
+            BenchSource_Append(source, "# s%u > 0 {\n$s%u = s%u - 1\n", i - 1, i, i - 1);
+        }
+        BenchSource_Append(source, ":: s%u, \"\\n\"\n", nesting - 1);
+        for (uint32_t i = 1; i < nesting; ++i) {
+            BenchSource_Append(source, "}\n");
+        }
+        BenchSource_Append(source, "}\nnest%u(%u)\n", done, nesting);
+    }
+}
+
+static const BenchShape BENCH_SHAPES[] = {
+    {"deep_expression", Bench_DeepExpression, 256},
+    {"wide_block", Bench_WideBlock, 2000},
+    {"many_functions", Bench_ManyFunctions, 1000},
+    {"call_chain", Bench_CallChain, 128},
+    {"nested_scopes", Bench_NestedScopes, 128},
+};
+
+static errno_t Bench_Fail(const BenchShape *shape, const char *phase, Arena *arena, const errno_t err) {
+    fprintf(stderr, "%s: %s failed: %s\n", shape->name, phase, GetErrorString(err));
+    Arena_Destroy(arena);
+    return err;
+}
+
+static errno_t Bench_Run(const BenchShape *shape, const BenchSource *source, BenchResult *result) {
+    errno_t err;
+    Arena *arena = Arena_Create(ARENA_BLOCK_SIZE_DEFAULT);
+    VismutErrorInfo error_info = {0};
+    Tokenizer tokenizer = Tokenizer_Create((const uint8_t *) source->data, source->length,
+                                           (const uint8_t *) "bench.vismut", arena, &error_info);
+    ASTParser ast_parser = ASTParser_Create(&tokenizer);
+
+    const uint64_t start = Bench_Nanoseconds();
+    if ((err = ASTParser_Parse(&ast_parser)) != VISMUT_ERROR_OK) {
+        return Bench_Fail(shape, "parse", arena, err);
+    }
+    const uint64_t parsed = Bench_Nanoseconds();
+    result->parse_bytes = Arena_BytesUsed(arena);
+
+    if ((err = ASTModuleTypeAnalyze(arena, ast_parser.module)) != VISMUT_ERROR_OK) {
+        return Bench_Fail(shape, "analysis", arena, err);
+    }
+    const uint64_t analyzed = Bench_Nanoseconds();
+    result->analyze_bytes = Arena_BytesUsed(arena) - result->parse_bytes;
+
+    if ((err = ASTOptimize(arena, ast_parser.module)) != VISMUT_ERROR_OK) {
+        return Bench_Fail(shape, "optimization", arena, err);
+    }
+    const uint64_t optimized = Bench_Nanoseconds();
+    result->optimize_bytes = Arena_BytesUsed(arena) - result->parse_bytes - result->analyze_bytes;
+
+    result->parse_ns = parsed - start;
+    result->analyze_ns = analyzed - parsed;
+    result->optimize_ns = optimized - analyzed;
+    result->nodes_count = ast_parser.module->nodes_count;
+    Arena_Destroy(arena);
+    return VISMUT_ERROR_OK;
+}
+
+static double Bench_Milliseconds(const uint64_t ns) {
+    return (double) ns / 1e6;
+}
+
+int main(int argc, const char **argv) {
+    uint32_t scale = 1;
+    uint32_t repeat = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = (uint32_t) strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = (uint32_t) strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [--scale N] [--repeat N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (scale == 0 || repeat == 0) {
+        fprintf(stderr, "--scale and --repeat must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("{\n  \"version\": \"%s\",\n  \"scale\": %u,\n  \"repeat\": %u,\n  \"benchmarks\": [", VISMUT_VERSION,
+           scale, repeat);
+
+    // A shape that fails is left out and the others still run, the JSON stays complete and the exit code tells
+    errno_t failure = VISMUT_ERROR_OK;
+    uint32_t printed_count = 0;
+    const size_t shapes_count = sizeof(BENCH_SHAPES) / sizeof(BENCH_SHAPES[0]);
+    for (size_t i = 0; i < shapes_count; ++i) {
+        const BenchShape *shape = &BENCH_SHAPES[i];
+        const uint32_t size = shape->base_size * scale;
+
+        BenchSource source = {0};
+        shape->generate(&source, size);
+
+        // The fastest run of each phase is the least disturbed by the rest of the machine
+        BenchResult best = {0};
+        errno_t err = VISMUT_ERROR_OK;
+        for (uint32_t run = 0; run < repeat; ++run) {
+            BenchResult result = {0};
+            if ((err = Bench_Run(shape, &source, &result)) != VISMUT_ERROR_OK) {
+                break;
+            }
+            if (run == 0) {
+                best = result;
+                continue;
+            }
+            if (result.parse_ns < best.parse_ns) best.parse_ns = result.parse_ns;
+            if (result.analyze_ns < best.analyze_ns) best.analyze_ns = result.analyze_ns;
+            if (result.optimize_ns < best.optimize_ns) best.optimize_ns = result.optimize_ns;
+        }
+
+        if (err != VISMUT_ERROR_OK) {
+            failure = err;
+            free(source.data);
+            continue;
+        }
+
+        printf("%s\n    {\n", printed_count++ == 0 ? "" : ",");
+        printf("      \"name\": \"%s\",\n", shape->name);
+        printf("      \"size\": %u,\n", size);
+        printf("      \"source_bytes\": %zu,\n", source.length);
+        printf("      \"nodes\": %u,\n", best.nodes_count);
+        printf("      \"parse_ms\": %.3f,\n", Bench_Milliseconds(best.parse_ns));
+        printf("      \"analyze_ms\": %.3f,\n", Bench_Milliseconds(best.analyze_ns));
+        printf("      \"optimize_ms\": %.3f,\n", Bench_Milliseconds(best.optimize_ns));
+        printf("      \"arena_bytes\": {\"parse\": %zu, \"analyze\": %zu, \"optimize\": %zu}\n",
+               best.parse_bytes, best.analyze_bytes, best.optimize_bytes);
+        printf("    }");
+        free(source.data);
+    }
+    printf("\n  ]\n}\n");
+    return failure == VISMUT_ERROR_OK ? EXIT_SUCCESS : failure;
+}
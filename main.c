@@ -4,8 +4,12 @@
 
 #include "Vismut/core/ansi_colors.h"
 #include "Vismut/core/ast/ast_analyze.h"
+#include "Vismut/core/ast/ast_cache.h"
+#include "Vismut/core/ast/ast_compact.h"
 #include "Vismut/core/ast/ast_optimize.h"
 #include "Vismut/core/ast/ast_parse.h"
+#include "Vismut/core/ast/ast_print.h"
+#include "Vismut/core/ast/ast_range.h"
 #include "Vismut/core/errors/errors.h"
 #include "Vismut/core/codegen/codegen.h"
 #include "Vismut/core/codegen/run.h"
@@ -22,7 +26,31 @@ int main(int argc, const char **argv) {
 
     errno_t err;
 
-    const char *filename = argv[1] == NULL ? "..\\code.vismut" : argv[1];
+    // AST dumps are opt-in: --print-ast writes the tree to stdout, --dump-ast[=tree|sexpr] next to the source.
+    // --lazy-functions parses function bodies only once they are called
+    const char *filename = "..\\code.vismut";
+    bool print_ast = false;
+    bool dump_ast = false;
+    ASTPrintFormat dump_format = AST_PRINT_TREE;
+    bool lazy_functions = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--print-ast") == 0) {
+            print_ast = true;
+        } else if (strcmp(argv[i], "--dump-ast") == 0 || strcmp(argv[i], "--dump-ast=tree") == 0) {
+            dump_ast = true;
+            dump_format = AST_PRINT_TREE;
+        } else if (strcmp(argv[i], "--dump-ast=sexpr") == 0) {
+            dump_ast = true;
+            dump_format = AST_PRINT_SEXPR;
+        } else if (strcmp(argv[i], "--lazy-functions") == 0) {
+            lazy_functions = true;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            printf("Usage: %s [--print-ast] [--dump-ast[=tree|sexpr]] [--lazy-functions] <source>\n", argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            filename = argv[i];
+        }
+    }
     const size_t filename_len = strlen(filename);
 
     char c_filename[filename_len + 3];
@@ -37,17 +65,13 @@ int main(int argc, const char **argv) {
     exe_filename[filename_len + 2] = 'x';
     exe_filename[filename_len + 3] = 'e';
     exe_filename[filename_len + 4] = '\0';
-    char ast_filename[filename_len + 9];
-    memcpy(ast_filename, filename, strlen(filename));
-    ast_filename[filename_len] = '.';
-    ast_filename[filename_len + 1] = 'a';
-    ast_filename[filename_len + 2] = 's';
-    ast_filename[filename_len + 3] = 't';
-    ast_filename[filename_len + 4] = '.';
-    ast_filename[filename_len + 5] = 't';
-    ast_filename[filename_len + 6] = 'x';
-    ast_filename[filename_len + 7] = 't';
-    ast_filename[filename_len + 8] = '\0';
+    const char *ast_extension = dump_format == AST_PRINT_SEXPR ? ".ast.sexpr" : ".ast.txt";
+    char ast_filename[filename_len + sizeof(".ast.sexpr")];
+    memcpy(ast_filename, filename, filename_len);
+    memcpy(ast_filename + filename_len, ast_extension, strlen(ast_extension) + 1);
+    char vast_filename[filename_len + sizeof(".vast")];
+    memcpy(vast_filename, filename, filename_len);
+    memcpy(vast_filename + filename_len, ".vast", sizeof(".vast"));
 
     StringView text;
     if ((err = Reader_ReadFile(filename, &text)) != 0) {
@@ -57,38 +81,81 @@ int main(int argc, const char **argv) {
 
     Arena *arena = Arena_Create(ARENA_BLOCK_SIZE_DEFAULT);
 
-    VismutErrorInfo error_info = {0};
-    Tokenizer tokenizer = Tokenizer_Create(text.data, text.length, (uint8_t *) filename, arena, &error_info);
-    ASTParser ast_parser = ASTParser_Create(&tokenizer);
+    // An up to date .vast cache replaces the whole front end
+    ASTModule *module = NULL;
+    MappedFile cache_file = {0};
+    if (ASTCache_Load(arena, vast_filename, text, lazy_functions, &cache_file, &module) != VISMUT_ERROR_OK) {
+        VismutErrorInfo error_info = {0};
+        Tokenizer tokenizer = Tokenizer_Create(text.data, text.length, (uint8_t *) filename, arena, &error_info);
+        ASTParser ast_parser = ASTParser_Create(&tokenizer);
+        ast_parser.lazy_function_bodies = lazy_functions;
+
+        // A cache of an older source still holds the functions that did not change since
+        MappedFile previous_file = {0};
+        ASTModule *previous_module = NULL;
+        if (ASTCache_LoadPrevious(arena, vast_filename, &previous_file, &previous_module) == VISMUT_ERROR_OK) {
+            ast_parser.previous_module = previous_module;
+        }
+        err = ASTParser_Parse(&ast_parser);
+        if (previous_module != NULL) {
+            MappedFile_Close(&previous_file);
+        }
+        if (err != VISMUT_ERROR_OK) {
+            VismutErrorInfo_Print(error_info);
+            return err;
+        }
+
+        if ((err = ASTModuleTypeAnalyze(arena, ast_parser.module)) != VISMUT_ERROR_OK) {
+            printf("%s\n", GetErrorString(err));
+            return err;
+        }
+
+        if ((err = ASTOptimize(arena, ast_parser.module)) != VISMUT_ERROR_OK) {
+            printf("%s\n", GetErrorString(err));
+            return err;
+        }
+
+        // Only the live AST outlives the front end: the tokens, scopes and replaced nodes go with the old arena
+        Arena *module_arena = Arena_Create(ARENA_BLOCK_SIZE_DEFAULT);
+        if ((err = ASTModule_Compact(ast_parser.module, module_arena, &module)) != VISMUT_ERROR_OK) {
+            printf("%s\n", GetErrorString(err));
+            return err;
+        }
+        Arena_Destroy(arena);
+        arena = module_arena;
+
+        if ((err = ASTCache_Store(module, vast_filename, text, lazy_functions)) != VISMUT_ERROR_OK) {
+            printf("Cannot write AST cache: %s\n", GetErrorString(err));
+        }
+    }
 
-    if ((err = ASTParser_Parse(&ast_parser)) != VISMUT_ERROR_OK) {
-        VismutErrorInfo_Print(error_info);
-        return err;
+    if (print_ast) {
+        ASTNode_Print(module, module->root, stdout);
     }
 
-    if ((err = ASTModuleTypeAnalyze(arena, ast_parser.module_node)) != VISMUT_ERROR_OK) {
-        printf("%s\n", GetErrorString(err));
-        return err;
+    if (dump_ast) {
+        FILE *ast_file = fopen(ast_filename, "w");
+        if (ast_file == NULL) {
+            return EXIT_FAILURE;
+        }
+        ansi_enable_color(0);
+        ASTNode_PrintFormat(module, module->root, dump_format, ast_file);
+        fclose(ast_file);
     }
 
-    if ((err = ASTOptimize(arena, ast_parser.module_node)) != VISMUT_ERROR_OK) {
+    // Ranges of the final tree, which the optimizer has rewritten and hash-consed since its own pass
+    if ((err = ASTModule_InferRanges(module)) != VISMUT_ERROR_OK) {
         printf("%s\n", GetErrorString(err));
         return err;
     }
 
-    ASTNode_Print(ast_parser.module_node, stdout);
-
-    FILE *ast_file = fopen(ast_filename, "w");
-    ansi_enable_color(0);
-    ASTNode_Print(ast_parser.module_node, ast_file);
-
     FILE *file = fopen(c_filename, "wb");
     if (file == NULL) {
         return EXIT_FAILURE;
     }
-    CodeGen_GenerateFromAST(CodeGen_CreateContext(file, ast_parser.module_node->module.module_name),
-                            ast_parser.module_node);
+    CodeGen_GenerateFromAST(CodeGen_CreateContext(file, module));
     fclose(file);
+    MappedFile_Close(&cache_file);
     Arena_Destroy(arena);
     free(text.data);
 
@@ -0,0 +1,22 @@
+# Компилирует программу копией в WORK_DIR, запускает её и сверяет stdout с ожидаемым выводом.
+# Использование: cmake -DVISMUT=<компилятор> -DSOURCE=<.vismut> -DEXPECTED=<.expected> -DWORK_DIR=<каталог> -P ...
+get_filename_component(name ${SOURCE} NAME)
+file(MAKE_DIRECTORY ${WORK_DIR})
+# Кэш .vast прошлого запуска не должен подменять собранное дерево
+file(REMOVE ${WORK_DIR}/${name}.vast)
+configure_file(${SOURCE} ${WORK_DIR}/${name} COPYONLY)
+
+execute_process(
+        COMMAND ${VISMUT} ${WORK_DIR}/${name}
+        WORKING_DIRECTORY ${WORK_DIR}
+        OUTPUT_VARIABLE actual
+        RESULT_VARIABLE result
+)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${name}: vismut exited with ${result}\n${actual}")
+endif ()
+
+file(READ ${EXPECTED} expected)
+if (NOT actual STREQUAL expected)
+    message(FATAL_ERROR "${name}: output differs\n--- expected\n${expected}--- actual\n${actual}")
+endif ()